@@ -93,7 +93,7 @@ if ~check_path_exist(envi_toolbox_dir, pathCell)
         addpath(envi_mex_build_path,envi_mex_build_path2);
     else
         addpath(envi_mex_build_path,envi_mex_build_path2);
-        fprintf('Run envi/v3/lazy_mex/build/envi_v3_lazy_mex_compile_all.m to compile C/MEX sources.\n');
+        fprintf('Run envi/envi_v3_lazy_mex_compile_all_verX_v2.m to compile C/MEX sources.\n');
     end
 end
 
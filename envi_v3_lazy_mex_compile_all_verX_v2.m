@@ -42,6 +42,18 @@ end
 %%
 source_lib_filenames = { ...
     'envi_v2.c', ...
+    'envi_io.c', ...
+    'envi_ioplan.c', ...
+    'envi_copy.c', ...
+    'envi_transpose.c', ...
+    'envi_glt.c', ...
+    'envi_cache.c', ...
+    'envi_filepool.c', ...
+    'envi_hdr.c', ...
+    'envi_readplan.c', ...
+    'envi_uring.c', ...
+    'envi_direct.c', ...
+    'envi_tileiter.c', ...
 };
 
 lib_dir = envi_mex_libdir_path;
@@ -69,12 +81,13 @@ end
 
 %%
 source_filenames = { ...
-    ...'lazyenvireadRect_singleLayerRasterInt8_mex.c'  ,   ...
     'lazyenvireadRectxv2_multBandRaster_mex.c'   ,   ...
-    ...'lazyenvireadRect_singleLayerRasterInt16_mex.c' ,   ...
-    ...'lazyenvireadRect_singleLayerRasterSingle_mex.c',   ...
-    ...'lazyenvireadRect_singleLayerRasterUint16_mex.c',   ...
-    ...'lazyenvireadRect_singleLayerRasterUint8_mex.c'     ...
+    'envi_convert_interleave_mex.c'              ,   ...
+    'lazyenvireadPixelsx_multBandRaster_mex.c'   ,   ...
+    'lazyenvireadGLTx_multBandRaster_mex.c'      ,   ...
+    'lazyenvireadGLTProjx_multBandRaster_mex.c'  ,   ...
+    'img_proj_w_glt_mex.c'                       ,   ...
+    'envihdrreadx_mex.c'                             ...
 };
 
 api_wo_hyphen = lower(strip(compile_opt_api_char,'left','-'));
@@ -97,6 +110,12 @@ if ~exist(out_dir,'dir'), mkdir(out_dir); end
 static_libraries = cellfun(@(x) fullfile(lib_dir,x), ...
     out_filename_list,'UniformOutput',false);
 static_libraries = strjoin(static_libraries,' ');
+% the pread read mode of libenvi (envi_io.c, envi_ioplan.c) uses POSIX threads.
+if isunix()
+    link_libraries = {'-lpthread'};
+else
+    link_libraries = {};
+end
 for i=1:length(source_filenames)
     filename = source_filenames{i};
     fprintf('Compiling %s ...\n',filename);
@@ -105,7 +124,7 @@ for i=1:length(source_filenames)
         ...'GCC=''/software/gcc-6.3.0/bin/gcc''', ...
         ['CFLAGS="$CFLAGS -c -O3 -fPIC -ffast-math ' ...
          '-fno-strict-aliasing -Wno-unused-result -std=c99 -pedantic"'], ...
-        ['-I' envi_mex_include_path], ...
+        ['-I' envi_mex_include_path], link_libraries{:}, ...
         '-outdir',out_dir, mexCompileOpt{:});
 end
 
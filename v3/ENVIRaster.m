@@ -65,8 +65,14 @@ classdef ENVIRaster < handle
             obj.fid_img = fopen(obj.imgpath,'r');
         end
         function [] = fclose_img(obj)
-            fclose(obj.fid_img);
+            if obj.fid_img ~= -1
+                fclose(obj.fid_img);
+            end
             obj.fid_img = -1;
+            % the MEX readers keep their own handle on the image file.
+            if ~isempty(obj.imgpath)
+                envi_file_pool('close','IMGPATH',obj.imgpath);
+            end
         end
         function [tf] = isValid_sampleline(obj,smpl,ln)
             if smpl<0.5 || smpl>obj.hdr.samples+0.5 ...
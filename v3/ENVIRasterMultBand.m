@@ -75,6 +75,10 @@ classdef ENVIRasterMultBand < ENVIRaster
         %      replaced values for the pixels with data_ignore_value.
         %      (default) nan (for double and single precisions). Need
         %      to specify for integer precisions.
+        %  "READ_MODE": back-end of the read (see
+        %      lazyenvireadRectxv2_multBandRaster_mexw.m). Batch scans of
+        %      cubes that are not read again can use 'direct', which
+        %      streams the file around the page cache.
         function [img] = readimg(obj,varargin)
             if isempty(obj.hdr)
                 error('no img is found');
@@ -102,13 +106,35 @@ classdef ENVIRasterMultBand < ENVIRaster
             if any(size(s)~=size(l))
                 error('Input s and l has different shape');
             end
-            spc = lazyenvireadRectxv2_multBandRaster_mexw(...
-                obj.imgpath,obj.hdr,[s s],[l l],[1,obj.hdr.bands],varargin{:});
+            if numel(s)>1
+                % a list of pixels is read at once as [N x bands].
+                spc = obj.lazyEnviReadPixels(s,l,varargin{:});
+            else
+                spc = lazyenvireadRectxv2_multBandRaster_mexw(...
+                    obj.imgpath,obj.hdr,[s s],[l l],[1,obj.hdr.bands],varargin{:});
+            end
         end
         
         function spc = lazyEnviReadi(obj,s,l,varargin)
             spc = obj.lazyEnviRead(s,l,varargin{:});
-            spc = flip(spc,3);
+            spc = flip(spc,ndims(spc));
+        end
+        % lazyEnviReadPixels: read the spectra of the pixels (s(i),l(i)),
+        %   returned as [N x bands] in the order of the pixels. Each
+        %   distinct pixel is read once, in the order of the file.
+        function spc = lazyEnviReadPixels(obj,s,l,varargin)
+            if isempty(obj.hdr)
+                error('no img is found');
+            end
+            if numel(s)~=numel(l)
+                error('Input s and l has different number of elements');
+            end
+            spc = lazyenvireadPixelsx_multBandRaster_mexw(...
+                obj.imgpath,obj.hdr,s,l,[1,obj.hdr.bands],varargin{:});
+        end
+        function spc = lazyEnviReadPixelsi(obj,s,l,varargin)
+            spc = obj.lazyEnviReadPixels(s,l,varargin{:});
+            spc = flip(spc,2);
         end
         function imb = lazyEnviReadb(obj,b,varargin)
             if isempty(obj.hdr)
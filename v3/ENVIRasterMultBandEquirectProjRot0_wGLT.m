@@ -38,14 +38,29 @@ classdef ENVIRasterMultBandEquirectProjRot0_wGLT < ENVIRasterMultBandEquirectPro
         end
         
         function [img_proj] = readimg(obj,varargin)
-            [img] = obj.RasterSource.readimg(varargin{:});
-            [img_proj] = img_proj_w_glt(img,obj.GLTdata);
+            % the source image is projected from its file a group of 
+            % bands at a time, without loading the whole source cube.
+            glt = obj.get_glt();
+            [img_proj] = lazyenvireadGLTProjx_multBandRaster_mexw(...
+                obj.RasterSource.imgpath,obj.RasterSource.hdr,...
+                glt(:,:,1),glt(:,:,2),[1 obj.RasterSource.hdr.bands],...
+                varargin{:});
             if nargout<1
-                obj.img = img;
+                obj.img = img_proj;
                 obj.is_img_band_inverse = false;
             end
         end
         
+        function [glt] = get_glt(obj)
+            % [glt] = get_glt(obj)
+            % GLT image [lines x samples x 2], read if not loaded.
+            if isempty(obj.GLTdata.img)
+                glt = obj.GLTdata.readimg();
+            else
+                glt = obj.GLTdata.img;
+            end
+        end
+        
         function [spc,xf,yf] = lazyEnviRead(obj,s,l,varargin)
             xf = obj.GLTdata.img(l,s,1); yf = obj.GLTdata.img(l,s,2);
             if obj.isValid_sampleline(xf,yf)
@@ -62,7 +77,7 @@ classdef ENVIRasterMultBandEquirectProjRot0_wGLT < ENVIRasterMultBandEquirectPro
         
         function [imb_proj] = lazyEnviReadb(obj,b,varargin)
             [imb] = obj.RasterSource.lazyEnviReadb(b,varargin{:});
-            [imb_proj] = img_proj_w_glt(imb,obj.GLTdata);
+            [imb_proj] = img_proj_w_glt(imb,obj.get_glt());
         end
         
         function [imb_proj] = lazyEnviReadbi(obj,b,varargin)
@@ -101,6 +116,8 @@ classdef ENVIRasterMultBandEquirectProjRot0_wGLT < ENVIRasterMultBandEquirectPro
             % OUTPUTS
             %   subimage: a rectangle region of the image cube, data type
             %             depends on "Precision".
+            % OPTIONAL PARAMETERS
+            %   Refer "lazyenvireadGLTx_multBandRaster_mexw.m".
             
             if length(xrange)~=2 || length(yrange)~=2
                 error('Either the size of xrange or yrange is invalid');
@@ -109,20 +126,18 @@ classdef ENVIRasterMultBandEquirectProjRot0_wGLT < ENVIRasterMultBandEquirectPro
             if xrange(1)>xrange(2) || yrange(1)>yrange(2)
                 error('Either of the range is not in the right order');
             end
-            samplesc = xrange(2)-xrange(1)+1;
-            linesc = yrange(2)-yrange(1)+1;
-            bandsc = zrange(2)-zrange(1)+1; % band_offset = zrange(1)-1;
-            subimg = nan(linesc,samplesc,bandsc);
-            for yi=1:linesc
-                for xi=1:samplesc
-                    x=xrange(1)+xi-1; y=yrange(1)+yi-1;
-                    xf = obj.GLTdata.img(y,x,1);
-                    yf = obj.GLTdata.img(y,x,2);
-                    [subimg(yi,xi,:)] = ...
-                        obj.RasterSource.get_subimage_wPixelRange(...
-                        [xf xf],[yf yf],zrange,varargin{:});
-                end
+            if isempty(obj.GLTdata.img)
+                glt = obj.GLTdata.get_subimage_wPixelRange(xrange,yrange,...
+                    [1 2]);
+            else
+                glt = obj.GLTdata.img(yrange(1):yrange(2),...
+                    xrange(1):xrange(2),1:2);
             end
+            % the source pixels of the window are read at once, and the
+            % pixels without a source are filled with "FILL_VALUE" (NaN).
+            [subimg] = lazyenvireadGLTx_multBandRaster_mexw(...
+                obj.RasterSource.imgpath,obj.RasterSource.hdr,...
+                glt(:,:,1),glt(:,:,2),zrange,varargin{:});
         end
         
         function [] = set_rgb(obj,varargin)
@@ -51,7 +51,7 @@ else
     end
 end
 
-[precision_raw,sz,iscx] = envihdr_get_precision_sizeA_from_data_type(...
+[precision_raw] = envihdr_get_precision_sizeA_from_data_type(...
         hdr.data_type);
 
 if strcmpi(precision,'raw')
@@ -80,97 +80,14 @@ if ~exist(imgpath,'file')
 end
 
 %% Main processing
+% The v2 reader supports every ENVI data_type (complex ones included), 
+% converts the values into precision, replaces data_ignore_value, and 
+% writes the cube in [lines x samples x bands] while reading, whatever 
+% the interleave.
+img = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
+    [1 hdr.samples],[1 hdr.lines],[1 hdr.bands],'PRECISION',precision,...
+    'REPLACE_DATA_IGNORE_VALUE',rep_div,...
+    'REPVAL_DATA_IGNORE_VALUE',repval_div);
 
-interleave    = hdr.interleave;
-samples       = hdr.samples;
-lines         = hdr.lines;
-header_offset = hdr.header_offset;
-bands         = hdr.bands;
 
-switch hdr.byte_order
-    case {0}
-        byteorder = 'ieee-le';
-    case {1}
-        byteorder = 'ieee-be';
-    otherwise
-        byteorder = 'n';
-end
-
-
-switch iscx % if complex value or not.
-    case 0
-        switch lower(precision_raw)
-            case 'single'
-                img = lazyenvireadRect_multBandRasterSingle_mex(...
-                    imgpath,hdr,0,0,0,hdr.samples,hdr.lines,hdr.bands);
-            otherwise
-                fid = fopen(imgpath,'rb');
-                n = samples*lines*bands;
-                img = fread(fid, n, [precision_raw '=>' precision_raw], ...
-                    header_offset, byteorder);
-                fclose(fid);
-                switch lower(interleave)
-                    case {'bsq'}
-                        img = reshape(img,[samples,lines,bands]);
-                    case {'bil'}
-                        img = reshape(img,[samples,bands,lines]);
-                    case {'bip'}
-                        img = reshape(img,[bands,samples,lines]);
-                end
-        end
-    case 1
-        % not tested well.
-        fid = fopen(imgpath,'rb');
-        n = samples*lines*bands;
-        img = fread(fid, n*2, [precision_raw '=>' precision_raw],...
-            header_offset, byteorder);
-        img = complex(img(1:2:end),img(2:2:end));
-        fclose(fid);
-end
-
-
-switch lower(interleave)
-    case {'bsq'}
-        img = permute(img,[2,1,3]);
-    case {'bil'}
-        img = permute(img,[3,1,2]);
-    case {'bip'}
-        img = permute(img,[3,2,1]);
 end
-
-%% Post processing
-switch lower(precision)
-    case 'double'
-        img = double(img);
-    case 'single'
-        img = single(img);
-    case 'int8'
-        img = int8(img);
-    case 'int16'
-        img = int16(img);
-    case 'int32'
-        img = int32(img);
-    case 'int64'
-        img = int64(img);
-    case 'uint8'
-        img = uint8(img);
-    case 'uint16'
-        img = uint16(img);
-    case 'uint32'
-        img = uint32(img);
-    case 'uint64'
-        img = uint64(img);
-    case 'raw'
-        % not changing data_type
-    otherwise
-        error('Undefined precision %d',precision);
-end
-
-if rep_div && isfield(hdr,'data_ignore_value')
-    div = cast(hdr.data_ignore_value,class(img));
-    repval_div = cast(repval_div,class(img));
-    img(img==div) = repval_div;
-end
-
-
-end
\ No newline at end of file
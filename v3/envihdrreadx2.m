@@ -42,58 +42,16 @@ function hdr = envihdrreadx2(hdrpath)
 %     end
 % end
 
-cmout = '^;.*$'; % added by Yuki for read commented out parameters
-fid = fopen(hdrpath);
-while true
-    line = fgetl(fid);
-    if line == -1
-        break
-    else
-        if ~isempty(regexp(line,cmout))
-            line = line(2:end);
-        end
-        eqsn = strfind(line,'=');
-        if ~isempty(eqsn)
-            param = strtrim(line(1:eqsn(1)-1));
-            param(strfind(param,':')) = '_';
-            param(strfind(param,' ')) = '_';
-            param(strfind(param,'(')) = '';
-            param(strfind(param,')')) = '';
-            param(strfind(param,'/')) = '';
-            value = strtrim(line(eqsn(1)+1:end));
-            if strcmpi(param,'description')
-                if ~isempty(strfind(value,'{')) && isempty(strfind(value,'}'))
-                    while isempty(strfind(line,'}'))
-                        line = fgetl(fid);
-                        value = [value;{line}];
-                    end
-                end
-                hdr.(param)=value;
-            elseif isnan(str2double(value))
-                if ~isempty(strfind(value,'{')) && isempty(strfind(value,'}'))
-                    while isempty(strfind(line,'}'))
-                        line = fgetl(fid);
-                        value = [value,strtrim(line)];
-                    end
-                end
-                hdr.(param)=value;
-                % edited by Yuki below
-%                 eval(['info.',param,' = ''',value,''';'])
-            elseif strcmp(param,'cat_crism_obsid')
-                % added by Yuki on May 31 2017
-                hdr.(param) = value;
-            elseif strcmp(param,'cat_sclk_start')
-                % added by Yuki on May 31 2017
-                hdr.(param) = value;
-            else
-                hdr.(param) = str2num(value);
-            end
-        end
-    end
+% the native parser (envihdrreadx_mex.c) is used when it is compiled; it
+% returns band_names, spectra_names, wavelength, fwhm, default_bands and
+% bbl already split.
+if exist('envihdrreadx_mex','file')==3
+    hdr = envihdrreadx_mex(hdrpath);
+else
+    hdr = envihdrreadx_parse(hdrpath);
 end
-fclose(fid);
 
-if isfield(hdr,'band_names')
+if isfield(hdr,'band_names') && ischar(hdr.band_names)
     line = hdr.band_names;
     line = line(2:end-1);
     line = strsplit(line,',');
@@ -102,7 +60,7 @@ if isfield(hdr,'band_names')
     end
     hdr.band_names = line;
 end
-if isfield(hdr,'spectra_names')
+if isfield(hdr,'spectra_names') && ischar(hdr.spectra_names)
     line = hdr.spectra_names;
     line = line(2:end-1);
     line = strsplit(line,',');
@@ -164,23 +122,23 @@ if isfield(hdr,'pixel_size')
     hdr.pixel_size.units = line{3}(7:end);
 end
 
-if isfield(hdr,'wavelength')
+if isfield(hdr,'wavelength') && ischar(hdr.wavelength)
     % info.wavelength = sscanf(info.wavelength(2:end-1),'%f,')';
     % strip the curly bracket
     hdr.wavelength = envihdr_testsplit_numeric_array(hdr.wavelength);
 end
 
-if isfield(hdr,'fwhm')
+if isfield(hdr,'fwhm') && ischar(hdr.fwhm)
     % info.fwhm = sscanf(info.fwhm(2:end-1),'%f,')';
     hdr.fwhm = envihdr_testsplit_numeric_array(hdr.fwhm);
 end
 
-if isfield(hdr,'default_bands')
+if isfield(hdr,'default_bands') && ischar(hdr.default_bands)
     % info.default_bands = sscanf(info.default_bands(2:end-1),'%d,')';
     hdr.default_bands = envihdr_testsplit_numeric_array(hdr.default_bands);
 end
 
-if isfield(hdr,'bbl')
+if isfield(hdr,'bbl') && ischar(hdr.bbl)
     % info.bbl = sscanf(info.bbl(2:end-1),'%d,')';
     hdr.bbl = envihdr_testsplit_numeric_array(hdr.bbl);
 end
@@ -203,4 +161,59 @@ value = regexpi(str_numar,ptrn_array,'names');
 value = {value.element};
 value = str2double(value);
 numar = value;
-end
\ No newline at end of file
+end
+
+function [hdr] = envihdrreadx_parse(hdrpath)
+% parse the fields of the header file line by line.
+hdr = struct();
+cmout = '^;.*$'; % added by Yuki for read commented out parameters
+fid = fopen(hdrpath);
+while true
+    line = fgetl(fid);
+    if line == -1
+        break
+    else
+        if ~isempty(regexp(line,cmout))
+            line = line(2:end);
+        end
+        eqsn = strfind(line,'=');
+        if ~isempty(eqsn)
+            param = strtrim(line(1:eqsn(1)-1));
+            param(strfind(param,':')) = '_';
+            param(strfind(param,' ')) = '_';
+            param(strfind(param,'(')) = '';
+            param(strfind(param,')')) = '';
+            param(strfind(param,'/')) = '';
+            value = strtrim(line(eqsn(1)+1:end));
+            if strcmpi(param,'description')
+                if ~isempty(strfind(value,'{')) && isempty(strfind(value,'}'))
+                    while isempty(strfind(line,'}'))
+                        line = fgetl(fid);
+                        value = [value;{line}];
+                    end
+                end
+                hdr.(param)=value;
+            elseif isnan(str2double(value))
+                if ~isempty(strfind(value,'{')) && isempty(strfind(value,'}'))
+                    while isempty(strfind(line,'}'))
+                        line = fgetl(fid);
+                        value = [value,strtrim(line)];
+                    end
+                end
+                hdr.(param)=value;
+                % edited by Yuki below
+%                 eval(['info.',param,' = ''',value,''';'])
+            elseif strcmp(param,'cat_crism_obsid')
+                % added by Yuki on May 31 2017
+                hdr.(param) = value;
+            elseif strcmp(param,'cat_sclk_start')
+                % added by Yuki on May 31 2017
+                hdr.(param) = value;
+            else
+                hdr.(param) = str2num(value);
+            end
+        end
+    end
+end
+fclose(fid);
+end
@@ -0,0 +1,68 @@
+function [img_proj] = img_proj_w_glt(img,GLTdata,varargin)
+% [img_proj] = img_proj_w_glt(img,GLTdata,varargin)
+%  Project an image cube or a band stack through a geometric lookup table
+%  (GLT). The projection is performed by a MEX function, with the output
+%  lines split across threads.
+%  *INPUTS*
+%    img: source image [lines x samples x bands], numeric or logical
+%    GLTdata: GLT, either an ENVIRaster object of the GLT image or an
+%      array [Lo x So x 2] whose first and second layers are the source
+%      samples and lines (1-based) of the projected pixels. The pixels
+%      whose source sample or line is out of the source image (0, NaN, ...)
+%      have no source.
+%  *OUTPUTS*
+%    img_proj: projected image [Lo x So x bands], class of img
+%  OPTIONAL Parameters
+%   "FILL_VALUE": value of the pixels without a source, cast to the class
+%      of img.
+%      (default) nan (false for logical images)
+%   "GLT_NEGATIVE_ABS": boolean, whether negative GLT entries (pixels ENVI
+%      filled with their nearest neighbor) refer to the source pixel of
+%      their absolute value (true) or have no source (false).
+%      (default) false
+%   "NUM_THREADS": integer, number of threads. 0 uses the number of
+%      available processors.
+%      (default) 0
+%
+% Copyright (C) 2021 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+fill_value  = nan;
+glt_neg_abs = false;
+num_threads = 0;
+if (rem(length(varargin),2)==1)
+    error('Optional parameters should always go by pairs');
+else
+    for i=1:2:(length(varargin)-1)
+        switch upper(varargin{i})
+            case 'FILL_VALUE'
+                fill_value = varargin{i+1};
+            case 'GLT_NEGATIVE_ABS'
+                glt_neg_abs = varargin{i+1};
+            case 'NUM_THREADS'
+                num_threads = varargin{i+1};
+            otherwise
+                error('Unrecognized option: %s',varargin{i});
+        end
+    end
+end
+
+if isnumeric(GLTdata)
+    glt = GLTdata;
+elseif isempty(GLTdata.img)
+    glt = GLTdata.readimg();
+else
+    glt = GLTdata.img;
+end
+
+if islogical(img)
+    fill = false;
+else
+    % cast maps NaN to 0 for integer classes.
+    fill = cast(fill_value,class(img));
+end
+
+[img_proj] = img_proj_w_glt_mex(img,double(glt(:,:,1)),double(glt(:,:,2)),...
+    fill,logical(glt_neg_abs),num_threads);
+
+end
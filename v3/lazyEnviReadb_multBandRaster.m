@@ -43,18 +43,18 @@ switch upper(idx_mode)
         imb = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
             [1 hdr.samples],[1,hdr.lines], b, varargin{:});
     case 'DIRECT'
-        if issorted(b)
+        if all(diff(b(:))>0)
             brange = ind2rangelist(b);
             imb = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
                 [1 hdr.samples],[1,hdr.lines], brange, varargin{:});
         else
-            [b_sortd,~] = sort(b);
-            brange = ind2rangelist(b_sortd);
+            % each distinct band is read once, in file order, and written
+            % by the MEX function to every output band requesting it.
+            [b_unq,~,band_index] = unique(b(:));
+            brange = ind2rangelist(b_unq);
             imb = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
-                [1 hdr.samples],[1,hdr.lines], brange, varargin{:});
-            indx_out = rangelist2ind(brange);
-            [~,rindx_mapper] = ismember(b,indx_out); % this is to deal with duplications.
-            imb = imb(:,:,rindx_mapper);
+                [1 hdr.samples],[1,hdr.lines], brange, varargin{:}, ...
+                'BAND_INDEX', band_index);
         end
     otherwise
         error('Undefined INDEX_MODE %s',idx_mode);
@@ -0,0 +1,244 @@
+/* =====================================================================
+ * envi_bench.c
+ * Time the reads of an ENVI image with libenvi, without MATLAB.
+ *
+ * USAGE:
+ *   envi_bench [options] hdrpath imgpath
+ *
+ * OPTIONS:
+ *   -m mode       read mode: fread, mmap, pread, uring, direct or default
+ *                 (default)
+ *   -t threads    number of threads of the pread mode (default 0: auto)
+ *   -q depth      queue depth of the uring mode (default 0: 64)
+ *   -g gap        coalesce gap (bytes) of the I/O plans
+ *   -p precision  class of the output ('double', 'single', ..., 'raw')
+ *   -n nrep       number of repetitions (default 3)
+ *   -c capacity   capacity (MiB) of the block cache (default 0: disabled)
+ *   -r s0,s1,l0,l1,b0,b1
+ *                 rectangle to read (0-based, inclusive), the whole image
+ *                 by default
+ *   -P            prepare the read once (see envi_readplan.h) and execute
+ *                 the prepared read at each repetition
+ *
+ * Each repetition reads the rectangle into a [lines x samples x bands]
+ * array and prints the elapsed time, the throughput against the bytes
+ * used, and the statistics of the I/O plan.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "envi_io.h"
+#include "envi_cache.h"
+#include "envi_readplan.h"
+
+static double envi_bench_now(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void envi_bench_usage(void)
+{
+    fprintf(stderr,
+        "usage: envi_bench [-m mode] [-t threads] [-q depth] [-g gap]\n"
+        "                  [-p precision] [-n nrep] [-c capacity_MiB]\n"
+        "                  [-r s0,s1,l0,l1,b0,b1] [-P]\n"
+        "                  hdrpath imgpath\n");
+}
+
+int main(int argc, char *argv[])
+{
+    EnviHeader hdr;
+    EnviReadOption opt;
+    EnviCopyKernel kernel;
+    EnviIOPlanStats stats;
+    EnviReadPlan rp;
+    const char *hdrpath, *imgpath;
+    long int rect[6];
+    long int smpl_skip, line_skip, band_skip;
+    long int smpl_skip_last, line_skip_last, band_skip_last;
+    size_t smpl_read, line_read, band_read;
+    size_t dims[3], sz, nrep, rep, capacity;
+    void *subimg;
+    double t0, t1;
+    int i, errflg;
+    bool has_rect, prepared;
+
+    envi_read_option_init(&opt);
+    nrep = 3;
+    capacity = 0;
+    has_rect = false;
+    prepared = false;
+    for(i=1;i<argc-1 && argv[i][0]=='-';i+=2){
+        /* flags without a value */
+        if(argv[i][1] == 'P'){
+            prepared = true;
+            i--;
+            continue;
+        }
+        switch(argv[i][1]){
+            case 'm':
+                if(strcmp(argv[i+1],"fread") == 0)
+                    opt.read_mode = ENVI_READ_FREAD;
+                else if(strcmp(argv[i+1],"mmap") == 0)
+                    opt.read_mode = ENVI_READ_MMAP;
+                else if(strcmp(argv[i+1],"pread") == 0)
+                    opt.read_mode = ENVI_READ_PREAD;
+                else if(strcmp(argv[i+1],"uring") == 0)
+                    opt.read_mode = ENVI_READ_URING;
+                else if(strcmp(argv[i+1],"direct") == 0)
+                    opt.read_mode = ENVI_READ_DIRECT;
+                else if(strcmp(argv[i+1],"default") != 0){
+                    envi_bench_usage();
+                    return 1;
+                }
+                break;
+            case 't': opt.num_threads = (size_t) atol(argv[i+1]); break;
+            case 'q': opt.queue_depth = (size_t) atol(argv[i+1]); break;
+            case 'g': opt.coalesce_gap = (size_t) atol(argv[i+1]); break;
+            case 'n': nrep = (size_t) atol(argv[i+1]); break;
+            case 'c': capacity = (size_t) atol(argv[i+1]) << 20; break;
+            case 'p':
+                opt.precision = envi_get_data_type_from_precision(argv[i+1]);
+                if(opt.precision < 0){
+                    envi_bench_usage();
+                    return 1;
+                }
+                break;
+            case 'r':
+                if(sscanf(argv[i+1], "%ld,%ld,%ld,%ld,%ld,%ld", &rect[0],
+                        &rect[1], &rect[2], &rect[3], &rect[4],
+                        &rect[5]) != 6){
+                    envi_bench_usage();
+                    return 1;
+                }
+                has_rect = true;
+                break;
+            default:
+                envi_bench_usage();
+                return 1;
+        }
+    }
+    if(argc - i != 2){
+        envi_bench_usage();
+        return 1;
+    }
+    hdrpath = argv[i];
+    imgpath = argv[i+1];
+
+    errflg = envi_header_read(&hdr, hdrpath);
+    if(errflg != 0){
+        fprintf(stderr, "%s: %s\n", hdrpath, (errflg == ENVI_ERR_SIZE)
+            ? "Not a valid ENVI header" : envi_strerror(errflg));
+        return 1;
+    }
+    if(capacity > 0 && envi_cache_configure(capacity, 0) != 0){
+        fprintf(stderr, "The block cache is not supported.\n");
+        return 1;
+    }
+    if(capacity > 0 && opt.read_mode != ENVI_READ_PREAD)
+        opt.read_mode = envi_read_mode_default();
+    if(!has_rect){
+        rect[0] = 0; rect[1] = hdr.samples - 1;
+        rect[2] = 0; rect[3] = hdr.lines - 1;
+        rect[4] = 0; rect[5] = hdr.bands - 1;
+    }
+    if(rect[0] < 0 || rect[1] < rect[0] || rect[1] >= hdr.samples
+            || rect[2] < 0 || rect[3] < rect[2] || rect[3] >= hdr.lines
+            || rect[4] < 0 || rect[5] < rect[4] || rect[5] >= hdr.bands){
+        fprintf(stderr, "The rectangle is out of the image.\n");
+        return 1;
+    }
+    smpl_skip = rect[0]; smpl_read = (size_t) (rect[1] - rect[0] + 1);
+    smpl_skip_last = hdr.samples - 1 - rect[1];
+    line_skip = rect[2]; line_read = (size_t) (rect[3] - rect[2] + 1);
+    line_skip_last = hdr.lines - 1 - rect[3];
+    band_skip = rect[4]; band_read = (size_t) (rect[5] - rect[4] + 1);
+    band_skip_last = hdr.bands - 1 - rect[5];
+    dims[0] = line_read; dims[1] = smpl_read; dims[2] = band_read;
+
+    sz = envi_get_data_type_size(hdr.data_type);
+    if(sz == 0){
+        fprintf(stderr, "data_type=%d is not supported.\n", hdr.data_type);
+        return 1;
+    }
+    envi_copy_kernel_init(&kernel, hdr, &opt, NULL);
+    subimg = malloc(dims[0]*dims[1]*dims[2]*kernel.dst_sz);
+    if(subimg == NULL){
+        fprintf(stderr, "%s\n", envi_strerror(ENVI_ERR_NOMEM));
+        return 1;
+    }
+
+    printf("%s: %d x %d x %d, data_type %d, %s\n", imgpath, hdr.samples,
+        hdr.lines, hdr.bands, hdr.data_type,
+        (hdr.interleave == BSQ) ? "bsq" :
+        ((hdr.interleave == BIL) ? "bil" : "bip"));
+    if(prepared){
+        t0 = envi_bench_now();
+        errflg = envi_readplan_create(&rp, hdr, &smpl_skip, &smpl_read, 1,
+                    &line_skip, &line_read, 1, &band_skip, &band_read, 1,
+                    NULL, 0, &opt);
+        t1 = envi_bench_now();
+        if(errflg != 0){
+            fprintf(stderr, "%s: %s\n", hdrpath, envi_strerror(errflg));
+            free(subimg);
+            return 1;
+        }
+        printf("prepare: %.6f s\n", t1 - t0);
+    }
+    for(rep=0;rep<nrep;rep++){
+        memset(&stats, 0, sizeof(EnviIOPlanStats));
+        t0 = envi_bench_now();
+        if(prepared)
+            errflg = envi_readplan_execute(&rp, imgpath, subimg, NULL,
+                        &stats);
+        else
+            errflg = lazyenvireadRectx_multBand_auto((char*) imgpath, hdr,
+                &smpl_skip, &smpl_read, 1, smpl_skip_last,
+                &line_skip, &line_read, 1, line_skip_last,
+                &band_skip, &band_read, 1, band_skip_last,
+                subimg, dims, sz, &opt, &stats);
+        t1 = envi_bench_now();
+        if(errflg != 0){
+            fprintf(stderr, "%s: %s\n", imgpath, envi_strerror(errflg));
+            if(prepared)
+                envi_readplan_free(&rp);
+            free(subimg);
+            return 1;
+        }
+        printf("rep %zu: %.6f s, %.1f MiB/s, syscalls %zu, copies %zu, "
+            "read %zu B, used %zu B\n", rep, t1 - t0,
+            (double) stats.nbytes_used / (1024.0*1024.0) / (t1 - t0),
+            stats.n_syscalls, stats.n_copies, stats.nbytes_read,
+            stats.nbytes_used);
+    }
+    if(prepared)
+        envi_readplan_free(&rp);
+    free(subimg);
+    envi_cache_free();
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* envi_cache.h */
+#ifndef ENVI_CACHE_H
+#define ENVI_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ENVI_CACHE_BLOCK_SIZE: default size (bytes) of the blocks of the files
+ * held by the block cache. Blocks are aligned to multiples of it in the
+ * file. ENVI_CACHE_CAPACITY_DEFAULT: capacity (bytes) of the cache when it
+ * is enabled without a capacity. */
+#ifndef ENVI_CACHE_BLOCK_SIZE
+#define ENVI_CACHE_BLOCK_SIZE (256*1024)
+#endif
+#ifndef ENVI_CACHE_CAPACITY_DEFAULT
+#define ENVI_CACHE_CAPACITY_DEFAULT (256*1024*1024)
+#endif
+
+/* EnviCacheFile
+ *  An open file and its version. The blocks of a file are identified by
+ *  the device and inode, and are valid while the size, the modification
+ *  and the status change times are those of the version. */
+typedef struct EnviCacheFile {
+    int fd;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    int64_t ctime;
+} EnviCacheFile ;
+
+/* EnviCacheStats
+ *  Counters of the cache since it was configured or cleared: the blocks
+ *  found (hits) and read from the file (misses), the bytes copied out of
+ *  cached blocks and read from the file into them, the bytes read around
+ *  the cache (reads larger than half of the capacity), and the blocks
+ *  evicted or invalidated (file changed). nblocks and nbytes are the
+ *  current contents. */
+typedef struct EnviCacheStats {
+    size_t capacity;
+    size_t block_size;
+    size_t nblocks;
+    size_t nbytes;
+    size_t hits;
+    size_t misses;
+    size_t bytes_hit;
+    size_t bytes_miss;
+    size_t bytes_bypass;
+    size_t evictions;
+    size_t invalidations;
+} EnviCacheStats ;
+
+/* function : envi_cache_configure
+ *  Set the capacity (bytes) and the block size (bytes, 0:
+ *  ENVI_CACHE_BLOCK_SIZE) of the process-wide block cache. The cache is
+ *  emptied. A capacity of 0 disables the cache and frees its memory.
+ *  Returns 0 on success, -1 if the cache is not supported on the
+ *  platform (no POSIX pread), and -5 if memory allocation failed. */
+extern int envi_cache_configure(size_t capacity, size_t block_size);
+
+/* function : envi_cache_clear
+ *  Drop all the blocks and reset the counters, keeping the configuration.
+ */
+extern void envi_cache_clear(void);
+
+/* function : envi_cache_free
+ *  Disable the cache and free its memory (envi_cache_configure(0,0)). */
+extern void envi_cache_free(void);
+
+extern bool envi_cache_enabled(void);
+extern void envi_cache_get_stats(EnviCacheStats *stats);
+
+/* function : envi_cache_file_init
+ *  Get the version of the file open as fd, and invalidate the cached 
+ *  blocks of the same file with another version (in constant time; they
+ *  are freed as they are found or evicted).
+ *  Returns 0 on success and -1 if the file cannot be stat'ed. */
+extern int envi_cache_file_init(EnviCacheFile *file, int fd);
+
+/* function : envi_cache_pread
+ *  Read nbytes bytes at offset of the file into dst through the cache:
+ *  the blocks overlapping the range are copied from the cache, or read
+ *  from the file whole (LRU blocks are evicted to stay within the
+ *  capacity). The range needs to be inside the file. The cache is safe
+ *  to use from several threads.
+ *  Returns 0 on success and -4 if reading the file failed, -5 if memory
+ *  allocation failed. */
+extern int envi_cache_pread(const EnviCacheFile *file, char *dst,
+        size_t nbytes, uint64_t offset);
+
+#endif
@@ -0,0 +1,106 @@
+/* envi_copy.h */
+#ifndef ENVI_COPY_H
+#define ENVI_COPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* EnviCopyKernel
+ *  Transformation applied to the elements while they are copied out of 
+ *  the read buffers. src_type and dst_type are ENVI data_type codes of 
+ *  the (real and imaginary) parts in the file and in subimg, which have 
+ *  ncomp parts per element (2 for complex data). swap_sz is the size of 
+ *  the words whose bytes are reversed before the conversion (0: none). 
+ *  src_sz and dst_sz are the element sizes (bytes) in the file and in 
+ *  subimg. 
+ *  If check_div is true, the elements are compared with the data ignore 
+ *  value div (stored in src_type) before the conversion. If replace_div is
+ *  true, the matching elements are replaced with repval (stored in 
+ *  dst_type), and if valid is not NULL, valid[i] is set to false for the
+ *  matching i-th element of subimg (dst_base) and true otherwise. */
+typedef struct EnviCopyKernel {
+    int32_t src_type;
+    int32_t dst_type;
+    size_t ncomp;
+    size_t swap_sz;
+    size_t src_sz;
+    size_t dst_sz;
+    bool check_div;
+    bool replace_div;
+    unsigned char div[8];
+    unsigned char repval[8];
+    char *dst_base;
+    bool *valid;
+} EnviCopyKernel ;
+
+/* ENVI_COPY_CHUNK: size (bytes) of the stack buffer in which elements are
+ * byte-swapped before they are converted. It also bounds the number of 
+ * elements compared with the data ignore value at a time. */
+#ifndef ENVI_COPY_CHUNK
+#define ENVI_COPY_CHUNK 4096
+#endif
+
+/* ENVI_COPY_SHORT_RUN: number of elements below which the specialized
+ * copies (see envi_copy_kernel_fn) move the elements one by one with 
+ * fixed-width loads and stores instead of calling memcpy or the SIMD 
+ * byte swap. */
+#ifndef ENVI_COPY_SHORT_RUN
+#define ENVI_COPY_SHORT_RUN 16
+#endif
+
+/* EnviCopyFn
+ *  Copy of n elements from src to dst applying kernel (see 
+ *  envi_copy_kernel_apply). */
+typedef void (*EnviCopyFn)(const EnviCopyKernel *kernel, void *dst,
+        const void *src, size_t n);
+
+/* function : envi_memcpy_swap
+ *  Copy n elements of sz bytes (1, 2, 4, or 8) from src to dst reversing
+ *  the byte order of each element. The bytes are shuffled with AVX2 or
+ *  SSSE3 (pshufb) on x86 and with NEON on ARM when available, and with a
+ *  scalar loop otherwise. dst may be identical to src (in-place swap),
+ *  but they may not overlap otherwise. */
+extern void envi_memcpy_swap(void *dst, const void *src, size_t n, size_t sz);
+
+/* function : envi_copy_swap
+ *  Copy nbytes bytes from src to dst, reversing the byte order of each 
+ *  word of swap_sz bytes. swap_sz is the size of the element, or of its
+ *  real and imaginary parts for complex data. No swap is performed if 
+ *  swap_sz is 0 or 1. */
+extern void envi_copy_swap(void *dst, const void *src, size_t nbytes,
+        size_t swap_sz);
+
+/* function : envi_copy_kernel_is_plain
+ *  Evaluate if the kernel does not change the data type, i.e., the data 
+ *  can be read directly into subimg and swapped in place. */
+extern bool envi_copy_kernel_is_plain(const EnviCopyKernel *kernel);
+
+/* function : envi_copy_kernel_set_div
+ *  Set up the comparison with the data ignore value div (NaN: none) for 
+ *  the kernel writing into dst_base. The comparison is performed on the 
+ *  values in the file: floating point values are compared with div 
+ *  rounded to their type (e.g. -1.23e34 for float32 images), and integer
+ *  values with div only if it is representable in their type (otherwise
+ *  nothing matches). Complex data are not compared. */
+extern void envi_copy_kernel_set_div(EnviCopyKernel *kernel, double div,
+        bool replace, double repval, bool *valid, void *dst_base);
+
+/* function : envi_copy_kernel_apply
+ *  Copy n elements from src to dst applying the kernel. Values are 
+ *  converted as MATLAB casts them: integer results are rounded to the 
+ *  nearest (halves away from zero) and saturated, and NaN becomes 0. 
+ *  The data ignore value is replaced on the way (see EnviCopyKernel).
+ *  dst may be identical to src only if the kernel is plain. */
+extern void envi_copy_kernel_apply(const EnviCopyKernel *kernel, void *dst,
+        const void *src, size_t n);
+
+/* function : envi_copy_kernel_fn
+ *  Copy function for the kernel, looked up once before a loop over many
+ *  short runs. Plain kernels (no conversion, no data ignore value) get a
+ *  copy specialized at compile time on the element size and the size of
+ *  the swapped words, from a dispatch table; the other kernels get 
+ *  envi_copy_kernel_apply. */
+extern EnviCopyFn envi_copy_kernel_fn(const EnviCopyKernel *kernel);
+
+#endif
@@ -0,0 +1,40 @@
+/* envi_direct.h
+ *  Streaming back-end of the I/O plans for scans of whole cubes that are
+ *  not read again: the file is read with O_DIRECT (F_NOCACHE on macOS),
+ *  so that the scan does not evict the page cache of the other users of
+ *  the node. The segments are read in aligned windows, double-buffered so
+ *  that the read of a window overlaps the copy of the previous one. */
+#ifndef ENVI_DIRECT_H
+#define ENVI_DIRECT_H
+
+#include <stddef.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_transpose.h"
+
+/* ENVI_DIRECT_ALIGN: alignment (bytes) of the file offsets, the sizes and
+ * the buffers of the O_DIRECT reads (a multiple of the logical block size
+ * of the usual devices). ENVI_DIRECT_WINDOW: size (bytes) of each of the
+ * two buffers (at least max_segment of the plan plus two alignments). */
+#ifndef ENVI_DIRECT_ALIGN
+#define ENVI_DIRECT_ALIGN 4096
+#endif
+#ifndef ENVI_DIRECT_WINDOW
+#define ENVI_DIRECT_WINDOW (8*1024*1024)
+#endif
+
+/* function : envi_ioplan_execute_direct
+ *  Same as envi_ioplan_execute, with the segments of the plan read from
+ *  imgpath in windows of consecutive segments, each window read with one
+ *  aligned O_DIRECT pread into one of two buffers of an aligned arena
+ *  while the previous window is copied into the stage by the calling
+ *  thread. If the file system rejects O_DIRECT (e.g., tmpfs), the windows
+ *  are read from fd (an open descriptor of imgpath) instead, and dropped
+ *  from the page cache once copied (POSIX_FADV_DONTNEED). The block cache
+ *  of the plan is ignored.
+ *  Returns 0 on success, -4 if reading failed, and -5 if memory
+ *  allocation failed. */
+extern int envi_ioplan_execute_direct(const EnviIOPlan *plan,
+        const char *imgpath, int fd, char *subimg, const EnviLayout *layout);
+
+#endif
@@ -0,0 +1,76 @@
+/* envi_filepool.h */
+#ifndef ENVI_FILEPOOL_H
+#define ENVI_FILEPOOL_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* ENVI_FILEPOOL_SIZE: default number of image files kept open across
+ * reads by the file pool. */
+#ifndef ENVI_FILEPOOL_SIZE
+#define ENVI_FILEPOOL_SIZE 16
+#endif
+
+/* EnviFile
+ *  An image file open for reading: the stream fid, its descriptor fd 
+ *  (-1 where there are no descriptors) and the size of the file (bytes).
+ *  stream tells whether the caller uses fid. entry is the
+ *  entry of the pool holding the file, or NULL if the file is not pooled
+ *  and is closed by envi_file_close. */
+typedef struct EnviFile {
+    FILE *fid;
+    int fd;
+    size_t size;
+    bool stream;
+    struct EnviFilePoolEntry *entry;
+} EnviFile ;
+
+/* EnviFilePoolStats
+ *  Counters of the pool since it was configured: the opens served by a
+ *  pooled file (hits) and by opening the file (misses), the pooled files
+ *  reopened because the file at their path changed (replaced, resized or
+ *  modified), and the pooled files closed to make room for others. nopen
+ *  is the current number of pooled files. */
+typedef struct EnviFilePoolStats {
+    size_t capacity;
+    size_t nopen;
+    size_t hits;
+    size_t misses;
+    size_t reopens;
+    size_t evictions;
+} EnviFilePoolStats ;
+
+/* function : envi_file_open
+ *  Open the image file at path, reusing the pooled file of the path if it
+ *  is still the file at path: the device, inode, size, modification and
+ *  status change times given by stat(path) are those of the pooled file.
+ *  Otherwise the file is opened (and pooled in place of the least
+ *  recently used idle file if the pool is full). If stream is true, the
+ *  caller uses fid, which then cannot be shared: a pooled file in use by
+ *  another caller is not reused and the file is opened unpooled.
+ *  Descriptors are shared (positional reads only).
+ *  Returns 0 on success and -1 if the file cannot be opened. */
+extern int envi_file_open(EnviFile *file, const char *path, bool stream);
+
+/* function : envi_file_close
+ *  Give the file back to the pool, or close it if it is not pooled. */
+extern void envi_file_close(EnviFile *file);
+
+/* function : envi_filepool_configure
+ *  Set the number of pooled files (0 disables the pool). The pool is
+ *  flushed and its counters are reset. */
+extern void envi_filepool_configure(size_t capacity);
+
+/* function : envi_filepool_close
+ *  Close the pooled file of path. A file in use is closed when it is
+ *  given back. Returns true if the path was pooled. */
+extern bool envi_filepool_close(const char *path);
+
+/* function : envi_filepool_flush
+ *  Close all the pooled files (those in use when they are given back). */
+extern void envi_filepool_flush(void);
+
+extern void envi_filepool_get_stats(EnviFilePoolStats *stats);
+
+#endif
@@ -0,0 +1,64 @@
+/* envi_glt.h */
+#ifndef ENVI_GLT_H
+#define ENVI_GLT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ENVI_GLT_NONE: source index of a projected pixel without a source.
+ * ENVI_GLT_STAGE_SIZE: target size (bytes) of the group of source band
+ * planes that are read from the file and projected at a time when an
+ * image is projected from its file. */
+#define ENVI_GLT_NONE ((size_t) -1)
+#ifndef ENVI_GLT_STAGE_SIZE
+#define ENVI_GLT_STAGE_SIZE (256*1024*1024)
+#endif
+
+/* EnviGLTBox
+ *  Bounding box (0-based, inclusive) of the source pixels referred to by a
+ *  geometric lookup table and the number of projected pixels having a
+ *  source. */
+typedef struct EnviGLTBox {
+    size_t smpl0;
+    size_t smpl1;
+    size_t line0;
+    size_t line1;
+    size_t nvalid;
+} EnviGLTBox ;
+
+/* function : envi_glt_bbox
+ *  Compute the bounding box of the source pixels of the npix entries of
+ *  the GLT planes glt_x and glt_y (1-based samples and lines of a source
+ *  image of samples x lines). An entry has no source if its sample or
+ *  line is out of the source image (0 and NaN included). Negative entries
+ *  are the pixels that ENVI filled with their nearest neighbor: their
+ *  absolute values are used if neg_abs is true, and they have no source
+ *  otherwise. */
+extern void envi_glt_bbox(EnviGLTBox *box, const double *glt_x,
+        const double *glt_y, size_t npix, size_t samples, size_t lines,
+        bool neg_abs);
+
+/* function : envi_glt_index
+ *  Convert the GLT planes into the indices srcidx[j] of the source pixels
+ *  in a [lines x samples] plane (column-major) of the part of the source
+ *  image inside box (ENVI_GLT_NONE: no source). samples, lines and
+ *  neg_abs are the same as in envi_glt_bbox. */
+extern void envi_glt_index(size_t *srcidx, const double *glt_x,
+        const double *glt_y, size_t npix, size_t samples, size_t lines,
+        bool neg_abs, const EnviGLTBox *box);
+
+/* function : envi_glt_project
+ *  Project nb band planes of the source (src_plane elements of sz bytes
+ *  each, contiguous planes) into dst, a [lines_o x samples_o x nb]
+ *  column-major array:
+ *      dst[j + b*lines_o*samples_o] = src[srcidx[j] + b*src_plane]
+ *  where the pixels without a source take fill (sz bytes). The output
+ *  lines are split across num_threads threads (resolved by the caller,
+ *  see envi_get_num_threads).
+ *  Returns
+ *    0 on success and -5 if memory allocation failed. */
+extern int envi_glt_project(char *dst, size_t lines_o, size_t samples_o,
+        const char *src, size_t src_plane, const size_t *srcidx, size_t nb,
+        size_t sz, const void *fill, size_t num_threads);
+
+#endif
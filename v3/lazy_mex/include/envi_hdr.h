@@ -0,0 +1,82 @@
+/* envi_hdr.h */
+#ifndef ENVI_HDR_H
+#define ENVI_HDR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ENVI_HDR_NAME_MAX: maximum length of a field name (namelengthmax of
+ * MATLAB). */
+#define ENVI_HDR_NAME_MAX 63
+
+/* Type of the value of a header field, following envihdrreadx2.m:
+ *  ENVI_HDR_STRING : the value as it is (trimmed), with the trimmed lines
+ *                    of a multi-line {...} value appended without a
+ *                    separator.
+ *  ENVI_HDR_NUMBER : a value that is a single number.
+ *  ENVI_HDR_LINES  : a multi-line description, its first line followed by
+ *                    the raw lines up to the closing brace.
+ *  ENVI_HDR_STRINGS: 'band_names' and 'spectra_names', the list between
+ *                    the braces split at (runs of) commas and trimmed.
+ *  ENVI_HDR_NUMBERS: 'wavelength', 'fwhm', 'default_bands' and 'bbl', the
+ *                    list between the braces split at commas, elements
+ *                    that are not a number being NaN. A value that is a
+ *                    number with commas for str2double (e.g. 1,200) is
+ *                    also split at the commas, as str2num does. */
+typedef enum EnviHdrValueType {
+    ENVI_HDR_STRING,ENVI_HDR_NUMBER,ENVI_HDR_LINES,ENVI_HDR_STRINGS,
+    ENVI_HDR_NUMBERS
+} EnviHdrValueType ;
+
+/* EnviHdrField
+ *  A header field. str is the value of a string, strs[0..nstrs) the
+ *  strings of lines and strings, num the value of a number and
+ *  nums[0..nnums) the values of numbers. */
+typedef struct EnviHdrField {
+    char name[ENVI_HDR_NAME_MAX+1];
+    EnviHdrValueType type;
+    char *str;
+    char **strs;
+    size_t nstrs;
+    double num;
+    double *nums;
+    size_t nnums;
+} EnviHdrField ;
+
+/* EnviHdr
+ *  The fields of a header in the order of their first appearance (a field
+ *  given again takes the last value). */
+typedef struct EnviHdr {
+    EnviHdrField *fields;
+    size_t nfields;
+    size_t capfields;
+} EnviHdr ;
+
+/* function : envi_hdr_parse
+ *  Parse the text of a header (n bytes) in one pass. The lines holding a
+ *  '=' are the fields (a leading ';' is ignored); the name before the '='
+ *  is trimmed, ':' and ' ' become '_', and '(', ')' and '/' are removed.
+ *  Other characters are kept, so a name may not be a valid MATLAB field
+ *  name.
+ *  Returns 0 on success and -5 if memory allocation failed. */
+extern int envi_hdr_parse(EnviHdr *hdr, const char *text, size_t n);
+
+/* function : envi_hdr_read
+ *  Read the header file at path and parse it.
+ *  Returns 0 on success, -1 if the file cannot be opened, -4 if reading
+ *  it failed, and -5 if memory allocation failed. */
+extern int envi_hdr_read(EnviHdr *hdr, const char *path);
+
+extern void envi_hdr_free(EnviHdr *hdr);
+
+/* function : envi_parse_double
+ *  Parse [s,e) as a single real number like str2double of MATLAB:
+ *  surrounding white spaces, a sign, commas between the digits of the
+ *  integer part, 'e' or 'd' exponents, and inf are accepted. Decimal
+ *  numbers of up to 19 significant digits and small exponents are
+ *  converted exactly with one multiplication or division (Clinger's fast
+ *  path); the others go through strtod.
+ *  Returns true and the value in *v if [s,e) is a number (not NaN). */
+extern bool envi_parse_double(const char *s, const char *e, double *v);
+
+#endif
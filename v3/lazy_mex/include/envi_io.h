@@ -0,0 +1,449 @@
+/* envi_io.h 
+ *  I/O core of the lazy ENVI readers, in plain C without any MATLAB 
+ *  dependency: built into libenvi (see CMakeLists.txt) and wrapped by the
+ *  MEX gateways through envi_v2.h. */
+#ifndef ENVI_IO_H
+#define ENVI_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "envi_copy.h"
+#include "envi_transpose.h"
+
+/* Error codes returned by the readers (0 on success). */
+#define ENVI_ERR_OPEN  (-1) /* the file cannot be opened */
+#define ENVI_ERR_SIZE  (-2) /* the file size is inconsistent with the header */
+#define ENVI_ERR_MMAP  (-3) /* the file cannot be memory-mapped */
+#define ENVI_ERR_READ  (-4) /* reading the file failed */
+#define ENVI_ERR_NOMEM (-5) /* memory allocation failed */
+
+typedef enum EnviHeaderInterleave {
+    BSQ,BIP,BIL
+} EnviHeaderInterleave ;
+
+typedef struct EnviHeader {
+    int32_t samples;
+    int32_t lines;
+    int32_t bands;
+    int32_t data_type;
+    int32_t byte_order;
+    int32_t header_offset;
+    EnviHeaderInterleave interleave;
+    char* file_type;
+    double data_ignore_value;
+} EnviHeader ;
+
+/* Back-end used to fetch the image data from the file.
+ *  ENVI_READ_FREAD : buffered fopen/fseek/fread of the selected d2 rows 
+ *                    (or the exact byte spans if the rows are sparse).
+ *  ENVI_READ_MMAP  : the file is memory-mapped and the requested runs are
+ *                    gathered from the mapping directly into subimg.
+ *  ENVI_READ_PREAD : the coalesced I/O plan (see envi_ioplan.h) is split 
+ *                    across a pool of threads, each of which reads its 
+ *                    share with positional pread into its own region of 
+ *                    subimg. 
+ *  ENVI_READ_URING : the coalesced I/O plan is submitted to an io_uring
+ *                    (see envi_uring.h), opt->queue_depth reads in 
+ *                    flight, by the calling thread. It falls back to 
+ *                    ENVI_READ_PREAD where io_uring is not supported.
+ *  ENVI_READ_DIRECT: the coalesced I/O plan is streamed with O_DIRECT 
+ *                    (see envi_direct.h) into double-buffered aligned 
+ *                    windows, bypassing the page cache, for scans of 
+ *                    whole cubes that are not read again.
+ * The pread back-end and the pixel readers go through the block cache 
+ * (see envi_cache.h) when it is enabled, and the 'default' read mode then
+ * resolves to ENVI_READ_PREAD. */
+typedef enum EnviReadMode {
+    ENVI_READ_FREAD,ENVI_READ_MMAP,ENVI_READ_PREAD,ENVI_READ_URING,
+    ENVI_READ_DIRECT
+} EnviReadMode ;
+
+#if defined(__linux__)
+#define ENVI_READ_MODE_DEFAULT ENVI_READ_MMAP
+#else
+#define ENVI_READ_MODE_DEFAULT ENVI_READ_FREAD
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ENVI_HAS_MMAP
+#define ENVI_HAS_PTHREAD
+#endif
+
+/* ENVI_READBUF_SIZE: maximum size (bytes) of a single read into a staging
+ * buffer (the row buffer of the fread back-end and the segments of an I/O
+ * plan). ENVI_EXACT_SPAN_GAP: average gap (bytes) between the runs of a 
+ * row above which only the exact byte spans are read. 
+ * ENVI_COALESCE_GAP_DEFAULT: default gap (bytes) below which neighboring 
+ * runs are merged into one read by the I/O plan. 
+ * ENVI_READ_SPAN_MAX: maximum size (bytes) of a single read of a span that
+ * is contiguous both in the file and in the output, which is read directly
+ * into the output instead of through a staging buffer. 
+ * ENVI_SLABBUF_SIZE: size (bytes) of the buffer into which the fread 
+ * back-end reads consecutive d1 x d2 slabs (lines of BIL and BIP) at 
+ * once. */
+#ifndef ENVI_READBUF_SIZE
+#define ENVI_READBUF_SIZE   (4*1024*1024)
+#endif
+#ifndef ENVI_SLABBUF_SIZE
+#define ENVI_SLABBUF_SIZE   (4*1024*1024)
+#endif
+#ifndef ENVI_READ_SPAN_MAX
+#define ENVI_READ_SPAN_MAX  (1024*1024*1024)
+#endif
+#ifndef ENVI_EXACT_SPAN_GAP
+#define ENVI_EXACT_SPAN_GAP 4096
+#endif
+/* maximum number of threads used when num_threads is left to 0 (auto) */
+#ifndef ENVI_NUM_THREADS_MAX
+#define ENVI_NUM_THREADS_MAX 16
+#endif
+#ifndef ENVI_PIXEL_PLAN_PIECES
+#define ENVI_PIXEL_PLAN_PIECES (1024*1024)
+#endif
+/* sample or line index of a pixel that is not in the image (filled) */
+#define ENVI_PIXEL_NONE ((size_t) -1)
+#ifndef ENVI_COALESCE_GAP_DEFAULT
+#define ENVI_COALESCE_GAP_DEFAULT (64*1024)
+#endif
+
+/* EnviReadOption
+ *  precision is the ENVI data_type of the output (of its real and 
+ *  imaginary parts for complex data), or 0 to keep the data_type of the 
+ *  image. The values are converted while they are copied out of the read
+ *  buffers. 
+ *  If replace_div is true, the elements equal to the data_ignore_value of
+ *  the header are replaced with repval_div (in precision) on the same 
+ *  pass. If valid is not NULL, it receives one flag per element of subimg,
+ *  false where the element equals the data_ignore_value. 
+ *  If band_map is not NULL, the k-th selected band (in file order) is 
+ *  written to the band band_map[k] of subimg instead of k (see 
+ *  envi_band_map_init). 
+ *  queue_depth is the number of reads in flight of ENVI_READ_URING (0: 
+ *  ENVI_URING_QUEUE_DEPTH). coalesce_gap is the gap (bytes) below which 
+ *  neighboring runs are merged into one read by the I/O plans, and 
+ *  consecutive slabs into one read by ENVI_READ_FREAD. */
+typedef struct EnviReadOption {
+    EnviReadMode read_mode;
+    size_t num_threads;
+    size_t coalesce_gap;
+    size_t queue_depth;
+    int32_t precision;
+    bool replace_div;
+    double repval_div;
+    bool *valid;
+    size_t *band_map;
+} EnviReadOption ;
+
+/* EnviSkipReadDim
+ *  skip-read list of one dimension of the image file. d1 is the fastest 
+ *  varying dimension in the file and d3 is the slowest. */
+typedef struct EnviSkipReadDim {
+    long int d;
+    long int *skipszlist;
+    size_t *readszlist;
+    size_t N_skipread;
+    long int skip_last;
+} EnviSkipReadDim ;
+
+/* EnviIOPlanStats
+ *  Summary of an I/O plan: the number of read syscalls, the number of 
+ *  copies scattering the wanted parts out of the staging buffer, and the 
+ *  bytes read from the file against the bytes actually used. */
+typedef struct EnviIOPlanStats {
+    size_t n_syscalls;
+    size_t n_copies;
+    size_t nbytes_read;
+    size_t nbytes_used;
+} EnviIOPlanStats ;
+
+/* function : envi_strerror
+ *  Message of the error code errflg returned by a reader. */
+extern const char *envi_strerror(int errflg);
+
+/* function : envi_header_read
+ *  Read the fields of the ENVI header file at hdrpath used by the readers 
+ *  into hdr (see envi_hdr.h), for callers without MATLAB. file_type is 
+ *  set to NULL and data_ignore_value to NaN if it is not given.
+ *  Returns 0 on success, -1 if the file cannot be opened, -2 if a field 
+ *  is missing or invalid, -4 if reading it failed, and -5 if memory 
+ *  allocation failed. */
+extern int envi_header_read(EnviHeader *hdr, const char *hdrpath);
+
+/* function : envi_read_mode_default
+ *  Back-end of the 'default' read mode: ENVI_READ_PREAD while the block 
+ *  cache is enabled (only the pread back-end reads through it), and 
+ *  ENVI_READ_MODE_DEFAULT otherwise. */
+extern EnviReadMode envi_read_mode_default(void);
+
+/* function : envi_read_option_init
+ *  Default read options: the default read mode, automatic number of 
+ *  threads, ENVI_COALESCE_GAP_DEFAULT, the data_type of the image, and no
+ *  replacement of the data ignore value. */
+extern void envi_read_option_init(EnviReadOption *opt);
+
+extern bool isComputerLSBF(void);
+
+/* function : envi_is_byteswap_necessary
+ *  Evaluate if the byte order of the image data (byte_order in the ENVI 
+ *  header, 0: little endian, 1: big endian) differs from the computer. */
+extern bool envi_is_byteswap_necessary(int32_t byte_order);
+
+/* function : envi_get_data_type_size
+ *  Size (bytes) of one element of the ENVI data_type, or 0 if the type is
+ *  not supported. Complex types (6 and 9) count the real and imaginary 
+ *  parts together, which are stored interleaved in the file. */
+extern size_t envi_get_data_type_size(int32_t data_type);
+
+/* function : envi_get_swap_size
+ *  Size of the words whose bytes need to be reversed when the elements of
+ *  sz bytes of the data_type are read, or 0 if no swap is necessary. */
+extern size_t envi_get_swap_size(int32_t data_type, int32_t byte_order,
+        size_t sz);
+
+/* function : envi_get_data_type_from_precision
+ *  ENVI data_type of the MATLAB class name (e.g. 'double' -> 5). 'raw' and
+ *  '' give 0 (same as the image). Returns -1 for an unknown name. */
+extern int32_t envi_get_data_type_from_precision(const char *precision);
+
+/* function : envi_copy_kernel_init
+ *  Set up the copy kernel converting the elements of the image described 
+ *  by hdr to the precision in opt (NULL: no conversion), with the byte 
+ *  swap if the image byte order differs from the computer, and with the 
+ *  replacement of the data ignore value requested by opt for the output 
+ *  array subimg. */
+extern void envi_copy_kernel_init(EnviCopyKernel *kernel, EnviHeader hdr,
+        const EnviReadOption *opt, void *subimg);
+
+/* function : envi_assign_skipread_dims
+ *  Assign sample/line/band skip-read lists to the dimensions (d1,d2,d3) 
+ *  of the image file depending on the interleave. */
+extern void envi_assign_skipread_dims(EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        EnviSkipReadDim *dim1, EnviSkipReadDim *dim2, EnviSkipReadDim *dim3);
+
+/* function : envi_layout_init_skipread
+ *  Set up the layout writing the elements selected by dim1, dim2, dim3 
+ *  (d1 to d3 of the interleave of hdr) into a [lines x samples x bands] 
+ *  column-major array of elements of sz bytes. The bands are placed 
+ *  following band_map if it is not NULL. */
+extern void envi_layout_init_skipread(EnviLayout *layout, EnviHeader hdr,
+        const EnviSkipReadDim *dim1, const EnviSkipReadDim *dim2,
+        const EnviSkipReadDim *dim3, size_t *band_map, size_t sz);
+
+/* function : envi_band_map_init
+ *  Prepare the read of the nb output bands band_index (0-based indices 
+ *  into the nd selected bands, in any order and possibly duplicated). 
+ *  band_map (nd elements) receives the band of subimg into which each
+ *  selected band is read: the selected bands are packed in the order of 
+ *  their first occurrence in band_index, so that each is read once.
+ *  Returns 0 on success and -1 if an index is out of range or a selected
+ *  band is not requested. */
+extern int envi_band_map_init(size_t *band_map, const size_t *band_index,
+        size_t nb, size_t nd);
+
+/* function : envi_band_map_expand
+ *  Move the bands read following band_map to their nb output bands 
+ *  band_index, in place in subimg of band planes of plane_nbytes bytes.
+ *  The duplicated bands are copied from their first occurrence. */
+extern void envi_band_map_expand(char *subimg, size_t plane_nbytes,
+        const size_t *band_index, const size_t *band_map, size_t nb);
+
+/* function : swapFloat_shuffle 
+ *  swap the bytes of the input float variable into the reverse direction 
+ *  for resolving endian issues using byte shuffling.  
+ *  Input Parameters
+ *    float inFolat: input float before swapped 
+ *  Returns
+ *    float retVal : output float after swapped */
+extern float swapFloat_shuffle( float inFloat );
+
+/* function : swapFloat 
+ *  swap the bytes of the input float variable into the reverse direction 
+ *  for resolving endian issues using bit shifts. 
+ *  Input Parameters
+ *    float inFolat: input float before swapped 
+ *  Returns
+ *    float retVal : output float after swapped */
+extern float swapFloat( const float inFloat );
+
+/* function : lazyenvireadRectx_multBand
+ *  Read the runs selected by the skip-read lists of samples, lines, and 
+ *  bands into subimg, a [lines x samples x bands] column-major array 
+ *  (dims_subimg) whatever the interleave of the file. The rows of the file
+ *  are staged in blocks and transposed into subimg (see envi_transpose.h).
+ *  sz is the size (bytes) of an element in the file. The elements are 
+ *  byte-swapped and converted to opt->precision (opt may be NULL: no 
+ *  conversion) on their way to subimg, where the data ignore value is 
+ *  replaced as requested by opt.
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -4 if reading the file failed, -5 if 
+ *    memory allocation failed. */
+extern int lazyenvireadRectx_multBand(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt);
+
+/* function : lazyenvireadRectx_multBand_mmap
+ *  Same as lazyenvireadRectx_multBand, but the image file is mapped into 
+ *  memory and the requested runs are copied from the mapping directly 
+ *  into subimg without an intermediate plane buffer. Falls back to 
+ *  lazyenvireadRectx_multBand on platforms without mmap.
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -3 if the file cannot be mapped, -5 if
+ *    memory allocation failed. */
+extern int lazyenvireadRectx_multBand_mmap(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt);
+
+/* function : lazyenvireadRectx_multBand_pthread
+ *  Same as lazyenvireadRectx_multBand, but the selected runs are first 
+ *  planned into coalesced segments (runs closer than opt->coalesce_gap 
+ *  bytes are merged into one read). The segments are split into 
+ *  opt->num_threads contiguous shares of staging blocks, each read and 
+ *  transposed into subimg by its own thread with pread. num_threads=0 
+ *  uses the number of online processors (at most ENVI_NUM_THREADS_MAX). 
+ *  With the read mode ENVI_READ_URING, the segments are read through an
+ *  io_uring instead (see envi_ioplan_execute_uring), and with 
+ *  ENVI_READ_DIRECT they are streamed around the page cache (see 
+ *  envi_ioplan_execute_direct). The statistics of the plan are stored in
+ *  stats if it is not NULL.
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -4 if reading the file failed, -5 if 
+ *    memory allocation failed. */
+extern int lazyenvireadRectx_multBand_pthread(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt, EnviIOPlanStats *stats);
+
+/* function : lazyenvireadRectx_multBand_auto
+ *  Read the rectangle with the back-end selected by opt->read_mode (see 
+ *  lazyenvireadRectx_multBand, lazyenvireadRectx_multBand_mmap and
+ *  lazyenvireadRectx_multBand_pthread). The statistics of the I/O plan of
+ *  the rectangle are stored in stats if it is not NULL, whatever the 
+ *  back-end.
+ *  Returns
+ *    0 on success or the error code of the back-end. */
+extern int lazyenvireadRectx_multBand_auto(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt, EnviIOPlanStats *stats);
+
+/* function : lazyenvireadPixelsx_multBand
+ *  Read the spectra of the npix pixels (smpls[j], lines[j]) (0-based) for
+ *  the bands selected by the band skip-read list into spc, a [npix x 
+ *  bands] column-major array, in the order of the pixels given. The 
+ *  distinct pixels are sorted by their offset in the file and read once 
+ *  each, through I/O plans (runs closer than opt->coalesce_gap bytes are 
+ *  merged into one read) of at most ENVI_PIXEL_PLAN_PIECES pieces, into a
+ *  staging buffer of one spectrum per distinct pixel. The spectra are 
+ *  then transposed into spc, where duplicated pixels take the same 
+ *  spectrum. Conversion, byte swap, data ignore value and opt->valid 
+ *  ([npix x bands]) are handled as in lazyenvireadRectx_multBand. The
+ *  plans are read with fread, or through an io_uring with the read mode
+ *  ENVI_READ_URING (see envi_uring_use). The 
+ *  statistics of the plans are stored in stats if it is not NULL.
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -4 if reading the file failed, -5 if 
+ *    memory allocation failed. */
+extern int lazyenvireadPixelsx_multBand(char *imgpath, EnviHeader hdr,
+        const size_t *smpls, const size_t *lines, size_t npix,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *spc, size_t sz, const EnviReadOption *opt,
+        EnviIOPlanStats *stats);
+
+/* function : lazyenvireadGLTx_multBand
+ *  Gather the spectra of a window of npix pixels of a projected image 
+ *  whose source pixels are given by a geometric lookup table: the j-th 
+ *  pixel takes the spectrum of the source pixel (smpls[j], lines[j]) 
+ *  (0-based) of the image. Pixels whose sample or line is ENVI_PIXEL_NONE
+ *  have no source and are filled with fillval (converted to the 
+ *  precision; valid is false). The source pixels are read as in 
+ *  lazyenvireadPixelsx_multBand, each distinct one once, and spc is 
+ *  [npix x bands].
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -4 if reading the file failed, -5 if 
+ *    memory allocation failed. */
+extern int lazyenvireadGLTx_multBand(char *imgpath, EnviHeader hdr,
+        const size_t *smpls, const size_t *lines, size_t npix,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last, double fillval,
+        void *spc, size_t sz, const EnviReadOption *opt,
+        EnviIOPlanStats *stats);
+
+/* function : lazyenvireadGLTProjx_multBand
+ *  Project the bands selected by the band skip-read list of the image 
+ *  through a geometric lookup table into img_proj, a [lines_o x samples_o 
+ *  x bands] column-major array: the pixel j takes the spectrum of the 
+ *  source pixel (glt_x[j], glt_y[j]) (1-based), or fillval (converted to
+ *  the precision) if it has no source (see envi_glt_bbox for the 0 and 
+ *  negative entries and neg_abs). Only the bounding box of the source 
+ *  pixels is read, by groups of bands of about ENVI_GLT_STAGE_SIZE bytes
+ *  with the back-end of opt->read_mode, and each group is projected with
+ *  opt->num_threads threads across the output lines, so the whole 
+ *  unprojected cube is never held in memory. opt->valid and 
+ *  opt->band_map are ignored.
+ *  Returns
+ *    0 on success, -1 if the file cannot be opened, -2 if the file size is
+ *    inconsistent with the header, -3 if the file cannot be mapped, -4 if
+ *    reading the file failed, -5 if memory allocation failed. */
+extern int lazyenvireadGLTProjx_multBand(char *imgpath, EnviHeader hdr,
+        const double *glt_x, const double *glt_y, size_t lines_o,
+        size_t samples_o, bool neg_abs,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last, double fillval,
+        void *img_proj, size_t sz, const EnviReadOption *opt);
+
+/* function : lazyenvireadRectx_multBand_ioplan_stats
+ *  Build the I/O plan of the rectangle read with opt->coalesce_gap and 
+ *  store its statistics in stats without reading the image. 
+ *  Returns
+ *    0 on success and -5 if memory allocation failed. */
+extern int lazyenvireadRectx_multBand_ioplan_stats(EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        size_t sz, const EnviReadOption *opt, EnviIOPlanStats *stats);
+
+extern int image_byteswapFloat(float* img, size_t *dims_img,
+        int32_t byte_order);
+extern int image_byteswapInt16(int16_t* img, size_t *dims_img,
+        int32_t byte_order);
+extern int image_byteswapUint16(uint16_t* img, size_t *dims_img,
+        int32_t byte_order);
+
+#endif
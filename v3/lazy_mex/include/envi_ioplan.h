@@ -0,0 +1,130 @@
+/* envi_ioplan.h */
+#ifndef ENVI_IOPLAN_H
+#define ENVI_IOPLAN_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "envi_io.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#include "envi_cache.h"
+
+/* EnviIOPiece
+ *  A wanted part of a segment: nbytes bytes at src_offset from the start
+ *  of the segment are copied to dst_offset (bytes) of subimg. nbytes 
+ *  counts the bytes in the file, which differ from the bytes written to 
+ *  subimg if the kernel of the plan converts the data type. */
+typedef struct EnviIOPiece {
+    size_t src_offset;
+    size_t dst_offset;
+    size_t nbytes;
+} EnviIOPiece ;
+
+/* EnviIOSegment
+ *  One read syscall: nbytes bytes from file_offset of the file. Its pieces
+ *  are pieces[piece_start..piece_start+npieces) of the plan. */
+typedef struct EnviIOSegment {
+    size_t file_offset;
+    size_t nbytes;
+    size_t piece_start;
+    size_t npieces;
+} EnviIOSegment ;
+
+/* EnviIOPlan
+ *  Segments sorted by file offset. Runs whose gap to the current segment 
+ *  is at most gap_threshold bytes are merged into it, as long as the 
+ *  segment stays within max_segment bytes. Pieces never cross a multiple 
+ *  of block_nbytes in subimg (the staging blocks of the layout; 0: no 
+ *  blocks). A segment made of a single piece whose kernel is plain is 
+ *  read straight into its destination, so runs continuing it both in the
+ *  file and in subimg extend it up to max_span bytes instead (a span; 
+ *  max_span is max_segment unless set by envi_ioplan_enable_spans). If 
+ *  cache is not NULL, the segments are read through the block cache (see
+ *  envi_cache.h) from the file it describes. */
+typedef struct EnviIOPlan {
+    EnviIOSegment *segments;
+    size_t nsegments;
+    size_t capsegments;
+    EnviIOPiece *pieces;
+    size_t npieces;
+    size_t cappieces;
+    size_t sz;
+    size_t gap_threshold;
+    size_t max_segment;
+    size_t max_span;
+    size_t block_nbytes;
+    EnviCopyKernel kernel;
+    const EnviCacheFile *cache;
+} EnviIOPlan ;
+
+/* function : envi_ioplan_init
+ *  Initialize an empty plan whose pieces are copied to subimg with the 
+ *  kernel. The elements are kernel->src_sz bytes in the file, and 
+ *  max_segment is rounded down to a multiple of it. block_nbytes is the 
+ *  size of the staging blocks (bytes in subimg) of the layout passed to
+ *  envi_ioplan_execute. The plan reads around the block cache until its 
+ *  cache is set. */
+extern void envi_ioplan_init(EnviIOPlan *plan, const EnviCopyKernel *kernel,
+        size_t gap_threshold, size_t max_segment, size_t block_nbytes);
+extern void envi_ioplan_free(EnviIOPlan *plan);
+
+/* function : envi_ioplan_enable_spans
+ *  Let the runs that are contiguous both in the file and in subimg be read
+ *  with one syscall of up to ENVI_READ_SPAN_MAX bytes directly into 
+ *  subimg, for a plan executed with the layout (before any run is added).
+ *  This is only done if the layout is the identity (subimg is packed in 
+ *  file order, so no staging is needed) and the kernel of the plan is 
+ *  plain. The staging blocks are then dropped (block_nbytes is 0). Not 
+ *  for envi_ioplan_execute_direct and envi_ioplan_execute_fread, which 
+ *  read every segment into a buffer of max_segment bytes. */
+extern void envi_ioplan_enable_spans(EnviIOPlan *plan, 
+        const EnviLayout *layout);
+
+/* function : envi_ioplan_add_run
+ *  Append a run of nbytes bytes at file_offset going to dst_offset of 
+ *  subimg (bytes, counted with the element size of subimg). Runs need to
+ *  be added in increasing order of file_offset.
+ *  Returns 0 on success and -5 if memory allocation failed. */
+extern int envi_ioplan_add_run(EnviIOPlan *plan, size_t file_offset,
+        size_t nbytes, size_t dst_offset);
+
+/* function : envi_ioplan_build
+ *  Add all the runs selected by dim1, dim2, dim3 for an image whose data 
+ *  start at header_offset. The runs are packed into subimg in file order.
+ *  Returns 0 on success and -5 if memory allocation failed. */
+extern int envi_ioplan_build(EnviIOPlan *plan, const EnviSkipReadDim *dim1,
+        const EnviSkipReadDim *dim2, const EnviSkipReadDim *dim3,
+        size_t header_offset);
+
+extern void envi_ioplan_get_stats(const EnviIOPlan *plan, 
+        EnviIOPlanStats *stats);
+
+/* function : envi_get_num_threads
+ *  Resolve the number of threads used for n_jobs jobs. num_threads=0 
+ *  means the number of online processors, capped at ENVI_NUM_THREADS_MAX. */
+extern size_t envi_get_num_threads(size_t num_threads, size_t n_jobs);
+
+/* function : envi_ioplan_execute
+ *  Read the segments of the plan from the file descriptor fd and scatter
+ *  the pieces into subimg following layout. The staging blocks of the 
+ *  layout are split into num_threads contiguous shares, and each thread 
+ *  reads the parts of the segments whose pieces fall in its share. The 
+ *  pieces are copied into the stage of the thread with the kernel of the
+ *  plan. If the kernel is plain, a segment consisting of a single piece 
+ *  (e.g., a span) is read directly into the stage and swapped in place.
+ *  Returns 0 on success, -4 if reading failed, and -5 if memory 
+ *  allocation failed. */
+extern int envi_ioplan_execute(const EnviIOPlan *plan, int fd, 
+        char *subimg, const EnviLayout *layout, size_t num_threads);
+
+/* function : envi_ioplan_execute_fread
+ *  Read the segments of the plan one after the other from fid and copy 
+ *  each piece with the kernel of the plan to subimg + dst_offset. Unlike
+ *  envi_ioplan_execute, the pieces may go anywhere in subimg (no layout 
+ *  and no ordering of dst_offset is assumed).
+ *  Returns 0 on success, -4 if reading failed, and -5 if memory 
+ *  allocation failed. */
+extern int envi_ioplan_execute_fread(const EnviIOPlan *plan, FILE *fid,
+        char *subimg);
+
+#endif
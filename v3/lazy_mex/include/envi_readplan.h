@@ -0,0 +1,71 @@
+/* envi_readplan.h */
+#ifndef ENVI_READPLAN_H
+#define ENVI_READPLAN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+
+/* EnviReadPlan
+ *  A prepared read of a rectangle (skip-read lists of samples, lines and
+ *  bands) of images with the geometry of hdr, for repeated reads of the
+ *  same window. The skip-read lists, the last skips, the band map and
+ *  the layout of the output are resolved once, and so is the I/O plan
+ *  of the pread, io_uring and direct modes (has_ioplan). smpl, line and
+ *  band hold the lists (d is the image size), dims the size 
+ *  [lines x samples x bands] of the output (bands: N_band_index if 
+ *  band_index is given) and dims_read the same with the bands read. 
+ *  nbytes_file is the minimum size of the image file. */
+typedef struct EnviReadPlan {
+    EnviHeader hdr;
+    EnviReadOption opt;
+    size_t sz;
+    EnviSkipReadDim smpl;
+    EnviSkipReadDim line;
+    EnviSkipReadDim band;
+    size_t dims[3];
+    size_t dims_read[3];
+    size_t *band_index;
+    size_t *band_map;
+    size_t N_band_index;
+    size_t nbytes_file;
+    EnviCopyKernel kernel;
+    EnviLayout layout;
+    EnviIOPlan ioplan;
+    bool has_ioplan;
+    EnviIOPlanStats stats;
+} EnviReadPlan ;
+
+/* function : envi_readplan_create
+ *  Prepare the read of the samples, lines and bands selected by the
+ *  skip-read lists (copied) with the options opt (opt->valid and
+ *  opt->band_map are ignored). If band_index is not NULL, the output has
+ *  the N_band_index bands band_index (0-based indices into the selected
+ *  bands, see envi_band_map_init).
+ *  Returns 0 on success, -2 if the lists or band_index are inconsistent
+ *  with the image size or the data type is not supported, and -5 if
+ *  memory allocation failed. */
+extern int envi_readplan_create(EnviReadPlan *rp, EnviHeader hdr,
+        const long int *smpl_skipszlist, const size_t *smpl_readszlist,
+        size_t N_smpl_skipread,
+        const long int *line_skipszlist, const size_t *line_readszlist,
+        size_t N_line_skipread,
+        const long int *band_skipszlist, const size_t *band_readszlist,
+        size_t N_band_skipread,
+        const size_t *band_index, size_t N_band_index,
+        const EnviReadOption *opt);
+
+/* function : envi_readplan_execute
+ *  Read the prepared rectangle of the image file imgpath, which may be
+ *  any file with the geometry of the plan, into subimg (dims elements of
+ *  kernel.dst_sz bytes). valid (optional, dims elements initialized to
+ *  true) is set as opt->valid of the readers. If stats is not NULL, it
+ *  receives the statistics of the I/O plan.
+ *  Returns 0 on success and the error codes of the readers otherwise. */
+extern int envi_readplan_execute(const EnviReadPlan *rp, const char *imgpath,
+        void *subimg, bool *valid, EnviIOPlanStats *stats);
+
+extern void envi_readplan_free(EnviReadPlan *rp);
+
+#endif
@@ -0,0 +1,78 @@
+/* envi_tileiter.h */
+#ifndef ENVI_TILEITER_H
+#define ENVI_TILEITER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "envi_io.h"
+
+/* ENVI_TILE_BUDGET_DEFAULT: default memory budget (bytes) of a tile in
+ * the output precision. */
+#ifndef ENVI_TILE_BUDGET_DEFAULT
+#define ENVI_TILE_BUDGET_DEFAULT (64*1024*1024)
+#endif
+
+/* EnviTile
+ *  A tile of an image: the count[k] lines (k=0), samples (k=1) or bands
+ *  (k=2) from start[k] (0-based), read as a [lines x samples x bands]
+ *  array. index is its rank in the iteration. */
+typedef struct EnviTile {
+    size_t index;
+    size_t start[3];
+    size_t count[3];
+} EnviTile ;
+
+/* EnviTileIter
+ *  Iteration over the tiles of tile[0] lines x tile[1] samples x tile[2]
+ *  bands covering an image with the geometry of hdr (the tiles on the far
+ *  edges are smaller), ntiles[k] along each dimension. The tiles are
+ *  visited in the order of the file: order[0] is the dimension varying
+ *  fastest in the file (samples for BSQ and BIL, bands for BIP), whose
+ *  tile index changes first, and order[2] the slowest. next is the index
+ *  of the next tile. */
+typedef struct EnviTileIter {
+    EnviHeader hdr;
+    EnviReadOption opt;
+    size_t dims[3];
+    size_t tile[3];
+    size_t ntiles[3];
+    size_t ntiles_total;
+    size_t nbytes_tile;
+    int order[3];
+    size_t next;
+} EnviTileIter ;
+
+/* function : envi_tileiter_init
+ *  Set up the iteration over the tiles of tile[0] x tile[1] x tile[2]
+ *  (lines x samples x bands) of an image with the geometry of hdr, read
+ *  with the options opt (opt->valid and opt->band_map are ignored). The
+ *  sizes tile[k] left to 0 are chosen so that a tile holds at most
+ *  max_nbytes bytes (0: ENVI_TILE_BUDGET_DEFAULT) in the precision of
+ *  opt, giving the whole extent to the dimensions varying fastest in the
+ *  file first. The sizes given are capped to the image size.
+ *  Returns 0 on success, and -2 if the data type is not supported or the
+ *  tiles given do not fit in max_nbytes. */
+extern int envi_tileiter_init(EnviTileIter *it, EnviHeader hdr,
+        const size_t *tile, size_t max_nbytes, const EnviReadOption *opt);
+
+/* function : envi_tileiter_next
+ *  Get the next tile into tile and advance. Returns false once all the
+ *  tiles have been visited. */
+extern bool envi_tileiter_next(EnviTileIter *it, EnviTile *tile);
+
+/* function : envi_tileiter_reset
+ *  Restart the iteration from the first tile. */
+extern void envi_tileiter_reset(EnviTileIter *it);
+
+/* function : envi_tileiter_read
+ *  Read the tile of the image file imgpath (geometry of the iterator)
+ *  into subimg (count[0] x count[1] x count[2] elements of the precision
+ *  of the iterator, at most nbytes_tile bytes). valid (optional, same
+ *  size, initialized to true) is set as opt->valid of the readers. If
+ *  stats is not NULL, it receives the statistics of the I/O plan.
+ *  Returns 0 on success and the error codes of the readers otherwise. */
+extern int envi_tileiter_read(const EnviTileIter *it, const char *imgpath,
+        const EnviTile *tile, void *subimg, bool *valid,
+        EnviIOPlanStats *stats);
+
+#endif
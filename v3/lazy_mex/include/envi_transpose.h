@@ -0,0 +1,119 @@
+/* envi_transpose.h */
+#ifndef ENVI_TRANSPOSE_H
+#define ENVI_TRANSPOSE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "envi_copy.h"
+
+/* ENVI_TRANSPOSE_TILE: size (bytes) of the square tiles in which a
+ * transpose is performed, so that both the rows read and the columns
+ * written by a tile stay in the L1 cache. The edge of a tile is the 
+ * largest power of two (at least 8 elements) that fits in it. Inside a
+ * tile, blocks of 8x8 (1- and 2-byte), 4x4 (4-byte) or 2x2 (8-byte) 
+ * elements are transposed in SSE2/NEON registers when available.
+ * ENVI_TRANSPOSE_BLOCK_SIZE: target size (bytes) of a staging block, the
+ * rows of the image that are converted in file order before they are
+ * scattered into the output. */
+#ifndef ENVI_TRANSPOSE_TILE
+#define ENVI_TRANSPOSE_TILE (16*1024)
+#endif
+#ifndef ENVI_TRANSPOSE_BLOCK_SIZE
+#define ENVI_TRANSPOSE_BLOCK_SIZE (1024*1024)
+#endif
+
+/* function : envi_transpose2d
+ *  Copy the na x nb elements of sz bytes
+ *      src[(a + b*src_sb)*sz] -> dst[(a*dst_sa + b*dst_sb)*sz]
+ *  in tiles of ENVI_TRANSPOSE_TILE bytes. */
+extern void envi_transpose2d(char *dst, size_t dst_sa, size_t dst_sb,
+        const char *src, size_t src_sb, size_t na, size_t nb, size_t sz);
+
+/* function : envi_transpose2d_map
+ *  Same as envi_transpose2d with the index a placed at amap[a]*dst_sa in
+ *  dst and the index b taken from the row bmap[b]*src_sb of src (NULL: no
+ *  map). */
+extern void envi_transpose2d_map(char *dst, const size_t *amap, 
+        size_t dst_sa, size_t dst_sb, const char *src, const size_t *bmap,
+        size_t src_sb, size_t na, size_t nb, size_t sz);
+
+/* EnviLayout
+ *  Mapping of the elements (i1,i2,i3) read in file order (n1 x n2 x n3,
+ *  packed) to the output, where they are stored at i1*o1 + i2*o2 + i3*o3
+ *  (elements). A row is the n1 elements of a given (i2,i3); rows are
+ *  numbered i2 + n2*i3 and are staged block_rows at a time. identity is
+ *  true if the output is the packed file order.
+ *  If omap[k] is not NULL, the index ik is stored at omap[k][ik]*ok 
+ *  instead of ik*ok, which reorders (a subset of) the output positions 
+ *  along k. omap[1] and omap[2] cannot be given together. */
+typedef struct EnviLayout {
+    size_t n[3];
+    size_t o[3];
+    size_t *omap[3];
+    size_t nrows;
+    size_t block_rows;
+    bool identity;
+} EnviLayout ;
+
+/* function : envi_layout_init
+ *  Set up the layout of the dimensions n and output strides o for the
+ *  elements of sz bytes. */
+extern void envi_layout_init(EnviLayout *layout, const size_t *n,
+        const size_t *o, size_t sz);
+
+/* function : envi_layout_init_map
+ *  Same as envi_layout_init with the output maps omap (NULL: no map). The
+ *  maps are referenced, not copied. */
+extern void envi_layout_init_map(EnviLayout *layout, const size_t *n,
+        const size_t *o, size_t *const *omap, size_t sz);
+
+/* function : envi_layout_scatter
+ *  Copy the rows [row_start, row_start+nrows) packed in stage into dst
+ *  following the layout. */
+extern void envi_layout_scatter(const EnviLayout *layout, char *dst,
+        const char *stage, size_t row_start, size_t nrows, size_t sz);
+
+/* function : envi_layout_transpose
+ *  Copy the whole image packed in file order in src into dst following
+ *  the layout, with num_threads threads (at least 1), each taking a 
+ *  contiguous share of slabs (lines for BIL and BIP).
+ *  Returns 0 on success and -5 if memory allocation failed. */
+extern int envi_layout_transpose(const EnviLayout *layout, char *dst,
+        const char *src, size_t sz, size_t num_threads);
+
+/* EnviStage
+ *  Staging block of one reader (or one thread of a reader). The rows of
+ *  the current block are written with kernel into buf (and the validity
+ *  flags into vbuf), and scattered into subimg (and valid) when the
+ *  reader moves to another block. With an identity layout, the rows are
+ *  written directly into subimg. */
+typedef struct EnviStage {
+    const EnviLayout *layout;
+    EnviCopyKernel kernel;
+    char *subimg;
+    bool *valid;
+    char *buf;
+    bool *vbuf;
+    size_t row_nbytes;
+    size_t block;
+    bool has_block;
+} EnviStage ;
+
+/* function : envi_stage_init
+ *  Set up a staging block writing into subimg with kernel.
+ *  Returns 0 on success and -5 if memory allocation failed. */
+extern int envi_stage_init(EnviStage *stage, const EnviLayout *layout,
+        const EnviCopyKernel *kernel, char *subimg);
+
+/* function : envi_stage_row
+ *  Pointer at which the row (numbered in file order) is written with
+ *  stage->kernel. The rows following it in the same block are contiguous.
+ *  The current block is flushed if the row belongs to another one. */
+extern char *envi_stage_row(EnviStage *stage, size_t row);
+
+/* function : envi_stage_flush
+ *  Scatter the current block into subimg. */
+extern void envi_stage_flush(EnviStage *stage);
+extern void envi_stage_free(EnviStage *stage);
+
+#endif
@@ -0,0 +1,59 @@
+/* envi_uring.h
+ *  io_uring back-end of the I/O plans (Linux 5.6 or later). The segments
+ *  of a plan are submitted to the kernel queue_depth at a time instead of
+ *  one blocking pread each, so that random reads are bounded by the IOPS
+ *  of the device rather than by the latency of the syscalls. The rings
+ *  are set up with the raw syscalls (no liburing). */
+#ifndef ENVI_URING_H
+#define ENVI_URING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_transpose.h"
+
+/* ENVI_URING_QUEUE_DEPTH: default number of reads in flight (queue_depth
+ * 0). ENVI_URING_QUEUE_DEPTH_MAX: upper bound of the queue depth.
+ * ENVI_URING_BUF_SIZE: size (bytes) of the ring buffer holding the
+ * segments in flight (at least max_segment of the plan). */
+#ifndef ENVI_URING_QUEUE_DEPTH
+#define ENVI_URING_QUEUE_DEPTH 64
+#endif
+#ifndef ENVI_URING_QUEUE_DEPTH_MAX
+#define ENVI_URING_QUEUE_DEPTH_MAX 4096
+#endif
+#ifndef ENVI_URING_BUF_SIZE
+#define ENVI_URING_BUF_SIZE (16*1024*1024)
+#endif
+
+/* function : envi_uring_supported
+ *  Evaluate if the running kernel provides io_uring with IORING_OP_READ
+ *  (probed once). false where the library was built without io_uring, or
+ *  if io_uring is disabled (kernel.io_uring_disabled, seccomp). */
+extern bool envi_uring_supported(void);
+
+/* function : envi_uring_use
+ *  Evaluate if a plan read with read_mode goes through
+ *  envi_ioplan_execute_uring: read_mode is ENVI_READ_URING, the plan
+ *  reads around the block cache and io_uring is supported. The readers
+ *  fall back to their pread (or fread) execution otherwise. */
+extern bool envi_uring_use(EnviReadMode read_mode, const EnviIOPlan *plan);
+
+/* function : envi_ioplan_execute_uring
+ *  Same as envi_ioplan_execute, with the segments of the plan read
+ *  through an io_uring of queue_depth entries (0: ENVI_URING_QUEUE_DEPTH)
+ *  by the calling thread. The reads complete in any order, and the
+ *  segments are copied into the stage in plan order as soon as they are
+ *  complete. If layout is NULL, the pieces are copied to subimg +
+ *  dst_offset as in envi_ioplan_execute_fread. If layout is NULL or the
+ *  identity, a segment consisting of a single piece is read directly into
+ *  subimg when the kernel is plain. The segments are read with pread one
+ *  after the other if the ring cannot be set up, and through the block
+ *  cache if the plan has one.
+ *  Returns 0 on success, -4 if reading failed, and -5 if memory
+ *  allocation failed. */
+extern int envi_ioplan_execute_uring(const EnviIOPlan *plan, int fd,
+        char *subimg, const EnviLayout *layout, size_t queue_depth);
+
+#endif
@@ -1,61 +1,90 @@
-/* envi.h */
+/* envi_v2.h 
+ *  MEX adapter of the I/O core (envi_io.h): conversions between mxArrays
+ *  and the structs of the core, and the parts shared by the gateways. */
 #ifndef ENVI_V2_H
 #define ENVI_V2_H
 
 #include <stdint.h>
 #include <stdbool.h>
-// #include <string.h> 
 #include "mex.h"
 #include "matrix.h"
-
-typedef enum EnviHeaderInterleave {
-    BSQ,BIP,BIL
-} EnviHeaderInterleave ;
-
-typedef struct EnviHeader {
-    int32_T samples;
-    int32_T lines;
-    int32_T bands;
-    int32_T data_type;
-    int32_T byte_order;
-    int32_T header_offset;
-    EnviHeaderInterleave interleave;
-    char* file_type;
-    double data_ignore_value;
-} EnviHeader ;
+#include "envi_io.h"
+#include "envi_readplan.h"
+#include "envi_tileiter.h"
 
 extern EnviHeader mxGetEnviHeader(const mxArray *pm);
-extern bool isComputerLSBF(void);
-
-/* function : swapFloat_shuffle 
- *  swap the bytes of the input float variable into the reverse direction 
- *  for resolving endian issues using byte shuffling.  
- *  Input Parameters
- *    float inFolat: input float before swapped 
- *  Returns
- *    float retVal : output float after swapped */
-extern float swapFloat_shuffle( float inFloat );
-
-/* function : swapFloat 
- *  swap the bytes of the input float variable into the reverse direction 
- *  for resolving endian issues using bit shifts. 
- *  Input Parameters
- *    float inFolat: input float before swapped 
- *  Returns
- *    float retVal : output float after swapped */
-extern float swapFloat( const float inFloat );
-
-extern int lazyenvireadRectx_multBand(char *imgpath, EnviHeader hdr, 
-        long int* smpl_skipszlist, size_t* smpl_readszlist, 
-        size_t N_smpl_skipread, long int smpl_skip_last,
-        long int* line_skipszlist, size_t* line_readszlist,
-        size_t N_line_skipread, long int line_skip_last,
-        long int* band_skipszlist, size_t* band_readszlist,
-        size_t N_band_skipread, long int band_skip_last,
-        void *subimg, size_t *dims_subimg, size_t sz);
-
-extern int image_byteswapFloat(float* img, size_t *dims_img, int32_t byte_order);
-extern int image_byteswapInt16(int16_t* img, size_t *dims_img, int32_t byte_order);
-extern int image_byteswapUint16(uint16_t* img, size_t *dims_img, int32_t byte_order);
+extern EnviReadOption mxGetEnviReadOption(const mxArray *pm);
+
+/* function : mxEnviControlCommand
+ *  Handle the control commands passed to a reader MEX file as its 
+ *  arguments, for the block cache (see envi_cache.h):
+ *    ('-cache','configure'[,capacity[,block_size]])
+ *        set the capacity (bytes, 0 disables the cache; default 
+ *        ENVI_CACHE_CAPACITY_DEFAULT) and the block size (bytes). The MEX
+ *        file stays locked in memory while the cache is enabled.
+ *    ('-cache','stats')  get the counters
+ *    ('-cache','clear')  drop the blocks and reset the counters
+ *  and for the pool of open image files (see envi_filepool.h):
+ *    ('-files','configure'[,capacity])  set the number of pooled files 
+ *                                       (0 disables the pool)
+ *    ('-files','stats')                 get the counters
+ *    ('-files','close',imgpath)         close the pooled file of imgpath
+ *    ('-files','flush')                 close all the pooled files
+ *  Every command returns the counters as a struct in plhs[0]. It also 
+ *  registers the exit function freeing the cache and closing the pooled
+ *  files, so it is called first by the gateway of every reader.
+ *  Returns false if the arguments are not a control command. */
+extern bool mxEnviControlCommand(int nlhs, mxArray *plhs[], int nrhs, 
+        const mxArray *prhs[]);
+
+/* function : envi_data_type_to_mxClassID
+ *  mxClassID of the ENVI data_type (of the real part for complex types). */
+extern mxClassID envi_data_type_to_mxClassID(int32_t data_type);
+
+#if !MX_HAS_INTERLEAVED_COMPLEX
+/* function : split_complex_mxArray
+ *  Split interleaved complex data (real and imaginary parts of szpart
+ *  bytes each) into the real and imaginary arrays of the complex mxArray.
+ */
+extern void split_complex_mxArray(mxArray *mx, const void *cx, 
+        size_t szpart);
+#endif
+
+/* function : mxCreateEnviIOPlanStats
+ *  Struct with the fields n_syscalls, n_copies, bytes_read and bytes_used
+ *  of stats. */
+extern mxArray *mxCreateEnviIOPlanStats(const EnviIOPlanStats *stats);
+
+/* function : mxEnviErrMsg
+ *  Raise the MATLAB error of the error code errflg returned by a reader 
+ *  of the core for imgpath, with the identifier prefixed by mexname. Does
+ *  nothing if errflg is 0. */
+extern void mxEnviErrMsg(const char *mexname, int errflg, 
+        const char *imgpath);
+
+/* function : mxEnviReadPlanRegister
+ *  Keep the prepared read rp (malloc'ed, owned by the MEX file from now
+ *  on) across the calls and return its handle, a positive integer that is
+ *  never reused. The MEX file stays locked in memory while it holds 
+ *  plans, which are freed when it is cleared. */
+extern double mxEnviReadPlanRegister(EnviReadPlan *rp);
+
+/* function : mxGetEnviReadPlan
+ *  Prepared read of the handle pm. Raises an error if pm is not the 
+ *  handle of a registered plan. */
+extern EnviReadPlan *mxGetEnviReadPlan(const mxArray *pm);
+
+/* function : mxEnviReadPlanRelease
+ *  Free the prepared read of the handle pm (nothing if it is not 
+ *  registered). */
+extern void mxEnviReadPlanRelease(const mxArray *pm);
+
+/* function : mxEnviTileIterRegister, mxGetEnviTileIter, 
+ *            mxEnviTileIterRelease
+ *  Same as the functions of the prepared reads above for the tile 
+ *  iterators (see envi_tileiter.h). The handles of both are distinct. */
+extern double mxEnviTileIterRegister(EnviTileIter *it);
+extern EnviTileIter *mxGetEnviTileIter(const mxArray *pm);
+extern void mxEnviTileIterRelease(const mxArray *pm);
 
 #endif
@@ -0,0 +1,502 @@
+/* envi_cache.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_cache.h"
+
+#if !defined(ENVI_HAS_PTHREAD) && (defined(__unix__) || defined(__APPLE__))
+#define ENVI_HAS_PTHREAD
+#endif
+
+#if defined(ENVI_HAS_PTHREAD)
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* EnviCacheRecord
+ *  The version (size,mtime,ctime) of a file (dev,ino) that has blocks in
+ *  the cache. Its generation is incremented whenever the file is opened
+ *  with another version, which invalidates the blocks at once: a block is
+ *  current while it has the generation of its record. The record is
+ *  freed with the last of its nblocks blocks. Records are chained in
+ *  their hash bucket (hnext). */
+typedef struct EnviCacheRecord {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    int64_t ctime;
+    uint64_t generation;
+    size_t nblocks;
+    struct EnviCacheRecord *hnext;
+} EnviCacheRecord ;
+
+/* EnviCacheBlock
+ *  Block index of the file of record holding nbytes bytes, read at the
+ *  generation of the record. Blocks are chained in their hash bucket
+ *  (hnext) and in the LRU list (prev,next; most recently used first). */
+typedef struct EnviCacheBlock {
+    EnviCacheRecord *record;
+    uint64_t generation;
+    uint64_t index;
+    size_t nbytes;
+    struct EnviCacheBlock *hnext;
+    struct EnviCacheBlock *prev;
+    struct EnviCacheBlock *next;
+    char *data;
+} EnviCacheBlock ;
+
+/* EnviCache
+ *  The process-wide cache. generation is incremented whenever the cache is
+ *  configured or cleared, so that blocks read across it are not inserted.
+ *  The blocks and the records have nbuckets buckets each.
+ */
+typedef struct EnviCache {
+    pthread_mutex_t mutex;
+    EnviCacheBlock **buckets;
+    EnviCacheRecord **records;
+    size_t nbuckets;
+    EnviCacheBlock *head;
+    EnviCacheBlock *tail;
+    size_t generation;
+    EnviCacheStats stats;
+} EnviCache ;
+
+static EnviCache envi_cache = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, NULL,
+    NULL, 0, { 0 } };
+
+static size_t envi_cache_hash(uint64_t dev, uint64_t ino, uint64_t index)
+{
+    uint64_t h;
+
+    h = (dev * 0x9E3779B97F4A7C15ULL) ^ (ino * 0xC2B2AE3D27D4EB4FULL)
+        ^ (index * 0x165667B19E3779F9ULL);
+    h ^= h >> 29;
+    return (size_t) (h & (uint64_t) (envi_cache.nbuckets - 1));
+}
+
+static bool envi_cache_record_is_version(const EnviCacheRecord *rec,
+        const EnviCacheFile *file)
+{
+    return rec->size == file->size && rec->mtime == file->mtime
+            && rec->ctime == file->ctime;
+}
+
+/* function : envi_cache_block_is_current
+ *  Evaluate if the block is valid for the version of file. */
+static bool envi_cache_block_is_current(const EnviCacheBlock *blk,
+        const EnviCacheFile *file)
+{
+    return blk->generation == blk->record->generation
+            && envi_cache_record_is_version(blk->record, file);
+}
+
+/* function : envi_cache_record_find
+ *  Record of the file (dev,ino), or NULL. The mutex is held. */
+static EnviCacheRecord *envi_cache_record_find(uint64_t dev, uint64_t ino)
+{
+    EnviCacheRecord *rec;
+
+    rec = envi_cache.records[envi_cache_hash(dev, ino, 0)];
+    while(rec != NULL && (rec->dev != dev || rec->ino != ino))
+        rec = rec->hnext;
+    return rec;
+}
+
+/* function : envi_cache_unlink
+ *  Remove the block from its bucket and the LRU list, and free it (and 
+ *  its record if it was the last block of the file). The mutex is held. */
+static void envi_cache_unlink(EnviCacheBlock *blk)
+{
+    EnviCacheBlock **p;
+    EnviCacheRecord **q, *rec;
+
+    rec = blk->record;
+    p = &envi_cache.buckets[envi_cache_hash(rec->dev, rec->ino, blk->index)];
+    while(*p != blk)
+        p = &(*p)->hnext;
+    *p = blk->hnext;
+    if(blk->prev != NULL) blk->prev->next = blk->next;
+    else envi_cache.head = blk->next;
+    if(blk->next != NULL) blk->next->prev = blk->prev;
+    else envi_cache.tail = blk->prev;
+    envi_cache.stats.nblocks--;
+    envi_cache.stats.nbytes -= blk->nbytes;
+    free(blk);
+    if(--rec->nblocks == 0){
+        q = &envi_cache.records[envi_cache_hash(rec->dev, rec->ino, 0)];
+        while(*q != rec)
+            q = &(*q)->hnext;
+        *q = rec->hnext;
+        free(rec);
+    }
+}
+
+static void envi_cache_touch(EnviCacheBlock *blk)
+{
+    if(blk == envi_cache.head)
+        return;
+    blk->prev->next = blk->next;
+    if(blk->next != NULL) blk->next->prev = blk->prev;
+    else envi_cache.tail = blk->prev;
+    blk->prev = NULL;
+    blk->next = envi_cache.head;
+    envi_cache.head->prev = blk;
+    envi_cache.head = blk;
+}
+
+/* function : envi_cache_find
+ *  Block of the file with the index, or NULL. A block of another version
+ *  of the file is invalidated. The mutex is held. */
+static EnviCacheBlock *envi_cache_find(const EnviCacheFile *file,
+        uint64_t index)
+{
+    EnviCacheBlock *blk;
+
+    blk = envi_cache.buckets[envi_cache_hash(file->dev, file->ino, index)];
+    while(blk != NULL){
+        if(blk->record->dev == file->dev && blk->record->ino == file->ino
+                && blk->index == index)
+            break;
+        blk = blk->hnext;
+    }
+    if(blk != NULL && !envi_cache_block_is_current(blk, file)){
+        envi_cache_unlink(blk);
+        envi_cache.stats.invalidations++;
+        blk = NULL;
+    }
+    return blk;
+}
+
+/* function : envi_cache_insert
+ *  Insert the block of file as the most recently used one, evicting the 
+ *  least recently used blocks to stay within the capacity. Returns false
+ *  (the block is not inserted) if the cache holds another version of the
+ *  file, or if memory allocation failed. The mutex is held. */
+static bool envi_cache_insert(EnviCacheBlock *blk, const EnviCacheFile *file)
+{
+    EnviCacheRecord *rec;
+    size_t h;
+
+    rec = envi_cache_record_find(file->dev, file->ino);
+    if(rec != NULL && !envi_cache_record_is_version(rec, file))
+        return false;
+    while(envi_cache.tail != NULL
+            && envi_cache.stats.nbytes + blk->nbytes
+                > envi_cache.stats.capacity){
+        if(envi_cache.tail->record == rec && rec->nblocks == 1)
+            rec = NULL;
+        if(envi_cache.tail->generation == envi_cache.tail->record->generation)
+            envi_cache.stats.evictions++;
+        else
+            envi_cache.stats.invalidations++;
+        envi_cache_unlink(envi_cache.tail);
+    }
+    if(rec == NULL){
+        rec = (EnviCacheRecord*) malloc(sizeof(EnviCacheRecord));
+        if(rec == NULL)
+            return false;
+        rec->dev = file->dev;
+        rec->ino = file->ino;
+        rec->size = file->size;
+        rec->mtime = file->mtime;
+        rec->ctime = file->ctime;
+        rec->generation = 0;
+        rec->nblocks = 0;
+        h = envi_cache_hash(rec->dev, rec->ino, 0);
+        rec->hnext = envi_cache.records[h];
+        envi_cache.records[h] = rec;
+    }
+    blk->record = rec;
+    blk->generation = rec->generation;
+    rec->nblocks++;
+    h = envi_cache_hash(rec->dev, rec->ino, blk->index);
+    blk->hnext = envi_cache.buckets[h];
+    envi_cache.buckets[h] = blk;
+    blk->prev = NULL;
+    blk->next = envi_cache.head;
+    if(envi_cache.head != NULL) envi_cache.head->prev = blk;
+    else envi_cache.tail = blk;
+    envi_cache.head = blk;
+    envi_cache.stats.nblocks++;
+    envi_cache.stats.nbytes += blk->nbytes;
+    return true;
+}
+
+/* function : envi_cache_drop
+ *  Free all the blocks and reset the counters. The mutex is held. */
+static void envi_cache_drop(void)
+{
+    EnviCacheBlock *blk, *next;
+    EnviCacheRecord *rec, *rnext;
+    size_t capacity, block_size, h;
+
+    for(blk=envi_cache.head;blk!=NULL;blk=next){
+        next = blk->next;
+        free(blk);
+    }
+    envi_cache.head = NULL;
+    envi_cache.tail = NULL;
+    if(envi_cache.buckets != NULL)
+        memset(envi_cache.buckets, 0,
+            envi_cache.nbuckets*sizeof(EnviCacheBlock*));
+    for(h=0;envi_cache.records!=NULL && h<envi_cache.nbuckets;h++){
+        for(rec=envi_cache.records[h];rec!=NULL;rec=rnext){
+            rnext = rec->hnext;
+            free(rec);
+        }
+        envi_cache.records[h] = NULL;
+    }
+    capacity = envi_cache.stats.capacity;
+    block_size = envi_cache.stats.block_size;
+    memset(&envi_cache.stats, 0, sizeof(EnviCacheStats));
+    envi_cache.stats.capacity = capacity;
+    envi_cache.stats.block_size = block_size;
+    envi_cache.generation++;
+}
+
+int envi_cache_configure(size_t capacity, size_t block_size)
+{
+    EnviCacheBlock **buckets;
+    EnviCacheRecord **records;
+    size_t nbuckets;
+
+    if(block_size == 0)
+        block_size = ENVI_CACHE_BLOCK_SIZE;
+    buckets = NULL;
+    records = NULL;
+    nbuckets = 0;
+    if(capacity > 0){
+        /* about two buckets per block */
+        nbuckets = 64;
+        while(nbuckets < 2 * (capacity / block_size))
+            nbuckets *= 2;
+        buckets = (EnviCacheBlock**) calloc(nbuckets,
+                    sizeof(EnviCacheBlock*));
+        records = (EnviCacheRecord**) calloc(nbuckets,
+                    sizeof(EnviCacheRecord*));
+        if(buckets == NULL || records == NULL){
+            free(buckets);
+            free(records);
+            return -5;
+        }
+    }
+    pthread_mutex_lock(&envi_cache.mutex);
+    envi_cache_drop();
+    free(envi_cache.buckets);
+    free(envi_cache.records);
+    envi_cache.buckets = buckets;
+    envi_cache.records = records;
+    envi_cache.nbuckets = nbuckets;
+    envi_cache.stats.capacity = capacity;
+    envi_cache.stats.block_size = (capacity > 0) ? block_size : 0;
+    pthread_mutex_unlock(&envi_cache.mutex);
+    return 0;
+}
+
+void envi_cache_clear(void)
+{
+    pthread_mutex_lock(&envi_cache.mutex);
+    envi_cache_drop();
+    pthread_mutex_unlock(&envi_cache.mutex);
+}
+
+bool envi_cache_enabled(void)
+{
+    bool enabled;
+
+    pthread_mutex_lock(&envi_cache.mutex);
+    enabled = envi_cache.stats.capacity > 0;
+    pthread_mutex_unlock(&envi_cache.mutex);
+    return enabled;
+}
+
+void envi_cache_get_stats(EnviCacheStats *stats)
+{
+    pthread_mutex_lock(&envi_cache.mutex);
+    *stats = envi_cache.stats;
+    pthread_mutex_unlock(&envi_cache.mutex);
+}
+
+int envi_cache_file_init(EnviCacheFile *file, int fd)
+{
+    struct stat st;
+    EnviCacheRecord *rec;
+
+    if(fstat(fd, &st) != 0)
+        return -1;
+    file->fd = fd;
+    file->dev = (uint64_t) st.st_dev;
+    file->ino = (uint64_t) st.st_ino;
+    file->size = (uint64_t) st.st_size;
+#if defined(__APPLE__)
+    file->mtime = (int64_t) st.st_mtimespec.tv_sec * 1000000000
+                + (int64_t) st.st_mtimespec.tv_nsec;
+    file->ctime = (int64_t) st.st_ctimespec.tv_sec * 1000000000
+                + (int64_t) st.st_ctimespec.tv_nsec;
+#else
+    file->mtime = (int64_t) st.st_mtim.tv_sec * 1000000000
+                + (int64_t) st.st_mtim.tv_nsec;
+    file->ctime = (int64_t) st.st_ctim.tv_sec * 1000000000
+                + (int64_t) st.st_ctim.tv_nsec;
+#endif
+
+    /* the blocks of another version of the file are invalidated at once
+     * by a new generation of its record, and freed when they are found or
+     * reach the tail of the LRU list. */
+    pthread_mutex_lock(&envi_cache.mutex);
+    rec = (envi_cache.records != NULL)
+        ? envi_cache_record_find(file->dev, file->ino) : NULL;
+    if(rec != NULL && !envi_cache_record_is_version(rec, file)){
+        rec->size = file->size;
+        rec->mtime = file->mtime;
+        rec->ctime = file->ctime;
+        rec->generation++;
+    }
+    pthread_mutex_unlock(&envi_cache.mutex);
+    return 0;
+}
+
+/* function : envi_cache_pread_full
+ *  pread n bytes at the offset of the file, retrying on short reads and
+ *  interrupts. Returns 0 on success and -4 on failure. */
+static int envi_cache_pread_full(int fd, char *buf, size_t n, off_t offset)
+{
+    ssize_t nread;
+
+    while(n > 0){
+        nread = pread(fd, buf, n, offset);
+        if(nread < 0){
+            if(errno == EINTR) continue;
+            return -4;
+        } else if(nread == 0){
+            return -4;
+        }
+        buf += nread; offset += nread; n -= (size_t) nread;
+    }
+    return 0;
+}
+
+int envi_cache_pread(const EnviCacheFile *file, char *dst,
+        size_t nbytes, uint64_t offset)
+{
+    EnviCacheBlock *blk;
+    size_t block_size, generation, skip, n;
+    uint64_t index;
+    int errflg;
+
+    pthread_mutex_lock(&envi_cache.mutex);
+    block_size = envi_cache.stats.block_size;
+    generation = envi_cache.generation;
+    /* reads larger than half of the cache would only flush it */
+    if(block_size == 0 || nbytes > envi_cache.stats.capacity / 2){
+        if(block_size > 0)
+            envi_cache.stats.bytes_bypass += nbytes;
+        pthread_mutex_unlock(&envi_cache.mutex);
+        return envi_cache_pread_full(file->fd, dst, nbytes, (off_t) offset);
+    }
+    pthread_mutex_unlock(&envi_cache.mutex);
+    if(offset + nbytes > file->size)
+        return -4;
+
+    while(nbytes > 0){
+        index = offset / block_size;
+        skip = (size_t) (offset - index * block_size);
+        n = block_size - skip;
+        if(n > nbytes) n = nbytes;
+
+        pthread_mutex_lock(&envi_cache.mutex);
+        blk = (envi_cache.generation == generation)
+            ? envi_cache_find(file, index) : NULL;
+        if(blk != NULL){
+            envi_cache_touch(blk);
+            memcpy(dst, blk->data + skip, n);
+            envi_cache.stats.hits++;
+            envi_cache.stats.bytes_hit += n;
+            pthread_mutex_unlock(&envi_cache.mutex);
+        } else {
+            pthread_mutex_unlock(&envi_cache.mutex);
+            /* the whole block is read without holding the mutex */
+            blk = (EnviCacheBlock*) malloc(sizeof(EnviCacheBlock)
+                    + block_size);
+            if(blk == NULL)
+                return -5;
+            blk->index = index;
+            blk->data = (char*) (blk + 1);
+            blk->nbytes = (file->size - index * block_size > block_size)
+                ? block_size : (size_t) (file->size - index * block_size);
+            errflg = envi_cache_pread_full(file->fd, blk->data, blk->nbytes,
+                        (off_t) (index * block_size));
+            if(errflg != 0){
+                free(blk);
+                return errflg;
+            }
+            memcpy(dst, blk->data + skip, n);
+
+            /* another thread may have cached the block meanwhile, or the
+             * cache may have been reconfigured or cleared. */
+            pthread_mutex_lock(&envi_cache.mutex);
+            envi_cache.stats.misses++;
+            envi_cache.stats.bytes_miss += blk->nbytes;
+            if(envi_cache.generation == generation
+                    && blk->nbytes <= envi_cache.stats.capacity
+                    && envi_cache_find(file, index) == NULL
+                    && envi_cache_insert(blk, file)){
+                blk = NULL;
+            }
+            pthread_mutex_unlock(&envi_cache.mutex);
+            free(blk);
+        }
+        dst += n; offset += n; nbytes -= n;
+    }
+    return 0;
+}
+
+void envi_cache_free(void)
+{
+    envi_cache_configure(0, 0);
+}
+
+#else
+/* no POSIX pread: the cache is not available and stays disabled. */
+
+int envi_cache_configure(size_t capacity, size_t block_size)
+{
+    return (capacity > 0) ? -1 : 0;
+}
+
+void envi_cache_clear(void)
+{
+}
+
+void envi_cache_free(void)
+{
+}
+
+bool envi_cache_enabled(void)
+{
+    return false;
+}
+
+void envi_cache_get_stats(EnviCacheStats *stats)
+{
+    memset(stats, 0, sizeof(EnviCacheStats));
+}
+
+int envi_cache_file_init(EnviCacheFile *file, int fd)
+{
+    return -1;
+}
+
+int envi_cache_pread(const EnviCacheFile *file, char *dst,
+        size_t nbytes, uint64_t offset)
+{
+    return -4;
+}
+#endif
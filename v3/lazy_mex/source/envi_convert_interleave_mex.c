@@ -0,0 +1,203 @@
+/* =====================================================================
+ * envi_convert_interleave_mex.c
+ * Convert an image cube in memory from one interleave to another with
+ * the cache-blocked, multithreaded transpose kernel of the readers.
+ * The layouts are named after the order of their dimensions:
+ *   'bsq' [samples x lines x bands]
+ *   'bil' [samples x bands x lines]
+ *   'bip' [bands x samples x lines]
+ *   'lsb' [lines x samples x bands] (layout returned by the readers)
+ * The first three are the order of the data in ENVI files of the
+ * corresponding interleave.
+ *
+ * INPUTS:
+ * 0 img           numeric or logical array in the layout from
+ * 1 from          char*, layout of img
+ * 2 to            char*, layout of the output
+ * 3 num_threads   integer (optional), number of threads (0: automatic)
+ *
+ * OUTPUTS:
+ * 0 img_out       array of the class of img in the layout to.
+ *
+ *
+ * This is a MEX file for MATLAB.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include "io64.h"
+#include "mex.h"
+#include "matrix.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_v2.h"
+#include "envi_ioplan.h"
+#include "envi_transpose.h"
+
+/* function : envi_interleave_axes
+ *  Set axes to the dimensions (0: samples, 1: lines, 2: bands) of the
+ *  layout name, from the fastest to the slowest. Returns 0 on success and
+ *  -1 if name is not a layout. */
+static int envi_interleave_axes(const char *name, int *axes)
+{
+    if(strcmp(name,"bsq")==0){
+        axes[0] = 0; axes[1] = 1; axes[2] = 2;
+    } else if(strcmp(name,"bil")==0){
+        axes[0] = 0; axes[1] = 2; axes[2] = 1;
+    } else if(strcmp(name,"bip")==0){
+        axes[0] = 2; axes[1] = 0; axes[2] = 1;
+    } else if(strcmp(name,"lsb")==0){
+        axes[0] = 1; axes[1] = 0; axes[2] = 2;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* function : envi_convert_interleave
+ *  Transpose the image of n_in (its dimensions in the input layout) with
+ *  elements of sz bytes. The output strides are derived from axes_in and
+ *  axes_out. Returns 0 on success and -5 if memory allocation failed. */
+static int envi_convert_interleave(char *dst, const char *src,
+        const size_t *n_in, const int *axes_in, const int *axes_out,
+        size_t sz, size_t num_threads)
+{
+    EnviLayout layout;
+    size_t ext[3], stride[3], o[3];
+    int i;
+
+    for(i=0;i<3;i++)
+        ext[axes_in[i]] = n_in[i];
+    stride[axes_out[0]] = 1;
+    stride[axes_out[1]] = ext[axes_out[0]];
+    stride[axes_out[2]] = ext[axes_out[0]] * ext[axes_out[1]];
+    for(i=0;i<3;i++)
+        o[i] = stride[axes_in[i]];
+    envi_layout_init(&layout, n_in, o, sz);
+    return envi_layout_transpose(&layout, dst, src, sz, num_threads);
+}
+
+/* The gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    char *from, *to;
+    int axes_in[3], axes_out[3];
+    mwSize ndim;
+    const mwSize *dims_in;
+    mwSize dims_out[3];
+    size_t n_in[3], ext[3];
+    size_t num_threads, sz, nrows;
+    int i, errflg;
+
+    /* -----------------------------------------------------------------
+     * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
+     * ----------------------------------------------------------------- */
+    if(nrhs!=3 && nrhs!=4) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:nrhs",
+                "Three or four inputs required.");
+    }
+    if(nlhs>1) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:nlhs",
+                "One output required.");
+    }
+    if( !mxIsNumeric(prhs[0]) && !mxIsLogical(prhs[0]) ) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:notNumeric",
+                "Input 0 (img) needs to be a numeric or logical array.");
+    }
+    if( !mxIsChar(prhs[1]) ) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:notChar",
+                "Input 1 (from) needs to be a string.");
+    }
+    if( !mxIsChar(prhs[2]) ) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:notChar",
+                "Input 2 (to) needs to be a string.");
+    }
+    if( nrhs>3 && (!mxIsNumeric(prhs[3]) || mxGetNumberOfElements(prhs[3])!=1) ) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:notScalar",
+                "Input 3 (num_threads) needs to be a scalar.");
+    }
+    ndim = mxGetNumberOfDimensions(prhs[0]);
+    if(ndim > 3) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:DimensionMismatch",
+                "Input 0 (img) needs to have at most three dimensions.");
+    }
+
+    /* -----------------------------------------------------------------
+     * I/O SETUPs
+     * ----------------------------------------------------------------- */
+    from = mxArrayToString(prhs[1]);
+    to   = mxArrayToString(prhs[2]);
+    if(envi_interleave_axes(from, axes_in) != 0) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:InvalidLayout",
+                "Input 1 (from) needs to be 'bsq', 'bil', 'bip', or 'lsb'.");
+    }
+    if(envi_interleave_axes(to, axes_out) != 0) {
+        mexErrMsgIdAndTxt(
+                "envi_convert_interleave_mex:InvalidLayout",
+                "Input 2 (to) needs to be 'bsq', 'bil', 'bip', or 'lsb'.");
+    }
+    mxFree(from);
+    mxFree(to);
+    num_threads = (nrhs>3) ? (size_t) mxGetScalar(prhs[3]) : 0;
+
+    dims_in = mxGetDimensions(prhs[0]);
+    for(i=0;i<3;i++){
+        n_in[i] = (i < (int) ndim) ? (size_t) dims_in[i] : 1;
+        ext[axes_in[i]] = n_in[i];
+    }
+    for(i=0;i<3;i++)
+        dims_out[i] = (mwSize) ext[axes_out[i]];
+
+    plhs[0] = mxCreateNumericArray(3, dims_out, mxGetClassID(prhs[0]),
+        mxIsComplex(prhs[0]) ? mxCOMPLEX : mxREAL);
+    if(mxIsEmpty(plhs[0]))
+        return;
+
+    /* -----------------------------------------------------------------
+     * CALL MAIN COMPUTATION ROUTINE
+     * ----------------------------------------------------------------- */
+    sz = mxGetElementSize(prhs[0]);
+    nrows = n_in[1] * n_in[2];
+    num_threads = envi_get_num_threads(num_threads, nrows);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    /* complex elements are transposed as a whole (mxGetElementSize counts
+     * both parts). */
+    errflg = envi_convert_interleave((char*) mxGetData(plhs[0]),
+        (const char*) mxGetData(prhs[0]), n_in, axes_in, axes_out,
+        sz, num_threads);
+#else
+    errflg = envi_convert_interleave((char*) mxGetData(plhs[0]),
+        (const char*) mxGetData(prhs[0]), n_in, axes_in, axes_out,
+        sz, num_threads);
+    if(errflg==0 && mxIsComplex(prhs[0])){
+        errflg = envi_convert_interleave((char*) mxGetImagData(plhs[0]),
+            (const char*) mxGetImagData(prhs[0]), n_in, axes_in, axes_out,
+            sz, num_threads);
+    }
+#endif
+    if(errflg == -5){
+        mexErrMsgIdAndTxt("envi_convert_interleave_mex:OutOfMemory",
+            "Memory allocation failed.");
+    }
+}
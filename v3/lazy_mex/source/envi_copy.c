@@ -0,0 +1,572 @@
+/* envi_copy.c */
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "envi_copy.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+        && (defined(__x86_64__) || defined(__i386__))
+#define ENVI_HAS_X86_SIMD
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENVI_HAS_NEON
+#include <arm_neon.h>
+#endif
+
+/* function : envi_swap_scalar
+ *  Scalar byte swap of n elements of sz bytes. */
+static void envi_swap_scalar(char *dst, const char *src, size_t n, size_t sz)
+{
+    size_t i;
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+
+    switch(sz){
+        case 2:
+            for(i=0;i<n;i++){
+                memcpy(&v16, src+2*i, 2);
+                v16 = (uint16_t) ((v16<<8) | (v16>>8));
+                memcpy(dst+2*i, &v16, 2);
+            }
+            break;
+        case 4:
+            for(i=0;i<n;i++){
+                memcpy(&v32, src+4*i, 4);
+                v32 = (v32<<24) | ((v32<<8) & 0x00FF0000u)
+                      | ((v32>>8) & 0x0000FF00u) | (v32>>24);
+                memcpy(dst+4*i, &v32, 4);
+            }
+            break;
+        case 8:
+            for(i=0;i<n;i++){
+                memcpy(&v64, src+8*i, 8);
+                v64 = ((v64 & 0x00000000FFFFFFFFull) << 32)
+                      | ((v64 & 0xFFFFFFFF00000000ull) >> 32);
+                v64 = ((v64 & 0x0000FFFF0000FFFFull) << 16)
+                      | ((v64 & 0xFFFF0000FFFF0000ull) >> 16);
+                v64 = ((v64 & 0x00FF00FF00FF00FFull) << 8)
+                      | ((v64 & 0xFF00FF00FF00FF00ull) >> 8);
+                memcpy(dst+8*i, &v64, 8);
+            }
+            break;
+        default:
+            if(dst != src)
+                memmove(dst, src, n*sz);
+            break;
+    }
+}
+
+#if defined(ENVI_HAS_X86_SIMD)
+/* The shuffle masks reverse the bytes within each element of sz bytes,
+ * e.g. {1,0,3,2,...} for sz=2. */
+__attribute__((target("avx2")))
+static size_t envi_swap_avx2(char *dst, const char *src, size_t nbytes,
+        size_t sz)
+{
+    __m256i mask, v0, v1;
+    size_t i;
+
+    switch(sz){
+        case 2:
+            mask = _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+                                    1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+            break;
+        case 4:
+            mask = _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+                                    3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+            break;
+        default:
+            mask = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                    7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+            break;
+    }
+    for(i=0;i+64<=nbytes;i+=64){
+        v0 = _mm256_loadu_si256((const __m256i*) (src+i));
+        v1 = _mm256_loadu_si256((const __m256i*) (src+i+32));
+        _mm256_storeu_si256((__m256i*) (dst+i),
+            _mm256_shuffle_epi8(v0,mask));
+        _mm256_storeu_si256((__m256i*) (dst+i+32),
+            _mm256_shuffle_epi8(v1,mask));
+    }
+    for(;i+32<=nbytes;i+=32){
+        v0 = _mm256_loadu_si256((const __m256i*) (src+i));
+        _mm256_storeu_si256((__m256i*) (dst+i), _mm256_shuffle_epi8(v0,mask));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static size_t envi_swap_ssse3(char *dst, const char *src, size_t nbytes,
+        size_t sz)
+{
+    __m128i mask, v;
+    size_t i;
+
+    switch(sz){
+        case 2:
+            mask = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+            break;
+        case 4:
+            mask = _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+            break;
+        default:
+            mask = _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+            break;
+    }
+    for(i=0;i+16<=nbytes;i+=16){
+        v = _mm_loadu_si128((const __m128i*) (src+i));
+        _mm_storeu_si128((__m128i*) (dst+i), _mm_shuffle_epi8(v,mask));
+    }
+    return i;
+}
+
+/* 0: not evaluated yet, 1: scalar, 2: SSSE3, 3: AVX2. Concurrent first
+ * calls may evaluate it more than once, which is harmless. */
+static int envi_swap_isa = 0;
+
+static int envi_get_swap_isa(void)
+{
+    if(envi_swap_isa == 0){
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            envi_swap_isa = 3;
+        else if(__builtin_cpu_supports("ssse3"))
+            envi_swap_isa = 2;
+        else
+            envi_swap_isa = 1;
+    }
+    return envi_swap_isa;
+}
+#endif
+
+#if defined(ENVI_HAS_NEON)
+static size_t envi_swap_neon(char *dst, const char *src, size_t nbytes,
+        size_t sz)
+{
+    uint8x16_t v;
+    size_t i;
+
+    for(i=0;i+16<=nbytes;i+=16){
+        v = vld1q_u8((const uint8_t*) (src+i));
+        switch(sz){
+            case 2: v = vrev16q_u8(v); break;
+            case 4: v = vrev32q_u8(v); break;
+            default: v = vrev64q_u8(v); break;
+        }
+        vst1q_u8((uint8_t*) (dst+i), v);
+    }
+    return i;
+}
+#endif
+
+void envi_memcpy_swap(void *dst, const void *src, size_t n, size_t sz)
+{
+    char *dst_c = (char*) dst;
+    const char *src_c = (const char*) src;
+    size_t nbytes, ndone;
+
+    if(sz != 2 && sz != 4 && sz != 8){
+        if(dst != src)
+            memmove(dst, src, n*sz);
+        return;
+    }
+    nbytes = n*sz;
+    ndone = 0;
+#if defined(ENVI_HAS_X86_SIMD)
+    switch(envi_get_swap_isa()){
+        case 3: ndone = envi_swap_avx2(dst_c, src_c, nbytes, sz); break;
+        case 2: ndone = envi_swap_ssse3(dst_c, src_c, nbytes, sz); break;
+        default: break;
+    }
+#elif defined(ENVI_HAS_NEON)
+    ndone = envi_swap_neon(dst_c, src_c, nbytes, sz);
+#endif
+    envi_swap_scalar(dst_c+ndone, src_c+ndone, (nbytes-ndone)/sz, sz);
+}
+
+void envi_copy_swap(void *dst, const void *src, size_t nbytes,
+        size_t swap_sz)
+{
+    if(swap_sz > 1)
+        envi_memcpy_swap(dst, src, nbytes/swap_sz, swap_sz);
+    else
+        memcpy(dst, src, nbytes);
+}
+
+/* ---------------------------------------------------------------------
+ * Type conversion
+ *  envi_cvt_{f,s,u}_<type> convert a value read as double (floating point
+ *  sources), int64_t (signed sources), or uint64_t (unsigned sources) to
+ *  <type> with the rounding and saturation of MATLAB. 
+ * --------------------------------------------------------------------- */
+/* function : envi_isnan
+ *  NaN test on the bit pattern, which is not optimized away under 
+ *  -ffast-math (used by the MEX build). */
+static bool envi_isnan(double d)
+{
+    uint64_t u;
+    
+    memcpy(&u, &d, sizeof(u));
+    return (u & 0x7FF0000000000000ull) == 0x7FF0000000000000ull
+            && (u & 0x000FFFFFFFFFFFFFull) != 0;
+}
+
+#define ENVI_DEFINE_CVT_INT(NAME, T, TMIN, TMAX)                        \
+static T envi_cvt_f_##NAME(double d)                                    \
+{                                                                       \
+    if(envi_isnan(d)) return 0;                                         \
+    if(d >= (double) (TMAX)) return (TMAX);                             \
+    if(d <= (double) (TMIN)) return (TMIN);                             \
+    return (T) round(d);                                                \
+}                                                                       \
+static T envi_cvt_s_##NAME(int64_t v)                                   \
+{                                                                       \
+    if(v < (int64_t) (TMIN)) return (TMIN);                             \
+    if(v > 0 && (uint64_t) v > (uint64_t) (TMAX)) return (TMAX);        \
+    return (T) v;                                                       \
+}                                                                       \
+static T envi_cvt_u_##NAME(uint64_t v)                                  \
+{                                                                       \
+    return (v > (uint64_t) (TMAX)) ? (TMAX) : (T) v;                    \
+}
+
+ENVI_DEFINE_CVT_INT(int8,   int8_t,   INT8_MIN,  INT8_MAX)
+ENVI_DEFINE_CVT_INT(uint8,  uint8_t,  0,         UINT8_MAX)
+ENVI_DEFINE_CVT_INT(int16,  int16_t,  INT16_MIN, INT16_MAX)
+ENVI_DEFINE_CVT_INT(uint16, uint16_t, 0,         UINT16_MAX)
+ENVI_DEFINE_CVT_INT(int32,  int32_t,  INT32_MIN, INT32_MAX)
+ENVI_DEFINE_CVT_INT(uint32, uint32_t, 0,         UINT32_MAX)
+ENVI_DEFINE_CVT_INT(int64,  int64_t,  INT64_MIN, INT64_MAX)
+ENVI_DEFINE_CVT_INT(uint64, uint64_t, 0,         UINT64_MAX)
+
+#define envi_cvt_f_float(d)  ((float) (d))
+#define envi_cvt_s_float(v)  ((float) (v))
+#define envi_cvt_u_float(v)  ((float) (v))
+#define envi_cvt_f_double(d) ((double) (d))
+#define envi_cvt_s_double(v) ((double) (v))
+#define envi_cvt_u_double(v) ((double) (v))
+
+/* The source may not be aligned (odd header_offset), so the values are 
+ * loaded and stored with memcpy, which compiles to plain moves. */
+#define ENVI_CVT_LOOP(SRC_T, DST_T, CVT)                                \
+    for(i=0;i<n;i++){                                                   \
+        SRC_T v; DST_T r;                                               \
+        memcpy(&v, src+i*sizeof(SRC_T), sizeof(SRC_T));                \
+        r = CVT(v);                                                     \
+        memcpy(dst+i*sizeof(DST_T), &r, sizeof(DST_T));                 \
+    }
+
+#define ENVI_DEFINE_CONVERT(NAME, DST_T)                                \
+static void envi_convert_to_##NAME(char *dst, const char *src,         \
+        int32_t src_type, size_t n)                                     \
+{                                                                       \
+    size_t i;                                                           \
+    switch(src_type){                                                   \
+        case 1:  ENVI_CVT_LOOP(uint8_t,  DST_T, envi_cvt_u_##NAME) break; \
+        case 2:  ENVI_CVT_LOOP(int16_t,  DST_T, envi_cvt_s_##NAME) break; \
+        case 3:  ENVI_CVT_LOOP(int32_t,  DST_T, envi_cvt_s_##NAME) break; \
+        case 4:  ENVI_CVT_LOOP(float,    DST_T, envi_cvt_f_##NAME) break; \
+        case 5:  ENVI_CVT_LOOP(double,   DST_T, envi_cvt_f_##NAME) break; \
+        case 12: ENVI_CVT_LOOP(uint16_t, DST_T, envi_cvt_u_##NAME) break; \
+        case 13: ENVI_CVT_LOOP(uint32_t, DST_T, envi_cvt_u_##NAME) break; \
+        case 14: ENVI_CVT_LOOP(int64_t,  DST_T, envi_cvt_s_##NAME) break; \
+        case 15: ENVI_CVT_LOOP(uint64_t, DST_T, envi_cvt_u_##NAME) break; \
+        case 16: ENVI_CVT_LOOP(int8_t,   DST_T, envi_cvt_s_##NAME) break; \
+        default: break;                                                 \
+    }                                                                   \
+}
+
+ENVI_DEFINE_CONVERT(int8,   int8_t)
+ENVI_DEFINE_CONVERT(uint8,  uint8_t)
+ENVI_DEFINE_CONVERT(int16,  int16_t)
+ENVI_DEFINE_CONVERT(uint16, uint16_t)
+ENVI_DEFINE_CONVERT(int32,  int32_t)
+ENVI_DEFINE_CONVERT(uint32, uint32_t)
+ENVI_DEFINE_CONVERT(int64,  int64_t)
+ENVI_DEFINE_CONVERT(uint64, uint64_t)
+ENVI_DEFINE_CONVERT(float,  float)
+ENVI_DEFINE_CONVERT(double, double)
+
+/* function : envi_convert
+ *  Convert n values of src_type in src to dst_type in dst. */
+static void envi_convert(char *dst, int32_t dst_type, const char *src,
+        int32_t src_type, size_t n)
+{
+    switch(dst_type){
+        case 1:  envi_convert_to_uint8(dst, src, src_type, n);  break;
+        case 2:  envi_convert_to_int16(dst, src, src_type, n);  break;
+        case 3:  envi_convert_to_int32(dst, src, src_type, n);  break;
+        case 4:  envi_convert_to_float(dst, src, src_type, n);  break;
+        case 5:  envi_convert_to_double(dst, src, src_type, n); break;
+        case 12: envi_convert_to_uint16(dst, src, src_type, n); break;
+        case 13: envi_convert_to_uint32(dst, src, src_type, n); break;
+        case 14: envi_convert_to_int64(dst, src, src_type, n);  break;
+        case 15: envi_convert_to_uint64(dst, src, src_type, n); break;
+        case 16: envi_convert_to_int8(dst, src, src_type, n);   break;
+        default: break;
+    }
+}
+
+bool envi_copy_kernel_is_plain(const EnviCopyKernel *kernel)
+{
+    return kernel->src_type == kernel->dst_type;
+}
+
+/* function : envi_match_div
+ *  mask[i] = 1 if the i-th of the n values of type (ENVI data_type) in src
+ *  equals div, and 0 otherwise. The values are compared by their bits, 
+ *  which stays correct for NaN under -ffast-math; for floating point 
+ *  types, a zero div matches both 0 and -0. The loops are written 
+ *  branch-free so that they compile to SIMD compares. */
+#define ENVI_MATCH_LOOP(T,SIGN)                                         \
+    {                                                                   \
+        T d, d2;                                                        \
+        memcpy(&d, div, sizeof(T));                                     \
+        d2 = ((T) (d << 1) == 0) ? (T) (d ^ (SIGN)) : d;                \
+        for(i=0;i<n;i++){                                               \
+            T v;                                                        \
+            memcpy(&v, src+i*sizeof(T), sizeof(T));                     \
+            mask[i] = (uint8_t) ((v == d) | (v == d2));                 \
+        }                                                               \
+    }
+
+static void envi_match_div(uint8_t *mask, const char *src, int32_t type,
+        const unsigned char *div, size_t n)
+{
+    size_t i;
+    
+    switch(type){
+        case 4:  ENVI_MATCH_LOOP(uint32_t, UINT32_C(0x80000000)) break;
+        case 5:  ENVI_MATCH_LOOP(uint64_t, UINT64_C(0x8000000000000000)) break;
+        case 1:  case 16: ENVI_MATCH_LOOP(uint8_t,  0) break;
+        case 2:  case 12: ENVI_MATCH_LOOP(uint16_t, 0) break;
+        case 3:  case 13: ENVI_MATCH_LOOP(uint32_t, 0) break;
+        case 14: case 15: ENVI_MATCH_LOOP(uint64_t, 0) break;
+        default: memset(mask, 0, n); break;
+    }
+}
+
+/* function : envi_blend_repval
+ *  Replace the i-th of the n elements of sz bytes in dst with repval where
+ *  mask[i] is set. */
+#define ENVI_BLEND_LOOP(T)                                              \
+    {                                                                   \
+        T r;                                                            \
+        memcpy(&r, repval, sizeof(T));                                  \
+        for(i=0;i<n;i++){                                               \
+            T v;                                                        \
+            memcpy(&v, dst+i*sizeof(T), sizeof(T));                     \
+            v = mask[i] ? r : v;                                        \
+            memcpy(dst+i*sizeof(T), &v, sizeof(T));                     \
+        }                                                               \
+    }
+
+static void envi_blend_repval(char *dst, size_t sz, const uint8_t *mask,
+        const unsigned char *repval, size_t n)
+{
+    size_t i;
+    
+    switch(sz){
+        case 1: ENVI_BLEND_LOOP(uint8_t)  break;
+        case 2: ENVI_BLEND_LOOP(uint16_t) break;
+        case 4: ENVI_BLEND_LOOP(uint32_t) break;
+        case 8: ENVI_BLEND_LOOP(uint64_t) break;
+        default: break;
+    }
+}
+
+void envi_copy_kernel_set_div(EnviCopyKernel *kernel, double div,
+        bool replace, double repval, bool *valid, void *dst_base)
+{
+    double div_back;
+    
+    kernel->check_div = false;
+    kernel->replace_div = false;
+    kernel->dst_base = (char*) dst_base;
+    kernel->valid = valid;
+    if(envi_isnan(div) || kernel->ncomp != 1 || (!replace && valid == NULL))
+        return;
+    envi_convert((char*) kernel->div, kernel->src_type, (const char*) &div,
+        5, 1);
+    if(kernel->src_type != 4 && kernel->src_type != 5){
+        /* div needs to be representable in the integer type of the image;
+         * floating point images are compared with div rounded to their 
+         * type, as cast(div,'single') in MATLAB */
+        envi_convert((char*) &div_back, 5, (const char*) kernel->div,
+            kernel->src_type, 1);
+        if(div_back != div)
+            return;
+    }
+    envi_convert((char*) kernel->repval, kernel->dst_type,
+        (const char*) &repval, 5, 1);
+    kernel->check_div = true;
+    kernel->replace_div = replace;
+}
+
+/* function : envi_copy_kernel_apply_div
+ *  envi_copy_kernel_apply with the comparison with the data ignore value.
+ *  The elements are processed in chunks: swapped into the stack buffer if
+ *  necessary, compared with div, converted (or copied) into dst, and the 
+ *  matching ones are replaced. */
+static void envi_copy_kernel_apply_div(const EnviCopyKernel *kernel,
+        char *dst, const char *src, size_t n)
+{
+    union { double d; uint64_t u; char c[ENVI_COPY_CHUNK]; } tmp;
+    uint8_t mask[ENVI_COPY_CHUNK];
+    const char *s;
+    bool *valid;
+    size_t i, nchunk;
+    
+    valid = NULL;
+    if(kernel->valid != NULL)
+        valid = kernel->valid + (size_t) (dst - kernel->dst_base)
+                                    / kernel->dst_sz;
+    while(n > 0){
+        nchunk = ENVI_COPY_CHUNK / kernel->src_sz;
+        if(nchunk > n) nchunk = n;
+        s = src;
+        if(kernel->swap_sz > 1){
+            envi_memcpy_swap(tmp.c, src, nchunk, kernel->swap_sz);
+            s = tmp.c;
+        }
+        envi_match_div(mask, s, kernel->src_type, kernel->div, nchunk);
+        if(envi_copy_kernel_is_plain(kernel)){
+            if(s != dst)
+                memcpy(dst, s, nchunk*kernel->src_sz);
+        } else {
+            envi_convert(dst, kernel->dst_type, s, kernel->src_type, nchunk);
+        }
+        if(kernel->replace_div)
+            envi_blend_repval(dst, kernel->dst_sz, mask, kernel->repval,
+                nchunk);
+        if(valid != NULL){
+            for(i=0;i<nchunk;i++)
+                valid[i] = !mask[i];
+            valid += nchunk;
+        }
+        src += nchunk*kernel->src_sz;
+        dst += nchunk*kernel->dst_sz;
+        n -= nchunk;
+    }
+}
+
+void envi_copy_kernel_apply(const EnviCopyKernel *kernel, void *dst,
+        const void *src, size_t n)
+{
+    union { double d; uint64_t u; char c[ENVI_COPY_CHUNK]; } tmp;
+    char *dst_c = (char*) dst;
+    const char *src_c = (const char*) src;
+    size_t nparts, nchunk, src_partsz, dst_partsz;
+
+    if(kernel->check_div){
+        envi_copy_kernel_apply_div(kernel, dst_c, src_c, n);
+        return;
+    }
+    if(envi_copy_kernel_is_plain(kernel)){
+        envi_copy_swap(dst, src, n*kernel->src_sz, kernel->swap_sz);
+        return;
+    }
+    nparts = n * kernel->ncomp;
+    if(kernel->swap_sz < 2){
+        envi_convert(dst_c, kernel->dst_type, src_c, kernel->src_type, nparts);
+        return;
+    }
+    /* swap a chunk of parts into the stack buffer and convert from there */
+    src_partsz = kernel->src_sz / kernel->ncomp;
+    dst_partsz = kernel->dst_sz / kernel->ncomp;
+    while(nparts > 0){
+        nchunk = ENVI_COPY_CHUNK / src_partsz;
+        if(nchunk > nparts) nchunk = nparts;
+        envi_memcpy_swap(tmp.c, src_c, nchunk, src_partsz);
+        envi_convert(dst_c, kernel->dst_type, tmp.c, kernel->src_type, nchunk);
+        src_c += nchunk * src_partsz;
+        dst_c += nchunk * dst_partsz;
+        nparts -= nchunk;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Specialized copies of plain kernels
+ *  envi_copy_plain_<name> copy elements made of NPARTS words of type T, 
+ *  reversing the bytes of each word with BSWAP. Runs shorter than 
+ *  ENVI_COPY_SHORT_RUN elements (e.g., one band of a BIP pixel) are moved
+ *  with fixed-width loads and stores the compiler keeps in registers, the
+ *  longer ones go to memcpy or the SIMD swap. */
+#if defined(__GNUC__) || defined(__clang__)
+#define ENVI_BSWAP16(v) ((uint16_t) __builtin_bswap16(v))
+#define ENVI_BSWAP32(v) __builtin_bswap32(v)
+#define ENVI_BSWAP64(v) __builtin_bswap64(v)
+#else
+#define ENVI_BSWAP16(v) ((uint16_t) (((v) << 8) | ((v) >> 8)))
+#define ENVI_BSWAP32(v) (((v) << 24) | (((v) << 8) & 0x00FF0000u)      \
+        | (((v) >> 8) & 0x0000FF00u) | ((v) >> 24))
+#define ENVI_BSWAP64(v) (((uint64_t) ENVI_BSWAP32((uint32_t) (v)) << 32) \
+        | (uint64_t) ENVI_BSWAP32((uint32_t) ((v) >> 32)))
+#endif
+#define ENVI_NOSWAP(v) (v)
+
+#define ENVI_DEFINE_PLAIN_COPY(NAME, T, NPARTS, BSWAP, SWAP_SZ)         \
+static void envi_copy_plain_##NAME(const EnviCopyKernel *kernel,        \
+        void *dst, const void *src, size_t n)                           \
+{                                                                       \
+    char *d = (char*) dst;                                              \
+    const char *s = (const char*) src;                                  \
+    size_t i;                                                           \
+    T v;                                                                \
+    (void) kernel;                                                      \
+    if(n >= ENVI_COPY_SHORT_RUN){                                       \
+        if(SWAP_SZ > 1)                                                 \
+            envi_memcpy_swap(d, s, n*(NPARTS), sizeof(T));              \
+        else if(d != s)                                                 \
+            memcpy(d, s, n*(NPARTS)*sizeof(T));                         \
+        return;                                                         \
+    }                                                                   \
+    for(i=0;i<n*(NPARTS);i++){                                          \
+        memcpy(&v, s+i*sizeof(T), sizeof(T));                           \
+        v = BSWAP(v);                                                   \
+        memcpy(d+i*sizeof(T), &v, sizeof(T));                           \
+    }                                                                   \
+}
+
+ENVI_DEFINE_PLAIN_COPY(1,      uint8_t,  1, ENVI_NOSWAP,  0)
+ENVI_DEFINE_PLAIN_COPY(2,      uint16_t, 1, ENVI_NOSWAP,  0)
+ENVI_DEFINE_PLAIN_COPY(2_s2,   uint16_t, 1, ENVI_BSWAP16, 2)
+ENVI_DEFINE_PLAIN_COPY(4,      uint32_t, 1, ENVI_NOSWAP,  0)
+ENVI_DEFINE_PLAIN_COPY(4_s4,   uint32_t, 1, ENVI_BSWAP32, 4)
+ENVI_DEFINE_PLAIN_COPY(8,      uint64_t, 1, ENVI_NOSWAP,  0)
+ENVI_DEFINE_PLAIN_COPY(8_s8,   uint64_t, 1, ENVI_BSWAP64, 8)
+ENVI_DEFINE_PLAIN_COPY(8_s4,   uint32_t, 2, ENVI_BSWAP32, 4)
+ENVI_DEFINE_PLAIN_COPY(16,     uint64_t, 2, ENVI_NOSWAP,  0)
+ENVI_DEFINE_PLAIN_COPY(16_s8,  uint64_t, 2, ENVI_BSWAP64, 8)
+
+/* dispatch table of the specialized copies by element size and size of 
+ * the swapped words (0 or 1: no swap) */
+static const struct {
+    size_t src_sz;
+    size_t swap_sz;
+    EnviCopyFn fn;
+} envi_copy_plain_table[] = {
+    { 1, 0, envi_copy_plain_1 },     { 1, 1, envi_copy_plain_1 },
+    { 2, 0, envi_copy_plain_2 },     { 2, 2, envi_copy_plain_2_s2 },
+    { 4, 0, envi_copy_plain_4 },     { 4, 4, envi_copy_plain_4_s4 },
+    { 8, 0, envi_copy_plain_8 },     { 8, 8, envi_copy_plain_8_s8 },
+    { 8, 4, envi_copy_plain_8_s4 },  {16, 0, envi_copy_plain_16 },
+    {16, 8, envi_copy_plain_16_s8 }
+};
+
+EnviCopyFn envi_copy_kernel_fn(const EnviCopyKernel *kernel)
+{
+    size_t k, ntable;
+
+    if(kernel->check_div || !envi_copy_kernel_is_plain(kernel))
+        return envi_copy_kernel_apply;
+    ntable = sizeof(envi_copy_plain_table)/sizeof(envi_copy_plain_table[0]);
+    for(k=0;k<ntable;k++){
+        if(envi_copy_plain_table[k].src_sz == kernel->src_sz
+                && envi_copy_plain_table[k].swap_sz == kernel->swap_sz)
+            return envi_copy_plain_table[k].fn;
+    }
+    return envi_copy_kernel_apply;
+}
@@ -0,0 +1,225 @@
+/* envi_direct.c */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#include "envi_direct.h"
+#if defined(ENVI_HAS_PTHREAD)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#if defined(ENVI_HAS_PTHREAD)
+/* EnviDirectWindow
+ *  The segments [seg_start, seg_end) of the plan, read with nbytes bytes
+ *  from the aligned file offset into buf. need is the number of bytes
+ *  from offset up to the end of the last segment (nbytes is need rounded
+ *  up to the alignment). errflg is -1 if the read was rejected as not
+ *  aligned (EINVAL). */
+typedef struct EnviDirectWindow {
+    int fd;
+    char *buf;
+    size_t offset;
+    size_t nbytes;
+    size_t need;
+    size_t seg_start;
+    size_t seg_end;
+    int errflg;
+} EnviDirectWindow ;
+
+static size_t envi_direct_align_up(size_t n)
+{
+    return (n + ENVI_DIRECT_ALIGN - 1) / ENVI_DIRECT_ALIGN * ENVI_DIRECT_ALIGN;
+}
+
+/* function : envi_direct_window
+ *  Take the segments from seg_start whose aligned extents are contiguous
+ *  or overlap and fit in window_nbytes bytes. */
+static void envi_direct_window(const EnviIOPlan *plan, size_t seg_start,
+        size_t window_nbytes, EnviDirectWindow *w)
+{
+    const EnviIOSegment *seg;
+    size_t i, end, aligned_end;
+
+    seg = &plan->segments[seg_start];
+    w->offset = seg->file_offset / ENVI_DIRECT_ALIGN * ENVI_DIRECT_ALIGN;
+    w->need = seg->file_offset + seg->nbytes - w->offset;
+    aligned_end = envi_direct_align_up(seg->file_offset + seg->nbytes);
+    for(i=seg_start+1;i<plan->nsegments;i++){
+        seg = &plan->segments[i];
+        end = seg->file_offset + seg->nbytes;
+        /* a gap of whole blocks is not read */
+        if(seg->file_offset / ENVI_DIRECT_ALIGN * ENVI_DIRECT_ALIGN
+                > aligned_end
+            || envi_direct_align_up(end) - w->offset > window_nbytes)
+            break;
+        w->need = end - w->offset;
+        aligned_end = envi_direct_align_up(end);
+    }
+    w->nbytes = aligned_end - w->offset;
+    w->seg_start = seg_start;
+    w->seg_end = i;
+}
+
+/* function : envi_direct_read
+ *  Read the window. The read stops short of nbytes at the end of the
+ *  file, which is fine as long as the need bytes are read. */
+static void *envi_direct_read(void *arg)
+{
+    EnviDirectWindow *w = (EnviDirectWindow*) arg;
+    size_t got;
+    ssize_t nread;
+
+    got = 0;
+    w->errflg = 0;
+    while(got < w->need){
+        nread = pread(w->fd, w->buf + got, w->nbytes - got,
+                    (off_t) (w->offset + got));
+        if(nread < 0){
+            if(errno == EINTR) continue;
+            w->errflg = (errno == EINVAL) ? -1 : -4;
+            return NULL;
+        } else if(nread == 0){
+            break;
+        }
+        got += (size_t) nread;
+    }
+    if(got < w->need)
+        w->errflg = -4;
+    return NULL;
+}
+
+/* function : envi_direct_open
+ *  Open imgpath bypassing the page cache. Returns the file descriptor,
+ *  or -1 if the platform or the file system does not support it. */
+static int envi_direct_open(const char *imgpath)
+{
+    int fd;
+
+#if defined(O_DIRECT)
+    fd = open(imgpath, O_RDONLY | O_DIRECT);
+#elif defined(F_NOCACHE)
+    fd = open(imgpath, O_RDONLY);
+    if(fd >= 0 && fcntl(fd, F_NOCACHE, 1) == -1){
+        close(fd);
+        fd = -1;
+    }
+#else
+    (void) imgpath;
+    fd = -1;
+#endif
+    return fd;
+}
+
+int envi_ioplan_execute_direct(const EnviIOPlan *plan, const char *imgpath,
+        int fd, char *subimg, const EnviLayout *layout)
+{
+    EnviDirectWindow w[2], *cur, *nxt;
+    const EnviIOSegment *seg;
+    const EnviIOPiece *pc;
+    EnviStage stage;
+    EnviCopyFn copy_fn;
+    pthread_t thread;
+    size_t window_nbytes, i, k, t;
+    char *arena, *src;
+    void *ptr;
+    int direct_fd, errflg;
+    bool launched;
+
+    if(plan->nsegments == 0)
+        return 0;
+    window_nbytes = envi_direct_align_up(plan->max_segment
+                        + 2*ENVI_DIRECT_ALIGN);
+    if(window_nbytes < ENVI_DIRECT_WINDOW)
+        window_nbytes = envi_direct_align_up(ENVI_DIRECT_WINDOW);
+    if(posix_memalign(&ptr, ENVI_DIRECT_ALIGN, 2*window_nbytes) != 0)
+        return -5;
+    arena = (char*) ptr;
+    if(envi_stage_init(&stage, layout, &plan->kernel, subimg) != 0){
+        free(arena);
+        return -5;
+    }
+    copy_fn = envi_copy_kernel_fn(&stage.kernel);
+
+    /* The first window tells whether the file system takes O_DIRECT; the
+     * windows are read from fd with the page cache otherwise. */
+    direct_fd = envi_direct_open(imgpath);
+    envi_direct_window(plan, 0, window_nbytes, &w[0]);
+    w[0].buf = arena;
+    w[0].fd = (direct_fd >= 0) ? direct_fd : fd;
+    envi_direct_read(&w[0]);
+    if(w[0].errflg == -1 && direct_fd >= 0){
+        close(direct_fd);
+        direct_fd = -1;
+        w[0].fd = fd;
+        envi_direct_read(&w[0]);
+    }
+
+    errflg = 0;
+    for(t=0;;t++){
+        cur = &w[t % 2];
+        nxt = &w[(t+1) % 2];
+        if(cur->errflg != 0){
+            errflg = -4;
+            break;
+        }
+        /* read the next window while this one is copied */
+        launched = false;
+        if(cur->seg_end < plan->nsegments){
+            envi_direct_window(plan, cur->seg_end, window_nbytes, nxt);
+            nxt->buf = arena + ((t+1) % 2)*window_nbytes;
+            nxt->fd = cur->fd;
+            launched = (pthread_create(&thread, NULL, envi_direct_read, nxt)
+                            == 0);
+        }
+        for(i=cur->seg_start;i<cur->seg_end;i++){
+            seg = &plan->segments[i];
+            src = cur->buf + (seg->file_offset - cur->offset);
+            pc = plan->pieces + seg->piece_start;
+            for(k=0;k<seg->npieces;k++){
+                copy_fn(&stage.kernel,
+                    envi_stage_row(&stage, pc[k].dst_offset/stage.row_nbytes)
+                        + pc[k].dst_offset % stage.row_nbytes,
+                    src + pc[k].src_offset, pc[k].nbytes / plan->sz);
+            }
+        }
+#if defined(POSIX_FADV_DONTNEED)
+        if(direct_fd < 0)
+            posix_fadvise(cur->fd, (off_t) cur->offset, (off_t) cur->nbytes,
+                POSIX_FADV_DONTNEED);
+#endif
+        if(cur->seg_end >= plan->nsegments)
+            break;
+        if(launched)
+            pthread_join(thread, NULL);
+        else
+            envi_direct_read(nxt);
+    }
+
+    if(errflg == 0)
+        envi_stage_flush(&stage);
+    envi_stage_free(&stage);
+    if(direct_fd >= 0)
+        close(direct_fd);
+    free(arena);
+    return errflg;
+}
+#else
+int envi_ioplan_execute_direct(const EnviIOPlan *plan, const char *imgpath,
+        int fd, char *subimg, const EnviLayout *layout)
+{
+    return -4;
+}
+#endif
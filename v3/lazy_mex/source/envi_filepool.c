@@ -0,0 +1,366 @@
+/* envi_filepool.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_filepool.h"
+
+#if !defined(ENVI_HAS_PTHREAD) && (defined(__unix__) || defined(__APPLE__))
+#define ENVI_HAS_PTHREAD
+#endif
+
+#if defined(ENVI_HAS_PTHREAD)
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* EnviFilePoolEntry
+ *  A pooled file: its path, stream and version (device, inode, size,
+ *  modification and status change times). nusers counts the callers
+ *  holding it, and stream_in_use whether one of them uses the stream.
+ *  A detached entry is no longer in the pool and is closed when its last
+ *  user gives it back. */
+typedef struct EnviFilePoolEntry {
+    char *path;
+    FILE *fid;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    int64_t ctime;
+    size_t nusers;
+    bool stream_in_use;
+    bool detached;
+    size_t last_use;
+} EnviFilePoolEntry ;
+
+typedef struct EnviFilePool {
+    pthread_mutex_t mutex;
+    EnviFilePoolEntry **entries;
+    size_t clock;
+    EnviFilePoolStats stats;
+} EnviFilePool ;
+
+static EnviFilePool envi_filepool = { PTHREAD_MUTEX_INITIALIZER, NULL, 0,
+    { ENVI_FILEPOOL_SIZE, 0, 0, 0, 0, 0 } };
+
+static void envi_filepool_version(const struct stat *st, uint64_t *dev,
+        uint64_t *ino, uint64_t *size, int64_t *mtime, int64_t *ctime)
+{
+    *dev = (uint64_t) st->st_dev;
+    *ino = (uint64_t) st->st_ino;
+    *size = (uint64_t) st->st_size;
+#if defined(__APPLE__)
+    *mtime = (int64_t) st->st_mtimespec.tv_sec * 1000000000
+           + (int64_t) st->st_mtimespec.tv_nsec;
+    *ctime = (int64_t) st->st_ctimespec.tv_sec * 1000000000
+           + (int64_t) st->st_ctimespec.tv_nsec;
+#else
+    *mtime = (int64_t) st->st_mtim.tv_sec * 1000000000
+           + (int64_t) st->st_mtim.tv_nsec;
+    *ctime = (int64_t) st->st_ctim.tv_sec * 1000000000
+           + (int64_t) st->st_ctim.tv_nsec;
+#endif
+}
+
+static void envi_filepool_entry_free(EnviFilePoolEntry *e)
+{
+    fclose(e->fid);
+    free(e->path);
+    free(e);
+}
+
+/* function : envi_filepool_remove
+ *  Take the entry k out of the pool, closing it unless it is in use. The
+ *  mutex is held. */
+static void envi_filepool_remove(size_t k)
+{
+    EnviFilePoolEntry *e = envi_filepool.entries[k];
+
+    envi_filepool.entries[k] = NULL;
+    envi_filepool.stats.nopen--;
+    if(e->nusers == 0)
+        envi_filepool_entry_free(e);
+    else
+        e->detached = true;
+}
+
+/* function : envi_filepool_free_slot
+ *  Index of an empty slot of the pool, evicting the least recently used
+ *  idle entry if the pool is full, or the capacity if all the entries are
+ *  in use. The mutex is held. */
+static size_t envi_filepool_free_slot(void)
+{
+    size_t k, lru;
+
+    lru = envi_filepool.stats.capacity;
+    for(k=0;k<envi_filepool.stats.capacity;k++){
+        if(envi_filepool.entries[k] == NULL)
+            return k;
+        if(envi_filepool.entries[k]->nusers == 0
+                && (lru == envi_filepool.stats.capacity
+                || envi_filepool.entries[k]->last_use
+                    < envi_filepool.entries[lru]->last_use))
+            lru = k;
+    }
+    if(lru < envi_filepool.stats.capacity){
+        envi_filepool_remove(lru);
+        envi_filepool.stats.evictions++;
+    }
+    return lru;
+}
+
+/* function : envi_file_open_unpooled
+ *  Open the file and get its version. Returns NULL on failure. */
+static EnviFilePoolEntry *envi_file_open_unpooled(const char *path)
+{
+    EnviFilePoolEntry *e;
+    struct stat st;
+
+    e = (EnviFilePoolEntry*) malloc(sizeof(EnviFilePoolEntry));
+    if(e == NULL)
+        return NULL;
+    e->path = (char*) malloc(strlen(path)+1);
+    e->fid = fopen(path, "rb");
+    if(e->path == NULL || e->fid == NULL || fstat(fileno(e->fid), &st) != 0){
+        if(e->fid != NULL) fclose(e->fid);
+        free(e->path);
+        free(e);
+        return NULL;
+    }
+    strcpy(e->path, path);
+    envi_filepool_version(&st, &e->dev, &e->ino, &e->size, &e->mtime,
+        &e->ctime);
+    e->nusers = 0;
+    e->stream_in_use = false;
+    e->detached = true;
+    e->last_use = 0;
+    return e;
+}
+
+/* function : envi_filepool_lookup
+ *  Pooled file of path if it has the version of v and can be used (its
+ *  stream is free if stream is true), or NULL. A pooled file of another
+ *  version is taken out of the pool. pooled tells whether the path is
+ *  still pooled. The mutex is held. */
+static EnviFilePoolEntry *envi_filepool_lookup(const char *path,
+        const EnviFilePoolEntry *v, bool stream, bool *pooled)
+{
+    EnviFilePoolEntry *e;
+    size_t k;
+
+    *pooled = false;
+    if(envi_filepool.stats.capacity == 0)
+        return NULL;
+    if(envi_filepool.entries == NULL){
+        envi_filepool.entries = (EnviFilePoolEntry**) calloc(
+            envi_filepool.stats.capacity, sizeof(EnviFilePoolEntry*));
+        if(envi_filepool.entries == NULL)
+            return NULL;
+    }
+    for(k=0;k<envi_filepool.stats.capacity;k++){
+        if(envi_filepool.entries[k] != NULL
+                && strcmp(envi_filepool.entries[k]->path, path) == 0)
+            break;
+    }
+    if(k == envi_filepool.stats.capacity)
+        return NULL;
+    /* the pooled file is reused while it is the file at path */
+    e = envi_filepool.entries[k];
+    if(v->dev != e->dev || v->ino != e->ino || v->size != e->size
+            || v->mtime != e->mtime || v->ctime != e->ctime){
+        envi_filepool_remove(k);
+        envi_filepool.stats.reopens++;
+        return NULL;
+    }
+    *pooled = true;
+    if(stream && e->stream_in_use)
+        return NULL;
+    return e;
+}
+
+int envi_file_open(EnviFile *file, const char *path, bool stream)
+{
+    EnviFilePoolEntry cur, *e, *opened, *discarded;
+    struct stat st;
+    size_t k;
+    bool pooled;
+
+    /* stat and fopen may block (network file systems, cold storage), so
+     * they run outside the mutex, which only guards the slots. */
+    if(stat(path, &st) != 0){
+        envi_filepool_close(path);
+        return -1;
+    }
+    envi_filepool_version(&st, &cur.dev, &cur.ino, &cur.size, &cur.mtime,
+        &cur.ctime);
+
+    discarded = NULL;
+    pthread_mutex_lock(&envi_filepool.mutex);
+    e = envi_filepool_lookup(path, &cur, stream, &pooled);
+    if(e != NULL){
+        envi_filepool.stats.hits++;
+    } else {
+        pthread_mutex_unlock(&envi_filepool.mutex);
+        opened = envi_file_open_unpooled(path);
+        if(opened == NULL)
+            return -1;
+        pthread_mutex_lock(&envi_filepool.mutex);
+        envi_filepool.stats.misses++;
+        /* another reader may have pooled the file meanwhile: use that one
+         * and discard ours. Otherwise pool ours unless the path is pooled
+         * already (and its stream in use). */
+        e = envi_filepool_lookup(path, opened, stream, &pooled);
+        if(e != NULL){
+            discarded = opened;
+        } else {
+            e = opened;
+            if(!pooled && envi_filepool.entries != NULL){
+                k = envi_filepool_free_slot();
+                if(k < envi_filepool.stats.capacity){
+                    envi_filepool.entries[k] = e;
+                    envi_filepool.stats.nopen++;
+                    e->detached = false;
+                }
+            }
+        }
+    }
+    e->nusers++;
+    if(stream) e->stream_in_use = true;
+    e->last_use = ++envi_filepool.clock;
+    pthread_mutex_unlock(&envi_filepool.mutex);
+    if(discarded != NULL)
+        envi_filepool_entry_free(discarded);
+
+    file->fid = e->fid;
+    file->fd = fileno(e->fid);
+    file->size = (size_t) e->size;
+    file->stream = stream;
+    file->entry = e;
+    return 0;
+}
+
+void envi_file_close(EnviFile *file)
+{
+    EnviFilePoolEntry *e = file->entry;
+
+    if(e == NULL)
+        return;
+    pthread_mutex_lock(&envi_filepool.mutex);
+    e->nusers--;
+    if(file->stream)
+        e->stream_in_use = false;
+    if(e->detached && e->nusers == 0)
+        envi_filepool_entry_free(e);
+    pthread_mutex_unlock(&envi_filepool.mutex);
+    file->entry = NULL;
+    file->fid = NULL;
+    file->fd = -1;
+}
+
+bool envi_filepool_close(const char *path)
+{
+    size_t k;
+    bool found;
+
+    found = false;
+    pthread_mutex_lock(&envi_filepool.mutex);
+    for(k=0;envi_filepool.entries!=NULL
+            && k<envi_filepool.stats.capacity;k++){
+        if(envi_filepool.entries[k] != NULL
+                && strcmp(envi_filepool.entries[k]->path, path) == 0){
+            envi_filepool_remove(k);
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&envi_filepool.mutex);
+    return found;
+}
+
+/* function : envi_filepool_flush_locked
+ *  Close all the pooled files and free the slots. The mutex is held. */
+static void envi_filepool_flush_locked(void)
+{
+    size_t k;
+
+    for(k=0;envi_filepool.entries!=NULL
+            && k<envi_filepool.stats.capacity;k++){
+        if(envi_filepool.entries[k] != NULL)
+            envi_filepool_remove(k);
+    }
+    free(envi_filepool.entries);
+    envi_filepool.entries = NULL;
+}
+
+void envi_filepool_flush(void)
+{
+    pthread_mutex_lock(&envi_filepool.mutex);
+    envi_filepool_flush_locked();
+    pthread_mutex_unlock(&envi_filepool.mutex);
+}
+
+void envi_filepool_configure(size_t capacity)
+{
+    pthread_mutex_lock(&envi_filepool.mutex);
+    envi_filepool_flush_locked();
+    memset(&envi_filepool.stats, 0, sizeof(EnviFilePoolStats));
+    envi_filepool.stats.capacity = capacity;
+    pthread_mutex_unlock(&envi_filepool.mutex);
+}
+
+void envi_filepool_get_stats(EnviFilePoolStats *stats)
+{
+    pthread_mutex_lock(&envi_filepool.mutex);
+    *stats = envi_filepool.stats;
+    pthread_mutex_unlock(&envi_filepool.mutex);
+}
+
+#else
+/* no POSIX stat: the files are opened and closed on every read. */
+
+int envi_file_open(EnviFile *file, const char *path, bool stream)
+{
+    long int szfile;
+
+    file->fid = fopen(path, "rb");
+    if(file->fid == NULL)
+        return -1;
+    fseek(file->fid, 0L, SEEK_END);
+    szfile = ftell(file->fid);
+    fseek(file->fid, 0L, SEEK_SET);
+    file->fd = -1;
+    file->size = (szfile > 0) ? (size_t) szfile : 0;
+    file->stream = stream;
+    file->entry = NULL;
+    return 0;
+}
+
+void envi_file_close(EnviFile *file)
+{
+    if(file->fid != NULL)
+        fclose(file->fid);
+    file->fid = NULL;
+}
+
+void envi_filepool_configure(size_t capacity)
+{
+}
+
+bool envi_filepool_close(const char *path)
+{
+    return false;
+}
+
+void envi_filepool_flush(void)
+{
+}
+
+void envi_filepool_get_stats(EnviFilePoolStats *stats)
+{
+    memset(stats, 0, sizeof(EnviFilePoolStats));
+}
+#endif
@@ -0,0 +1,205 @@
+/* envi_glt.c */
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_glt.h"
+
+#if !defined(ENVI_HAS_PTHREAD) && (defined(__unix__) || defined(__APPLE__))
+#define ENVI_HAS_PTHREAD
+#endif
+#if defined(ENVI_HAS_PTHREAD)
+#include <pthread.h>
+#endif
+
+/* function : envi_glt_source
+ *  0-based source index of the GLT entry v for a dimension of n pixels,
+ *  or ENVI_GLT_NONE. NaN fails both comparisons. */
+static size_t envi_glt_source(double v, size_t n, bool neg_abs)
+{
+    if(neg_abs && v < 0)
+        v = -v;
+    if(v > 0.5 && v < (double) n + 0.5)
+        return (size_t) (v - 0.5);
+    return ENVI_GLT_NONE;
+}
+
+void envi_glt_bbox(EnviGLTBox *box, const double *glt_x,
+        const double *glt_y, size_t npix, size_t samples, size_t lines,
+        bool neg_abs)
+{
+    size_t j, s, l;
+
+    box->smpl0 = samples; box->smpl1 = 0;
+    box->line0 = lines;   box->line1 = 0;
+    box->nvalid = 0;
+    for(j=0;j<npix;j++){
+        s = envi_glt_source(glt_x[j], samples, neg_abs);
+        l = envi_glt_source(glt_y[j], lines, neg_abs);
+        if(s == ENVI_GLT_NONE || l == ENVI_GLT_NONE)
+            continue;
+        if(s < box->smpl0) box->smpl0 = s;
+        if(s > box->smpl1) box->smpl1 = s;
+        if(l < box->line0) box->line0 = l;
+        if(l > box->line1) box->line1 = l;
+        box->nvalid++;
+    }
+}
+
+void envi_glt_index(size_t *srcidx, const double *glt_x,
+        const double *glt_y, size_t npix, size_t samples, size_t lines,
+        bool neg_abs, const EnviGLTBox *box)
+{
+    size_t j, s, l, ld;
+
+    ld = box->line1 - box->line0 + 1;
+    for(j=0;j<npix;j++){
+        s = envi_glt_source(glt_x[j], samples, neg_abs);
+        l = envi_glt_source(glt_y[j], lines, neg_abs);
+        if(s == ENVI_GLT_NONE || l == ENVI_GLT_NONE)
+            srcidx[j] = ENVI_GLT_NONE;
+        else
+            srcidx[j] = (l - box->line0) + (s - box->smpl0)*ld;
+    }
+}
+
+/* EnviGLTTask
+ *  Projection of the output lines [line_start, line_start+nlines). */
+typedef struct EnviGLTTask {
+    char *dst;
+    size_t lines_o;
+    size_t samples_o;
+    const char *src;
+    size_t src_plane;
+    const size_t *srcidx;
+    size_t nb;
+    size_t sz;
+    const void *fill;
+    size_t line_start;
+    size_t nlines;
+} EnviGLTTask ;
+
+/* ENVI_GLT_PROJECT_LOOP: projection loop for elements of type T. The
+ * inner loop runs along the lines, contiguous in dst. */
+#define ENVI_GLT_PROJECT_LOOP(T)                                        \
+    {                                                                   \
+        T fv, *d;                                                       \
+        const T *s;                                                     \
+        memcpy(&fv, t->fill, sizeof(T));                                \
+        for(b=0;b<t->nb;b++){                                           \
+            s = (const T*) t->src + b*t->src_plane;                     \
+            for(c=0;c<t->samples_o;c++){                                \
+                j = c*t->lines_o;                                       \
+                d = (T*) t->dst + b*npix + j;                           \
+                for(l=l0;l<l1;l++)                                      \
+                    d[l] = (t->srcidx[j+l] == ENVI_GLT_NONE)            \
+                        ? fv : s[t->srcidx[j+l]];                       \
+            }                                                           \
+        }                                                               \
+    }
+
+static void *envi_glt_task(void *arg)
+{
+    EnviGLTTask *t = (EnviGLTTask*) arg;
+    size_t npix, b, c, j, l, l0, l1, sz;
+    const char *s;
+    char *d;
+
+    npix = t->lines_o * t->samples_o;
+    l0 = t->line_start; l1 = t->line_start + t->nlines;
+    switch(t->sz){
+        case 1: ENVI_GLT_PROJECT_LOOP(uint8_t)  break;
+        case 2: ENVI_GLT_PROJECT_LOOP(uint16_t) break;
+        case 4: ENVI_GLT_PROJECT_LOOP(uint32_t) break;
+        case 8: ENVI_GLT_PROJECT_LOOP(uint64_t) break;
+        default:
+            /* e.g., interleaved complex double */
+            sz = t->sz;
+            for(b=0;b<t->nb;b++){
+                s = t->src + b*t->src_plane*sz;
+                for(c=0;c<t->samples_o;c++){
+                    j = c*t->lines_o;
+                    d = t->dst + (b*npix + j)*sz;
+                    for(l=l0;l<l1;l++){
+                        if(t->srcidx[j+l] == ENVI_GLT_NONE)
+                            memcpy(d + l*sz, t->fill, sz);
+                        else
+                            memcpy(d + l*sz, s + t->srcidx[j+l]*sz, sz);
+                    }
+                }
+            }
+            break;
+    }
+    return NULL;
+}
+
+int envi_glt_project(char *dst, size_t lines_o, size_t samples_o,
+        const char *src, size_t src_plane, const size_t *srcidx, size_t nb,
+        size_t sz, const void *fill, size_t num_threads)
+{
+    EnviGLTTask *tasks;
+    size_t t;
+#if defined(ENVI_HAS_PTHREAD)
+    pthread_t *threads;
+    bool *launched;
+#endif
+
+    if(lines_o == 0 || samples_o == 0 || nb == 0)
+        return 0;
+#if !defined(ENVI_HAS_PTHREAD)
+    num_threads = 1;
+#endif
+    if(num_threads > lines_o) num_threads = lines_o;
+    if(num_threads < 1) num_threads = 1;
+    tasks = (EnviGLTTask*) malloc(num_threads*sizeof(EnviGLTTask));
+    if(tasks == NULL)
+        return -5;
+    for(t=0;t<num_threads;t++){
+        tasks[t].dst = dst;
+        tasks[t].lines_o = lines_o;
+        tasks[t].samples_o = samples_o;
+        tasks[t].src = src;
+        tasks[t].src_plane = src_plane;
+        tasks[t].srcidx = srcidx;
+        tasks[t].nb = nb;
+        tasks[t].sz = sz;
+        tasks[t].fill = fill;
+        tasks[t].line_start = lines_o * t / num_threads;
+        tasks[t].nlines = lines_o * (t+1) / num_threads - tasks[t].line_start;
+    }
+    if(num_threads <= 1){
+        envi_glt_task(&tasks[0]);
+        free(tasks);
+        return 0;
+    }
+
+#if defined(ENVI_HAS_PTHREAD)
+    threads = (pthread_t*) malloc(num_threads*sizeof(pthread_t));
+    launched = (bool*) malloc(num_threads*sizeof(bool));
+    if(threads == NULL || launched == NULL){
+        free(threads); free(launched); free(tasks);
+        return -5;
+    }
+    /* The first task runs on the calling thread. Tasks whose thread could
+     * not be created are also run on the calling thread. */
+    launched[0] = false;
+    for(t=1;t<num_threads;t++)
+        launched[t] = (pthread_create(&threads[t], NULL, envi_glt_task,
+                        &tasks[t]) == 0);
+    for(t=0;t<num_threads;t++){
+        if(!launched[t])
+            envi_glt_task(&tasks[t]);
+    }
+    for(t=0;t<num_threads;t++){
+        if(launched[t])
+            pthread_join(threads[t], NULL);
+    }
+    free(launched);
+    free(threads);
+#else
+    for(t=0;t<num_threads;t++)
+        envi_glt_task(&tasks[t]);
+#endif
+    free(tasks);
+    return 0;
+}
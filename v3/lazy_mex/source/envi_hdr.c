@@ -0,0 +1,550 @@
+/* envi_hdr.c */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "envi_hdr.h"
+
+/* exact powers of ten for the fast path of envi_parse_double */
+static const double envi_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* white spaces removed by strtrim of MATLAB */
+static bool envi_hdr_isspace(char c)
+{
+    return c==' ' || c=='\t' || c=='\n' || c=='\r' || c=='\v' || c=='\f'
+            || c=='\0';
+}
+
+static bool envi_hdr_isdigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static void envi_hdr_trim(const char **s, const char **e)
+{
+    while(*s < *e && envi_hdr_isspace(**s)) (*s)++;
+    while(*e > *s && envi_hdr_isspace((*e)[-1])) (*e)--;
+}
+
+static bool envi_hdr_has(const char *s, const char *e, char c)
+{
+    return memchr(s, c, (size_t) (e - s)) != NULL;
+}
+
+static int envi_hdr_lower(int c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+bool envi_parse_double(const char *s, const char *e, double *v)
+{
+    const char *p, *p0;
+    uint64_t mant;
+    int ndig, exp10, expv, expsgn;
+    bool neg, any, exact;
+    char sbuf[64], *buf, *b;
+
+    envi_hdr_trim(&s, &e);
+    p = s;
+    neg = false;
+    if(p < e && (*p == '+' || *p == '-')){
+        neg = (*p == '-');
+        p++;
+    }
+    if(e - p == 3 && envi_hdr_lower(p[0]) == 'i'
+            && envi_hdr_lower(p[1]) == 'n' && envi_hdr_lower(p[2]) == 'f'){
+        *v = neg ? -HUGE_VAL : HUGE_VAL;
+        return true;
+    }
+
+    /* the first 19 significant digits go to mant, the others only count
+     * in the exponent (and the conversion is left to strtod). */
+    p0 = p;
+    mant = 0; ndig = 0; exp10 = 0;
+    any = false; exact = true;
+    while(p < e){
+        if(envi_hdr_isdigit(*p)){
+            if(ndig < 19){
+                mant = mant*10 + (uint64_t) (*p - '0');
+                if(mant > 0) ndig++;
+            } else {
+                exp10++;
+                if(*p != '0') exact = false;
+            }
+            any = true;
+            p++;
+        } else if(*p == ',' && any && p+1 < e && envi_hdr_isdigit(p[1])){
+            /* thousands separator */
+            p++;
+        } else {
+            break;
+        }
+    }
+    if(p < e && *p == '.'){
+        p++;
+        while(p < e && envi_hdr_isdigit(*p)){
+            if(ndig < 19){
+                mant = mant*10 + (uint64_t) (*p - '0');
+                if(mant > 0) ndig++;
+                exp10--;
+            } else if(*p != '0'){
+                exact = false;
+            }
+            any = true;
+            p++;
+        }
+    }
+    if(!any)
+        return false;
+    if(p < e && (*p=='e' || *p=='E' || *p=='d' || *p=='D')){
+        p++;
+        expsgn = 1;
+        if(p < e && (*p == '+' || *p == '-')){
+            expsgn = (*p == '-') ? -1 : 1;
+            p++;
+        }
+        if(p >= e || !envi_hdr_isdigit(*p))
+            return false;
+        expv = 0;
+        while(p < e && envi_hdr_isdigit(*p)){
+            if(expv < 100000) expv = expv*10 + (*p - '0');
+            p++;
+        }
+        exp10 += expsgn * expv;
+    }
+    if(p != e)
+        return false;
+
+    if(exact && mant <= ((uint64_t) 1 << 53) && exp10 >= -22 && exp10 <= 22){
+        *v = (exp10 < 0) ? (double) mant / envi_pow10[-exp10]
+                         : (double) mant * envi_pow10[exp10];
+    } else {
+        /* copy the number without the separators, with an 'e' exponent */
+        buf = ((size_t) (e - s) < sizeof(sbuf)) ? sbuf
+                : (char*) malloc((size_t) (e - s) + 1);
+        if(buf == NULL)
+            return false;
+        b = buf;
+        for(p=p0;p<e;p++){
+            if(*p == ',') continue;
+            *b++ = (*p=='d' || *p=='D') ? 'e' : *p;
+        }
+        *b = '\0';
+        *v = strtod(buf, NULL);
+        if(buf != sbuf)
+            free(buf);
+    }
+    if(neg) *v = -*v;
+    return true;
+}
+
+/* EnviHdrBuf
+ *  Growing string. */
+typedef struct EnviHdrBuf {
+    char *p;
+    size_t n;
+    size_t cap;
+} EnviHdrBuf ;
+
+static int envi_hdr_buf_append(EnviHdrBuf *buf, const char *s, size_t n)
+{
+    char *p;
+    size_t cap;
+
+    if(buf->n + n + 1 > buf->cap){
+        cap = (buf->cap > 0) ? buf->cap : 64;
+        while(cap < buf->n + n + 1) cap *= 2;
+        p = (char*) realloc(buf->p, cap);
+        if(p == NULL)
+            return -5;
+        buf->p = p;
+        buf->cap = cap;
+    }
+    memcpy(buf->p + buf->n, s, n);
+    buf->n += n;
+    buf->p[buf->n] = '\0';
+    return 0;
+}
+
+static char *envi_hdr_strndup(const char *s, size_t n)
+{
+    char *p;
+
+    p = (char*) malloc(n + 1);
+    if(p == NULL)
+        return NULL;
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+static void envi_hdr_field_clear(EnviHdrField *f)
+{
+    size_t i;
+
+    free(f->str);
+    for(i=0;i<f->nstrs;i++)
+        free(f->strs[i]);
+    free(f->strs);
+    free(f->nums);
+    f->str = NULL;
+    f->strs = NULL;
+    f->nstrs = 0;
+    f->nums = NULL;
+    f->nnums = 0;
+    f->num = 0;
+}
+
+/* function : envi_hdr_field_name
+ *  Convert the name [s,e) of a field into name as envihdrreadx2.m does:
+ *  ':' and ' ' become '_', and '(', ')' and '/' are removed. Returns the
+ *  length of the name. */
+static size_t envi_hdr_field_name(char *name, const char *s, const char *e)
+{
+    size_t n;
+    char c;
+
+    envi_hdr_trim(&s, &e);
+    n = 0;
+    for(;s<e && n<ENVI_HDR_NAME_MAX;s++){
+        c = *s;
+        if(c == '(' || c == ')' || c == '/')
+            continue;
+        if(c == ':' || c == ' ')
+            c = '_';
+        name[n++] = c;
+    }
+    name[n] = '\0';
+    return n;
+}
+
+/* function : envi_hdr_field
+ *  Field of the name, appended if it is new, with its value cleared.
+ *  Returns NULL if memory allocation failed. */
+static EnviHdrField *envi_hdr_field(EnviHdr *hdr, const char *name)
+{
+    EnviHdrField *f;
+    size_t i, cap;
+
+    for(i=0;i<hdr->nfields;i++){
+        if(strcmp(hdr->fields[i].name, name) == 0){
+            envi_hdr_field_clear(&hdr->fields[i]);
+            return &hdr->fields[i];
+        }
+    }
+    if(hdr->nfields == hdr->capfields){
+        cap = (hdr->capfields > 0) ? 2*hdr->capfields : 32;
+        f = (EnviHdrField*) realloc(hdr->fields, cap*sizeof(EnviHdrField));
+        if(f == NULL)
+            return NULL;
+        hdr->fields = f;
+        hdr->capfields = cap;
+    }
+    f = &hdr->fields[hdr->nfields++];
+    memset(f, 0, sizeof(EnviHdrField));
+    strcpy(f->name, name);
+    return f;
+}
+
+/* function : envi_hdr_next_line
+ *  Bounds [*ls,*le) of the line starting at *pos (without its newline),
+ *  and move *pos to the next line. Returns false at the end of text. */
+static bool envi_hdr_next_line(const char *text, size_t n, size_t *pos,
+        const char **ls, const char **le)
+{
+    const char *nl;
+
+    if(*pos >= n)
+        return false;
+    *ls = text + *pos;
+    nl = (const char*) memchr(*ls, '\n', n - *pos);
+    *le = (nl != NULL) ? nl : text + n;
+    *pos = (size_t) (*le - text) + 1;
+    return true;
+}
+
+/* function : envi_hdr_split_strings
+ *  Split the string value of f (without its first and last characters,
+ *  the braces) at runs of commas into trimmed strings (strsplit and
+ *  strtrim of MATLAB). */
+static int envi_hdr_split_strings(EnviHdrField *f)
+{
+    const char *s, *e, *p, *q, *ts, *te;
+    size_t n, k;
+    char **strs;
+
+    n = strlen(f->str);
+    s = f->str + ((n > 0) ? 1 : 0);
+    e = f->str + ((n > 1) ? n-1 : ((n > 0) ? 1 : 0));
+    k = 1;
+    for(p=s;p<e;p++){
+        if(*p == ',' && (p == s || p[-1] != ','))
+            k++;
+    }
+    strs = (char**) malloc(k*sizeof(char*));
+    if(strs == NULL)
+        return -5;
+    k = 0;
+    p = s;
+    while(true){
+        q = p;
+        while(q < e && *q != ',') q++;
+        ts = p; te = q;
+        envi_hdr_trim(&ts, &te);
+        strs[k] = envi_hdr_strndup(ts, (size_t) (te - ts));
+        if(strs[k] == NULL){
+            while(k > 0) free(strs[--k]);
+            free(strs);
+            return -5;
+        }
+        k++;
+        if(q >= e)
+            break;
+        while(q < e && *q == ',') q++;
+        p = q;
+    }
+    free(f->str);
+    f->str = NULL;
+    f->strs = strs;
+    f->nstrs = k;
+    f->type = ENVI_HDR_STRINGS;
+    return 0;
+}
+
+/* function : envi_hdr_set_numbers
+ *  Set the value of f to the numbers of [s,e) split at commas, NaN for 
+ *  the elements that are not numbers. [s,e) may be in the string value 
+ *  of f, which is freed. */
+static int envi_hdr_set_numbers(EnviHdrField *f, const char *s,
+        const char *e)
+{
+    const char *p, *q;
+    size_t k;
+    double *nums;
+
+    k = 1;
+    for(p=s;p<e;p++)
+        if(*p == ',') k++;
+    nums = (double*) malloc(k*sizeof(double));
+    if(nums == NULL)
+        return -5;
+    k = 0;
+    p = s;
+    while(true){
+        q = p;
+        while(q < e && *q != ',') q++;
+        if(!envi_parse_double(p, q, &nums[k]))
+            nums[k] = NAN;
+        k++;
+        if(q >= e)
+            break;
+        p = q + 1;
+    }
+    free(f->str);
+    f->str = NULL;
+    f->nums = nums;
+    f->nnums = k;
+    f->type = ENVI_HDR_NUMBERS;
+    return 0;
+}
+
+/* function : envi_hdr_split_numbers
+ *  Parse the string value "{a, b, ...}" of f into numbers, NaN for the
+ *  elements that are not numbers or if the value is not in braces. */
+static int envi_hdr_split_numbers(EnviHdrField *f)
+{
+    const char *s, *e;
+
+    s = f->str; e = f->str + strlen(f->str);
+    envi_hdr_trim(&s, &e);
+    if(e - s >= 2 && *s == '{' && e[-1] == '}'){
+        s++; e--;
+    } else {
+        s = e;
+    }
+    return envi_hdr_set_numbers(f, s, e);
+}
+
+int envi_hdr_parse(EnviHdr *hdr, const char *text, size_t n)
+{
+    size_t pos, i;
+    const char *ls, *le, *eq, *vs, *ve, *ts, *te;
+    char name[ENVI_HDR_NAME_MAX+1];
+    EnviHdrField *f;
+    EnviHdrBuf buf;
+    char **strs;
+    double num;
+    int errflg;
+
+    hdr->fields = NULL;
+    hdr->nfields = 0;
+    hdr->capfields = 0;
+    pos = 0;
+    errflg = 0;
+    while(errflg == 0 && envi_hdr_next_line(text, n, &pos, &ls, &le)){
+        /* commented out parameters are read too */
+        if(ls < le && *ls == ';') ls++;
+        eq = (const char*) memchr(ls, '=', (size_t) (le - ls));
+        if(eq == NULL)
+            continue;
+        if(envi_hdr_field_name(name, ls, eq) == 0)
+            continue;
+        vs = eq + 1; ve = le;
+        envi_hdr_trim(&vs, &ve);
+        f = envi_hdr_field(hdr, name);
+        if(f == NULL){
+            errflg = -5;
+            break;
+        }
+        f->type = ENVI_HDR_STRING;
+        buf.p = NULL; buf.n = 0; buf.cap = 0;
+        errflg = envi_hdr_buf_append(&buf, vs, (size_t) (ve - vs));
+        if(errflg != 0)
+            break;
+
+        if(envi_hdr_lower(name[0]) == 'd' && strlen(name) == 11
+                && envi_hdr_lower(name[1]) == 'e'
+                && envi_hdr_lower(name[2]) == 's'
+                && envi_hdr_lower(name[3]) == 'c'
+                && envi_hdr_lower(name[4]) == 'r'
+                && envi_hdr_lower(name[5]) == 'i'
+                && envi_hdr_lower(name[6]) == 'p'
+                && envi_hdr_lower(name[7]) == 't'
+                && envi_hdr_lower(name[8]) == 'i'
+                && envi_hdr_lower(name[9]) == 'o'
+                && envi_hdr_lower(name[10]) == 'n'){
+            if(!envi_hdr_has(vs, ve, '{') || envi_hdr_has(vs, ve, '}')){
+                f->str = buf.p;
+                continue;
+            }
+            /* the first line and the raw lines up to the closing brace */
+            f->type = ENVI_HDR_LINES;
+            f->strs = (char**) malloc(sizeof(char*));
+            if(f->strs == NULL){
+                free(buf.p);
+                errflg = -5;
+                break;
+            }
+            f->strs[0] = buf.p;
+            f->nstrs = 1;
+            while(!envi_hdr_has(ls, le, '}')
+                    && envi_hdr_next_line(text, n, &pos, &ls, &le)){
+                strs = (char**) realloc(f->strs,
+                        (f->nstrs+1)*sizeof(char*));
+                if(strs == NULL){
+                    errflg = -5;
+                    break;
+                }
+                f->strs = strs;
+                f->strs[f->nstrs] = envi_hdr_strndup(ls, (size_t) (le - ls));
+                if(f->strs[f->nstrs] == NULL){
+                    errflg = -5;
+                    break;
+                }
+                f->nstrs++;
+            }
+        } else if(!envi_parse_double(vs, ve, &num)){
+            /* the trimmed lines up to the closing brace are appended */
+            if(envi_hdr_has(vs, ve, '{') && !envi_hdr_has(vs, ve, '}')){
+                while(errflg == 0 && !envi_hdr_has(ls, le, '}')
+                        && envi_hdr_next_line(text, n, &pos, &ls, &le)){
+                    ts = ls; te = le;
+                    envi_hdr_trim(&ts, &te);
+                    errflg = envi_hdr_buf_append(&buf, ts,
+                                (size_t) (te - ts));
+                }
+            }
+            f->str = buf.p;
+        } else if(strcmp(name,"cat_crism_obsid") == 0
+                || strcmp(name,"cat_sclk_start") == 0){
+            f->str = buf.p;
+        } else if(envi_hdr_has(vs, ve, ',')){
+            /* a number with thousands separators for str2double is a 
+             * list split at the commas for str2num */
+            free(buf.p);
+            errflg = envi_hdr_set_numbers(f, vs, ve);
+        } else {
+            free(buf.p);
+            f->type = ENVI_HDR_NUMBER;
+            f->num = num;
+        }
+    }
+
+    /* lists */
+    for(i=0;errflg==0 && i<hdr->nfields;i++){
+        f = &hdr->fields[i];
+        if(f->type != ENVI_HDR_STRING)
+            continue;
+        if(strcmp(f->name,"band_names") == 0
+                || strcmp(f->name,"spectra_names") == 0){
+            errflg = envi_hdr_split_strings(f);
+        } else if(strcmp(f->name,"wavelength") == 0
+                || strcmp(f->name,"fwhm") == 0
+                || strcmp(f->name,"default_bands") == 0
+                || strcmp(f->name,"bbl") == 0){
+            errflg = envi_hdr_split_numbers(f);
+        }
+    }
+    if(errflg != 0)
+        envi_hdr_free(hdr);
+    return errflg;
+}
+
+int envi_hdr_read(EnviHdr *hdr, const char *path)
+{
+    FILE *fid;
+    char *text, *p;
+    size_t n, cap, nread;
+    int errflg;
+
+    hdr->fields = NULL;
+    hdr->nfields = 0;
+    hdr->capfields = 0;
+    fid = fopen(path, "rb");
+    if(fid == NULL)
+        return -1;
+    /* headers are small: read the whole file at once */
+    cap = 64*1024;
+    n = 0;
+    text = (char*) malloc(cap);
+    if(text == NULL){
+        fclose(fid);
+        return -5;
+    }
+    while((nread = fread(text + n, 1, cap - n, fid)) > 0){
+        n += nread;
+        if(n == cap){
+            p = (char*) realloc(text, 2*cap);
+            if(p == NULL){
+                free(text);
+                fclose(fid);
+                return -5;
+            }
+            text = p;
+            cap *= 2;
+        }
+    }
+    errflg = ferror(fid) ? -4 : 0;
+    fclose(fid);
+    if(errflg == 0)
+        errflg = envi_hdr_parse(hdr, text, n);
+    free(text);
+    return errflg;
+}
+
+void envi_hdr_free(EnviHdr *hdr)
+{
+    size_t i;
+
+    for(i=0;i<hdr->nfields;i++)
+        envi_hdr_field_clear(&hdr->fields[i]);
+    free(hdr->fields);
+    hdr->fields = NULL;
+    hdr->nfields = 0;
+    hdr->capfields = 0;
+}
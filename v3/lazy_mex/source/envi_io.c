@@ -0,0 +1,1513 @@
+/* envi_io.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "envi_io.h"
+#include "envi_hdr.h"
+#include "envi_ioplan.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#include "envi_glt.h"
+#include "envi_cache.h"
+#include "envi_filepool.h"
+#include "envi_uring.h"
+#include "envi_direct.h"
+#if defined(ENVI_HAS_MMAP)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+EnviReadMode envi_read_mode_default(void)
+{
+    return envi_cache_enabled() ? ENVI_READ_PREAD : ENVI_READ_MODE_DEFAULT;
+}
+
+void envi_read_option_init(EnviReadOption *opt)
+{
+    opt->read_mode = envi_read_mode_default();
+    opt->num_threads = 0;
+    opt->coalesce_gap = ENVI_COALESCE_GAP_DEFAULT;
+    opt->queue_depth = 0;
+    opt->precision = 0;
+    opt->replace_div = false;
+    opt->repval_div = NAN;
+    opt->valid = NULL;
+    opt->band_map = NULL;
+}
+
+const char *envi_strerror(int errflg)
+{
+    switch(errflg){
+        case 0:              return "Success";
+        case ENVI_ERR_OPEN:  return "The file cannot be opened";
+        case ENVI_ERR_SIZE:
+            return "The file size is inconsistent with the header";
+        case ENVI_ERR_MMAP:  return "The file cannot be memory-mapped";
+        case ENVI_ERR_READ:  return "Failed to read the file";
+        case ENVI_ERR_NOMEM: return "Failed to allocate memory";
+        default:             return "Unknown error";
+    }
+}
+
+int envi_header_read(EnviHeader *hdr, const char *hdrpath)
+{
+    EnviHdr h;
+    const EnviHdrField *f;
+    size_t i;
+    int errflg, nfound;
+
+    errflg = envi_hdr_read(&h, hdrpath);
+    if(errflg != 0)
+        return errflg;
+    hdr->samples = 0; hdr->lines = 0; hdr->bands = 0;
+    hdr->data_type = 0; hdr->byte_order = 0; hdr->header_offset = 0;
+    hdr->interleave = BSQ;
+    hdr->file_type = NULL;
+    hdr->data_ignore_value = NAN;
+    nfound = 0;
+    for(i=0;i<h.nfields;i++){
+        f = &h.fields[i];
+        if(f->type == ENVI_HDR_STRING && strcmp(f->name,"interleave") == 0){
+            if(strcmp(f->str,"bsq") == 0 || strcmp(f->str,"BSQ") == 0){
+                hdr->interleave = BSQ;
+            } else if(strcmp(f->str,"bip") == 0 || strcmp(f->str,"BIP") == 0){
+                hdr->interleave = BIP;
+            } else if(strcmp(f->str,"bil") == 0 || strcmp(f->str,"BIL") == 0){
+                hdr->interleave = BIL;
+            } else {
+                errflg = ENVI_ERR_SIZE;
+            }
+            nfound++;
+        }
+        if(f->type != ENVI_HDR_NUMBER)
+            continue;
+        if(strcmp(f->name,"samples") == 0){
+            hdr->samples = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"lines") == 0){
+            hdr->lines = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"bands") == 0){
+            hdr->bands = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"data_type") == 0){
+            hdr->data_type = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"byte_order") == 0){
+            hdr->byte_order = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"header_offset") == 0){
+            hdr->header_offset = (int32_t) f->num; nfound++;
+        } else if(strcmp(f->name,"data_ignore_value") == 0){
+            hdr->data_ignore_value = f->num;
+        }
+    }
+    envi_hdr_free(&h);
+    /* samples, lines, bands, data_type, byte_order, header_offset and 
+     * interleave are necessary, as in mxGetEnviHeader */
+    if(errflg == 0 && nfound != 7)
+        errflg = ENVI_ERR_SIZE;
+    return errflg;
+}
+
+bool isComputerLSBF(void){
+    int i = 1;
+    char *c = (char*)&i;
+    
+    if (*c) {
+        /* little endian */
+        return true;
+    } else {
+        /* big endian */
+        return false;
+    }
+        
+}
+
+bool envi_is_byteswap_necessary(int32_t byte_order){
+    bool computer_isLSBF;
+    bool data_isLSBF;
+    
+    /* Evaluate the endians of the computer and image data. */
+    computer_isLSBF = isComputerLSBF();
+    data_isLSBF = !((bool) byte_order);
+    return (computer_isLSBF != data_isLSBF);
+}
+
+size_t envi_get_data_type_size(int32_t data_type)
+{
+    switch(data_type){
+        case 1:  /* uint8 */
+        case 16: /* int8 */
+            return 1;
+        case 2:  /* int16 */
+        case 12: /* uint16 */
+            return 2;
+        case 3:  /* int32 */
+        case 4:  /* float */
+        case 13: /* uint32 */
+            return 4;
+        case 5:  /* double */
+        case 6:  /* complex float */
+        case 14: /* int64 */
+        case 15: /* uint64 */
+            return 8;
+        case 9:  /* complex double */
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t envi_get_swap_size(int32_t data_type, int32_t byte_order, size_t sz)
+{
+    if(sz < 2 || !envi_is_byteswap_necessary(byte_order))
+        return 0;
+    /* real and imaginary parts are swapped separately. */
+    if(data_type == 6 || data_type == 9)
+        return sz/2;
+    return sz;
+}
+
+int32_t envi_get_data_type_from_precision(const char *precision)
+{
+    if(precision[0]=='\0' || strcmp(precision,"raw")==0)     return 0;
+    else if(strcmp(precision,"uint8")==0)  return 1;
+    else if(strcmp(precision,"int16")==0)  return 2;
+    else if(strcmp(precision,"int32")==0)  return 3;
+    else if(strcmp(precision,"single")==0) return 4;
+    else if(strcmp(precision,"double")==0) return 5;
+    else if(strcmp(precision,"uint16")==0) return 12;
+    else if(strcmp(precision,"uint32")==0) return 13;
+    else if(strcmp(precision,"int64")==0)  return 14;
+    else if(strcmp(precision,"uint64")==0) return 15;
+    else if(strcmp(precision,"int8")==0)   return 16;
+    else return -1;
+}
+
+void envi_copy_kernel_init(EnviCopyKernel *kernel, EnviHeader hdr,
+        const EnviReadOption *opt, void *subimg)
+{
+    int32_t dst_type;
+    
+    /* complex data are handled as pairs of float/double parts. */
+    switch(hdr.data_type){
+        case 6:
+            kernel->src_type = 4; kernel->ncomp = 2; break;
+        case 9:
+            kernel->src_type = 5; kernel->ncomp = 2; break;
+        default:
+            kernel->src_type = hdr.data_type; kernel->ncomp = 1; break;
+    }
+    dst_type = (opt != NULL) ? opt->precision : 0;
+    if(dst_type == 6) dst_type = 4;
+    if(dst_type == 9) dst_type = 5;
+    kernel->dst_type = (dst_type > 0) ? dst_type : kernel->src_type;
+    kernel->src_sz = kernel->ncomp*envi_get_data_type_size(kernel->src_type);
+    kernel->dst_sz = kernel->ncomp*envi_get_data_type_size(kernel->dst_type);
+    kernel->swap_sz = envi_get_swap_size(hdr.data_type, hdr.byte_order,
+                        kernel->src_sz);
+    if(opt != NULL)
+        envi_copy_kernel_set_div(kernel, hdr.data_ignore_value,
+            opt->replace_div, opt->repval_div, opt->valid, subimg);
+    else
+        envi_copy_kernel_set_div(kernel, hdr.data_ignore_value,
+            false, 0, NULL, subimg);
+}
+
+/* function : swapFloat_shuffle 
+ *  swap the bytes of the input float variable into the reverse direction 
+ *  for resolving endian issues using byte shuffling.  
+ *  Input Parameters
+ *    float inFolat: input float before swapped 
+ *  Returns
+ *    float retVal : output float after swapped */
+float swapFloat_shuffle( float inFloat )
+{
+   float retVal;
+   char *inFloat_char = (char*) &inFloat;
+   char *retVal_char  = (char*) &retVal;
+   
+   // swap the bytes into a temporary buffer
+   retVal_char[0] = inFloat_char[3];
+   retVal_char[1] = inFloat_char[2];
+   retVal_char[2] = inFloat_char[1];
+   retVal_char[3] = inFloat_char[0];
+
+   return retVal;
+}
+
+/* function : swapFloat 
+ *  swap the bytes of the input float variable into the reverse direction 
+ *  for resolving endian issues using bit shifts. 
+ *  Input Parameters
+ *    float inFolat: input float before swapped 
+ *  Returns
+ *    float retVal : output float after swapped */
+float swapFloat( const float inFloat )
+{
+   float retVal;
+   uint32_t *inFloat_int = (uint32_t*) &inFloat;
+   uint32_t *retVal_int  = (uint32_t*) &retVal;
+   
+   *retVal_int = (*inFloat_int<<24) | ( (*inFloat_int<<8) & 0x00FF0000u )
+                 | ( (*inFloat_int>>8) & 0x0000FF00u)
+                 | ( (*inFloat_int>>24) & 0x000000FFu);
+   
+   return retVal;
+}
+
+void envi_assign_skipread_dims(EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        EnviSkipReadDim *dim1, EnviSkipReadDim *dim2, EnviSkipReadDim *dim3)
+{
+    EnviSkipReadDim smpl, line, band;
+    
+    smpl.d          = (long int) hdr.samples;
+    smpl.skipszlist = smpl_skipszlist;
+    smpl.readszlist = smpl_readszlist;
+    smpl.N_skipread = N_smpl_skipread;
+    smpl.skip_last  = smpl_skip_last;
+    
+    line.d          = (long int) hdr.lines;
+    line.skipszlist = line_skipszlist;
+    line.readszlist = line_readszlist;
+    line.N_skipread = N_line_skipread;
+    line.skip_last  = line_skip_last;
+    
+    band.d          = (long int) hdr.bands;
+    band.skipszlist = band_skipszlist;
+    band.readszlist = band_readszlist;
+    band.N_skipread = N_band_skipread;
+    band.skip_last  = band_skip_last;
+    
+    switch(hdr.interleave){
+        case BIL :
+            *dim1 = smpl; *dim2 = band; *dim3 = line;
+            break;
+        case BIP :
+            *dim1 = band; *dim2 = smpl; *dim3 = line;
+            break;
+        case BSQ :
+        default :
+            *dim1 = smpl; *dim2 = line; *dim3 = band;
+            break;
+    }
+}
+
+/* function : envi_gather_row
+ *  Copy the runs selected by dim1 from one row (d1 elements) of the image
+ *  into subimg, applying the kernel on the way. Returns the number of 
+ *  bytes written to subimg. */
+static size_t envi_gather_row(char *subimg, const char *row,
+        const EnviSkipReadDim *dim1, const EnviCopyKernel *kernel)
+{
+    size_t k;
+    size_t subimg_offset, curskip;
+    EnviCopyFn copy_fn;
+    
+    copy_fn = envi_copy_kernel_fn(kernel);
+    subimg_offset = 0;
+    curskip = 0;
+    for(k=0;k<dim1->N_skipread;k++){
+        curskip += (size_t) dim1->skipszlist[k] * kernel->src_sz;
+        copy_fn(kernel, subimg+subimg_offset, row+curskip,
+            dim1->readszlist[k]);
+        subimg_offset += dim1->readszlist[k] * kernel->dst_sz;
+        curskip += dim1->readszlist[k] * kernel->src_sz;
+    }
+    return subimg_offset;
+}
+
+/* function : envi_gather_plane
+ *  Copy the runs selected by dim1 and dim2 from one d1 x d2 plane of the 
+ *  image into the rows of stage from *row on, applying the kernel of the
+ *  stage on the way. *row is advanced past the rows written. */
+static void envi_gather_plane(EnviStage *stage, size_t *row,
+        const char *plane, const EnviSkipReadDim *dim1, 
+        const EnviSkipReadDim *dim2)
+{
+    size_t j,jj;
+    size_t curskip, szrow;
+    
+    szrow = (size_t) dim1->d * stage->kernel.src_sz;
+    curskip = 0;
+    for(j=0;j<dim2->N_skipread;j++){
+        curskip += (size_t) dim2->skipszlist[j] * szrow;
+        for(jj=0;jj<dim2->readszlist[j];jj++){
+            envi_gather_row(envi_stage_row(stage, (*row)++),
+                plane+curskip, dim1, &stage->kernel);
+            curskip += szrow;
+        }
+    }
+}
+
+void envi_layout_init_skipread(EnviLayout *layout, EnviHeader hdr,
+        const EnviSkipReadDim *dim1, const EnviSkipReadDim *dim2,
+        const EnviSkipReadDim *dim3, size_t *band_map, size_t sz)
+{
+    size_t n[3], o[3], i, k;
+    const EnviSkipReadDim *dims[3];
+    size_t *omap[3];
+    size_t L, S;
+    
+    dims[0] = dim1; dims[1] = dim2; dims[2] = dim3;
+    omap[0] = NULL; omap[1] = NULL; omap[2] = NULL;
+    for(k=0;k<3;k++){
+        n[k] = 0;
+        for(i=0;i<dims[k]->N_skipread;i++)
+            n[k] += dims[k]->readszlist[i];
+    }
+    switch(hdr.interleave){
+        case BIL :
+            L = n[2]; S = n[0];
+            o[0] = L; o[1] = L*S; o[2] = 1;
+            omap[1] = band_map;
+            break;
+        case BIP :
+            L = n[2]; S = n[1];
+            o[0] = L*S; o[1] = L; o[2] = 1;
+            omap[0] = band_map;
+            break;
+        case BSQ :
+        default :
+            L = n[1]; S = n[0];
+            o[0] = L; o[1] = 1; o[2] = L*S;
+            omap[2] = band_map;
+            break;
+    }
+    envi_layout_init_map(layout, n, o, omap, sz);
+}
+
+int envi_band_map_init(size_t *band_map, const size_t *band_index,
+        size_t nb, size_t nd)
+{
+    size_t j, k, nfirst;
+
+    for(k=0;k<nd;k++)
+        band_map[k] = nd;
+    nfirst = 0;
+    for(j=0;j<nb;j++){
+        if(band_index[j] >= nd)
+            return -1;
+        if(band_map[band_index[j]] == nd)
+            band_map[band_index[j]] = nfirst++;
+    }
+    return (nfirst == nd) ? 0 : -1;
+}
+
+void envi_band_map_expand(char *subimg, size_t plane_nbytes,
+        const size_t *band_index, const size_t *band_map, size_t nb)
+{
+    size_t j, r;
+
+    /* The band read for the output band j was packed at 
+     * r = band_map[band_index[j]] <= j, so going backward never overwrites
+     * a band that is still to be copied. */
+    for(j=nb;j-->0;){
+        r = band_map[band_index[j]];
+        if(r != j)
+            memcpy(subimg + j*plane_nbytes, subimg + r*plane_nbytes,
+                plane_nbytes);
+    }
+}
+
+/* function : envi_fskip
+ *  Move the position of fid forward (or backward) by offset bytes.
+ *  Returns 0 on success and -4 on failure. */
+static int envi_fskip(FILE *fid, long int offset)
+{
+    if(offset != 0 && fseek(fid, offset, SEEK_CUR) != 0)
+        return -4;
+    return 0;
+}
+
+/* function : envi_fread_run
+ *  Read n elements at the current position of fid into subimg applying 
+ *  the kernel, which writes n*kernel->dst_sz bytes to subimg. If the 
+ *  kernel is plain, the elements are read directly into subimg and the
+ *  kernel is applied in place, otherwise they are read through buf of 
+ *  nbuf bytes. Returns 0 on success and -4 if fewer than n elements could
+ *  be read. */
+static int envi_fread_run(FILE *fid, char *subimg, size_t n,
+        const EnviCopyKernel *kernel, char *buf, size_t nbuf)
+{
+    size_t nchunk, nchunk_max, subimg_offset;
+    
+    if(envi_copy_kernel_is_plain(kernel)){
+        if(fread(subimg,kernel->src_sz,n,fid) != n)
+            return -4;
+        envi_copy_kernel_apply(kernel,subimg,subimg,n);
+        return 0;
+    }
+    nchunk_max = nbuf / kernel->src_sz;
+    subimg_offset = 0;
+    while(n > 0){
+        nchunk = (n < nchunk_max) ? n : nchunk_max;
+        if(fread(buf,kernel->src_sz,nchunk,fid) != nchunk)
+            return -4;
+        envi_copy_kernel_apply(kernel, subimg+subimg_offset, buf, nchunk);
+        subimg_offset += nchunk*kernel->dst_sz;
+        n -= nchunk;
+    }
+    return 0;
+}
+
+/* function : envi_fread_rows
+ *  Read nrows whole rows (d1 elements) that are contiguous in the file 
+ *  from the current position of fid into the rows of stage from *row on.
+ *  The rows of a staging block are contiguous in the stage, and all the 
+ *  rows are with an identity layout (the stage is subimg), so each block
+ *  is read with a single envi_fread_run. *row is advanced past the rows
+ *  read. Returns 0 on success and -4 if the rows could not be read. */
+static int envi_fread_rows(FILE *fid, EnviStage *stage, size_t *row,
+        size_t nrows, size_t d1, char *buf, size_t nbuf)
+{
+    const EnviLayout *layout = stage->layout;
+    size_t n;
+
+    while(nrows > 0){
+        n = nrows;
+        if(!layout->identity){
+            n = layout->block_rows - *row % layout->block_rows;
+            if(n > nrows) n = nrows;
+        }
+        if(envi_fread_run(fid, envi_stage_row(stage, *row), n*d1,
+                &stage->kernel, buf, nbuf) != 0)
+            return -4;
+        *row += n;
+        nrows -= n;
+    }
+    return 0;
+}
+
+/* function : envi_is_row_full
+ *  Evaluate if the runs selected by dim1 are the whole row. */
+static bool envi_is_row_full(const EnviSkipReadDim *dim1)
+{
+    size_t k, nread;
+
+    nread = 0;
+    for(k=0;k<dim1->N_skipread;k++)
+        nread += dim1->readszlist[k];
+    return nread == (size_t) dim1->d;
+}
+
+/* function : envi_fread_nslabs
+ *  Number of consecutive d1 x d2 slabs of the runs of dim3 that are read
+ *  at once into a buffer of at most ENVI_SLABBUF_SIZE bytes, from the 
+ *  first row selected by dim2 in the first slab to the last one in the 
+ *  last slab. Returns 0 (the slabs are read one at a time) if no rows are
+ *  selected, if fewer than two slabs fit, or if rows skipped between two
+ *  selected rows are more than gap bytes, which are better skipped than
+ *  read. */
+static size_t envi_fread_nslabs(const EnviSkipReadDim *dim2,
+        const EnviSkipReadDim *dim3, size_t szrow, size_t gap)
+{
+    size_t j, szplane, nslabs, nmax;
+
+    szplane = (size_t) dim2->d * szrow;
+    if(szplane == 0 || dim2->N_skipread == 0)
+        return 0;
+    nslabs = ENVI_SLABBUF_SIZE / szplane;
+    for(j=0,nmax=0;j<dim3->N_skipread;j++)
+        if(dim3->readszlist[j] > nmax) nmax = dim3->readszlist[j];
+    if(nmax < nslabs) nslabs = nmax;
+    if(nslabs < 2)
+        return 0;
+    for(j=1;j<dim2->N_skipread;j++)
+        if((size_t) dim2->skipszlist[j] * szrow > gap)
+            return 0;
+    if((size_t) (dim2->skip_last + dim2->skipszlist[0]) * szrow > gap)
+        return 0;
+    return nslabs;
+}
+
+/* function : envi_is_row_sparse
+ *  Evaluate if the runs selected by dim1 are sparse enough in a row that 
+ *  reading the exact byte spans is cheaper than reading the whole row.
+ *  This is the case when the average gap between the runs is no smaller 
+ *  than ENVI_EXACT_SPAN_GAP bytes. */
+static bool envi_is_row_sparse(const EnviSkipReadDim *dim1, size_t sz)
+{
+    size_t k, nread;
+    
+    nread = 0;
+    for(k=0;k<dim1->N_skipread;k++)
+        nread += dim1->readszlist[k];
+    return ((size_t) dim1->d - nread) * sz
+            >= ENVI_EXACT_SPAN_GAP * (dim1->N_skipread + 1);
+}
+
+int lazyenvireadRectx_multBand(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt)
+{
+    size_t i,ii,j,jj,k;
+    char *buf;
+    long int sz_li;
+    EnviFile file;
+    FILE *fid;
+    long int header_offset;
+    EnviSkipReadDim dim1, dim2, dim3;
+    EnviCopyKernel kernel;
+    long int szrow;
+    size_t nrows_buf, nrows, nbuf, row, nskip, nslabs_buf, nslabs;
+    size_t szplane, slab_start, slab_end, slab_nbytes;
+    bool row_sparse, row_full;
+    char *subimg_c;
+    EnviLayout layout;
+    EnviStage stage;
+    int errflg;
+
+    (void) dims_subimg;
+    sz_li = (long int) sz;
+    envi_copy_kernel_init(&kernel, hdr, opt, subimg);
+
+    if(envi_file_open(&file, imgpath, true) != 0){
+        return -1;
+    }
+    fid = file.fid;
+    /* Evaluate if the image header have valid information of the image */
+    header_offset = (long int) hdr.header_offset;
+    /* If the image file size is less than the size indicated by the header
+     * then return an error. */
+    if(file.size < (size_t) hdr.samples * (size_t) hdr.lines 
+            * (size_t) hdr.bands * sz + (size_t) header_offset){
+        envi_file_close(&file);
+        return -2;
+    }
+    if(fseek(fid, header_offset, SEEK_SET) != 0){
+        envi_file_close(&file);
+        return -4;
+    }
+    
+    /* Evaluate interleave option */
+    envi_assign_skipread_dims(hdr,
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        &dim1, &dim2, &dim3);
+
+    /* Only the d2 rows selected by dim2 are read. If dim1 selects whole 
+     * rows, the rows between two skips are one contiguous span of the file,
+     * read directly into the stage (see envi_fread_rows). If the runs in a
+     * row are sparse, only their exact byte spans are read directly into 
+     * the stage (through buf if the kernel converts the data type), 
+     * otherwise the selected rows are read into buf, nslabs_buf slabs at 
+     * a time (see envi_fread_nslabs) or else at most nrows_buf rows at a 
+     * time, and the runs are copied from there. The stage scatters the 
+     * rows into subimg. */
+    envi_layout_init_skipread(&layout, hdr, &dim1, &dim2, &dim3,
+        (opt != NULL) ? opt->band_map : NULL, kernel.dst_sz);
+    szrow = dim1.d * sz_li;
+    szplane = (size_t) dim2.d * (size_t) szrow;
+    row_full = envi_is_row_full(&dim1);
+    row_sparse = !row_full && envi_is_row_sparse(&dim1, sz);
+    nrows_buf = 0;
+    nslabs_buf = 0;
+    nbuf = 0;
+    if(!row_full && !row_sparse)
+        nslabs_buf = envi_fread_nslabs(&dim2, &dim3, (size_t) szrow,
+            (opt != NULL) ? opt->coalesce_gap : ENVI_COALESCE_GAP_DEFAULT);
+    if(row_full){
+        if(!envi_copy_kernel_is_plain(&kernel)){
+            nbuf = (size_t) szrow * layout.nrows;
+            if(nbuf > ENVI_READBUF_SIZE) nbuf = ENVI_READBUF_SIZE;
+            if(nbuf < sz) nbuf = sz;
+        }
+    } else if(nslabs_buf > 0){
+        nbuf = nslabs_buf * szplane;
+    } else if(!row_sparse && szrow > 0){
+        nrows_buf = ENVI_READBUF_SIZE / (size_t) szrow;
+        if(nrows_buf < 1) nrows_buf = 1;
+        for(j=0,nrows=0;j<dim2.N_skipread;j++)
+            if(dim2.readszlist[j] > nrows) nrows = dim2.readszlist[j];
+        if(nrows < nrows_buf) nrows_buf = nrows;
+        nbuf = nrows_buf * (size_t) szrow;
+    } else if(row_sparse && !envi_copy_kernel_is_plain(&kernel)){
+        nbuf = (szrow < ENVI_READBUF_SIZE) ? (size_t) szrow : ENVI_READBUF_SIZE;
+        if(nbuf < sz) nbuf = sz;
+    }
+    buf = NULL;
+    if(nbuf > 0){
+        buf = (char*) malloc(nbuf);
+        if(buf==NULL){
+            envi_file_close(&file);
+            return -5;
+        }
+    }
+    if(envi_stage_init(&stage, &layout, &kernel, (char*) subimg) != 0){
+        free(buf);
+        envi_file_close(&file);
+        return -5;
+    }
+    
+    /* read the data from the file */
+    row = 0;
+    errflg = 0;
+    if(row_full){
+        /* nrows rows are pending in the current span, and the nskip rows 
+         * following them are skipped when the span is read */
+        nrows = 0;
+        nskip = 0;
+        for(i=0;i<dim3.N_skipread && errflg==0;i++){
+            nskip += (size_t) dim3.skipszlist[i] * (size_t) dim2.d;
+            for(ii=0;ii<dim3.readszlist[i] && errflg==0;ii++){
+                for(j=0;j<dim2.N_skipread && errflg==0;j++){
+                    nskip += (size_t) dim2.skipszlist[j];
+                    if(nskip > 0){
+                        errflg = envi_fread_rows(fid, &stage, &row, nrows,
+                            (size_t) dim1.d, buf, nbuf);
+                        if(errflg == 0)
+                            errflg = envi_fskip(fid,(long int) nskip*szrow);
+                        nrows = 0;
+                        nskip = 0;
+                    }
+                    nrows += dim2.readszlist[j];
+                }
+                nskip += (size_t) dim2.skip_last;
+            }
+        }
+        if(errflg == 0)
+            errflg = envi_fread_rows(fid, &stage, &row, nrows,
+                (size_t) dim1.d, buf, nbuf);
+    } else if(nslabs_buf > 0){
+        /* The window [slab_start,slab_end) of the selected rows of a slab
+         * is read for nslabs consecutive slabs with one fread, into buf at
+         * the same offsets as in the file so that slab k starts at 
+         * buf+k*szplane. */
+        slab_start = 0;
+        if(dim2.N_skipread > 0)
+            slab_start = (size_t) dim2.skipszlist[0] * (size_t) szrow;
+        slab_end = szplane - (size_t) dim2.skip_last * (size_t) szrow;
+        for(i=0;i<dim3.N_skipread && errflg==0;i++){
+            errflg = envi_fskip(fid,dim1.d*dim2.d*dim3.skipszlist[i]*sz_li);
+            for(ii=0;ii<dim3.readszlist[i] && errflg==0;ii+=nslabs){
+                nslabs = dim3.readszlist[i] - ii;
+                if(nslabs > nslabs_buf) nslabs = nslabs_buf;
+                slab_nbytes = (nslabs-1)*szplane + slab_end - slab_start;
+                if(envi_fskip(fid,(long int) slab_start) != 0
+                        || fread(buf+slab_start,1,slab_nbytes,fid)
+                            != slab_nbytes
+                        || envi_fskip(fid,(long int) (szplane-slab_end))
+                            != 0){
+                    errflg = -4;
+                    break;
+                }
+                for(k=0;k<nslabs;k++)
+                    envi_gather_plane(&stage, &row, buf+k*szplane, &dim1,
+                        &dim2);
+            }
+        }
+    } else {
+        for(i=0;i<dim3.N_skipread && errflg==0;i++){
+            errflg = envi_fskip(fid,dim1.d*dim2.d*dim3.skipszlist[i]*sz_li);
+            for(ii=0;ii<dim3.readszlist[i] && errflg==0;ii++){
+                for(j=0;j<dim2.N_skipread && errflg==0;j++){
+                    errflg = envi_fskip(fid,dim2.skipszlist[j]*szrow);
+                    if(row_sparse){
+                        for(jj=0;jj<dim2.readszlist[j] && errflg==0;jj++){
+                            subimg_c = envi_stage_row(&stage, row++);
+                            for(k=0;k<dim1.N_skipread && errflg==0;k++){
+                                errflg = envi_fskip(fid,
+                                    dim1.skipszlist[k]*sz_li);
+                                if(errflg == 0)
+                                    errflg = envi_fread_run(fid, subimg_c,
+                                        dim1.readszlist[k], &stage.kernel,
+                                        buf, nbuf);
+                                subimg_c += dim1.readszlist[k]
+                                    * stage.kernel.dst_sz;
+                            }
+                            if(errflg == 0)
+                                errflg = envi_fskip(fid,dim1.skip_last*sz_li);
+                        }
+                    } else {
+                        for(jj=0;jj<dim2.readszlist[j] && errflg==0;
+                                jj+=nrows){
+                            nrows = dim2.readszlist[j] - jj;
+                            if(nrows > nrows_buf) nrows = nrows_buf;
+                            if(fread(buf,(size_t) szrow,nrows,fid) != nrows){
+                                errflg = -4;
+                                break;
+                            }
+                            for(k=0;k<nrows;k++){
+                                envi_gather_row(
+                                    envi_stage_row(&stage, row++),
+                                    buf+k*(size_t) szrow, &dim1,
+                                    &stage.kernel);
+                            }
+                        }
+                    }
+                }
+                if(errflg == 0)
+                    errflg = envi_fskip(fid,dim2.skip_last*szrow);
+            }
+        }
+    }
+    if(errflg == 0)
+        envi_stage_flush(&stage);
+    envi_stage_free(&stage);
+    free(buf);
+    envi_file_close(&file);
+    
+    return errflg;
+}
+
+#if defined(ENVI_HAS_MMAP)
+/* function : envi_mmap_advise
+ *  Give the kernel a hint on how the mapped region [span_start,span_end) 
+ *  is going to be accessed. Dense requests (more than a half of the bytes 
+ *  in the span are read) are read sequentially with read-ahead, while 
+ *  sparse requests (less than 1/16) are flagged random so that the kernel
+ *  does not waste read-ahead on the skipped parts. */
+static void envi_mmap_advise(char *map, size_t span_start, size_t span_end,
+        size_t nbytes_read)
+{
+    size_t pgsz, pg_start;
+    
+    if(span_end <= span_start)
+        return;
+    pgsz = (size_t) sysconf(_SC_PAGESIZE);
+    pg_start = span_start - span_start % pgsz;
+    if(nbytes_read*2 > span_end - span_start){
+        posix_madvise(map+pg_start, span_end-pg_start, POSIX_MADV_SEQUENTIAL);
+        posix_madvise(map+pg_start, span_end-pg_start, POSIX_MADV_WILLNEED);
+    } else if(nbytes_read*16 < span_end - span_start){
+        posix_madvise(map+pg_start, span_end-pg_start, POSIX_MADV_RANDOM);
+    }
+}
+#endif
+
+int lazyenvireadRectx_multBand_mmap(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt)
+{
+#if defined(ENVI_HAS_MMAP)
+    size_t i,ii;
+    EnviFile file;
+    char *map;
+    size_t szfile, szmap, header_offset;
+    size_t szplane, plane_offset, span_start, span_end;
+    EnviSkipReadDim dim1, dim2, dim3;
+    EnviCopyKernel kernel;
+    EnviLayout layout;
+    EnviStage stage;
+    size_t row;
+
+    envi_copy_kernel_init(&kernel, hdr, opt, subimg);
+    if(envi_file_open(&file, imgpath, false) != 0){
+        return -1;
+    }
+    /* If the image file size is less than the size indicated by the header
+     * then return an error. */
+    header_offset = (size_t) hdr.header_offset;
+    szfile = file.size;
+    szplane = (size_t) hdr.samples * (size_t) hdr.lines * sz;
+    if(szfile < szplane * (size_t) hdr.bands + header_offset){
+        envi_file_close(&file);
+        return -2;
+    }
+    szmap = szplane * (size_t) hdr.bands + header_offset;
+    if(szmap == 0){
+        envi_file_close(&file);
+        return 0;
+    }
+    map = (char*) mmap(NULL, szmap, PROT_READ, MAP_SHARED, file.fd, 0);
+    /* the mapping holds its own reference to the file. */
+    envi_file_close(&file);
+    if(map == MAP_FAILED){
+        return -3;
+    }
+    
+    /* Evaluate interleave option */
+    envi_assign_skipread_dims(hdr,
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        &dim1, &dim2, &dim3);
+    
+    /* Give access pattern hints for the span of the planes to be read. */
+    szplane = (size_t) dim1.d * (size_t) dim2.d * sz;
+    span_start = header_offset;
+    if(dim3.N_skipread > 0)
+        span_start += (size_t) dim3.skipszlist[0] * szplane;
+    span_end = szmap - (size_t) dim3.skip_last * szplane;
+    envi_mmap_advise(map, span_start, span_end,
+        dims_subimg[0]*dims_subimg[1]*dims_subimg[2]*sz);
+    
+    envi_layout_init_skipread(&layout, hdr, &dim1, &dim2, &dim3,
+        (opt != NULL) ? opt->band_map : NULL, kernel.dst_sz);
+    if(envi_stage_init(&stage, &layout, &kernel, (char*) subimg) != 0){
+        munmap(map, szmap);
+        return -5;
+    }
+    
+    /* gather the runs straight from the mapped file */
+    plane_offset = header_offset;
+    row = 0;
+    for(i=0;i<dim3.N_skipread;i++){
+        plane_offset += (size_t) dim3.skipszlist[i] * szplane;
+        for(ii=0;ii<dim3.readszlist[i];ii++){
+            envi_gather_plane(&stage, &row, map + plane_offset,
+                &dim1, &dim2);
+            plane_offset += szplane;
+        }
+    }
+    envi_stage_flush(&stage);
+    envi_stage_free(&stage);
+    munmap(map, szmap);
+    
+    return 0;
+#else
+    return lazyenvireadRectx_multBand(imgpath, hdr, 
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        subimg, dims_subimg, sz, opt);
+#endif
+}
+
+int lazyenvireadRectx_multBand_pthread(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt, EnviIOPlanStats *stats)
+{
+#if defined(ENVI_HAS_PTHREAD)
+    int errflg;
+    EnviFile file;
+    size_t header_offset;
+    EnviSkipReadDim dim1, dim2, dim3;
+    EnviCopyKernel kernel;
+    EnviLayout layout;
+    EnviIOPlan plan;
+    EnviCacheFile cache;
+    EnviReadOption opt_default;
+
+    (void) dims_subimg;
+    /* opt may be NULL: the default options are used */
+    if(opt == NULL){
+        envi_read_option_init(&opt_default);
+        opt = &opt_default;
+    }
+    if(envi_file_open(&file, imgpath, false) != 0){
+        return -1;
+    }
+    /* If the image file size is less than the size indicated by the header
+     * then return an error. */
+    header_offset = (size_t) hdr.header_offset;
+    if(file.size < (size_t) hdr.samples * (size_t) hdr.lines 
+            * (size_t) hdr.bands * sz + header_offset){
+        envi_file_close(&file);
+        return -2;
+    }
+    
+    /* Evaluate interleave option */
+    envi_assign_skipread_dims(hdr,
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        &dim1, &dim2, &dim3);
+    
+    /* plan the reads and execute them */
+    envi_copy_kernel_init(&kernel, hdr, opt, subimg);
+    envi_layout_init_skipread(&layout, hdr, &dim1, &dim2, &dim3,
+        opt->band_map, kernel.dst_sz);
+    envi_ioplan_init(&plan, &kernel, opt->coalesce_gap, ENVI_READBUF_SIZE,
+        layout.block_rows * layout.n[0] * kernel.dst_sz);
+    /* a streaming scan reads windows of max_segment, and does not fill the
+     * block cache either */
+    if(opt->read_mode != ENVI_READ_DIRECT){
+        envi_ioplan_enable_spans(&plan, &layout);
+        if(envi_cache_enabled() && envi_cache_file_init(&cache, file.fd) == 0)
+            plan.cache = &cache;
+    }
+    errflg = envi_ioplan_build(&plan, &dim1, &dim2, &dim3, header_offset);
+    if(errflg == 0){
+        if(stats != NULL)
+            envi_ioplan_get_stats(&plan, stats);
+        if(opt->read_mode == ENVI_READ_DIRECT)
+            errflg = envi_ioplan_execute_direct(&plan, imgpath, file.fd,
+                        (char*) subimg, &layout);
+        else if(envi_uring_use(opt->read_mode, &plan))
+            errflg = envi_ioplan_execute_uring(&plan, file.fd, 
+                        (char*) subimg, &layout, opt->queue_depth);
+        else
+            errflg = envi_ioplan_execute(&plan, file.fd, (char*) subimg,
+                        &layout, opt->num_threads);
+    }
+    envi_ioplan_free(&plan);
+    envi_file_close(&file);
+    
+    return errflg;
+#else
+    if(stats != NULL)
+        lazyenvireadRectx_multBand_ioplan_stats(hdr, 
+            smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+            line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+            band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+            sz, opt, stats);
+    return lazyenvireadRectx_multBand(imgpath, hdr, 
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        subimg, dims_subimg, sz, opt);
+#endif
+}
+
+/* function : envi_copy_kernel_fill
+ *  Store v, converted from double to the precision of the kernel, in the
+ *  element elem (in each part of complex elements). */
+static void envi_copy_kernel_fill(const EnviCopyKernel *kernel, char *elem,
+        double v)
+{
+    EnviCopyKernel kfill;
+    size_t c;
+
+    kfill = *kernel;
+    kfill.src_type = 5; kfill.ncomp = 1; kfill.swap_sz = 0;
+    kfill.src_sz = sizeof(double);
+    kfill.dst_sz = kernel->dst_sz / kernel->ncomp;
+    envi_copy_kernel_set_div(&kfill, 0, false, 0, NULL, NULL);
+    for(c=0;c<kernel->ncomp;c++)
+        envi_copy_kernel_apply(&kfill, elem + c*kfill.dst_sz, &v, 1);
+}
+
+/* EnviPixelKey
+ *  Offset of a pixel (line*samples + sample) and its index in the list of
+ *  pixels given by the caller. */
+typedef struct EnviPixelKey {
+    size_t key;
+    size_t j;
+} EnviPixelKey ;
+
+static int envi_pixel_key_cmp(const void *a, const void *b)
+{
+    const EnviPixelKey *ka = (const EnviPixelKey*) a;
+    const EnviPixelKey *kb = (const EnviPixelKey*) b;
+
+    if(ka->key != kb->key)
+        return (ka->key < kb->key) ? -1 : 1;
+    return (ka->j < kb->j) ? -1 : (ka->j > kb->j);
+}
+
+/* function : envi_pixel_ioplan_build
+ *  Add the runs of the selected bands of the distinct pixels 
+ *  pixkey[k0..k1) (sorted offsets) in increasing file order. The band b 
+ *  (among the B selected) of the pixel k goes to the element k*B+b of the
+ *  staging buffer. Returns 0 on success and -5 if memory allocation 
+ *  failed. */
+static int envi_pixel_ioplan_build(EnviIOPlan *plan, EnviHeader hdr,
+        const size_t *pixkey, size_t k0, size_t k1,
+        const long int *band_skipszlist, const size_t *band_readszlist,
+        size_t N_band_skipread, size_t B)
+{
+    size_t S, L, Bh, sz, dsz, offset0, k, kend, l, q, r, b, bo, bb;
+
+    S = (size_t) hdr.samples; L = (size_t) hdr.lines; Bh = (size_t) hdr.bands;
+    sz = plan->sz; dsz = plan->kernel.dst_sz;
+    offset0 = (size_t) hdr.header_offset;
+    switch(hdr.interleave){
+        case BIP :
+            /* the spectrum of a pixel is contiguous */
+            for(k=k0;k<k1;k++){
+                b = 0; bo = 0;
+                for(r=0;r<N_band_skipread;r++){
+                    b += (size_t) band_skipszlist[r];
+                    if(envi_ioplan_add_run(plan, 
+                            offset0 + (pixkey[k]*Bh + b)*sz,
+                            band_readszlist[r]*sz, (k*B + bo)*dsz) != 0)
+                        return -5;
+                    b += band_readszlist[r]; bo += band_readszlist[r];
+                }
+            }
+            break;
+        case BIL :
+            /* the pixels of a line are read band row after band row */
+            for(k=k0;k<k1;k=kend){
+                l = pixkey[k] / S;
+                for(kend=k;kend<k1 && pixkey[kend]/S==l;kend++);
+                b = 0; bo = 0;
+                for(r=0;r<N_band_skipread;r++){
+                    b += (size_t) band_skipszlist[r];
+                    for(bb=0;bb<band_readszlist[r];bb++,b++,bo++){
+                        for(q=k;q<kend;q++){
+                            if(envi_ioplan_add_run(plan, 
+                                    offset0 + ((l*Bh + b)*S + pixkey[q]%S)*sz,
+                                    sz, (q*B + bo)*dsz) != 0)
+                                return -5;
+                        }
+                    }
+                }
+            }
+            break;
+        case BSQ :
+        default :
+            /* the pixels are read band plane after band plane */
+            b = 0; bo = 0;
+            for(r=0;r<N_band_skipread;r++){
+                b += (size_t) band_skipszlist[r];
+                for(bb=0;bb<band_readszlist[r];bb++,b++,bo++){
+                    for(k=k0;k<k1;k++){
+                        if(envi_ioplan_add_run(plan, 
+                                offset0 + (b*L*S + pixkey[k])*sz,
+                                sz, (k*B + bo)*dsz) != 0)
+                            return -5;
+                    }
+                }
+            }
+            break;
+    }
+    return 0;
+}
+
+/* function : envi_read_pixels
+ *  Body of lazyenvireadPixelsx_multBand and lazyenvireadGLTx_multBand. 
+ *  The pixels with an ENVI_PIXEL_NONE index take the spectrum of an 
+ *  extra staged row holding fillval. */
+static int envi_read_pixels(char *imgpath, EnviHeader hdr,
+        const size_t *smpls, const size_t *lines, size_t npix,
+        const long int* band_skipszlist, const size_t* band_readszlist,
+        size_t N_band_skipread, double fillval,
+        void *spc, size_t sz, const EnviReadOption *opt,
+        EnviIOPlanStats *stats)
+{
+    EnviFile file;
+    EnviReadOption opt_stage;
+    EnviCopyKernel kernel;
+    EnviIOPlan plan;
+    EnviIOPlanStats plan_stats;
+    EnviCacheFile *pcache;
+#if defined(ENVI_HAS_PTHREAD)
+    EnviCacheFile cache;
+#endif
+    EnviPixelKey *keys;
+    size_t *pixkey, *rank;
+    size_t B, nuniq, nfill, nstage, npieces_pix, chunk, j, k0, k1;
+    char *stage;
+    bool *vstage;
+    int errflg;
+
+    if(stats != NULL){
+        stats->n_syscalls = 0; stats->n_copies = 0;
+        stats->nbytes_read = 0; stats->nbytes_used = 0;
+    }
+    if(envi_file_open(&file, imgpath, true) != 0){
+        return -1;
+    }
+    /* If the image file size is less than the size indicated by the header
+     * then return an error. */
+    if(file.size < (size_t) hdr.samples * (size_t) hdr.lines 
+            * (size_t) hdr.bands * sz + (size_t) hdr.header_offset){
+        envi_file_close(&file);
+        return -2;
+    }
+    B = 0;
+    for(j=0;j<N_band_skipread;j++)
+        B += band_readszlist[j];
+    if(npix == 0 || B == 0){
+        envi_file_close(&file);
+        return 0;
+    }
+
+    /* sort the pixels by file offset and number the distinct ones */
+    keys = (EnviPixelKey*) malloc(npix*sizeof(EnviPixelKey));
+    pixkey = (size_t*) malloc(npix*sizeof(size_t));
+    rank = (size_t*) malloc(npix*sizeof(size_t));
+    if(keys==NULL || pixkey==NULL || rank==NULL){
+        free(keys); free(pixkey); free(rank);
+        envi_file_close(&file);
+        return -5;
+    }
+    for(j=0;j<npix;j++){
+        if(smpls[j] == ENVI_PIXEL_NONE || lines[j] == ENVI_PIXEL_NONE)
+            keys[j].key = ENVI_PIXEL_NONE;
+        else
+            keys[j].key = lines[j] * (size_t) hdr.samples + smpls[j];
+        keys[j].j = j;
+    }
+    qsort(keys, npix, sizeof(EnviPixelKey), envi_pixel_key_cmp);
+    nuniq = 0; nfill = 0;
+    for(j=0;j<npix;j++){
+        if(keys[j].key == ENVI_PIXEL_NONE){
+            rank[keys[j].j] = ENVI_PIXEL_NONE;
+            nfill++;
+            continue;
+        }
+        if(nuniq==0 || keys[j].key != pixkey[nuniq-1])
+            pixkey[nuniq++] = keys[j].key;
+        rank[keys[j].j] = nuniq-1;
+    }
+    free(keys);
+    /* the pixels without a source share the row after the distinct ones */
+    if(nfill > 0){
+        for(j=0;j<npix;j++)
+            if(rank[j] == ENVI_PIXEL_NONE) rank[j] = nuniq;
+    }
+    nstage = nuniq + (nfill > 0);
+
+    /* one spectrum per distinct pixel is staged, with the kernel writing
+     * into the staging buffer. */
+    envi_copy_kernel_init(&kernel, hdr, opt, NULL);
+    stage = (char*) malloc(nstage*B*kernel.dst_sz);
+    vstage = NULL;
+    if(opt != NULL && opt->valid != NULL)
+        vstage = (bool*) malloc(nstage*B*sizeof(bool));
+    if(stage==NULL || (opt != NULL && opt->valid != NULL && vstage==NULL)){
+        free(stage); free(vstage); free(pixkey); free(rank);
+        envi_file_close(&file);
+        return -5;
+    }
+    if(opt != NULL){
+        opt_stage = *opt;
+        opt_stage.valid = vstage;
+        if(vstage != NULL){
+            memset(vstage, 1, nuniq*B*sizeof(bool));
+            memset(vstage + nuniq*B, 0, (nstage-nuniq)*B*sizeof(bool));
+        }
+    }
+    envi_copy_kernel_init(&kernel, hdr, (opt != NULL) ? &opt_stage : NULL,
+        stage);
+    if(nfill > 0){
+        for(j=0;j<B;j++)
+            envi_copy_kernel_fill(&kernel, 
+                stage + (nuniq*B + j)*kernel.dst_sz, fillval);
+    }
+
+    /* the segments are read through the block cache if it is enabled */
+    pcache = NULL;
+#if defined(ENVI_HAS_PTHREAD)
+    if(envi_cache_enabled() && envi_cache_file_init(&cache, file.fd)==0)
+        pcache = &cache;
+#endif
+
+    /* the plans are built and read a chunk of pixels at a time so that 
+     * their pieces stay within ENVI_PIXEL_PLAN_PIECES. */
+    npieces_pix = (hdr.interleave == BIP) ? N_band_skipread : B;
+    chunk = ENVI_PIXEL_PLAN_PIECES / npieces_pix;
+    if(chunk < 1) chunk = 1;
+    errflg = 0;
+    for(k0=0;k0<nuniq && errflg==0;k0=k1){
+        k1 = (nuniq - k0 > chunk) ? k0 + chunk : nuniq;
+        envi_ioplan_init(&plan, &kernel, 
+            (opt != NULL) ? opt->coalesce_gap : ENVI_COALESCE_GAP_DEFAULT,
+            ENVI_READBUF_SIZE, 0);
+        plan.cache = pcache;
+        errflg = envi_pixel_ioplan_build(&plan, hdr, pixkey, k0, k1,
+                    band_skipszlist, band_readszlist, N_band_skipread, B);
+        if(errflg == 0){
+            if(stats != NULL){
+                envi_ioplan_get_stats(&plan, &plan_stats);
+                stats->n_syscalls += plan_stats.n_syscalls;
+                stats->n_copies += plan_stats.n_copies;
+                stats->nbytes_read += plan_stats.nbytes_read;
+                stats->nbytes_used += plan_stats.nbytes_used;
+            }
+            if(opt != NULL && envi_uring_use(opt->read_mode, &plan))
+                errflg = envi_ioplan_execute_uring(&plan, file.fd, stage,
+                            NULL, opt->queue_depth);
+            else
+                errflg = envi_ioplan_execute_fread(&plan, file.fid, stage);
+        }
+        envi_ioplan_free(&plan);
+    }
+
+    /* spc[j + npix*b] = stage[rank[j]*B + b] */
+    if(errflg == 0){
+        envi_transpose2d_map((char*) spc, NULL, npix, 1, stage, rank, B,
+            B, npix, kernel.dst_sz);
+        if(vstage != NULL)
+            envi_transpose2d_map((char*) opt->valid, NULL, npix, 1,
+                (const char*) vstage, rank, B, B, npix, sizeof(bool));
+    }
+    free(stage);
+    free(vstage);
+    free(pixkey);
+    free(rank);
+    envi_file_close(&file);
+    return errflg;
+}
+
+int lazyenvireadPixelsx_multBand(char *imgpath, EnviHeader hdr,
+        const size_t *smpls, const size_t *lines, size_t npix,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *spc, size_t sz, const EnviReadOption *opt,
+        EnviIOPlanStats *stats)
+{
+    (void) band_skip_last;
+    return envi_read_pixels(imgpath, hdr, smpls, lines, npix,
+        band_skipszlist, band_readszlist, N_band_skipread, 0,
+        spc, sz, opt, stats);
+}
+
+int lazyenvireadGLTx_multBand(char *imgpath, EnviHeader hdr,
+        const size_t *smpls, const size_t *lines, size_t npix,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last, double fillval,
+        void *spc, size_t sz, const EnviReadOption *opt,
+        EnviIOPlanStats *stats)
+{
+    (void) band_skip_last;
+    return envi_read_pixels(imgpath, hdr, smpls, lines, npix,
+        band_skipszlist, band_readszlist, N_band_skipread, fillval,
+        spc, sz, opt, stats);
+}
+
+int lazyenvireadRectx_multBand_auto(char *imgpath, EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        void *subimg, size_t *dims_subimg, size_t sz,
+        const EnviReadOption *opt, EnviIOPlanStats *stats)
+{
+    EnviReadOption opt_default;
+
+    /* opt may be NULL: the default options are used */
+    if(opt == NULL){
+        envi_read_option_init(&opt_default);
+        opt = &opt_default;
+    }
+    if(stats != NULL && opt->read_mode != ENVI_READ_PREAD
+            && opt->read_mode != ENVI_READ_URING
+            && opt->read_mode != ENVI_READ_DIRECT){
+        lazyenvireadRectx_multBand_ioplan_stats(hdr, 
+            smpl_skipszlist, smpl_readszlist, N_smpl_skipread, 
+            smpl_skip_last, line_skipszlist, line_readszlist,
+            N_line_skipread, line_skip_last, band_skipszlist, 
+            band_readszlist, N_band_skipread, band_skip_last,
+            sz, opt, stats);
+    }
+    switch(opt->read_mode){
+        case ENVI_READ_MMAP:
+            return lazyenvireadRectx_multBand_mmap(imgpath, hdr, 
+                smpl_skipszlist, smpl_readszlist, N_smpl_skipread, 
+                smpl_skip_last, line_skipszlist, line_readszlist,
+                N_line_skipread, line_skip_last, band_skipszlist, 
+                band_readszlist, N_band_skipread, band_skip_last,
+                subimg, dims_subimg, sz, opt);
+        case ENVI_READ_PREAD:
+        case ENVI_READ_URING:
+        case ENVI_READ_DIRECT:
+            return lazyenvireadRectx_multBand_pthread(imgpath, hdr, 
+                smpl_skipszlist, smpl_readszlist, N_smpl_skipread, 
+                smpl_skip_last, line_skipszlist, line_readszlist,
+                N_line_skipread, line_skip_last, band_skipszlist, 
+                band_readszlist, N_band_skipread, band_skip_last,
+                subimg, dims_subimg, sz, opt, stats);
+        case ENVI_READ_FREAD:
+        default:
+            return lazyenvireadRectx_multBand(imgpath, hdr, 
+                smpl_skipszlist, smpl_readszlist, N_smpl_skipread, 
+                smpl_skip_last, line_skipszlist, line_readszlist,
+                N_line_skipread, line_skip_last, band_skipszlist, 
+                band_readszlist, N_band_skipread, band_skip_last,
+                subimg, dims_subimg, sz, opt);
+    }
+}
+
+int lazyenvireadGLTProjx_multBand(char *imgpath, EnviHeader hdr,
+        const double *glt_x, const double *glt_y, size_t lines_o,
+        size_t samples_o, bool neg_abs,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last, double fillval,
+        void *img_proj, size_t sz, const EnviReadOption *opt)
+{
+    EnviReadOption opt_g;
+    EnviCopyKernel kernel;
+    EnviGLTBox box;
+    char fill[16];
+    size_t *srcidx, *bidx, *g_readszlist, dims_g[3];
+    long int *g_skipszlist;
+    long int smpl_skip, smpl_skip_last, line_skip, line_skip_last;
+    size_t smpl_read, line_read;
+    size_t npix, B, plane, ng, g0, g1, N_g, b, r, q, j, num_threads;
+    char *buf;
+    int errflg;
+
+    (void) band_skip_last;
+    npix = lines_o * samples_o;
+    B = 0;
+    for(r=0;r<N_band_skipread;r++)
+        B += band_readszlist[r];
+    if(npix == 0 || B == 0)
+        return 0;
+    opt_g = *opt;
+    opt_g.valid = NULL;
+    opt_g.band_map = NULL;
+    envi_copy_kernel_init(&kernel, hdr, &opt_g, NULL);
+    envi_copy_kernel_fill(&kernel, fill, fillval);
+    num_threads = envi_get_num_threads(opt->num_threads, lines_o);
+
+    srcidx = (size_t*) malloc(npix*sizeof(size_t));
+    if(srcidx == NULL)
+        return -5;
+    envi_glt_bbox(&box, glt_x, glt_y, npix, (size_t) hdr.samples,
+        (size_t) hdr.lines, neg_abs);
+    if(box.nvalid == 0){
+        /* nothing to read: every pixel is filled */
+        for(j=0;j<npix;j++)
+            srcidx[j] = ENVI_GLT_NONE;
+        errflg = envi_glt_project((char*) img_proj, lines_o, samples_o,
+                    fill, 0, srcidx, B, kernel.dst_sz, fill, num_threads);
+        free(srcidx);
+        return errflg;
+    }
+    envi_glt_index(srcidx, glt_x, glt_y, npix, (size_t) hdr.samples,
+        (size_t) hdr.lines, neg_abs, &box);
+
+    /* only the bounding box of the source pixels is read, a group of 
+     * bands at a time. */
+    smpl_skip = (long int) box.smpl0;
+    smpl_read = box.smpl1 - box.smpl0 + 1;
+    smpl_skip_last = (long int) hdr.samples - (long int) box.smpl1 - 1;
+    line_skip = (long int) box.line0;
+    line_read = box.line1 - box.line0 + 1;
+    line_skip_last = (long int) hdr.lines - (long int) box.line1 - 1;
+    plane = smpl_read * line_read * kernel.dst_sz;
+    ng = ENVI_GLT_STAGE_SIZE / plane;
+    if(ng < 1) ng = 1;
+    if(ng > B) ng = B;
+
+    bidx = (size_t*) malloc(B*sizeof(size_t));
+    g_skipszlist = (long int*) malloc(ng*sizeof(long int));
+    g_readszlist = (size_t*) malloc(ng*sizeof(size_t));
+    buf = (char*) malloc(ng*plane);
+    if(bidx==NULL || g_skipszlist==NULL || g_readszlist==NULL || buf==NULL){
+        free(bidx); free(g_skipszlist); free(g_readszlist); free(buf);
+        free(srcidx);
+        return -5;
+    }
+    b = 0; j = 0;
+    for(r=0;r<N_band_skipread;r++){
+        b += (size_t) band_skipszlist[r];
+        for(q=0;q<band_readszlist[r];q++)
+            bidx[j++] = b++;
+    }
+
+    errflg = 0;
+    for(g0=0;g0<B && errflg==0;g0=g1){
+        g1 = (B - g0 > ng) ? g0 + ng : B;
+        /* skip-read list of the bands bidx[g0..g1) */
+        N_g = 0; b = 0;
+        for(j=g0;j<g1;j++){
+            if(N_g > 0 && bidx[j] == b){
+                g_readszlist[N_g-1]++;
+            } else {
+                g_skipszlist[N_g] = (long int) (bidx[j] - b);
+                g_readszlist[N_g] = 1;
+                N_g++;
+            }
+            b = bidx[j] + 1;
+        }
+        dims_g[0] = line_read; dims_g[1] = smpl_read; dims_g[2] = g1 - g0;
+        errflg = lazyenvireadRectx_multBand_auto(imgpath, hdr,
+                    &smpl_skip, &smpl_read, 1, smpl_skip_last,
+                    &line_skip, &line_read, 1, line_skip_last,
+                    g_skipszlist, g_readszlist, N_g, 
+                    (long int) hdr.bands - (long int) b,
+                    buf, dims_g, sz, &opt_g, NULL);
+        if(errflg == 0)
+            errflg = envi_glt_project(
+                        (char*) img_proj + g0*npix*kernel.dst_sz,
+                        lines_o, samples_o, buf, smpl_read*line_read,
+                        srcidx, g1 - g0, kernel.dst_sz, fill, num_threads);
+    }
+    free(bidx);
+    free(g_skipszlist);
+    free(g_readszlist);
+    free(buf);
+    free(srcidx);
+    return errflg;
+}
+
+int lazyenvireadRectx_multBand_ioplan_stats(EnviHeader hdr, 
+        long int* smpl_skipszlist, size_t* smpl_readszlist, 
+        size_t N_smpl_skipread, long int smpl_skip_last,
+        long int* line_skipszlist, size_t* line_readszlist,
+        size_t N_line_skipread, long int line_skip_last,
+        long int* band_skipszlist, size_t* band_readszlist,
+        size_t N_band_skipread, long int band_skip_last,
+        size_t sz, const EnviReadOption *opt, EnviIOPlanStats *stats)
+{
+    int errflg;
+    EnviSkipReadDim dim1, dim2, dim3;
+    EnviCopyKernel kernel;
+    EnviIOPlan plan;
+    
+    (void) sz;
+    envi_assign_skipread_dims(hdr,
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread, smpl_skip_last,
+        line_skipszlist, line_readszlist, N_line_skipread, line_skip_last,
+        band_skipszlist, band_readszlist, N_band_skipread, band_skip_last,
+        &dim1, &dim2, &dim3);
+    envi_copy_kernel_init(&kernel, hdr, opt, NULL);
+    envi_ioplan_init(&plan, &kernel,
+        (opt != NULL) ? opt->coalesce_gap : ENVI_COALESCE_GAP_DEFAULT,
+        ENVI_READBUF_SIZE, 0);
+    errflg = envi_ioplan_build(&plan, &dim1, &dim2, &dim3,
+                (size_t) hdr.header_offset);
+    if(errflg == 0)
+        envi_ioplan_get_stats(&plan, stats);
+    envi_ioplan_free(&plan);
+    return errflg;
+}
+
+int image_byteswapFloat(float *img, size_t *dims_img, int32_t byte_order)
+{
+    /* Swap bytes if necessary */
+    if(envi_is_byteswap_necessary(byte_order)){
+        envi_memcpy_swap(img, img, dims_img[0]*dims_img[1]*dims_img[2],
+            sizeof(float));
+    }
+
+    return 0;
+}
+
+int image_byteswapInt16(int16_t *img, size_t *dims_img, int32_t byte_order)
+{
+    /* Swap bytes if necessary */
+    if(envi_is_byteswap_necessary(byte_order)){
+        envi_memcpy_swap(img, img, dims_img[0]*dims_img[1]*dims_img[2],
+            sizeof(int16_t));
+    }
+    return 0;
+}
+
+int image_byteswapUint16(uint16_t *img, size_t *dims_img, int32_t byte_order)
+{
+    /* Swap bytes if necessary */
+    if(envi_is_byteswap_necessary(byte_order)){
+        envi_memcpy_swap(img, img, dims_img[0]*dims_img[1]*dims_img[2],
+            sizeof(uint16_t));
+    }
+
+    return 0;
+}
@@ -0,0 +1,538 @@
+/* envi_ioplan.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#if defined(ENVI_HAS_PTHREAD)
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+void envi_ioplan_init(EnviIOPlan *plan, const EnviCopyKernel *kernel,
+        size_t gap_threshold, size_t max_segment, size_t block_nbytes)
+{
+    size_t sz = kernel->src_sz;
+
+    plan->segments = NULL;
+    plan->nsegments = 0;
+    plan->capsegments = 0;
+    plan->pieces = NULL;
+    plan->npieces = 0;
+    plan->cappieces = 0;
+    plan->sz = sz;
+    plan->gap_threshold = gap_threshold;
+    plan->kernel = *kernel;
+    plan->block_nbytes = block_nbytes;
+    plan->cache = NULL;
+    plan->max_segment = (max_segment / sz) * sz;
+    if(plan->max_segment < sz)
+        plan->max_segment = sz;
+    plan->max_span = plan->max_segment;
+}
+
+void envi_ioplan_enable_spans(EnviIOPlan *plan, const EnviLayout *layout)
+{
+    size_t max_span;
+
+    if(!layout->identity || !envi_copy_kernel_is_plain(&plan->kernel))
+        return;
+    max_span = (ENVI_READ_SPAN_MAX / plan->sz) * plan->sz;
+    if(max_span > plan->max_segment)
+        plan->max_span = max_span;
+    plan->block_nbytes = 0;
+}
+
+void envi_ioplan_free(EnviIOPlan *plan)
+{
+    free(plan->segments);
+    free(plan->pieces);
+    plan->segments = NULL;
+    plan->pieces = NULL;
+    plan->nsegments = plan->capsegments = 0;
+    plan->npieces = plan->cappieces = 0;
+}
+
+/* function : envi_ioplan_push_segment
+ *  Start a new segment at file_offset. */
+static EnviIOSegment *envi_ioplan_push_segment(EnviIOPlan *plan,
+        size_t file_offset)
+{
+    EnviIOSegment *seg;
+    size_t cap;
+
+    if(plan->nsegments == plan->capsegments){
+        cap = (plan->capsegments==0) ? 64 : 2*plan->capsegments;
+        seg = (EnviIOSegment*) realloc(plan->segments,
+                cap*sizeof(EnviIOSegment));
+        if(seg==NULL)
+            return NULL;
+        plan->segments = seg;
+        plan->capsegments = cap;
+    }
+    seg = &plan->segments[plan->nsegments++];
+    seg->file_offset = file_offset;
+    seg->nbytes = 0;
+    seg->piece_start = plan->npieces;
+    seg->npieces = 0;
+    return seg;
+}
+
+/* function : envi_ioplan_dst_nbytes
+ *  Number of bytes written to subimg for nbytes bytes read from the file.
+ */
+static size_t envi_ioplan_dst_nbytes(const EnviIOPlan *plan, size_t nbytes)
+{
+    return nbytes / plan->sz * plan->kernel.dst_sz;
+}
+
+/* function : envi_ioplan_push_piece
+ *  Append a piece to the last segment, or extend its last piece if the
+ *  new one is contiguous with it both in the file and in subimg and does
+ *  not start a staging block. */
+static int envi_ioplan_push_piece(EnviIOPlan *plan, EnviIOSegment *seg,
+        size_t src_offset, size_t dst_offset, size_t nbytes)
+{
+    EnviIOPiece *pc;
+    size_t cap;
+
+    if(seg->npieces > 0){
+        pc = &plan->pieces[plan->npieces-1];
+        if(pc->src_offset + pc->nbytes == src_offset
+                && pc->dst_offset + envi_ioplan_dst_nbytes(plan, pc->nbytes)
+                    == dst_offset
+                && (plan->block_nbytes == 0
+                    || dst_offset % plan->block_nbytes != 0)){
+            pc->nbytes += nbytes;
+            return 0;
+        }
+    }
+    if(plan->npieces == plan->cappieces){
+        cap = (plan->cappieces==0) ? 256 : 2*plan->cappieces;
+        pc = (EnviIOPiece*) realloc(plan->pieces, cap*sizeof(EnviIOPiece));
+        if(pc==NULL)
+            return -5;
+        plan->pieces = pc;
+        plan->cappieces = cap;
+    }
+    pc = &plan->pieces[plan->npieces++];
+    pc->src_offset = src_offset;
+    pc->dst_offset = dst_offset;
+    pc->nbytes = nbytes;
+    seg->npieces++;
+    return 0;
+}
+
+/* function : envi_ioplan_is_span
+ *  Evaluate if the run at file_offset going to dst_offset continues the
+ *  segment seg as a span: seg is a single piece that the run extends both
+ *  in the file and in subimg. */
+static bool envi_ioplan_is_span(const EnviIOPlan *plan,
+        const EnviIOSegment *seg, size_t file_offset, size_t dst_offset)
+{
+    const EnviIOPiece *pc;
+
+    if(plan->max_span <= plan->max_segment || seg->npieces != 1
+            || seg->file_offset + seg->nbytes != file_offset)
+        return false;
+    pc = &plan->pieces[seg->piece_start];
+    return pc->src_offset == 0 && pc->nbytes == seg->nbytes
+        && pc->dst_offset + envi_ioplan_dst_nbytes(plan, pc->nbytes)
+            == dst_offset;
+}
+
+int envi_ioplan_add_run(EnviIOPlan *plan, size_t file_offset,
+        size_t nbytes, size_t dst_offset)
+{
+    EnviIOSegment *seg;
+    size_t seg_end, seg_limit, ntake;
+
+    while(nbytes > 0){
+        seg = NULL;
+        ntake = 0;
+        if(plan->nsegments > 0){
+            seg = &plan->segments[plan->nsegments-1];
+            seg_end = seg->file_offset + seg->nbytes;
+            seg_limit = seg->file_offset
+                + (envi_ioplan_is_span(plan, seg, file_offset, dst_offset)
+                    ? plan->max_span : plan->max_segment);
+            if(file_offset >= seg_end
+                    && file_offset - seg_end <= plan->gap_threshold
+                    && file_offset < seg_limit){
+                ntake = seg_limit - file_offset;
+            }
+        }
+        if(ntake == 0){
+            seg = envi_ioplan_push_segment(plan, file_offset);
+            if(seg==NULL)
+                return -5;
+            ntake = plan->max_segment;
+        }
+        if(ntake > nbytes)
+            ntake = nbytes;
+        if(envi_ioplan_push_piece(plan, seg, file_offset - seg->file_offset,
+                dst_offset, ntake) != 0)
+            return -5;
+        seg->nbytes = file_offset + ntake - seg->file_offset;
+        file_offset += ntake;
+        dst_offset += envi_ioplan_dst_nbytes(plan, ntake);
+        nbytes -= ntake;
+    }
+    return 0;
+}
+
+int envi_ioplan_build(EnviIOPlan *plan, const EnviSkipReadDim *dim1,
+        const EnviSkipReadDim *dim2, const EnviSkipReadDim *dim3,
+        size_t header_offset)
+{
+    size_t i,ii,j,jj,k;
+    size_t sz, szrow, szplane, nbytes;
+    size_t plane_offset, row_offset, offset, dst_offset;
+
+    sz = plan->sz;
+    szrow = (size_t) dim1->d * sz;
+    szplane = szrow * (size_t) dim2->d;
+    plane_offset = header_offset;
+    dst_offset = 0;
+    for(i=0;i<dim3->N_skipread;i++){
+        plane_offset += (size_t) dim3->skipszlist[i] * szplane;
+        for(ii=0;ii<dim3->readszlist[i];ii++){
+            row_offset = plane_offset;
+            for(j=0;j<dim2->N_skipread;j++){
+                row_offset += (size_t) dim2->skipszlist[j] * szrow;
+                for(jj=0;jj<dim2->readszlist[j];jj++){
+                    offset = row_offset;
+                    for(k=0;k<dim1->N_skipread;k++){
+                        offset += (size_t) dim1->skipszlist[k] * sz;
+                        nbytes = dim1->readszlist[k] * sz;
+                        if(envi_ioplan_add_run(plan, offset, nbytes,
+                                dst_offset) != 0)
+                            return -5;
+                        offset += nbytes;
+                        dst_offset += dim1->readszlist[k]
+                                        * plan->kernel.dst_sz;
+                    }
+                    row_offset += szrow;
+                }
+            }
+            plane_offset += szplane;
+        }
+    }
+    return 0;
+}
+
+void envi_ioplan_get_stats(const EnviIOPlan *plan, EnviIOPlanStats *stats)
+{
+    size_t i;
+
+    stats->n_syscalls = plan->nsegments;
+    stats->n_copies = 0;
+    stats->nbytes_read = 0;
+    stats->nbytes_used = 0;
+    for(i=0;i<plan->nsegments;i++){
+        stats->nbytes_read += plan->segments[i].nbytes;
+        /* single-piece segments are read directly into subimg unless the
+         * data type is converted. */
+        if(plan->segments[i].npieces > 1
+                || !envi_copy_kernel_is_plain(&plan->kernel))
+            stats->n_copies += plan->segments[i].npieces;
+    }
+    for(i=0;i<plan->npieces;i++)
+        stats->nbytes_used += plan->pieces[i].nbytes;
+}
+
+size_t envi_get_num_threads(size_t num_threads, size_t n_jobs)
+{
+#if defined(ENVI_HAS_PTHREAD)
+    long nproc;
+
+    if(num_threads == 0){
+        nproc = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (nproc > 0) ? (size_t) nproc : 1;
+        if(num_threads > ENVI_NUM_THREADS_MAX)
+            num_threads = ENVI_NUM_THREADS_MAX;
+    }
+#else
+    num_threads = 1;
+#endif
+    if(num_threads > n_jobs) num_threads = n_jobs;
+    if(num_threads < 1) num_threads = 1;
+    return num_threads;
+}
+
+int envi_ioplan_execute_fread(const EnviIOPlan *plan, FILE *fid,
+        char *subimg)
+{
+    const EnviIOSegment *seg;
+    const EnviIOPiece *pc;
+    size_t i,k;
+    char *buf;
+    int errflg;
+    EnviCopyFn copy_fn;
+
+    if(plan->nsegments == 0)
+        return 0;
+    copy_fn = envi_copy_kernel_fn(&plan->kernel);
+    buf = (char*) malloc(plan->max_segment);
+    if(buf==NULL)
+        return -5;
+    errflg = 0;
+    for(i=0;i<plan->nsegments;i++){
+        seg = &plan->segments[i];
+        if(plan->cache != NULL){
+            errflg = envi_cache_pread(plan->cache, buf, seg->nbytes,
+                        (uint64_t) seg->file_offset);
+            if(errflg != 0)
+                break;
+        } else if(fseek(fid, (long int) seg->file_offset, SEEK_SET) != 0
+                || fread(buf, 1, seg->nbytes, fid) != seg->nbytes){
+            errflg = -4;
+            break;
+        }
+        pc = plan->pieces + seg->piece_start;
+        for(k=0;k<seg->npieces;k++){
+            copy_fn(&plan->kernel, subimg + pc[k].dst_offset,
+                buf + pc[k].src_offset, pc[k].nbytes / plan->sz);
+        }
+    }
+    free(buf);
+    return errflg;
+}
+
+#if defined(ENVI_HAS_PTHREAD)
+/* function : envi_pread_full
+ *  pread n bytes at the offset of the file, retrying on short reads and
+ *  interrupts. Returns 0 on success and -1 on failure. */
+static int envi_pread_full(int fd, char *buf, size_t n, off_t offset)
+{
+    ssize_t nread;
+
+    while(n > 0){
+        nread = pread(fd, buf, n, offset);
+        if(nread < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        } else if(nread == 0){
+            return -1;
+        }
+        buf += nread; offset += nread; n -= (size_t) nread;
+    }
+    return 0;
+}
+
+/* function : envi_ioplan_pread
+ *  Read n bytes at the offset of the file of the plan, through its block
+ *  cache if it has one. Returns 0 on success, -4 if reading failed, and
+ *  -5 if memory allocation failed. */
+static int envi_ioplan_pread(const EnviIOPlan *plan, int fd, char *buf,
+        size_t n, size_t offset)
+{
+    if(plan->cache != NULL)
+        return envi_cache_pread(plan->cache, buf, n, (uint64_t) offset);
+    return (envi_pread_full(fd, buf, n, (off_t) offset) != 0) ? -4 : 0;
+}
+
+/* EnviIOPlanTask
+ *  A contiguous share of the staging blocks of a layout assigned to one 
+ *  thread: the pieces [piece_start,piece_end) of the plan, which belong to
+ *  the segments from seg_start on. */
+typedef struct EnviIOPlanTask {
+    const EnviIOPlan *plan;
+    const EnviLayout *layout;
+    int fd;
+    char *subimg;
+    size_t piece_start;
+    size_t piece_end;
+    size_t seg_start;
+    int errflg;
+} EnviIOPlanTask ;
+
+/* function : envi_ioplan_stage_dst
+ *  Pointer in the stage for the byte dst_offset of subimg (packed in file
+ *  order). */
+static char *envi_ioplan_stage_dst(EnviStage *stage, size_t dst_offset)
+{
+    return envi_stage_row(stage, dst_offset / stage->row_nbytes)
+            + dst_offset % stage->row_nbytes;
+}
+
+static void *envi_ioplan_task(void *arg)
+{
+    EnviIOPlanTask *task = (EnviIOPlanTask*) arg;
+    const EnviIOPlan *plan = task->plan;
+    const EnviIOSegment *seg;
+    const EnviIOPiece *pc;
+    size_t i,k,k_start,k_end,src_start,nbytes;
+    char *buf, *dst;
+    EnviStage stage;
+    EnviCopyFn copy_fn;
+
+    buf = NULL;
+    task->errflg = 0;
+    if(task->piece_end <= task->piece_start)
+        return NULL;
+    if(envi_stage_init(&stage, task->layout, &plan->kernel, task->subimg)
+            != 0){
+        task->errflg = -5;
+        return NULL;
+    }
+    copy_fn = envi_copy_kernel_fn(&stage.kernel);
+    for(i=task->seg_start;i<plan->nsegments;i++){
+        seg = &plan->segments[i];
+        if(seg->piece_start >= task->piece_end)
+            break;
+        /* the pieces of the segment in the share of this task */
+        k_start = (seg->piece_start > task->piece_start) ? seg->piece_start
+                                                        : task->piece_start;
+        k_end = seg->piece_start + seg->npieces;
+        if(k_end > task->piece_end) k_end = task->piece_end;
+        pc = plan->pieces;
+        if(seg->npieces == 1 && envi_copy_kernel_is_plain(&plan->kernel)){
+            dst = envi_ioplan_stage_dst(&stage, pc[k_start].dst_offset);
+            task->errflg = envi_ioplan_pread(plan, task->fd, dst,
+                            seg->nbytes, seg->file_offset);
+            if(task->errflg != 0)
+                break;
+            /* the segment was just read, so swap it (and replace the data
+             * ignore value) in place. */
+            envi_copy_kernel_apply(&stage.kernel, dst, dst,
+                seg->nbytes / plan->sz);
+            continue;
+        }
+        if(buf==NULL){
+            buf = (char*) malloc(plan->max_segment);
+            if(buf==NULL){
+                task->errflg = -5;
+                break;
+            }
+        }
+        /* only the span of the pieces of this task is read */
+        src_start = pc[k_start].src_offset;
+        nbytes = pc[k_end-1].src_offset + pc[k_end-1].nbytes - src_start;
+        task->errflg = envi_ioplan_pread(plan, task->fd, buf, nbytes,
+                        seg->file_offset + src_start);
+        if(task->errflg != 0)
+            break;
+        for(k=k_start;k<k_end;k++){
+            copy_fn(&stage.kernel,
+                envi_ioplan_stage_dst(&stage, pc[k].dst_offset),
+                buf + pc[k].src_offset - src_start,
+                pc[k].nbytes / plan->sz);
+        }
+    }
+    if(task->errflg == 0)
+        envi_stage_flush(&stage);
+    envi_stage_free(&stage);
+    free(buf);
+    return NULL;
+}
+
+/* function : envi_ioplan_lower_piece
+ *  Index of the first piece whose dst_offset is at least dst_offset. The
+ *  dst_offset of the pieces increase with their index. */
+static size_t envi_ioplan_lower_piece(const EnviIOPlan *plan,
+        size_t dst_offset)
+{
+    size_t lo, hi, mid;
+
+    lo = 0; hi = plan->npieces;
+    while(lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if(plan->pieces[mid].dst_offset < dst_offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* function : envi_ioplan_piece_segment
+ *  Index of the segment holding the piece k. */
+static size_t envi_ioplan_piece_segment(const EnviIOPlan *plan, size_t k)
+{
+    size_t lo, hi, mid;
+
+    lo = 0; hi = plan->nsegments;
+    while(lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if(plan->segments[mid].piece_start + plan->segments[mid].npieces <= k)
+            lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int envi_ioplan_execute(const EnviIOPlan *plan, int fd, char *subimg,
+        const EnviLayout *layout, size_t num_threads)
+{
+    size_t t, nblocks, block_nbytes;
+    int errflg;
+    EnviIOPlanTask *tasks;
+    pthread_t *threads;
+    bool *launched;
+
+    if(plan->nsegments == 0)
+        return 0;
+    block_nbytes = layout->block_rows * layout->n[0] * plan->kernel.dst_sz;
+    nblocks = (layout->nrows + layout->block_rows - 1) / layout->block_rows;
+    num_threads = envi_get_num_threads(num_threads, nblocks);
+    tasks = (EnviIOPlanTask*) malloc(num_threads*sizeof(EnviIOPlanTask));
+    threads = (pthread_t*) malloc(num_threads*sizeof(pthread_t));
+    launched = (bool*) malloc(num_threads*sizeof(bool));
+    if(tasks==NULL || threads==NULL || launched==NULL){
+        free(tasks); free(threads); free(launched);
+        return -5;
+    }
+
+    /* split the staging blocks into shares of about the same number of 
+     * blocks */
+    for(t=0;t<num_threads;t++){
+        tasks[t].plan = plan;
+        tasks[t].layout = layout;
+        tasks[t].fd = fd;
+        tasks[t].subimg = subimg;
+        tasks[t].piece_start = envi_ioplan_lower_piece(plan,
+                                nblocks * t / num_threads * block_nbytes);
+        tasks[t].piece_end = (t == num_threads-1) ? plan->npieces
+            : envi_ioplan_lower_piece(plan,
+                nblocks * (t+1) / num_threads * block_nbytes);
+        tasks[t].seg_start = envi_ioplan_piece_segment(plan,
+                                tasks[t].piece_start);
+        tasks[t].errflg = 0;
+    }
+
+    /* The first task runs on the calling thread. Tasks whose thread could
+     * not be created are also run on the calling thread. */
+    launched[0] = false;
+    for(t=1;t<num_threads;t++)
+        launched[t] = (pthread_create(&threads[t], NULL, envi_ioplan_task,
+                        &tasks[t]) == 0);
+    for(t=0;t<num_threads;t++){
+        if(!launched[t])
+            envi_ioplan_task(&tasks[t]);
+    }
+    errflg = 0;
+    for(t=0;t<num_threads;t++){
+        if(launched[t])
+            pthread_join(threads[t], NULL);
+        if(tasks[t].errflg != 0)
+            errflg = tasks[t].errflg;
+    }
+
+    free(launched);
+    free(threads);
+    free(tasks);
+    return errflg;
+}
+#else
+int envi_ioplan_execute(const EnviIOPlan *plan, int fd, char *subimg,
+        const EnviLayout *layout, size_t num_threads)
+{
+    return -4;
+}
+#endif
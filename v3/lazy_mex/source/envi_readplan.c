@@ -0,0 +1,245 @@
+/* envi_readplan.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#include "envi_cache.h"
+#include "envi_filepool.h"
+#include "envi_readplan.h"
+#include "envi_uring.h"
+#include "envi_direct.h"
+
+/* function : envi_readplan_copy_dim
+ *  Copy the skip-read list of N runs into dim for a dimension of size d.
+ *  Returns 0 on success, -2 if the runs go beyond d, and -5 if memory
+ *  allocation failed. */
+static int envi_readplan_copy_dim(EnviSkipReadDim *dim, long int d,
+        const long int *skipszlist, const size_t *readszlist, size_t N,
+        size_t *nread)
+{
+    size_t i;
+    long int skips;
+
+    dim->d = d;
+    dim->N_skipread = N;
+    dim->skipszlist = (long int*) malloc((N > 0 ? N : 1)*sizeof(long int));
+    dim->readszlist = (size_t*) malloc((N > 0 ? N : 1)*sizeof(size_t));
+    if(dim->skipszlist == NULL || dim->readszlist == NULL)
+        return -5;
+    *nread = 0; skips = 0;
+    for(i=0;i<N;i++){
+        if(skipszlist[i] < 0)
+            return -2;
+        dim->skipszlist[i] = skipszlist[i];
+        dim->readszlist[i] = readszlist[i];
+        skips += skipszlist[i];
+        *nread += readszlist[i];
+    }
+    dim->skip_last = d - skips - (long int) *nread;
+    return (dim->skip_last < 0) ? -2 : 0;
+}
+
+int envi_readplan_create(EnviReadPlan *rp, EnviHeader hdr,
+        const long int *smpl_skipszlist, const size_t *smpl_readszlist,
+        size_t N_smpl_skipread,
+        const long int *line_skipszlist, const size_t *line_readszlist,
+        size_t N_line_skipread,
+        const long int *band_skipszlist, const size_t *band_readszlist,
+        size_t N_band_skipread,
+        const size_t *band_index, size_t N_band_index,
+        const EnviReadOption *opt)
+{
+    EnviSkipReadDim dim1, dim2, dim3;
+    int errflg;
+
+    memset(rp, 0, sizeof(EnviReadPlan));
+    rp->hdr = hdr;
+    rp->opt = *opt;
+    rp->opt.valid = NULL;
+    rp->opt.band_map = NULL;
+    rp->sz = envi_get_data_type_size(hdr.data_type);
+    if(rp->sz == 0)
+        return -2;
+    rp->nbytes_file = (size_t) hdr.samples * (size_t) hdr.lines
+                    * (size_t) hdr.bands * rp->sz + (size_t) hdr.header_offset;
+    errflg = envi_readplan_copy_dim(&rp->smpl, hdr.samples, smpl_skipszlist,
+                smpl_readszlist, N_smpl_skipread, &rp->dims_read[1]);
+    if(errflg == 0)
+        errflg = envi_readplan_copy_dim(&rp->line, hdr.lines,
+                    line_skipszlist, line_readszlist, N_line_skipread,
+                    &rp->dims_read[0]);
+    if(errflg == 0)
+        errflg = envi_readplan_copy_dim(&rp->band, hdr.bands,
+                    band_skipszlist, band_readszlist, N_band_skipread,
+                    &rp->dims_read[2]);
+    if(errflg != 0){
+        envi_readplan_free(rp);
+        return errflg;
+    }
+    rp->dims[0] = rp->dims_read[0];
+    rp->dims[1] = rp->dims_read[1];
+    rp->dims[2] = rp->dims_read[2];
+
+    /* the selected bands are read once each and expanded to band_index
+     * after the read */
+    if(band_index != NULL){
+        rp->band_index = (size_t*) malloc((N_band_index > 0 ? N_band_index : 1)
+                            * sizeof(size_t));
+        rp->band_map = (size_t*) malloc((rp->dims_read[2]+1)*sizeof(size_t));
+        if(rp->band_index == NULL || rp->band_map == NULL){
+            envi_readplan_free(rp);
+            return -5;
+        }
+        memcpy(rp->band_index, band_index, N_band_index*sizeof(size_t));
+        rp->N_band_index = N_band_index;
+        if(envi_band_map_init(rp->band_map, rp->band_index, N_band_index,
+                rp->dims_read[2]) != 0){
+            envi_readplan_free(rp);
+            return -2;
+        }
+        rp->opt.band_map = rp->band_map;
+        rp->dims[2] = N_band_index;
+    }
+
+    envi_copy_kernel_init(&rp->kernel, hdr, &rp->opt, NULL);
+    envi_assign_skipread_dims(hdr,
+        rp->smpl.skipszlist, rp->smpl.readszlist, rp->smpl.N_skipread,
+        rp->smpl.skip_last,
+        rp->line.skipszlist, rp->line.readszlist, rp->line.N_skipread,
+        rp->line.skip_last,
+        rp->band.skipszlist, rp->band.readszlist, rp->band.N_skipread,
+        rp->band.skip_last,
+        &dim1, &dim2, &dim3);
+    envi_layout_init_skipread(&rp->layout, hdr, &dim1, &dim2, &dim3,
+        rp->band_map, rp->kernel.dst_sz);
+
+    /* The I/O plan is only kept for the pread, io_uring and direct modes,
+     * which execute it as it is; the other modes walk the skip-read
+     * lists. */
+#if defined(ENVI_HAS_PTHREAD)
+    if(rp->opt.read_mode == ENVI_READ_PREAD
+            || rp->opt.read_mode == ENVI_READ_URING
+            || rp->opt.read_mode == ENVI_READ_DIRECT){
+        envi_ioplan_init(&rp->ioplan, &rp->kernel, rp->opt.coalesce_gap,
+            ENVI_READBUF_SIZE,
+            rp->layout.block_rows * rp->layout.n[0] * rp->kernel.dst_sz);
+        if(rp->opt.read_mode != ENVI_READ_DIRECT)
+            envi_ioplan_enable_spans(&rp->ioplan, &rp->layout);
+        errflg = envi_ioplan_build(&rp->ioplan, &dim1, &dim2, &dim3,
+                    (size_t) hdr.header_offset);
+        if(errflg != 0){
+            envi_readplan_free(rp);
+            return errflg;
+        }
+        envi_ioplan_get_stats(&rp->ioplan, &rp->stats);
+        rp->has_ioplan = true;
+    }
+#endif
+    return 0;
+}
+
+#if defined(ENVI_HAS_PTHREAD)
+/* function : envi_readplan_pread
+ *  Execute the I/O plan of rp on the file imgpath. The plan is shared
+ *  read-only by the calls; only its kernel (the destination) and its
+ *  cache (the file) are set on a copy of the plan header. */
+static int envi_readplan_pread(const EnviReadPlan *rp, const char *imgpath,
+        void *subimg, bool *valid)
+{
+    EnviFile file;
+    EnviIOPlan plan;
+    EnviReadOption opt;
+    EnviCacheFile cache;
+    int errflg;
+
+    if(envi_file_open(&file, imgpath, false) != 0)
+        return -1;
+    if(file.size < rp->nbytes_file){
+        envi_file_close(&file);
+        return -2;
+    }
+    opt = rp->opt;
+    opt.valid = valid;
+    plan = rp->ioplan;
+    envi_copy_kernel_init(&plan.kernel, rp->hdr, &opt, subimg);
+    plan.cache = NULL;
+    if(opt.read_mode != ENVI_READ_DIRECT && envi_cache_enabled()
+            && envi_cache_file_init(&cache, file.fd) == 0)
+        plan.cache = &cache;
+    if(opt.read_mode == ENVI_READ_DIRECT)
+        errflg = envi_ioplan_execute_direct(&plan, imgpath, file.fd,
+                    (char*) subimg, &rp->layout);
+    else if(envi_uring_use(opt.read_mode, &plan))
+        errflg = envi_ioplan_execute_uring(&plan, file.fd, (char*) subimg,
+                    &rp->layout, opt.queue_depth);
+    else
+        errflg = envi_ioplan_execute(&plan, file.fd, (char*) subimg,
+                    &rp->layout, opt.num_threads);
+    envi_file_close(&file);
+    return errflg;
+}
+#endif
+
+int envi_readplan_execute(const EnviReadPlan *rp, const char *imgpath,
+        void *subimg, bool *valid, EnviIOPlanStats *stats)
+{
+    EnviReadOption opt;
+    size_t dims_read[3];
+    int errflg;
+
+    if(rp->dims[0]*rp->dims[1]*rp->dims[2] == 0){
+        if(stats != NULL)
+            memset(stats, 0, sizeof(EnviIOPlanStats));
+        return 0;
+    }
+#if defined(ENVI_HAS_PTHREAD)
+    if(rp->has_ioplan){
+        if(stats != NULL)
+            *stats = rp->stats;
+        errflg = envi_readplan_pread(rp, imgpath, subimg, valid);
+    } else
+#endif
+    {
+        opt = rp->opt;
+        opt.valid = valid;
+        dims_read[0] = rp->dims_read[0];
+        dims_read[1] = rp->dims_read[1];
+        dims_read[2] = rp->dims_read[2];
+        errflg = lazyenvireadRectx_multBand_auto((char*) imgpath, rp->hdr,
+            rp->smpl.skipszlist, rp->smpl.readszlist, rp->smpl.N_skipread,
+            rp->smpl.skip_last,
+            rp->line.skipszlist, rp->line.readszlist, rp->line.N_skipread,
+            rp->line.skip_last,
+            rp->band.skipszlist, rp->band.readszlist, rp->band.N_skipread,
+            rp->band.skip_last,
+            subimg, dims_read, rp->sz, &opt, stats);
+    }
+    if(errflg == 0 && rp->band_index != NULL){
+        envi_band_map_expand((char*) subimg,
+            rp->dims[0]*rp->dims[1]*rp->kernel.dst_sz, rp->band_index,
+            rp->band_map, rp->N_band_index);
+        if(valid != NULL)
+            envi_band_map_expand((char*) valid,
+                rp->dims[0]*rp->dims[1]*sizeof(bool), rp->band_index,
+                rp->band_map, rp->N_band_index);
+    }
+    return errflg;
+}
+
+void envi_readplan_free(EnviReadPlan *rp)
+{
+    free(rp->smpl.skipszlist); free(rp->smpl.readszlist);
+    free(rp->line.skipszlist); free(rp->line.readszlist);
+    free(rp->band.skipszlist); free(rp->band.readszlist);
+    free(rp->band_index);
+    free(rp->band_map);
+    envi_ioplan_free(&rp->ioplan);
+    memset(rp, 0, sizeof(EnviReadPlan));
+}
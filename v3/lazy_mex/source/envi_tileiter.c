@@ -0,0 +1,135 @@
+/* envi_tileiter.c */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_copy.h"
+#include "envi_tileiter.h"
+
+int envi_tileiter_init(EnviTileIter *it, EnviHeader hdr,
+        const size_t *tile, size_t max_nbytes, const EnviReadOption *opt)
+{
+    EnviCopyKernel kernel;
+    size_t k, d, fixed, budget;
+
+    memset(it, 0, sizeof(EnviTileIter));
+    it->hdr = hdr;
+    it->opt = *opt;
+    it->opt.valid = NULL;
+    it->opt.band_map = NULL;
+    if(envi_get_data_type_size(hdr.data_type) == 0)
+        return -2;
+    envi_copy_kernel_init(&kernel, hdr, &it->opt, NULL);
+    if(max_nbytes == 0)
+        max_nbytes = ENVI_TILE_BUDGET_DEFAULT;
+    it->dims[0] = (size_t) hdr.lines;
+    it->dims[1] = (size_t) hdr.samples;
+    it->dims[2] = (size_t) hdr.bands;
+
+    /* dimensions of the output (0: lines, 1: samples, 2: bands) from the
+     * fastest to the slowest varying in the file */
+    switch(hdr.interleave){
+        case BIP:
+            it->order[0] = 2; it->order[1] = 1; it->order[2] = 0;
+            break;
+        case BIL:
+            it->order[0] = 1; it->order[1] = 2; it->order[2] = 0;
+            break;
+        case BSQ:
+        default:
+            it->order[0] = 1; it->order[1] = 0; it->order[2] = 2;
+            break;
+    }
+
+    /* the sizes given are kept, and the others take as much of their
+     * extent as the budget leaves, fastest dimension first */
+    fixed = 1;
+    for(k=0;k<3;k++){
+        it->tile[k] = (tile != NULL) ? tile[k] : 0;
+        if(it->tile[k] > it->dims[k])
+            it->tile[k] = it->dims[k];
+        if(it->tile[k] > 0)
+            fixed *= it->tile[k];
+    }
+    budget = max_nbytes / kernel.dst_sz;
+    for(k=0;k<3;k++){
+        d = (size_t) it->order[k];
+        if(it->tile[d] > 0)
+            continue;
+        it->tile[d] = budget / fixed;
+        if(it->tile[d] > it->dims[d]) it->tile[d] = it->dims[d];
+        if(it->tile[d] < 1) it->tile[d] = 1;
+        fixed *= it->tile[d];
+    }
+    it->nbytes_tile = it->tile[0]*it->tile[1]*it->tile[2]*kernel.dst_sz;
+    if(it->nbytes_tile > max_nbytes)
+        return -2;
+
+    it->ntiles_total = 1;
+    for(k=0;k<3;k++){
+        it->ntiles[k] = (it->tile[k] > 0)
+            ? (it->dims[k] + it->tile[k] - 1) / it->tile[k] : 0;
+        it->ntiles_total *= it->ntiles[k];
+    }
+    it->next = 0;
+    return 0;
+}
+
+bool envi_tileiter_next(EnviTileIter *it, EnviTile *tile)
+{
+    size_t k, d, q;
+
+    if(it->next >= it->ntiles_total)
+        return false;
+    tile->index = it->next;
+    q = it->next;
+    for(k=0;k<3;k++){
+        d = (size_t) it->order[k];
+        tile->start[d] = (q % it->ntiles[d]) * it->tile[d];
+        tile->count[d] = (it->dims[d] - tile->start[d] < it->tile[d])
+                        ? it->dims[d] - tile->start[d] : it->tile[d];
+        q /= it->ntiles[d];
+    }
+    it->next++;
+    return true;
+}
+
+void envi_tileiter_reset(EnviTileIter *it)
+{
+    it->next = 0;
+}
+
+int envi_tileiter_read(const EnviTileIter *it, const char *imgpath,
+        const EnviTile *tile, void *subimg, bool *valid,
+        EnviIOPlanStats *stats)
+{
+    EnviReadOption opt;
+    long int smpl_skip, line_skip, band_skip;
+    size_t smpl_read, line_read, band_read, dims[3];
+
+    /* a tile is a rectangle of one run along each dimension */
+    line_skip = (long int) tile->start[0];
+    smpl_skip = (long int) tile->start[1];
+    band_skip = (long int) tile->start[2];
+    line_read = tile->count[0];
+    smpl_read = tile->count[1];
+    band_read = tile->count[2];
+    dims[0] = line_read;
+    dims[1] = smpl_read;
+    dims[2] = band_read;
+    opt = it->opt;
+    opt.valid = valid;
+    return lazyenvireadRectx_multBand_auto((char*) imgpath, it->hdr,
+        &smpl_skip, &smpl_read, 1,
+        (long int) (it->dims[1] - tile->start[1] - smpl_read),
+        &line_skip, &line_read, 1,
+        (long int) (it->dims[0] - tile->start[0] - line_read),
+        &band_skip, &band_read, 1,
+        (long int) (it->dims[2] - tile->start[2] - band_read),
+        subimg, dims, envi_get_data_type_size(it->hdr.data_type), &opt,
+        stats);
+}
@@ -0,0 +1,556 @@
+/* envi_transpose.c */
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_copy.h"
+#include "envi_transpose.h"
+
+#if !defined(ENVI_HAS_PTHREAD) && (defined(__unix__) || defined(__APPLE__))
+#define ENVI_HAS_PTHREAD
+#endif
+#if defined(ENVI_HAS_PTHREAD)
+#include <pthread.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define ENVI_HAS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENVI_HAS_NEON
+#include <arm_neon.h>
+#endif
+
+/* ENVI_AMAP: position of the index a, amap[a] if the map is given. */
+#define ENVI_AMAP(amap,a) (((amap) != NULL) ? (amap)[a] : (a))
+
+/* function : envi_transpose_scalar
+ *  Transpose na x nb elements one by one (see envi_transpose2d_map). The
+ *  inner loop runs along b, the dimension written contiguously for the
+ *  layouts of the readers. */
+#define ENVI_TRANSPOSE_SCALAR_LOOP(T)                                   \
+    for(a=0;a<na;a++){                                                  \
+        da = ENVI_AMAP(amap,a)*dst_sa;                                  \
+        for(b=0;b<nb;b++){                                              \
+            T v;                                                        \
+            memcpy(&v, src+(a+ENVI_AMAP(bmap,b)*src_sb)*sizeof(T),       \
+                sizeof(T));                                             \
+            memcpy(dst+(da+b*dst_sb)*sizeof(T), &v, sizeof(T));         \
+        }                                                               \
+    }
+
+static void envi_transpose_scalar(char *dst, const size_t *amap, 
+        size_t dst_sa, size_t dst_sb, const char *src, const size_t *bmap,
+        size_t src_sb, size_t na, size_t nb, size_t sz)
+{
+    size_t a,b,da;
+
+    switch(sz){
+        case 1: ENVI_TRANSPOSE_SCALAR_LOOP(uint8_t)  break;
+        case 2: ENVI_TRANSPOSE_SCALAR_LOOP(uint16_t) break;
+        case 4: ENVI_TRANSPOSE_SCALAR_LOOP(uint32_t) break;
+        case 8: ENVI_TRANSPOSE_SCALAR_LOOP(uint64_t) break;
+        default:
+            for(a=0;a<na;a++){
+                da = ENVI_AMAP(amap,a)*dst_sa;
+                for(b=0;b<nb;b++)
+                    memcpy(dst+(da+b*dst_sb)*sz,
+                        src+(a+ENVI_AMAP(bmap,b)*src_sb)*sz, sz);
+            }
+            break;
+    }
+}
+
+/* function : envi_transpose_micro_width
+ *  Edge (elements) of the square blocks transposed in SIMD registers for
+ *  elements of sz bytes, or 0 if there is no such micro-kernel. */
+static size_t envi_transpose_micro_width(size_t sz)
+{
+#if defined(ENVI_HAS_SSE2)
+    switch(sz){
+        case 1: return 8;
+        case 2: return 8;
+        case 4: return 4;
+        case 8: return 2;
+        default: return 0;
+    }
+#elif defined(ENVI_HAS_NEON)
+    switch(sz){
+        case 4: return 4;
+        case 8: return 2;
+        default: return 0;
+    }
+#else
+    (void) sz;
+    return 0;
+#endif
+}
+
+/* function : envi_transpose_micro
+ *  Transpose one block of envi_transpose_micro_width(sz) elements square 
+ *  in SIMD registers: the columns b are loaded from srow[b] as vectors 
+ *  along a, shuffled, and stored as vectors along b at drow[a] (the 
+ *  destination needs to be contiguous along b). */
+static void envi_transpose_micro(char *const *drow, const char *const *srow,
+        size_t sz)
+{
+#if defined(ENVI_HAS_SSE2)
+    __m128i r0,r1,r2,r3,r4,r5,r6,r7;
+    __m128i t0,t1,t2,t3,t4,t5,t6,t7;
+    __m128i u0,u1,u2,u3,u4,u5,u6,u7;
+
+    switch(sz){
+        case 1:
+            r0 = _mm_loadl_epi64((const __m128i*) srow[0]);
+            r1 = _mm_loadl_epi64((const __m128i*) srow[1]);
+            r2 = _mm_loadl_epi64((const __m128i*) srow[2]);
+            r3 = _mm_loadl_epi64((const __m128i*) srow[3]);
+            r4 = _mm_loadl_epi64((const __m128i*) srow[4]);
+            r5 = _mm_loadl_epi64((const __m128i*) srow[5]);
+            r6 = _mm_loadl_epi64((const __m128i*) srow[6]);
+            r7 = _mm_loadl_epi64((const __m128i*) srow[7]);
+            t0 = _mm_unpacklo_epi8(r0,r1); t1 = _mm_unpacklo_epi8(r2,r3);
+            t2 = _mm_unpacklo_epi8(r4,r5); t3 = _mm_unpacklo_epi8(r6,r7);
+            u0 = _mm_unpacklo_epi16(t0,t1); u1 = _mm_unpackhi_epi16(t0,t1);
+            u2 = _mm_unpacklo_epi16(t2,t3); u3 = _mm_unpackhi_epi16(t2,t3);
+            t0 = _mm_unpacklo_epi32(u0,u2); t1 = _mm_unpackhi_epi32(u0,u2);
+            t2 = _mm_unpacklo_epi32(u1,u3); t3 = _mm_unpackhi_epi32(u1,u3);
+            _mm_storel_epi64((__m128i*) drow[0], t0);
+            _mm_storel_epi64((__m128i*) drow[1], _mm_srli_si128(t0,8));
+            _mm_storel_epi64((__m128i*) drow[2], t1);
+            _mm_storel_epi64((__m128i*) drow[3], _mm_srli_si128(t1,8));
+            _mm_storel_epi64((__m128i*) drow[4], t2);
+            _mm_storel_epi64((__m128i*) drow[5], _mm_srli_si128(t2,8));
+            _mm_storel_epi64((__m128i*) drow[6], t3);
+            _mm_storel_epi64((__m128i*) drow[7], _mm_srli_si128(t3,8));
+            break;
+        case 2:
+            r0 = _mm_loadu_si128((const __m128i*) srow[0]);
+            r1 = _mm_loadu_si128((const __m128i*) srow[1]);
+            r2 = _mm_loadu_si128((const __m128i*) srow[2]);
+            r3 = _mm_loadu_si128((const __m128i*) srow[3]);
+            r4 = _mm_loadu_si128((const __m128i*) srow[4]);
+            r5 = _mm_loadu_si128((const __m128i*) srow[5]);
+            r6 = _mm_loadu_si128((const __m128i*) srow[6]);
+            r7 = _mm_loadu_si128((const __m128i*) srow[7]);
+            t0 = _mm_unpacklo_epi16(r0,r1); t1 = _mm_unpacklo_epi16(r2,r3);
+            t2 = _mm_unpacklo_epi16(r4,r5); t3 = _mm_unpacklo_epi16(r6,r7);
+            t4 = _mm_unpackhi_epi16(r0,r1); t5 = _mm_unpackhi_epi16(r2,r3);
+            t6 = _mm_unpackhi_epi16(r4,r5); t7 = _mm_unpackhi_epi16(r6,r7);
+            u0 = _mm_unpacklo_epi32(t0,t1); u1 = _mm_unpacklo_epi32(t2,t3);
+            u2 = _mm_unpackhi_epi32(t0,t1); u3 = _mm_unpackhi_epi32(t2,t3);
+            u4 = _mm_unpacklo_epi32(t4,t5); u5 = _mm_unpacklo_epi32(t6,t7);
+            u6 = _mm_unpackhi_epi32(t4,t5); u7 = _mm_unpackhi_epi32(t6,t7);
+            _mm_storeu_si128((__m128i*) drow[0], _mm_unpacklo_epi64(u0,u1));
+            _mm_storeu_si128((__m128i*) drow[1], _mm_unpackhi_epi64(u0,u1));
+            _mm_storeu_si128((__m128i*) drow[2], _mm_unpacklo_epi64(u2,u3));
+            _mm_storeu_si128((__m128i*) drow[3], _mm_unpackhi_epi64(u2,u3));
+            _mm_storeu_si128((__m128i*) drow[4], _mm_unpacklo_epi64(u4,u5));
+            _mm_storeu_si128((__m128i*) drow[5], _mm_unpackhi_epi64(u4,u5));
+            _mm_storeu_si128((__m128i*) drow[6], _mm_unpacklo_epi64(u6,u7));
+            _mm_storeu_si128((__m128i*) drow[7], _mm_unpackhi_epi64(u6,u7));
+            break;
+        case 4:
+            r0 = _mm_loadu_si128((const __m128i*) srow[0]);
+            r1 = _mm_loadu_si128((const __m128i*) srow[1]);
+            r2 = _mm_loadu_si128((const __m128i*) srow[2]);
+            r3 = _mm_loadu_si128((const __m128i*) srow[3]);
+            t0 = _mm_unpacklo_epi32(r0,r1); t1 = _mm_unpacklo_epi32(r2,r3);
+            t2 = _mm_unpackhi_epi32(r0,r1); t3 = _mm_unpackhi_epi32(r2,r3);
+            _mm_storeu_si128((__m128i*) drow[0], _mm_unpacklo_epi64(t0,t1));
+            _mm_storeu_si128((__m128i*) drow[1], _mm_unpackhi_epi64(t0,t1));
+            _mm_storeu_si128((__m128i*) drow[2], _mm_unpacklo_epi64(t2,t3));
+            _mm_storeu_si128((__m128i*) drow[3], _mm_unpackhi_epi64(t2,t3));
+            break;
+        case 8:
+            r0 = _mm_loadu_si128((const __m128i*) srow[0]);
+            r1 = _mm_loadu_si128((const __m128i*) srow[1]);
+            _mm_storeu_si128((__m128i*) drow[0], _mm_unpacklo_epi64(r0,r1));
+            _mm_storeu_si128((__m128i*) drow[1], _mm_unpackhi_epi64(r0,r1));
+            break;
+        default:
+            break;
+    }
+#elif defined(ENVI_HAS_NEON)
+    uint32x4x2_t p32, q32;
+    uint64x2_t r0, r1;
+
+    switch(sz){
+        case 4:
+            p32 = vtrnq_u32(vld1q_u32((const uint32_t*) srow[0]),
+                            vld1q_u32((const uint32_t*) srow[1]));
+            q32 = vtrnq_u32(vld1q_u32((const uint32_t*) srow[2]),
+                            vld1q_u32((const uint32_t*) srow[3]));
+            vst1q_u32((uint32_t*) drow[0],
+                vcombine_u32(vget_low_u32(p32.val[0]),
+                    vget_low_u32(q32.val[0])));
+            vst1q_u32((uint32_t*) drow[1],
+                vcombine_u32(vget_low_u32(p32.val[1]),
+                    vget_low_u32(q32.val[1])));
+            vst1q_u32((uint32_t*) drow[2],
+                vcombine_u32(vget_high_u32(p32.val[0]),
+                    vget_high_u32(q32.val[0])));
+            vst1q_u32((uint32_t*) drow[3],
+                vcombine_u32(vget_high_u32(p32.val[1]),
+                    vget_high_u32(q32.val[1])));
+            break;
+        case 8:
+            r0 = vld1q_u64((const uint64_t*) srow[0]);
+            r1 = vld1q_u64((const uint64_t*) srow[1]);
+            vst1q_u64((uint64_t*) drow[0],
+                vcombine_u64(vget_low_u64(r0), vget_low_u64(r1)));
+            vst1q_u64((uint64_t*) drow[1],
+                vcombine_u64(vget_high_u64(r0), vget_high_u64(r1)));
+            break;
+        default:
+            break;
+    }
+#else
+    (void) drow; (void) srow; (void) sz;
+#endif
+}
+
+/* function : envi_transpose_tile
+ *  Transpose one tile of na x nb elements (see envi_transpose2d_map) with
+ *  the SIMD micro-kernel where the destination is contiguous along b, and
+ *  element by element on the borders. */
+static void envi_transpose_tile(char *dst, const size_t *amap, 
+        size_t dst_sa, size_t dst_sb, const char *src, const size_t *bmap,
+        size_t src_sb, size_t na, size_t nb, size_t sz)
+{
+    size_t a,b,i,m,na_v,nb_v;
+    char *drow[8];
+    const char *srow[8];
+
+    m = (dst_sb == 1) ? envi_transpose_micro_width(sz) : 0;
+    if(m == 0 || na < m || nb < m){
+        envi_transpose_scalar(dst, amap, dst_sa, dst_sb, src, bmap, src_sb,
+            na, nb, sz);
+        return;
+    }
+    na_v = na - na % m;
+    nb_v = nb - nb % m;
+    for(a=0;a<na_v;a+=m){
+        for(i=0;i<m;i++)
+            drow[i] = dst + ENVI_AMAP(amap,a+i)*dst_sa*sz;
+        for(b=0;b<nb_v;b+=m){
+            for(i=0;i<m;i++)
+                srow[i] = src + (a + ENVI_AMAP(bmap,b+i)*src_sb)*sz;
+            envi_transpose_micro(drow, srow, sz);
+            for(i=0;i<m;i++)
+                drow[i] += m*sz;
+        }
+    }
+    if(nb_v < nb)
+        envi_transpose_scalar(dst + nb_v*sz, amap, dst_sa, 1,
+            (bmap != NULL) ? src : src + nb_v*src_sb*sz,
+            (bmap != NULL) ? bmap + nb_v : NULL, src_sb, na_v, nb - nb_v, sz);
+    if(na_v < na)
+        envi_transpose_scalar(
+            (amap != NULL) ? dst : dst + na_v*dst_sa*sz,
+            (amap != NULL) ? amap + na_v : NULL, dst_sa, 1,
+            src + na_v*sz, bmap, src_sb, na - na_v, nb, sz);
+}
+
+/* function : envi_transpose_tile_edge
+ *  Edge (elements) of the tiles for elements of sz bytes: the largest 
+ *  power of two (at least 8) whose square tile stays within 
+ *  ENVI_TRANSPOSE_TILE bytes. */
+static size_t envi_transpose_tile_edge(size_t sz)
+{
+    size_t edge = 8;
+
+    while(4*edge*edge*sz <= ENVI_TRANSPOSE_TILE)
+        edge *= 2;
+    return edge;
+}
+
+void envi_transpose2d_map(char *dst, const size_t *amap, size_t dst_sa,
+        size_t dst_sb, const char *src, const size_t *bmap, size_t src_sb,
+        size_t na, size_t nb, size_t sz)
+{
+    size_t a0,b0,ta,tb,edge;
+    char *dst_t;
+    const char *src_t;
+
+    edge = envi_transpose_tile_edge(sz);
+    for(b0=0;b0<nb;b0+=edge){
+        tb = (nb-b0 < edge) ? nb-b0 : edge;
+        for(a0=0;a0<na;a0+=edge){
+            ta = (na-a0 < edge) ? na-a0 : edge;
+            /* the mapped indices are offset in their map, the others in
+             * the pointers. */
+            dst_t = dst + ((amap != NULL) ? 0 : a0*dst_sa)*sz + b0*dst_sb*sz;
+            src_t = src + a0*sz + ((bmap != NULL) ? 0 : b0*src_sb)*sz;
+            envi_transpose_tile(dst_t, (amap != NULL) ? amap + a0 : NULL,
+                dst_sa, dst_sb, src_t, (bmap != NULL) ? bmap + b0 : NULL,
+                src_sb, ta, tb, sz);
+        }
+    }
+}
+
+void envi_transpose2d(char *dst, size_t dst_sa, size_t dst_sb,
+        const char *src, size_t src_sb, size_t na, size_t nb, size_t sz)
+{
+    envi_transpose2d_map(dst, NULL, dst_sa, dst_sb, src, NULL, src_sb,
+        na, nb, sz);
+}
+
+void envi_layout_init(EnviLayout *layout, const size_t *n,
+        const size_t *o, size_t sz)
+{
+    envi_layout_init_map(layout, n, o, NULL, sz);
+}
+
+void envi_layout_init_map(EnviLayout *layout, const size_t *n,
+        const size_t *o, size_t *const *omap, size_t sz)
+{
+    size_t i, p, rows_min, rows_target, edge;
+
+    layout->identity = true;
+    p = 1;
+    for(i=0;i<3;i++){
+        layout->n[i] = n[i];
+        layout->o[i] = o[i];
+        layout->omap[i] = (omap != NULL) ? omap[i] : NULL;
+        if(n[i] > 1 && (o[i] != p || layout->omap[i] != NULL))
+            layout->identity = false;
+        p *= n[i];
+    }
+    layout->nrows = n[1]*n[2];
+
+    /* A block is about ENVI_TRANSPOSE_BLOCK_SIZE bytes. If the output is
+     * contiguous along i3, it holds whole i1 x i2 slabs, enough of them
+     * to fill the tiles of the transpose. */
+    rows_target = (n[0]*sz > 0) ? ENVI_TRANSPOSE_BLOCK_SIZE / (n[0]*sz) : 1;
+    rows_min = 1;
+    if(!layout->identity && o[2] < o[1]){
+        edge = envi_transpose_tile_edge(sz);
+        rows_min = n[1] * ((n[2] < edge) ? n[2] : edge);
+    }
+    layout->block_rows = (rows_target > rows_min) ? rows_target : rows_min;
+    if(!layout->identity && n[1] > 0 && layout->block_rows > n[1])
+        layout->block_rows -= layout->block_rows % n[1];
+    if(layout->block_rows > layout->nrows)
+        layout->block_rows = layout->nrows;
+    if(layout->block_rows < 1)
+        layout->block_rows = 1;
+}
+
+void envi_layout_scatter(const EnviLayout *layout, char *dst,
+        const char *stage, size_t row_start, size_t nrows, size_t sz)
+{
+    size_t n1, n2, i2, i3, j0, j1, k0, k1, row_end;
+    const size_t *o = layout->o;
+    size_t *const *omap = layout->omap;
+
+    n1 = layout->n[0];
+    n2 = layout->n[1];
+    row_end = row_start + nrows;
+    if(nrows == 0 || n1 == 0)
+        return;
+    if(omap[1] == NULL && (omap[2] != NULL || o[1] <= o[2])){
+        /* the output is contiguous along i2: transpose the rows of each
+         * i1 x i2 slab in the block. */
+        for(i3=row_start/n2;i3*n2<row_end;i3++){
+            j0 = (row_start > i3*n2) ? row_start - i3*n2 : 0;
+            j1 = (row_end < (i3+1)*n2) ? row_end - i3*n2 : n2;
+            envi_transpose2d_map(
+                dst + (ENVI_AMAP(omap[2],i3)*o[2] + j0*o[1])*sz,
+                omap[0], o[0], o[1],
+                stage + (i3*n2 + j0 - row_start)*n1*sz, NULL, n1,
+                n1, j1-j0, sz);
+        }
+    } else {
+        /* the output is contiguous along i3: for each i2, transpose the
+         * rows of the slabs in the block. */
+        for(i2=0;i2<n2;i2++){
+            k0 = (row_start > i2) ? (row_start - i2 + n2 - 1) / n2 : 0;
+            k1 = (row_end > i2) ? (row_end - i2 + n2 - 1) / n2 : 0;
+            if(k1 <= k0)
+                continue;
+            envi_transpose2d_map(
+                dst + (ENVI_AMAP(omap[1],i2)*o[1] + k0*o[2])*sz,
+                omap[0], o[0], o[2],
+                stage + (k0*n2 + i2 - row_start)*n1*sz, NULL, n1*n2,
+                n1, k1-k0, sz);
+        }
+    }
+}
+
+/* EnviTransposeTask
+ *  Share of envi_layout_transpose run by one thread: the rows
+ *  [row_start, row_start+nrows). */
+typedef struct EnviTransposeTask {
+    const EnviLayout *layout;
+    char *dst;
+    const char *src;
+    size_t row_start;
+    size_t nrows;
+    size_t sz;
+} EnviTransposeTask ;
+
+static void *envi_transpose_task(void *arg)
+{
+    EnviTransposeTask *task = (EnviTransposeTask*) arg;
+
+    envi_layout_scatter(task->layout, task->dst,
+        task->src + task->row_start*task->layout->n[0]*task->sz,
+        task->row_start, task->nrows, task->sz);
+    return NULL;
+}
+
+int envi_layout_transpose(const EnviLayout *layout, char *dst,
+        const char *src, size_t sz, size_t num_threads)
+{
+    EnviTransposeTask *tasks;
+    size_t t, n2, unit, nunits, r0, r1;
+#if defined(ENVI_HAS_PTHREAD)
+    pthread_t *threads;
+    bool *launched;
+#endif
+
+    if(layout->nrows == 0 || layout->n[0] == 0)
+        return 0;
+    if(layout->identity){
+        memcpy(dst, src, layout->nrows*layout->n[0]*sz);
+        return 0;
+    }
+#if !defined(ENVI_HAS_PTHREAD)
+    num_threads = 1;
+#endif
+    /* shares are made of whole slabs (i1 x i2 planes) when there are 
+     * enough of them, so that a thread writes whole lines of BIL and BIP
+     * images. */
+    n2 = layout->n[1];
+    unit = (layout->nrows / n2 >= num_threads) ? n2 : 1;
+    nunits = (layout->nrows + unit - 1) / unit;
+    if(num_threads > nunits) num_threads = nunits;
+    if(num_threads <= 1){
+        envi_layout_scatter(layout, dst, src, 0, layout->nrows, sz);
+        return 0;
+    }
+
+    tasks = (EnviTransposeTask*) malloc(num_threads*sizeof(EnviTransposeTask));
+    if(tasks == NULL)
+        return -5;
+    for(t=0;t<num_threads;t++){
+        r0 = nunits * t / num_threads * unit;
+        r1 = (t == num_threads-1) ? layout->nrows
+                                  : nunits * (t+1) / num_threads * unit;
+        tasks[t].layout = layout;
+        tasks[t].dst = dst;
+        tasks[t].src = src;
+        tasks[t].row_start = r0;
+        tasks[t].nrows = r1 - r0;
+        tasks[t].sz = sz;
+    }
+
+#if defined(ENVI_HAS_PTHREAD)
+    threads = (pthread_t*) malloc(num_threads*sizeof(pthread_t));
+    launched = (bool*) malloc(num_threads*sizeof(bool));
+    if(threads == NULL || launched == NULL){
+        free(threads); free(launched); free(tasks);
+        return -5;
+    }
+    /* The first task runs on the calling thread. Tasks whose thread could
+     * not be created are also run on the calling thread. */
+    launched[0] = false;
+    for(t=1;t<num_threads;t++)
+        launched[t] = (pthread_create(&threads[t], NULL, envi_transpose_task,
+                        &tasks[t]) == 0);
+    for(t=0;t<num_threads;t++){
+        if(!launched[t])
+            envi_transpose_task(&tasks[t]);
+    }
+    for(t=0;t<num_threads;t++){
+        if(launched[t])
+            pthread_join(threads[t], NULL);
+    }
+    free(launched);
+    free(threads);
+#else
+    for(t=0;t<num_threads;t++)
+        envi_transpose_task(&tasks[t]);
+#endif
+    free(tasks);
+    return 0;
+}
+
+int envi_stage_init(EnviStage *stage, const EnviLayout *layout,
+        const EnviCopyKernel *kernel, char *subimg)
+{
+    size_t nelems;
+
+    stage->layout = layout;
+    stage->kernel = *kernel;
+    stage->subimg = subimg;
+    /* the flags are only staged if the kernel checks the elements. */
+    stage->valid = kernel->check_div ? kernel->valid : NULL;
+    stage->buf = NULL;
+    stage->vbuf = NULL;
+    stage->row_nbytes = layout->n[0] * kernel->dst_sz;
+    stage->has_block = false;
+    stage->block = 0;
+    if(layout->identity)
+        return 0;
+
+    nelems = layout->block_rows * layout->n[0];
+    stage->buf = (char*) malloc(nelems * kernel->dst_sz);
+    if(stage->buf == NULL)
+        return -5;
+    if(stage->valid != NULL){
+        stage->vbuf = (bool*) malloc(nelems * sizeof(bool));
+        if(stage->vbuf == NULL){
+            free(stage->buf);
+            stage->buf = NULL;
+            return -5;
+        }
+    }
+    stage->kernel.dst_base = stage->buf;
+    stage->kernel.valid = stage->vbuf;
+    return 0;
+}
+
+char *envi_stage_row(EnviStage *stage, size_t row)
+{
+    size_t block;
+
+    if(stage->layout->identity)
+        return stage->subimg + row * stage->row_nbytes;
+    block = row / stage->layout->block_rows;
+    if(!stage->has_block || block != stage->block){
+        envi_stage_flush(stage);
+        stage->block = block;
+        stage->has_block = true;
+    }
+    return stage->buf
+        + (row - block * stage->layout->block_rows) * stage->row_nbytes;
+}
+
+void envi_stage_flush(EnviStage *stage)
+{
+    const EnviLayout *layout = stage->layout;
+    size_t row_start, nrows;
+
+    if(layout->identity || !stage->has_block)
+        return;
+    row_start = stage->block * layout->block_rows;
+    nrows = layout->nrows - row_start;
+    if(nrows > layout->block_rows)
+        nrows = layout->block_rows;
+    envi_layout_scatter(layout, stage->subimg, stage->buf, row_start, nrows,
+        stage->kernel.dst_sz);
+    if(stage->vbuf != NULL)
+        envi_layout_scatter(layout, (char*) stage->valid,
+            (const char*) stage->vbuf, row_start, nrows, sizeof(bool));
+    stage->has_block = false;
+}
+
+void envi_stage_free(EnviStage *stage)
+{
+    free(stage->buf);
+    free(stage->vbuf);
+    stage->buf = NULL;
+    stage->vbuf = NULL;
+}
@@ -0,0 +1,550 @@
+/* envi_uring.c */
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "envi_io.h"
+#include "envi_ioplan.h"
+#include "envi_copy.h"
+#include "envi_transpose.h"
+#include "envi_cache.h"
+#include "envi_uring.h"
+#if defined(ENVI_HAS_PTHREAD)
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+/* ENVI_HAS_URING: the io_uring ABI of Linux 5.6 (IORING_OP_READ and the
+ * opcode probe) is available at build time. */
+#if defined(__linux__) && defined(ENVI_HAS_PTHREAD) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#if defined(IO_URING_OP_SUPPORTED) && defined(__NR_io_uring_setup) \
+    && (defined(__GNUC__) || defined(__clang__))
+#define ENVI_HAS_URING
+#endif
+#endif
+#endif
+
+#if defined(ENVI_HAS_URING)
+/* EnviUring
+ *  Submission and completion rings shared with the kernel, mapped from
+ *  the io_uring file descriptor fd. entries is the size of the submission
+ *  ring, and to_submit the number of queued entries not yet submitted. */
+typedef struct EnviUring {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_nbytes;
+    size_t cq_nbytes;
+    size_t sqes_nbytes;
+    unsigned to_submit;
+} EnviUring ;
+
+static void envi_uring_free(EnviUring *ring)
+{
+    if(ring->sqes != NULL)
+        munmap(ring->sqes, ring->sqes_nbytes);
+    if(ring->cq_ptr != NULL && ring->cq_ptr != ring->sq_ptr)
+        munmap(ring->cq_ptr, ring->cq_nbytes);
+    if(ring->sq_ptr != NULL)
+        munmap(ring->sq_ptr, ring->sq_nbytes);
+    if(ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(EnviUring));
+    ring->fd = -1;
+}
+
+static void *envi_uring_mmap(int fd, size_t nbytes, off_t offset)
+{
+    void *ptr = mmap(NULL, nbytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd,
+                    offset);
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+/* function : envi_uring_init
+ *  Set up a ring of (at most) entries submission entries.
+ *  Returns 0 on success and -1 if io_uring is not available. */
+static int envi_uring_init(EnviUring *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    char *sq, *cq;
+
+    memset(ring, 0, sizeof(EnviUring));
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CLAMP;
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+    if(ring->fd < 0){
+        ring->fd = -1;
+        return -1;
+    }
+    ring->entries = p.sq_entries;
+    ring->sq_nbytes = p.sq_off.array + p.sq_entries*sizeof(unsigned);
+    ring->cq_nbytes = p.cq_off.cqes
+                    + p.cq_entries*sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP){
+        if(ring->cq_nbytes > ring->sq_nbytes)
+            ring->sq_nbytes = ring->cq_nbytes;
+        ring->cq_nbytes = ring->sq_nbytes;
+    }
+    ring->sq_ptr = envi_uring_mmap(ring->fd, ring->sq_nbytes,
+                    IORING_OFF_SQ_RING);
+    if(ring->sq_ptr != NULL)
+        ring->cq_ptr = (p.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ptr
+            : envi_uring_mmap(ring->fd, ring->cq_nbytes, IORING_OFF_CQ_RING);
+    ring->sqes_nbytes = p.sq_entries*sizeof(struct io_uring_sqe);
+    if(ring->cq_ptr != NULL)
+        ring->sqes = (struct io_uring_sqe*) envi_uring_mmap(ring->fd,
+                        ring->sqes_nbytes, IORING_OFF_SQES);
+    if(ring->sqes == NULL){
+        envi_uring_free(ring);
+        return -1;
+    }
+    sq = (char*) ring->sq_ptr;
+    cq = (char*) ring->cq_ptr;
+    ring->sq_head  = (unsigned*) (sq + p.sq_off.head);
+    ring->sq_tail  = (unsigned*) (sq + p.sq_off.tail);
+    ring->sq_mask  = (unsigned*) (sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned*) (sq + p.sq_off.array);
+    ring->cq_head  = (unsigned*) (cq + p.cq_off.head);
+    ring->cq_tail  = (unsigned*) (cq + p.cq_off.tail);
+    ring->cq_mask  = (unsigned*) (cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+    return 0;
+}
+
+/* function : envi_uring_prep_read
+ *  Queue the read of n bytes at offset of fd into buf, tagged with
+ *  user_data. Returns 0 on success and -1 if the submission ring is full.
+ */
+static int envi_uring_prep_read(EnviUring *ring, int fd, char *buf,
+        size_t n, size_t offset, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe;
+    unsigned tail, idx;
+
+    tail = *ring->sq_tail;
+    if(tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)
+            >= ring->entries)
+        return -1;
+    idx = tail & *ring->sq_mask;
+    sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = (uint64_t) offset;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = (uint32_t) n;
+    sqe->user_data = user_data;
+    ring->sq_array[idx] = idx;
+    /* the entry is visible to the kernel once the tail is published */
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return 0;
+}
+
+/* function : envi_uring_enter
+ *  Submit the queued entries and wait until at least min_complete
+ *  completions are available. Returns 0 on success and -1 on failure. */
+static int envi_uring_enter(EnviUring *ring, unsigned min_complete)
+{
+    long ret;
+
+    for(;;){
+        ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit,
+                min_complete, (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0,
+                NULL, (size_t) 0);
+        if(ret >= 0){
+            ring->to_submit -= (unsigned) ret;
+            return 0;
+        }
+        if(errno != EINTR)
+            return -1;
+    }
+}
+
+static pthread_once_t envi_uring_probe_once = PTHREAD_ONCE_INIT;
+static bool envi_uring_probe_ok = false;
+
+/* function : envi_uring_probe
+ *  Check that a ring can be set up and that it supports IORING_OP_READ
+ *  (Linux 5.6), which the older kernels would only reject on completion.
+ */
+static void envi_uring_probe(void)
+{
+    EnviUring ring;
+    struct io_uring_probe *probe;
+    const unsigned nops = 256;
+
+    if(envi_uring_init(&ring, 2) != 0)
+        return;
+    probe = (struct io_uring_probe*) calloc(1, sizeof(struct io_uring_probe)
+                + nops*sizeof(struct io_uring_probe_op));
+    if(probe != NULL
+            && syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE,
+                probe, nops) == 0
+            && probe->last_op >= IORING_OP_READ
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+        envi_uring_probe_ok = true;
+    free(probe);
+    envi_uring_free(&ring);
+}
+
+bool envi_uring_supported(void)
+{
+    pthread_once(&envi_uring_probe_once, envi_uring_probe);
+    return envi_uring_probe_ok;
+}
+#else
+bool envi_uring_supported(void)
+{
+    return false;
+}
+#endif
+
+bool envi_uring_use(EnviReadMode read_mode, const EnviIOPlan *plan)
+{
+    return read_mode == ENVI_READ_URING && plan->cache == NULL
+        && envi_uring_supported();
+}
+
+#if defined(ENVI_HAS_PTHREAD)
+/* EnviUringSlot
+ *  A segment in flight: nbytes bytes at file_offset read into buf, of
+ *  which nread are complete. span is the number of bytes of the ring
+ *  buffer it holds (0: read directly into subimg). */
+typedef struct EnviUringSlot {
+    char *buf;
+    size_t nbytes;
+    size_t nread;
+    size_t file_offset;
+    size_t span;
+    bool done;
+} EnviUringSlot ;
+
+/* EnviUringQueue
+ *  Segments [next_done, next) of the plan are in flight in the slots
+ *  (segment i in slots[i % depth]) and hold the bytes [tail, head) of the
+ *  ring buffer buf, allocated and released in plan order. The reads are
+ *  performed by pread as they are queued if the ring is not set up. */
+typedef struct EnviUringQueue {
+    const EnviIOPlan *plan;
+    int fd;
+#if defined(ENVI_HAS_URING)
+    EnviUring ring;
+#endif
+    bool has_ring;
+    EnviUringSlot *slots;
+    size_t depth;
+    size_t next;
+    size_t next_done;
+    size_t inflight;
+    char *buf;
+    size_t buf_nbytes;
+    size_t head;
+    size_t tail;
+    size_t used;
+    int errflg;
+} EnviUringQueue ;
+
+/* function : envi_uring_buf_alloc
+ *  Take n contiguous bytes after the last allocation in the ring buffer,
+ *  wrapping to its start if the end is too short. Returns false if they
+ *  are not free yet. */
+static bool envi_uring_buf_alloc(EnviUringQueue *q, size_t n,
+        EnviUringSlot *slot)
+{
+    size_t off, span;
+
+    if(q->used == 0)
+        q->head = q->tail = 0;
+    if(q->used == 0 || q->head > q->tail){
+        if(q->buf_nbytes - q->head >= n){
+            off = q->head; span = n;
+        } else if(q->tail >= n){
+            off = 0; span = q->buf_nbytes - q->head + n;
+        } else {
+            return false;
+        }
+    } else if(q->head < q->tail && q->tail - q->head >= n){
+        off = q->head; span = n;
+    } else {
+        return false;
+    }
+    slot->buf = q->buf + off;
+    slot->span = span;
+    q->head = off + n;
+    q->used += span;
+    return true;
+}
+
+static void envi_uring_buf_release(EnviUringQueue *q, EnviUringSlot *slot)
+{
+    if(slot->span == 0)
+        return;
+    q->tail = (size_t) (slot->buf - q->buf) + slot->nbytes;
+    q->used -= slot->span;
+}
+
+/* function : envi_uring_pread_full
+ *  pread n bytes at the offset of the file, retrying on short reads and
+ *  interrupts. Returns 0 on success and -4 on failure. */
+static int envi_uring_pread_full(int fd, char *buf, size_t n, off_t offset)
+{
+    ssize_t nread;
+
+    while(n > 0){
+        nread = pread(fd, buf, n, offset);
+        if(nread < 0){
+            if(errno == EINTR) continue;
+            return -4;
+        } else if(nread == 0){
+            return -4;
+        }
+        buf += nread; offset += nread; n -= (size_t) nread;
+    }
+    return 0;
+}
+
+/* function : envi_uring_submit
+ *  Queue the read of the rest of the segment i. */
+static int envi_uring_submit(EnviUringQueue *q, size_t i)
+{
+    EnviUringSlot *slot = &q->slots[i % q->depth];
+    int errflg;
+
+#if defined(ENVI_HAS_URING)
+    if(q->has_ring){
+        if(envi_uring_prep_read(&q->ring, q->fd, slot->buf + slot->nread,
+                slot->nbytes - slot->nread, slot->file_offset + slot->nread,
+                (uint64_t) i) != 0)
+            return -4;
+        return 0;
+    }
+#endif
+    if(q->plan->cache != NULL)
+        errflg = envi_cache_pread(q->plan->cache, slot->buf, slot->nbytes,
+                    (uint64_t) slot->file_offset);
+    else
+        errflg = envi_uring_pread_full(q->fd, slot->buf, slot->nbytes,
+                    (off_t) slot->file_offset);
+    slot->nread = slot->nbytes;
+    slot->done = true;
+    q->inflight--;
+    return errflg;
+}
+
+#if defined(ENVI_HAS_URING)
+/* function : envi_uring_reap
+ *  Submit the queued reads, wait for min_complete completions and process
+ *  all the available ones. Short reads are queued again for the rest of
+ *  the segment. */
+static void envi_uring_reap(EnviUringQueue *q, unsigned min_complete)
+{
+    EnviUring *ring = &q->ring;
+    struct io_uring_cqe *cqe;
+    EnviUringSlot *slot;
+    unsigned head, tail;
+    size_t i;
+    int res;
+
+    if(envi_uring_enter(ring, min_complete) != 0){
+        /* nothing completes anymore */
+        q->errflg = -4;
+        q->inflight = 0;
+        return;
+    }
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for(;head!=tail;head++){
+        cqe = &ring->cqes[head & *ring->cq_mask];
+        i = (size_t) cqe->user_data;
+        res = cqe->res;
+        slot = &q->slots[i % q->depth];
+        if(res > 0)
+            slot->nread += (size_t) res;
+        if(q->errflg == 0 && (res == -EINTR || res == -EAGAIN
+                || (res > 0 && slot->nread < slot->nbytes))){
+            if(envi_uring_submit(q, i) == 0)
+                continue;
+        }
+        if(res <= 0 && res != -EINTR && res != -EAGAIN)
+            q->errflg = -4;
+        else if(slot->nread < slot->nbytes)
+            q->errflg = -4;
+        slot->done = true;
+        q->inflight--;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+/* function : envi_uring_segment_direct
+ *  Evaluate if the segment i is read directly into subimg. */
+static bool envi_uring_segment_direct(const EnviIOPlan *plan, size_t i,
+        bool direct)
+{
+    return direct && plan->segments[i].npieces == 1;
+}
+
+int envi_ioplan_execute_uring(const EnviIOPlan *plan, int fd, char *subimg,
+        const EnviLayout *layout, size_t queue_depth)
+{
+    EnviUringQueue q;
+    EnviUringSlot *slot;
+    const EnviIOSegment *seg;
+    const EnviIOPiece *pc;
+    const EnviCopyKernel *kernel;
+    EnviStage stage;
+    EnviCopyFn copy_fn;
+    size_t i,k,nbytes_buf;
+    bool direct;
+    char *dst;
+    int errflg;
+
+    if(plan->nsegments == 0)
+        return 0;
+    memset(&q, 0, sizeof(EnviUringQueue));
+    q.plan = plan;
+    q.fd = fd;
+
+    /* the segments made of a single piece go straight into subimg where
+     * it is laid out in file order, the others through the ring buffer */
+    direct = (layout == NULL || layout->identity)
+            && envi_copy_kernel_is_plain(&plan->kernel);
+    nbytes_buf = 0;
+    for(i=0;i<plan->nsegments;i++){
+        if(!envi_uring_segment_direct(plan, i, direct))
+            nbytes_buf += plan->segments[i].nbytes;
+    }
+    q.buf_nbytes = (plan->max_segment > ENVI_URING_BUF_SIZE)
+                    ? plan->max_segment : ENVI_URING_BUF_SIZE;
+    if(q.buf_nbytes > nbytes_buf)
+        q.buf_nbytes = nbytes_buf;
+
+    if(queue_depth == 0)
+        queue_depth = ENVI_URING_QUEUE_DEPTH;
+    if(queue_depth > ENVI_URING_QUEUE_DEPTH_MAX)
+        queue_depth = ENVI_URING_QUEUE_DEPTH_MAX;
+    if(queue_depth > plan->nsegments)
+        queue_depth = plan->nsegments;
+    q.depth = 1;
+#if defined(ENVI_HAS_URING)
+    /* the block cache is read with pread */
+    if(plan->cache == NULL && envi_uring_supported()
+            && envi_uring_init(&q.ring, (unsigned) queue_depth) == 0){
+        q.has_ring = true;
+        q.depth = (queue_depth < q.ring.entries) ? queue_depth
+                                                 : q.ring.entries;
+    }
+#endif
+
+    q.slots = (EnviUringSlot*) malloc(q.depth*sizeof(EnviUringSlot));
+    q.buf = (q.buf_nbytes > 0) ? (char*) malloc(q.buf_nbytes) : NULL;
+    errflg = (q.slots == NULL || (q.buf_nbytes > 0 && q.buf == NULL)) ? -5
+                                                                      : 0;
+    if(errflg == 0 && layout != NULL
+            && envi_stage_init(&stage, layout, &plan->kernel, subimg) != 0)
+        errflg = -5;
+    if(errflg != 0){
+#if defined(ENVI_HAS_URING)
+        if(q.has_ring)
+            envi_uring_free(&q.ring);
+#endif
+        free(q.slots);
+        free(q.buf);
+        return errflg;
+    }
+    kernel = (layout != NULL) ? &stage.kernel : &plan->kernel;
+    copy_fn = envi_copy_kernel_fn(kernel);
+
+    while(q.next_done < plan->nsegments){
+        /* queue the next segments while there is a free slot and room in
+         * the ring buffer */
+        while(q.errflg == 0 && q.next < plan->nsegments
+                && q.next - q.next_done < q.depth){
+            seg = &plan->segments[q.next];
+            slot = &q.slots[q.next % q.depth];
+            slot->nbytes = seg->nbytes;
+            if(envi_uring_segment_direct(plan, q.next, direct)){
+                slot->buf = subimg + plan->pieces[seg->piece_start].dst_offset;
+                slot->span = 0;
+            } else if(!envi_uring_buf_alloc(&q, seg->nbytes, slot)){
+                break;
+            }
+            slot->nread = 0;
+            slot->file_offset = seg->file_offset;
+            slot->done = false;
+            q.inflight++;
+            q.errflg = envi_uring_submit(&q, q.next);
+            q.next++;
+        }
+        if(q.errflg != 0)
+            break;
+        /* wait for the oldest segment and copy it into subimg */
+        slot = &q.slots[q.next_done % q.depth];
+#if defined(ENVI_HAS_URING)
+        while(!slot->done && q.errflg == 0)
+            envi_uring_reap(&q, 1);
+#endif
+        if(q.errflg != 0)
+            break;
+        seg = &plan->segments[q.next_done];
+        pc = plan->pieces + seg->piece_start;
+        if(slot->span == 0){
+            envi_copy_kernel_apply(kernel, slot->buf, slot->buf,
+                seg->nbytes / plan->sz);
+        } else {
+            for(k=0;k<seg->npieces;k++){
+                dst = (layout != NULL)
+                    ? envi_stage_row(&stage, pc[k].dst_offset/stage.row_nbytes)
+                        + pc[k].dst_offset % stage.row_nbytes
+                    : subimg + pc[k].dst_offset;
+                copy_fn(kernel, dst, slot->buf + pc[k].src_offset,
+                    pc[k].nbytes / plan->sz);
+            }
+        }
+        envi_uring_buf_release(&q, slot);
+        q.next_done++;
+    }
+
+#if defined(ENVI_HAS_URING)
+    /* the buffers of the reads still in flight after a failure are only
+     * released once the kernel is done with them */
+    while(q.has_ring && q.inflight > 0)
+        envi_uring_reap(&q, 1);
+    if(q.has_ring)
+        envi_uring_free(&q.ring);
+#endif
+    errflg = q.errflg;
+    if(layout != NULL){
+        if(errflg == 0)
+            envi_stage_flush(&stage);
+        envi_stage_free(&stage);
+    }
+    free(q.slots);
+    free(q.buf);
+    return errflg;
+}
+#else
+int envi_ioplan_execute_uring(const EnviIOPlan *plan, int fd, char *subimg,
+        const EnviLayout *layout, size_t queue_depth)
+{
+    return -4;
+}
+#endif
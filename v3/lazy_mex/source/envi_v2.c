@@ -1,27 +1,28 @@
-
 #include "io64.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include "envi_v2.h"
+#include "envi_cache.h"
+#include "envi_filepool.h"
 
 EnviHeader mxGetEnviHeader(const mxArray *pm){
     EnviHeader msldem_hdr;
     char *interleave_char;
     
     if(mxGetField(pm,0,"samples")!=NULL){
-        msldem_hdr.samples = (int32_T) mxGetScalar(mxGetField(pm,0,"samples"));
+        msldem_hdr.samples = (int32_t) mxGetScalar(mxGetField(pm,0,"samples"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header (sample)");
     }
     if(mxGetField(pm,0,"lines")!=NULL){
-        msldem_hdr.lines = (int32_T) mxGetScalar(mxGetField(pm,0,"lines"));
+        msldem_hdr.lines = (int32_t) mxGetScalar(mxGetField(pm,0,"lines"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
     if(mxGetField(pm,0,"bands")!=NULL){
-        msldem_hdr.bands = (int32_T) mxGetScalar(mxGetField(pm,0,"bands"));
+        msldem_hdr.bands = (int32_t) mxGetScalar(mxGetField(pm,0,"bands"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
@@ -40,21 +41,25 @@ EnviHeader mxGetEnviHeader(const mxArray *pm){
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
     if(mxGetField(pm,0,"data_type")!=NULL){
-        msldem_hdr.data_type = (int32_T) mxGetScalar(mxGetField(pm,0,"data_type"));
+        msldem_hdr.data_type = (int32_t) mxGetScalar(mxGetField(pm,0,"data_type"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
     if(mxGetField(pm,0,"byte_order")!=NULL){
-        msldem_hdr.byte_order = (int32_T) mxGetScalar(mxGetField(pm,0,"byte_order"));
+        msldem_hdr.byte_order = (int32_t) mxGetScalar(mxGetField(pm,0,"byte_order"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
     if(mxGetField(pm,0,"header_offset")!=NULL){
-        msldem_hdr.header_offset = (int32_T) mxGetScalar(mxGetField(pm,0,"header_offset"));
+        msldem_hdr.header_offset = (int32_t) mxGetScalar(mxGetField(pm,0,"header_offset"));
     }else{
         mexErrMsgIdAndTxt("envi:mexGetEnviHeader","Struct is not an envi header");
     }
-    if(mxGetField(pm,0,"data_ignore_value")!=NULL){
+    /* NaN means no data ignore value. A per-band data_ignore_value is left
+     * to the caller. */
+    msldem_hdr.data_ignore_value = mxGetNaN();
+    if(mxGetField(pm,0,"data_ignore_value")!=NULL
+            && mxGetNumberOfElements(mxGetField(pm,0,"data_ignore_value"))==1){
         msldem_hdr.data_ignore_value = mxGetScalar(mxGetField(pm,0,"data_ignore_value"));
     }
     
@@ -63,281 +68,463 @@ EnviHeader mxGetEnviHeader(const mxArray *pm){
     
 }
 
-bool isComputerLSBF(void){
-    int i = 1;
-    char *c = (char*)&i;
+EnviReadOption mxGetEnviReadOption(const mxArray *pm){
+    EnviReadOption opt;
+    char *read_mode_char, *precision_char;
     
-    if (*c) {
-        /* little endian */
-        return true;
-    } else {
-        /* big endian */
-        return false;
+    envi_read_option_init(&opt);
+    if(pm==NULL || mxIsEmpty(pm))
+        return opt;
+    if(!mxIsStruct(pm)){
+        mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","Read option needs to be a struct");
+    }
+    if(mxGetField(pm,0,"read_mode")!=NULL){
+        read_mode_char = mxArrayToString(mxGetField(pm,0,"read_mode"));
+        if(read_mode_char==NULL){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","read_mode needs to be a string");
+        } else if(strcmp(read_mode_char,"fread")==0){
+            opt.read_mode = ENVI_READ_FREAD;
+        } else if(strcmp(read_mode_char,"mmap")==0) {
+            opt.read_mode = ENVI_READ_MMAP;
+        } else if(strcmp(read_mode_char,"pread")==0) {
+            opt.read_mode = ENVI_READ_PREAD;
+        } else if(strcmp(read_mode_char,"uring")==0) {
+            opt.read_mode = ENVI_READ_URING;
+        } else if(strcmp(read_mode_char,"direct")==0) {
+            opt.read_mode = ENVI_READ_DIRECT;
+        } else if(strcmp(read_mode_char,"default")==0 || read_mode_char[0]=='\0') {
+            opt.read_mode = envi_read_mode_default();
+        } else {
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","read_mode %s is not valid",read_mode_char);
+        }
+        mxFree(read_mode_char);
+    }
+    if(mxGetField(pm,0,"num_threads")!=NULL && !mxIsEmpty(mxGetField(pm,0,"num_threads"))){
+        if(mxGetScalar(mxGetField(pm,0,"num_threads")) < 0){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","num_threads needs to be nonnegative");
+        }
+        opt.num_threads = (size_t) mxGetScalar(mxGetField(pm,0,"num_threads"));
+    }
+    if(mxGetField(pm,0,"coalesce_gap")!=NULL && !mxIsEmpty(mxGetField(pm,0,"coalesce_gap"))){
+        if(mxGetScalar(mxGetField(pm,0,"coalesce_gap")) < 0){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","coalesce_gap needs to be nonnegative");
+        }
+        opt.coalesce_gap = (size_t) mxGetScalar(mxGetField(pm,0,"coalesce_gap"));
     }
-        
+    if(mxGetField(pm,0,"queue_depth")!=NULL && !mxIsEmpty(mxGetField(pm,0,"queue_depth"))){
+        if(mxGetScalar(mxGetField(pm,0,"queue_depth")) < 0){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","queue_depth needs to be nonnegative");
+        }
+        opt.queue_depth = (size_t) mxGetScalar(mxGetField(pm,0,"queue_depth"));
+    }
+    if(mxGetField(pm,0,"precision")!=NULL){
+        precision_char = mxArrayToString(mxGetField(pm,0,"precision"));
+        if(precision_char==NULL){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","precision needs to be a string");
+        }
+        opt.precision = envi_get_data_type_from_precision(precision_char);
+        if(opt.precision < 0){
+            mexErrMsgIdAndTxt("envi:mxGetEnviReadOption","precision %s is not valid",precision_char);
+        }
+        mxFree(precision_char);
+    }
+    if(mxGetField(pm,0,"replace_div")!=NULL && !mxIsEmpty(mxGetField(pm,0,"replace_div"))){
+        opt.replace_div = mxGetScalar(mxGetField(pm,0,"replace_div")) != 0;
+    }
+    if(mxGetField(pm,0,"repval_div")!=NULL && !mxIsEmpty(mxGetField(pm,0,"repval_div"))){
+        opt.repval_div = mxGetScalar(mxGetField(pm,0,"repval_div"));
+    }
+    return opt;
 }
 
-/* function : swapFloat_shuffle 
- *  swap the bytes of the input float variable into the reverse direction 
- *  for resolving endian issues using byte shuffling.  
- *  Input Parameters
- *    float inFolat: input float before swapped 
- *  Returns
- *    float retVal : output float after swapped */
-float swapFloat_shuffle( float inFloat )
+/* the MEX file is locked in memory while the cache holds blocks */
+static bool envi_cache_locked = false;
+
+/* objects kept across the calls by the handles of the MEX file: the
+ * prepared reads (mxEnviReadPlanRegister) and the tile iterators 
+ * (mxEnviTileIterRegister). objs[k] of kinds[k] has the handle ids[k]. 
+ * The MEX file is locked in memory while there are any. */
+typedef enum EnviMexHandleKind {
+    ENVI_HANDLE_READPLAN, ENVI_HANDLE_TILEITER
+} EnviMexHandleKind ;
+
+static void **envi_handle_objs = NULL;
+static EnviMexHandleKind *envi_handle_kinds = NULL;
+static double *envi_handle_ids = NULL;
+static size_t envi_handles_n = 0;
+static size_t envi_handles_cap = 0;
+static double envi_handle_last_id = 0;
+
+static void envi_handle_obj_free(void *obj, EnviMexHandleKind kind)
 {
-   float retVal;
-   char *inFloat_char = (char*) &inFloat;
-   char *retVal_char  = (char*) &retVal;
-   
-   // swap the bytes into a temporary buffer
-   retVal_char[0] = inFloat_char[3];
-   retVal_char[1] = inFloat_char[2];
-   retVal_char[2] = inFloat_char[1];
-   retVal_char[3] = inFloat_char[0];
-
-   return retVal;
+    if(kind == ENVI_HANDLE_READPLAN)
+        envi_readplan_free((EnviReadPlan*) obj);
+    free(obj);
 }
 
-/* function : swapFloat 
- *  swap the bytes of the input float variable into the reverse direction 
- *  for resolving endian issues using bit shifts. 
- *  Input Parameters
- *    float inFolat: input float before swapped 
- *  Returns
- *    float retVal : output float after swapped */
-float swapFloat( const float inFloat )
+static void envi_handles_free(void)
 {
-   float retVal;
-   uint32_T *inFloat_int = (uint32_T*) &inFloat;
-   uint32_T *retVal_int  = (uint32_T*) &retVal;
-   
-   *retVal_int = (*inFloat_int<<24) | ( (*inFloat_int<<8) & 0x00FF0000u )
-                 | ( (*inFloat_int>>8) & 0x0000FF00u)
-                 | ( (*inFloat_int>>24) & 0x000000FFu);
-   
-   return retVal;
+    size_t k;
+
+    for(k=0;k<envi_handles_n;k++)
+        envi_handle_obj_free(envi_handle_objs[k], envi_handle_kinds[k]);
+    free(envi_handle_objs);
+    free(envi_handle_kinds);
+    free(envi_handle_ids);
+    envi_handle_objs = NULL;
+    envi_handle_kinds = NULL;
+    envi_handle_ids = NULL;
+    envi_handles_n = envi_handles_cap = 0;
 }
 
-int lazyenvireadRectx_multBand(char *imgpath, EnviHeader hdr, 
-        long int* smpl_skipszlist, size_t* smpl_readszlist, 
-        size_t N_smpl_skipread, long int smpl_skip_last,
-        long int* line_skipszlist, size_t* line_readszlist,
-        size_t N_line_skipread, long int line_skip_last,
-        long int* band_skipszlist, size_t* band_readszlist,
-        size_t N_band_skipread, long int band_skip_last,
-        void *subimg, size_t *dims_subimg, size_t sz)
+/* function : envi_mex_at_exit
+ *  Free the block cache and close the pooled files when the MEX file is 
+ *  cleared. */
+static void envi_mex_at_exit(void)
 {
-    size_t i,j,k, ii, jj,kk;
-    long int skip_pri;
-    void *buf;
-    long int sz_li;
-    FILE *fid;
-    size_t ncpy;
-    long int szfile,header_offset;
-    
-    long int d1, d2, d3;
-    size_t *d1_readszlist, *d2_readszlist, *d3_readszlist;
-    long int *d1_skipszlist, *d2_skipszlist, *d3_skipszlist;
-    size_t N_d1_skipread, N_d2_skipread, N_d3_skipread;
-    long int d1_skip_last, d2_skip_last, d3_skip_last;
+    envi_cache_free();
+    envi_filepool_flush();
+    envi_handles_free();
+}
 
-    size_t N;
-    size_t subimg_offset,curskip;
+static void envi_cache_command(int nlhs, mxArray *plhs[], int nrhs, 
+        const mxArray *prhs[])
+{
+    char *cmd;
+    double capacity, block_size;
+    int errflg;
+    EnviCacheStats stats;
+    const char *stats_fields[] = {"capacity","block_size","nblocks",
+        "bytes_cached","hits","misses","bytes_hit","bytes_miss",
+        "bytes_bypass","evictions","invalidations"};
 
-    sz_li = (long int) sz;
+    if(nrhs < 2 || !mxIsChar(prhs[1])){
+        mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+            "'-cache' needs a command: 'configure', 'stats', or 'clear'");
+    }
+    cmd = mxArrayToString(prhs[1]);
+    if(strcmp(cmd,"configure")==0){
+        capacity = (nrhs > 2) ? mxGetScalar(prhs[2]) 
+                              : (double) ENVI_CACHE_CAPACITY_DEFAULT;
+        block_size = (nrhs > 3) ? mxGetScalar(prhs[3]) : 0;
+        if(!(capacity >= 0) || !(block_size >= 0)){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+                "capacity and block_size need to be nonnegative");
+        }
+        errflg = envi_cache_configure((size_t) capacity, (size_t) block_size);
+        if(errflg == -1){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+                "The block cache is not supported on this platform.");
+        } else if(errflg == -5){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+                "Memory allocation failed.");
+        }
+        if(capacity > 0 && !envi_cache_locked){
+            mexLock();
+            envi_cache_locked = true;
+        } else if(capacity == 0 && envi_cache_locked){
+            mexUnlock();
+            envi_cache_locked = false;
+        }
+    } else if(strcmp(cmd,"clear")==0){
+        envi_cache_clear();
+    } else if(strcmp(cmd,"stats")!=0){
+        mxFree(cmd);
+        mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+            "'-cache' command is not valid");
+    }
+    mxFree(cmd);
 
-    fid = fopen(imgpath,"rb");
-    if(fid==NULL){
-        return -1;
+    /* every command returns the statistics */
+    if(nlhs > 0){
+        envi_cache_get_stats(&stats);
+        plhs[0] = mxCreateStructMatrix(1,1,11,stats_fields);
+        mxSetField(plhs[0],0,"capacity",mxCreateDoubleScalar((double) stats.capacity));
+        mxSetField(plhs[0],0,"block_size",mxCreateDoubleScalar((double) stats.block_size));
+        mxSetField(plhs[0],0,"nblocks",mxCreateDoubleScalar((double) stats.nblocks));
+        mxSetField(plhs[0],0,"bytes_cached",mxCreateDoubleScalar((double) stats.nbytes));
+        mxSetField(plhs[0],0,"hits",mxCreateDoubleScalar((double) stats.hits));
+        mxSetField(plhs[0],0,"misses",mxCreateDoubleScalar((double) stats.misses));
+        mxSetField(plhs[0],0,"bytes_hit",mxCreateDoubleScalar((double) stats.bytes_hit));
+        mxSetField(plhs[0],0,"bytes_miss",mxCreateDoubleScalar((double) stats.bytes_miss));
+        mxSetField(plhs[0],0,"bytes_bypass",mxCreateDoubleScalar((double) stats.bytes_bypass));
+        mxSetField(plhs[0],0,"evictions",mxCreateDoubleScalar((double) stats.evictions));
+        mxSetField(plhs[0],0,"invalidations",mxCreateDoubleScalar((double) stats.invalidations));
     }
-    /* Evaluate if the image header have valid information of the image */
-    header_offset = (long int) hdr.header_offset;
-    fseek(fid, 0L, SEEK_END);
-    szfile = ftell(fid);
-    /* If the image file size is less than the size indicated by the header
-     * then return an error. */
-    if(szfile < (long int) hdr.samples * (long int) hdr.lines * (long int) hdr.bands * sz_li + header_offset){
-        fclose(fid);
-        return -2;
+}
+
+static void envi_files_command(int nlhs, mxArray *plhs[], int nrhs, 
+        const mxArray *prhs[])
+{
+    char *cmd, *path;
+    double capacity;
+    EnviFilePoolStats stats;
+    const char *stats_fields[] = {"capacity","nopen","hits","misses",
+        "reopens","evictions"};
+
+    if(nrhs < 2 || !mxIsChar(prhs[1])){
+        mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+            "'-files' needs a command: 'configure', 'stats', 'close', or 'flush'");
     }
-    fseek(fid, header_offset, SEEK_SET);
-    
-    /* Evaluate interleave option */
-    switch(hdr.interleave){
-        case BSQ :
-            d1 = (long int) hdr.samples;
-            d1_skipszlist = smpl_skipszlist;
-            d1_readszlist = smpl_readszlist;
-            N_d1_skipread = N_smpl_skipread;
-            d1_skip_last   = smpl_skip_last;
-
-            d2 = (long int) hdr.lines;
-            d2_skipszlist = line_skipszlist;
-            d2_readszlist = line_readszlist;
-            N_d2_skipread = N_line_skipread;
-            d2_skip_last   = line_skip_last;
-            
-            d3 = (long int) hdr.bands;
-            d3_skipszlist = band_skipszlist;
-            d3_readszlist = band_readszlist;
-            N_d3_skipread = N_band_skipread;
-            d3_skip_last   = band_skip_last;
+    cmd = mxArrayToString(prhs[1]);
+    if(strcmp(cmd,"configure")==0){
+        capacity = (nrhs > 2) ? mxGetScalar(prhs[2]) 
+                              : (double) ENVI_FILEPOOL_SIZE;
+        if(!(capacity >= 0)){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+                "capacity needs to be nonnegative");
+        }
+        envi_filepool_configure((size_t) capacity);
+    } else if(strcmp(cmd,"close")==0){
+        if(nrhs < 3 || !mxIsChar(prhs[2])){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+                "'close' needs the path of the image file");
+        }
+        path = mxArrayToString(prhs[2]);
+        envi_filepool_close(path);
+        mxFree(path);
+    } else if(strcmp(cmd,"flush")==0){
+        envi_filepool_flush();
+    } else if(strcmp(cmd,"stats")!=0){
+        mxFree(cmd);
+        mexErrMsgIdAndTxt("envi:mxEnviControlCommand",
+            "'-files' command is not valid");
+    }
+    mxFree(cmd);
 
-            break;
+    if(nlhs > 0){
+        envi_filepool_get_stats(&stats);
+        plhs[0] = mxCreateStructMatrix(1,1,6,stats_fields);
+        mxSetField(plhs[0],0,"capacity",mxCreateDoubleScalar((double) stats.capacity));
+        mxSetField(plhs[0],0,"nopen",mxCreateDoubleScalar((double) stats.nopen));
+        mxSetField(plhs[0],0,"hits",mxCreateDoubleScalar((double) stats.hits));
+        mxSetField(plhs[0],0,"misses",mxCreateDoubleScalar((double) stats.misses));
+        mxSetField(plhs[0],0,"reopens",mxCreateDoubleScalar((double) stats.reopens));
+        mxSetField(plhs[0],0,"evictions",mxCreateDoubleScalar((double) stats.evictions));
+    }
+}
 
-        case BIL :
-            d1 = (long int) hdr.samples;
-            d1_skipszlist = smpl_skipszlist;
-            d1_readszlist = smpl_readszlist;
-            N_d1_skipread = N_smpl_skipread;
-            d1_skip_last   = smpl_skip_last;
-            
-            d2 = (long int) hdr.bands;
-            d2_skipszlist = band_skipszlist;
-            d2_readszlist = band_readszlist;
-            N_d2_skipread = N_band_skipread;
-            d2_skip_last   = band_skip_last;
-            
-            d3 = (long int) hdr.lines;
-            d3_skipszlist = line_skipszlist;
-            d3_readszlist = line_readszlist;
-            N_d3_skipread = N_line_skipread;
-            d3_skip_last   = line_skip_last;
+bool mxEnviControlCommand(int nlhs, mxArray *plhs[], int nrhs, 
+        const mxArray *prhs[])
+{
+    char *cmd;
+    bool is_cache, is_files;
 
-            break;
+    /* the readers leave files open in the pool across calls */
+    mexAtExit(envi_mex_at_exit);
+    if(nrhs < 1 || !mxIsChar(prhs[0]))
+        return false;
+    cmd = mxArrayToString(prhs[0]);
+    is_cache = (cmd != NULL && strcmp(cmd,"-cache") == 0);
+    is_files = (cmd != NULL && strcmp(cmd,"-files") == 0);
+    mxFree(cmd);
+    if(is_cache)
+        envi_cache_command(nlhs, plhs, nrhs, prhs);
+    else if(is_files)
+        envi_files_command(nlhs, plhs, nrhs, prhs);
+    return is_cache || is_files;
+}
 
-        case BIP :
-            d1 = (long int) hdr.bands;
-            d1_skipszlist = band_skipszlist;
-            d1_readszlist = band_readszlist;
-            N_d1_skipread = N_band_skipread;
-            d1_skip_last   = band_skip_last;
-            
-            d2 = (long int) hdr.samples;
-            d2_skipszlist = smpl_skipszlist;
-            d2_readszlist = smpl_readszlist;
-            N_d2_skipread = N_smpl_skipread;
-            d2_skip_last   = smpl_skip_last;
-            
-            d3 = (long int) hdr.lines;
-            d3_skipszlist = line_skipszlist;
-            d3_readszlist = line_readszlist;
-            N_d3_skipread = N_line_skipread;
-            d3_skip_last   = line_skip_last;
-            
-            break;
-            
+
+mxClassID envi_data_type_to_mxClassID(int32_t data_type)
+{
+    switch(data_type){
+        case 1:  return mxUINT8_CLASS;
+        case 2:  return mxINT16_CLASS;
+        case 3:  return mxINT32_CLASS;
+        case 4:  case 6: return mxSINGLE_CLASS;
+        case 5:  case 9: return mxDOUBLE_CLASS;
+        case 12: return mxUINT16_CLASS;
+        case 13: return mxUINT32_CLASS;
+        case 14: return mxINT64_CLASS;
+        case 15: return mxUINT64_CLASS;
+        case 16: return mxINT8_CLASS;
+        default: return mxUNKNOWN_CLASS;
     }
+}
 
-    /* read the data from the file */
-    N = d1*d2;
-    ncpy = N * sz;
-    buf = malloc(ncpy);
-    subimg_offset = 0;
-    for(i=0;i<N_d3_skipread;i++){
-        // printf("i=%d\n",i);
-        fseek(fid,d1*d2*d3_skipszlist[i]*sz_li,SEEK_CUR);
-        for(ii=0;ii<d3_readszlist[i];ii++){
-            fread(buf,sz,N,fid);
-            curskip = 0;
-            for(j=0;j<N_d2_skipread;j++){
-                // printf("j=%d\n",j);
-                curskip += d1*d2_skipszlist[j]*sz_li;
-                for(jj=0;jj<d2_readszlist[j];jj++){
-                    for(k=0;k<N_d1_skipread;k++){
-                        // printf("k=%d\n",k);
-                        curskip += d1_skipszlist[k]*sz_li;
-                        memcpy(subimg+subimg_offset,buf+curskip,d1_readszlist[k]*sz);
-                        subimg_offset += d1_readszlist[k]*sz;
-                        curskip += d1_readszlist[k]*sz_li;
-                        /* for(kk=0;kk<d1_readszlist[k];kk++){
-                            *(subimg+subimg_offset) = *(buf+curskip);
-                            subimg_offset++;
-                            curskip++;
-                        } */
-                    }
-                    curskip += d1_skip_last*sz_li;
-                }
-            }
-        }
+#if !MX_HAS_INTERLEAVED_COMPLEX
+void split_complex_mxArray(mxArray *mx, const void *cx, size_t szpart)
+{
+    size_t i, N;
+    const char *cx_c = (const char*) cx;
+    char *re, *im;
+
+    N  = mxGetNumberOfElements(mx);
+    re = (char*) mxGetData(mx);
+    im = (char*) mxGetImagData(mx);
+    for(i=0;i<N;i++){
+        memcpy(re+i*szpart, cx_c+2*i*szpart, szpart);
+        memcpy(im+i*szpart, cx_c+(2*i+1)*szpart, szpart);
+    }
+}
+#endif
+
+mxArray *mxCreateEnviIOPlanStats(const EnviIOPlanStats *stats)
+{
+    const char *io_stats_fields[] = {"n_syscalls","n_copies","bytes_read","bytes_used"};
+    mxArray *pm;
+
+    pm = mxCreateStructMatrix(1,1,4,io_stats_fields);
+    mxSetField(pm,0,"n_syscalls",mxCreateDoubleScalar((double) stats->n_syscalls));
+    mxSetField(pm,0,"n_copies",mxCreateDoubleScalar((double) stats->n_copies));
+    mxSetField(pm,0,"bytes_read",mxCreateDoubleScalar((double) stats->nbytes_read));
+    mxSetField(pm,0,"bytes_used",mxCreateDoubleScalar((double) stats->nbytes_used));
+    return pm;
+}
+
+void mxEnviErrMsg(const char *mexname, int errflg, const char *imgpath)
+{
+    char id[256];
+
+    switch(errflg){
+        case 0:
+            return;
+        case ENVI_ERR_OPEN:
+            snprintf(id, sizeof(id), "%s:FileOpenError", mexname);
+            mexErrMsgIdAndTxt(id, "File: %s does not exist.", imgpath);
+            break;
+        case ENVI_ERR_SIZE:
+            snprintf(id, sizeof(id), "%s:FileSizeInvalid", mexname);
+            mexErrMsgIdAndTxt(id, "FileSize is incorrect.");
+            break;
+        case ENVI_ERR_MMAP:
+            snprintf(id, sizeof(id), "%s:MemoryMapError", mexname);
+            mexErrMsgIdAndTxt(id, "File: %s cannot be memory-mapped.", 
+                imgpath);
+            break;
+        case ENVI_ERR_READ:
+            snprintf(id, sizeof(id), "%s:FileReadError", mexname);
+            mexErrMsgIdAndTxt(id, "Failed to read File: %s.", imgpath);
+            break;
+        case ENVI_ERR_NOMEM:
+            snprintf(id, sizeof(id), "%s:OutOfMemory", mexname);
+            mexErrMsgIdAndTxt(id, 
+                "Failed to allocate memory for reading File: %s.", imgpath);
+            break;
+        default:
+            snprintf(id, sizeof(id), "%s:UnknownError", mexname);
+            mexErrMsgIdAndTxt(id, "%s (%d).", envi_strerror(errflg), errflg);
+            break;
     }
-    free(buf);
-    fclose(fid);
-    
-    return 0;
 }
 
-int image_byteswapFloat(float *img, size_t *dims_img, int32_t byte_order)
+/* function : envi_handle_register
+ *  Keep obj of kind across the calls and return its handle. obj is freed
+ *  if it cannot be registered. */
+static double envi_handle_register(void *obj, EnviMexHandleKind kind)
 {
-    float swapped;
-    bool computer_isLSBF;
-    bool data_isLSBF;
-    bool swap_necessary;
-    size_t N,i;
-
-    /* Evaluate the endians of the computer and image data. */
-    computer_isLSBF = isComputerLSBF();
-    data_isLSBF = !((bool) byte_order);
-    swap_necessary = (computer_isLSBF != data_isLSBF);
-
-    /* Swap bytes if necessary */
-    if(swap_necessary){
-        N = dims_img[0]*dims_img[1]*dims_img[2];
-        for(i=0;i<N;i++){
-            swapped = swapFloat(img[i]);
-            img[i] = swapped;
+    void **objs;
+    EnviMexHandleKind *kinds;
+    double *ids;
+    size_t cap;
+
+    if(envi_handles_n == envi_handles_cap){
+        cap = (envi_handles_cap > 0) ? 2*envi_handles_cap : 8;
+        objs = (void**) realloc(envi_handle_objs, cap*sizeof(void*));
+        if(objs != NULL)
+            envi_handle_objs = objs;
+        kinds = (EnviMexHandleKind*) realloc(envi_handle_kinds,
+                    cap*sizeof(EnviMexHandleKind));
+        if(kinds != NULL)
+            envi_handle_kinds = kinds;
+        ids = (double*) realloc(envi_handle_ids, cap*sizeof(double));
+        if(ids != NULL)
+            envi_handle_ids = ids;
+        if(objs == NULL || kinds == NULL || ids == NULL){
+            envi_handle_obj_free(obj, kind);
+            mexErrMsgIdAndTxt("envi:mxEnviHandleRegister",
+                "Memory allocation failed.");
         }
+        envi_handles_cap = cap;
     }
+    if(envi_handles_n == 0)
+        mexLock();
+    envi_handle_objs[envi_handles_n] = obj;
+    envi_handle_kinds[envi_handles_n] = kind;
+    envi_handle_ids[envi_handles_n] = ++envi_handle_last_id;
+    envi_handles_n++;
+    return envi_handle_last_id;
+}
+
+/* function : envi_handle_find
+ *  Index of the object of kind with the handle pm, or envi_handles_n if
+ *  there is none. */
+static size_t envi_handle_find(const mxArray *pm, EnviMexHandleKind kind)
+{
+    double id;
+    size_t k;
 
-    return 0;
+    if(!mxIsDouble(pm) || mxGetNumberOfElements(pm) != 1 || mxIsComplex(pm))
+        return envi_handles_n;
+    id = mxGetScalar(pm);
+    for(k=0;k<envi_handles_n;k++)
+        if(envi_handle_ids[k] == id && envi_handle_kinds[k] == kind)
+            return k;
+    return envi_handles_n;
 }
 
-int image_byteswapInt16(int16_t *img, size_t *dims_img, int32_t byte_order)
+static void envi_handle_release(const mxArray *pm, EnviMexHandleKind kind)
 {
-    int16_t swapped;
-    bool computer_isLSBF;
-    bool data_isLSBF;
-    bool swap_necessary;
-    size_t N,i;
-
-    /* Evaluate the endians of the computer and image data. */
-    computer_isLSBF = isComputerLSBF();
-    data_isLSBF = !((bool) byte_order);
-    swap_necessary = (computer_isLSBF != data_isLSBF);
-
-    /* Swap bytes if necessary */
-    if(swap_necessary){
-        N = dims_img[0]*dims_img[1]*dims_img[2];
-        for(i=0;i<N;i++){
-            swapped = (img[i]<<8) | ((img[i]>>8) & 0xFF);
-            img[i] = swapped;
-        }
+    size_t k;
+
+    k = envi_handle_find(pm, kind);
+    if(k == envi_handles_n)
+        return;
+    envi_handle_obj_free(envi_handle_objs[k], kind);
+    envi_handles_n--;
+    envi_handle_objs[k] = envi_handle_objs[envi_handles_n];
+    envi_handle_kinds[k] = envi_handle_kinds[envi_handles_n];
+    envi_handle_ids[k] = envi_handle_ids[envi_handles_n];
+    if(envi_handles_n == 0)
+        mexUnlock();
+}
+
+double mxEnviReadPlanRegister(EnviReadPlan *rp)
+{
+    return envi_handle_register(rp, ENVI_HANDLE_READPLAN);
+}
+
+EnviReadPlan *mxGetEnviReadPlan(const mxArray *pm)
+{
+    size_t k;
+
+    k = envi_handle_find(pm, ENVI_HANDLE_READPLAN);
+    if(k == envi_handles_n){
+        mexErrMsgIdAndTxt("envi:InvalidReadPlan",
+            "The handle is not a prepared read of this MEX file.");
     }
-    return 0;
+    return (EnviReadPlan*) envi_handle_objs[k];
 }
 
-int image_byteswapUint16(uint16_t *img, size_t *dims_img, int32_t byte_order)
+void mxEnviReadPlanRelease(const mxArray *pm)
 {
-    uint16_t swapped;
-    bool computer_isLSBF;
-    bool data_isLSBF;
-    bool swap_necessary;
-    size_t N,i;
-
-    /* Evaluate the endians of the computer and image data. */
-    computer_isLSBF = isComputerLSBF();
-    data_isLSBF = !((bool) byte_order);
-    swap_necessary = (computer_isLSBF != data_isLSBF);
-
-    /* Swap bytes if necessary */
-    if(swap_necessary){
-        N = dims_img[0]*dims_img[1]*dims_img[2];
-        for(i=0;i<N;i++){
-            swapped = (img[i]<<8) | (img[i]>>8);
-            img[i] = swapped;
-        }
+    envi_handle_release(pm, ENVI_HANDLE_READPLAN);
+}
+
+double mxEnviTileIterRegister(EnviTileIter *it)
+{
+    return envi_handle_register(it, ENVI_HANDLE_TILEITER);
+}
+
+EnviTileIter *mxGetEnviTileIter(const mxArray *pm)
+{
+    size_t k;
+
+    k = envi_handle_find(pm, ENVI_HANDLE_TILEITER);
+    if(k == envi_handles_n){
+        mexErrMsgIdAndTxt("envi:InvalidTileIter",
+            "The handle is not a tile iterator of this MEX file.");
     }
+    return (EnviTileIter*) envi_handle_objs[k];
+}
 
-    return 0;
+void mxEnviTileIterRelease(const mxArray *pm)
+{
+    envi_handle_release(pm, ENVI_HANDLE_TILEITER);
 }
@@ -0,0 +1,156 @@
+/* =====================================================================
+ * envihdrreadx_mex.c
+ * Read an ENVI header file into a struct, the native counterpart of the
+ * parsing loop of envihdrreadx2.m. The whole file is read at once and
+ * tokenized in one pass; numbers are parsed with the fast float parser of
+ * envi_hdr.c.
+ *
+ * INPUTS:
+ * 0 hdrpath          char*
+ *
+ *
+ * OUTPUTS:
+ * 0  hdr struct, one field per parameter in the order of the file:
+ *      char for strings, double for numbers, a [N x 1] cell of char for
+ *      a multi-line description, a [1 x N] cell of char for band_names
+ *      and spectra_names and a [1 x N] double for wavelength, fwhm,
+ *      default_bands and bbl (and for a number with commas, split at
+ *      the commas as str2num does). map_info, pixel_size and
+ *      coordinate_system_string are left as strings (envihdrreadx2.m
+ *      converts them).
+ *    Field names are converted as in envihdrreadx2.m, and a name that
+ *    is not a valid MATLAB field name is an error, as it is there.
+ *
+ *
+ * This is a MEX file for MATLAB.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include "io64.h"
+#include "mex.h"
+#include "matrix.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_hdr.h"
+
+/* function : envi_hdr_field_to_mxArray
+ *  MATLAB value of the header field f. */
+static mxArray *envi_hdr_field_to_mxArray(const EnviHdrField *f)
+{
+    mxArray *val;
+    size_t i;
+
+    switch(f->type){
+        case ENVI_HDR_NUMBER:
+            val = mxCreateDoubleScalar(f->num);
+            break;
+        case ENVI_HDR_LINES:
+            val = mxCreateCellMatrix((mwSize) f->nstrs, 1);
+            for(i=0;i<f->nstrs;i++)
+                mxSetCell(val, (mwIndex) i, mxCreateString(f->strs[i]));
+            break;
+        case ENVI_HDR_STRINGS:
+            val = mxCreateCellMatrix(1, (mwSize) f->nstrs);
+            for(i=0;i<f->nstrs;i++)
+                mxSetCell(val, (mwIndex) i, mxCreateString(f->strs[i]));
+            break;
+        case ENVI_HDR_NUMBERS:
+            val = mxCreateDoubleMatrix(1, (mwSize) f->nnums, mxREAL);
+            memcpy(mxGetPr(val), f->nums, f->nnums*sizeof(double));
+            break;
+        default:
+            val = mxCreateString(f->str);
+            break;
+    }
+    return val;
+}
+
+/* function : envi_hdr_is_field_name
+ *  Evaluate if name is a valid MATLAB field name. */
+static bool envi_hdr_is_field_name(const char *name)
+{
+    const char *p;
+
+    if(!((name[0] >= 'a' && name[0] <= 'z')
+            || (name[0] >= 'A' && name[0] <= 'Z')))
+        return false;
+    for(p=name+1;*p!='\0';p++){
+        if(!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')
+                || (*p >= '0' && *p <= '9') || *p == '_'))
+            return false;
+    }
+    return true;
+}
+
+/* the gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    char *hdrpath;
+    EnviHdr hdr;
+    char name[ENVI_HDR_NAME_MAX+1];
+    size_t i;
+    int errflg;
+
+    /* -----------------------------------------------------------------
+     * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
+     * ----------------------------------------------------------------- */
+    if(nrhs!=1) {
+        mexErrMsgIdAndTxt("envihdrreadx_mex:nrhs","One input required.");
+    }
+    if(nlhs>1) {
+        mexErrMsgIdAndTxt("envihdrreadx_mex:nlhs","One output required.");
+    }
+    if( !mxIsChar(prhs[0]) ) {
+        mexErrMsgIdAndTxt("envihdrreadx_mex:notChar",
+                "Input 0 (hdrpath) needs to be a string.");
+    }
+
+    /* -----------------------------------------------------------------
+     * CALL MAIN COMPUTATION ROUTINE
+     * ----------------------------------------------------------------- */
+    hdrpath = mxArrayToString(prhs[0]);
+    errflg = envi_hdr_read(&hdr, hdrpath);
+    if(errflg == -1){
+        mexErrMsgIdAndTxt("envihdrreadx_mex:fopen",
+                "Cannot open %s.", hdrpath);
+    } else if(errflg == -4){
+        mexErrMsgIdAndTxt("envihdrreadx_mex:fread",
+                "Error while reading %s.", hdrpath);
+    } else if(errflg != 0){
+        mexErrMsgIdAndTxt("envihdrreadx_mex:OutOfMemory",
+                "Out of memory while parsing %s.", hdrpath);
+    }
+    mxFree(hdrpath);
+
+    /* -----------------------------------------------------------------
+     * OUTPUT
+     * ----------------------------------------------------------------- */
+    plhs[0] = mxCreateStructMatrix(1, 1, 0, NULL);
+    for(i=0;i<hdr.nfields;i++){
+        /* hdr.(param) of envihdrreadx2.m fails on the same names */
+        if(!envi_hdr_is_field_name(hdr.fields[i].name)
+                || mxAddField(plhs[0], hdr.fields[i].name) < 0){
+            strcpy(name, hdr.fields[i].name);
+            envi_hdr_free(&hdr);
+            mexErrMsgIdAndTxt("envihdrreadx_mex:InvalidFieldName",
+                "Invalid field name \"%s\".", name);
+        }
+        mxSetField(plhs[0], 0, hdr.fields[i].name,
+            envi_hdr_field_to_mxArray(&hdr.fields[i]));
+    }
+    envi_hdr_free(&hdr);
+}
@@ -0,0 +1,175 @@
+/* =====================================================================
+ * img_proj_w_glt_mex.c
+ * Project an image cube or a band stack in memory through a geometric
+ * lookup table (GLT). The output lines are split across threads.
+ *
+ * INPUTS:
+ * 0 img           numeric or logical array [L x S x B], source image
+ * 1 glt_x         double array [Lo x So], source samples of the projected
+ *                 pixels (1-based)
+ * 2 glt_y         double array [Lo x So], source lines of the projected
+ *                 pixels (1-based)
+ *                 Pixels whose glt_x or glt_y is out of the source image
+ *                 (0, NaN, ...) have no source.
+ * 3 fill          scalar of the class of img, value of the pixels without
+ *                 a source
+ * 4 neg_abs       logical scalar (optional), whether negative GLT entries
+ *                 (pixels ENVI filled with their nearest neighbor) refer
+ *                 to the source pixel of their absolute value (true) or
+ *                 have no source (false). (default) false
+ * 5 num_threads   integer (optional), number of threads (0: automatic)
+ *
+ * OUTPUTS:
+ * 0 img_proj      array [Lo x So x B] of the class of img.
+ *
+ *
+ * This is a MEX file for MATLAB.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include "io64.h"
+#include "mex.h"
+#include "matrix.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_v2.h"
+#include "envi_ioplan.h"
+#include "envi_glt.h"
+
+/* The gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    mwSize ndim;
+    const mwSize *dims_in;
+    mwSize dims_out[3];
+    size_t L, S, B, Lo, So, npix, sz, szpart, num_threads;
+    double *glt_x, *glt_y;
+    bool neg_abs;
+    char fill[16];
+    size_t *srcidx;
+    EnviGLTBox box;
+    int errflg;
+
+    /* -----------------------------------------------------------------
+     * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
+     * ----------------------------------------------------------------- */
+    if(nrhs<4 || nrhs>6) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:nrhs",
+                "Four to six inputs required.");
+    }
+    if(nlhs>1) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:nlhs",
+                "One output required.");
+    }
+    if( !mxIsNumeric(prhs[0]) && !mxIsLogical(prhs[0]) ) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:notNumeric",
+                "Input 0 (img) needs to be a numeric or logical array.");
+    }
+    if( !mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2]) ) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:notDouble",
+                "Inputs 1 (glt_x) and 2 (glt_y) need to be double arrays.");
+    }
+    if( mxGetNumberOfDimensions(prhs[1]) != 2
+            || mxGetNumberOfDimensions(prhs[2]) != 2
+            || mxGetM(prhs[1]) != mxGetM(prhs[2])
+            || mxGetN(prhs[1]) != mxGetN(prhs[2]) ) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:SizeMismatch",
+                "Inputs 1 (glt_x) and 2 (glt_y) need to be matrices of the same size.");
+    }
+    if( mxGetClassID(prhs[3]) != mxGetClassID(prhs[0])
+            || mxGetNumberOfElements(prhs[3]) != 1 || mxIsComplex(prhs[3]) ) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:InvalidFill",
+                "Input 3 (fill) needs to be a real scalar of the class of img.");
+    }
+    ndim = mxGetNumberOfDimensions(prhs[0]);
+    if(ndim > 3) {
+        mexErrMsgIdAndTxt(
+                "img_proj_w_glt_mex:DimensionMismatch",
+                "Input 0 (img) needs to have at most three dimensions.");
+    }
+
+    /* -----------------------------------------------------------------
+     * I/O SETUPs
+     * ----------------------------------------------------------------- */
+    dims_in = mxGetDimensions(prhs[0]);
+    L = (size_t) dims_in[0];
+    S = (size_t) dims_in[1];
+    B = (ndim > 2) ? (size_t) dims_in[2] : 1;
+    Lo = (size_t) mxGetM(prhs[1]);
+    So = (size_t) mxGetN(prhs[1]);
+    npix = Lo * So;
+    glt_x = (double*) mxGetData(prhs[1]);
+    glt_y = (double*) mxGetData(prhs[2]);
+    neg_abs = (nrhs>4) ? mxIsLogicalScalarTrue(prhs[4]) : false;
+    num_threads = (nrhs>5) ? (size_t) mxGetScalar(prhs[5]) : 0;
+    num_threads = envi_get_num_threads(num_threads, Lo);
+
+    dims_out[0] = (mwSize) Lo;
+    dims_out[1] = (mwSize) So;
+    dims_out[2] = (mwSize) B;
+    plhs[0] = mxCreateNumericArray(3, dims_out, mxGetClassID(prhs[0]),
+        mxIsComplex(prhs[0]) ? mxCOMPLEX : mxREAL);
+    if(mxIsEmpty(plhs[0]))
+        return;
+
+    /* -----------------------------------------------------------------
+     * CALL MAIN COMPUTATION ROUTINE
+     * ----------------------------------------------------------------- */
+    srcidx = (size_t*) malloc(npix*sizeof(size_t));
+    if(srcidx == NULL){
+        mexErrMsgIdAndTxt("img_proj_w_glt_mex:OutOfMemory",
+            "Memory allocation failed.");
+    }
+    /* the source image is whole, so the box is the image itself. */
+    box.smpl0 = 0; box.smpl1 = (S > 0) ? S-1 : 0;
+    box.line0 = 0; box.line1 = (L > 0) ? L-1 : 0;
+    envi_glt_index(srcidx, glt_x, glt_y, npix, S, L, neg_abs, &box);
+
+    szpart = mxGetElementSize(prhs[3]);
+    memcpy(fill, mxGetData(prhs[3]), szpart);
+#if MX_HAS_INTERLEAVED_COMPLEX
+    /* complex elements are projected as a whole (mxGetElementSize counts
+     * both parts), with fill in both parts. */
+    sz = mxGetElementSize(prhs[0]);
+    if(sz > szpart)
+        memcpy(fill + szpart, fill, szpart);
+    errflg = envi_glt_project((char*) mxGetData(plhs[0]), Lo, So,
+        (const char*) mxGetData(prhs[0]), L*S, srcidx, B, sz, fill,
+        num_threads);
+#else
+    sz = szpart;
+    errflg = envi_glt_project((char*) mxGetData(plhs[0]), Lo, So,
+        (const char*) mxGetData(prhs[0]), L*S, srcidx, B, sz, fill,
+        num_threads);
+    if(errflg==0 && mxIsComplex(prhs[0])){
+        errflg = envi_glt_project((char*) mxGetImagData(plhs[0]), Lo, So,
+            (const char*) mxGetImagData(prhs[0]), L*S, srcidx, B, sz, fill,
+            num_threads);
+    }
+#endif
+    free(srcidx);
+    if(errflg == -5){
+        mexErrMsgIdAndTxt("img_proj_w_glt_mex:OutOfMemory",
+            "Memory allocation failed.");
+    }
+}
@@ -0,0 +1,277 @@
+/* =====================================================================
+ * lazyenvireadGLTProjx_multBandRaster_mex.c
+ * Project an image cube of any ENVI data_type (1-6, 9, 12-16) through a
+ * geometric lookup table (GLT) directly from its file.
+ * This function is endian free. The image data needs to be a binary image.
+ * Only the bounding box of the source pixels is read, a group of bands at
+ * a time, and each group is projected with threads across the output 
+ * lines, so the unprojected cube is never held in memory as a whole.
+ *
+ * INPUTS:
+ * 0 imgpath          char*
+ * 1 header           struct for Envi Header
+ * 2 glt_x            double array [L x S], source samples of the 
+ *                    projected pixels (1-based)
+ * 3 glt_y            double array [L x S], source lines of the projected
+ *                    pixels (1-based)
+ *                    Pixels whose glt_x or glt_y is out of the source 
+ *                    image (e.g., 0 or NaN) have no source.
+ * 4 band_skipszlist  double vector
+ * 5 band_readszlist  double vector
+ * 6 read_opt         struct (optional), read options
+ *     read_mode  : 'fread', 'mmap', 'pread' (see 
+ *                  lazyenvireadRectxv2_multBandRaster_mex.c)
+ *     num_threads: number of threads (0: automatic)
+ *     coalesce_gap: gap (bytes) below which neighboring runs are merged
+ *                   into one read
+ *     precision  : class of the output ('double', 'single', 'int8', ...,
+ *                  'uint64'), or 'raw' for the class of data_type.
+ *     replace_div: whether or not to replace data_ignore_value in header
+ *                  with repval_div while reading (default false)
+ *     repval_div : value replacing data_ignore_value (default NaN)
+ *     fill_value : value of the pixels without a source (default NaN)
+ *     glt_neg_abs: whether negative GLT entries (pixels ENVI filled 
+ *                  with their nearest neighbor) refer to the source pixel
+ *                  of their absolute value (true) or have no source 
+ *                  (false). (default false)
+ *
+ *
+ * OUTPUTS:
+ * 0  img_proj [L x S x bands] array of the class of precision (data_type 
+ *    if 'raw'). Complex data types (6 and 9) are returned as complex 
+ *    single/double arrays.
+ *
+ *
+ * The block cache and the pool of open image files shared by the calls to
+ * this MEX file are controlled with ('-cache', ...) and ('-files', ...) 
+ * instead of the inputs above (see mxEnviControlCommand in envi_v2.h, 
+ * envi_block_cache.m and envi_file_pool.m).
+ *
+ * This is a MEX file for MATLAB.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include "io64.h"
+#include "mex.h"
+#include "matrix.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_v2.h"
+
+/* The gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    char *imgpath;
+    EnviHeader hdr;
+    EnviReadOption read_opt;
+    EnviCopyKernel kernel;
+    double *glt_x, *glt_y;
+    double fillval;
+    bool neg_abs;
+    mxArray *pm_fill;
+    double *band_skipszlist_dbl, *band_readszlist_dbl;
+    long int *band_skipszlist;
+    size_t   *band_readszlist;
+    size_t N_band_skipread, i;
+    size_t bandsc;
+    long int band_skips, band_skip_last;
+    void *img_proj;
+    size_t sz;
+    mwSize dims[3];
+    int errflg;
+
+    /* control commands, e.g. ('-cache','stats') */
+    if(mxEnviControlCommand(nlhs, plhs, nrhs, prhs))
+        return;
+
+    /* -----------------------------------------------------------------
+     * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
+     * ----------------------------------------------------------------- */
+    if(nrhs!=6 && nrhs!=7) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:nrhs",
+                "Six or seven inputs required.");
+    }
+    if(nlhs>1) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:nlhs",
+                "One output required.");
+    }
+    if( !mxIsChar(prhs[0]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notChar",
+                "Input 0 (imgpath) needs to be a string.");
+    }
+    if( !mxIsStruct(prhs[1]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notStruct",
+                "Input 1 (ENVI header) needs to be a struct.");
+    }
+    if( !mxIsDouble(prhs[2]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notDouble",
+                "Input 2 (glt_x) needs to be a double array.");
+    }
+    if( !mxIsDouble(prhs[3]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notDouble",
+                "Input 3 (glt_y) needs to be a double array.");
+    }
+    if( !mxIsDouble(prhs[4]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notDouble",
+                "Input 4 (band_skipszlist) needs to be a double vector.");
+    }
+    if( !mxIsDouble(prhs[5]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notDouble",
+                "Input 5 (band_readszlist) needs to be a double vector.");
+    }
+    if( nrhs>6 && !mxIsStruct(prhs[6]) && !mxIsEmpty(prhs[6]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:notStruct",
+                "Input 6 (read_opt) needs to be a struct.");
+    }
+    if( mxGetNumberOfDimensions(prhs[2]) != 2 
+            || mxGetNumberOfDimensions(prhs[3]) != 2
+            || mxGetM(prhs[2]) != mxGetM(prhs[3]) 
+            || mxGetN(prhs[2]) != mxGetN(prhs[3]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:SizeMismatch",
+                "Inputs 2 (glt_x) and 3 (glt_y) need to be matrices of the same size.");
+    }
+    if( mxGetNumberOfElements(prhs[4]) != mxGetNumberOfElements(prhs[5]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:SizeMismatch",
+                "Inputs 4 (band_skipszlist) and 5 (band_readszlist) need to have the same number of elements.");
+    }
+
+    /* -----------------------------------------------------------------
+     * I/O SETUPs
+     * ----------------------------------------------------------------- */
+
+    /* INPUT 0 imgpath */
+    imgpath = mxArrayToString(prhs[0]);
+
+    /* INPUT 1 msldem_header */
+    hdr = mxGetEnviHeader(prhs[1]);
+
+    /* INPUT 6 read_opt */
+    read_opt = mxGetEnviReadOption((nrhs>6) ? prhs[6] : NULL);
+
+    /* fill_value and glt_neg_abs of read_opt */
+    fillval = mxGetNaN();
+    neg_abs = false;
+    if(nrhs>6 && mxIsStruct(prhs[6])){
+        pm_fill = mxGetField(prhs[6],0,"fill_value");
+        if(pm_fill!=NULL && !mxIsEmpty(pm_fill))
+            fillval = mxGetScalar(pm_fill);
+        if(mxGetField(prhs[6],0,"glt_neg_abs")!=NULL 
+                && !mxIsEmpty(mxGetField(prhs[6],0,"glt_neg_abs")))
+            neg_abs = mxGetScalar(mxGetField(prhs[6],0,"glt_neg_abs")) != 0;
+    }
+
+    /* INPUT 2/3 glt_x/glt_y */
+    glt_x = (double*) mxGetData(prhs[2]);
+    glt_y = (double*) mxGetData(prhs[3]);
+
+    /* INPUT 4/5 band_skipszlist/band_readszlist */
+    N_band_skipread = (size_t) mxGetNumberOfElements(prhs[4]);
+    band_skipszlist_dbl = (double*) mxGetData(prhs[4]);
+    band_readszlist_dbl = (double*) mxGetData(prhs[5]);
+    band_skipszlist = (long int*) malloc( (size_t) N_band_skipread*sizeof(long int) );
+    band_readszlist = (size_t*) malloc( (size_t) N_band_skipread*sizeof(size_t) );
+    for(i=0;i<N_band_skipread;i++){
+        if(band_skipszlist_dbl[i] > -0.5){
+            band_skipszlist[i] = (long int) band_skipszlist_dbl[i];
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:"
+                "Invalid Value",
+                "Inputs 4 (band_skipszlist) have invalid values (needs to be nonnegative).");
+        }
+        if(band_readszlist_dbl[i] > -0.5){
+            band_readszlist[i] = (size_t) band_readszlist_dbl[i];
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadGLTProjx_multBandRaster_mex:"
+                "Invalid Value",
+                "Inputs 5 (band_readszlist) have invalid values (needs to be nonnegative).");
+        }
+    }
+    bandsc = 0; band_skips=0;
+    for(i=0;i<N_band_skipread;i++){
+        bandsc += band_readszlist[i];
+        band_skips += band_skipszlist[i];
+    }
+    band_skip_last = (long int) hdr.bands - band_skips - (long int) bandsc;
+    if(band_skip_last < 0){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadGLTProjx_multBandRaster_mex:"
+            "SizeInconsistent",
+            "Inputs 4 & 5 (band_skipszlist & band_readszlist) is inconsistent with the image size.");
+    }
+    dims[0] = (mwSize) mxGetM(prhs[2]);
+    dims[1] = (mwSize) mxGetN(prhs[2]);
+    dims[2] = (mwSize) bandsc;
+
+    /* -----------------------------------------------------------------
+     * CALL MAIN COMPUTATION ROUTINE
+     * ----------------------------------------------------------------- */
+    sz = envi_get_data_type_size(hdr.data_type);
+    if(sz==0){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadGLTProjx_multBandRaster_mex:"
+            "UnsupportedDataType",
+            "data_type=%d is not supported.",hdr.data_type);
+    }
+    envi_copy_kernel_init(&kernel, hdr, &read_opt, NULL);
+    plhs[0] = mxCreateNumericArray(3,dims,
+        envi_data_type_to_mxClassID(kernel.dst_type),
+        (kernel.ncomp==2) ? mxCOMPLEX : mxREAL);
+    if(mxIsEmpty(plhs[0])){
+        errflg = 0;
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        img_proj = mxGetData(plhs[0]);
+#else
+        if(mxIsComplex(plhs[0])){
+            img_proj = mxMalloc(mxGetNumberOfElements(plhs[0])*kernel.dst_sz);
+        } else {
+            img_proj = mxGetData(plhs[0]);
+        }
+#endif
+        errflg = lazyenvireadGLTProjx_multBand(imgpath, hdr, glt_x, glt_y,
+            (size_t) dims[0], (size_t) dims[1], neg_abs,
+            band_skipszlist, band_readszlist, N_band_skipread,
+            band_skip_last, fillval, img_proj, sz, &read_opt);
+#if !MX_HAS_INTERLEAVED_COMPLEX
+        if(mxIsComplex(plhs[0])){
+            if(errflg == 0)
+                split_complex_mxArray(plhs[0], img_proj, kernel.dst_sz/2);
+            mxFree(img_proj);
+        }
+#endif
+    }
+
+    mxEnviErrMsg("lazyenvireadGLTProjx_multBandRaster_mex", errflg, imgpath);
+
+    /* free memories */
+    mxFree(imgpath);
+    free(band_skipszlist);
+    free(band_readszlist);
+}
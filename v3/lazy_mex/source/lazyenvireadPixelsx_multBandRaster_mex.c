@@ -0,0 +1,289 @@
+/* =====================================================================
+ * lazyenvireadPixelsx_multBandRaster_mex.c
+ * Read the spectra of a list of pixels of an image cube of any ENVI
+ * data_type (1-6, 9, 12-16).
+ * This function is endian free. The image data needs to be a binary image.
+ * The pixels are sorted by their offset in the file and each distinct
+ * pixel is read once, with the reads of neighboring pixels coalesced.
+ *
+ * INPUTS:
+ * 0 imgpath          char*
+ * 1 header           struct for Envi Header
+ * 2 smpls            double vector, samples of the pixels (1-based)
+ * 3 lines            double vector, lines of the pixels (1-based), same
+ *                    number of elements as smpls
+ * 4 band_skipszlist  double vector
+ * 5 band_readszlist  double vector
+ * 6 read_opt         struct (optional), read options
+ *     coalesce_gap: gap (bytes) below which neighboring runs are merged
+ *                   into one read
+ *     precision  : class of the output ('double', 'single', 'int8', ...,
+ *                  'uint64'), or 'raw' for the class of data_type.
+ *     replace_div: whether or not to replace data_ignore_value in header
+ *                  with repval_div while reading (default false)
+ *     repval_div : value replacing data_ignore_value (default NaN)
+ *
+ *
+ * OUTPUTS:
+ * 0  spc [N x bands] array of the class of precision (data_type if
+ *    'raw'), the spectra in the order of the pixels given. Complex data
+ *    types (6 and 9) are returned as complex single/double arrays.
+ * 1  valid logical array (optional), same shape as spc, false where the
+ *    value in the file is data_ignore_value.
+ * 2  io_stats struct (optional), statistics of the I/O plans
+ *     n_syscalls : number of read syscalls
+ *     n_copies   : number of copies out of the staging buffer
+ *     bytes_read : number of bytes read from the file
+ *     bytes_used : number of bytes used in spc
+ *
+ *
+ * The block cache and the pool of open image files shared by the calls to
+ * this MEX file are controlled with ('-cache', ...) and ('-files', ...) 
+ * instead of the inputs above (see mxEnviControlCommand in envi_v2.h, 
+ * envi_block_cache.m and envi_file_pool.m).
+ *
+ * This is a MEX file for MATLAB.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include "io64.h"
+#include "mex.h"
+#include "matrix.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "envi_v2.h"
+
+/* The gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    char *imgpath;
+    EnviHeader hdr;
+    EnviReadOption read_opt;
+    EnviCopyKernel kernel;
+    EnviIOPlanStats io_stats;
+    double *smpls_dbl, *lines_dbl;
+    double *band_skipszlist_dbl, *band_readszlist_dbl;
+    size_t *smpls, *lines;
+    long int *band_skipszlist;
+    size_t   *band_readszlist;
+    size_t N_band_skipread, npix, i;
+    size_t bandsc;
+    long int band_skips, band_skip_last;
+    void *spc;
+    size_t sz;
+    mwSize dims[2];
+    int errflg;
+
+    /* control commands, e.g. ('-cache','stats') */
+    if(mxEnviControlCommand(nlhs, plhs, nrhs, prhs))
+        return;
+
+    /* -----------------------------------------------------------------
+     * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
+     * ----------------------------------------------------------------- */
+    if(nrhs!=6 && nrhs!=7) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:nrhs",
+                "Six or seven inputs required.");
+    }
+    if(nlhs>3) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:nlhs",
+                "One to three outputs required.");
+    }
+    if( !mxIsChar(prhs[0]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notChar",
+                "Input 0 (imgpath) needs to be a string.");
+    }
+    if( !mxIsStruct(prhs[1]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notStruct",
+                "Input 1 (ENVI header) needs to be a struct.");
+    }
+    if( !mxIsDouble(prhs[2]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notDouble",
+                "Input 2 (smpls) needs to be a double vector.");
+    }
+    if( !mxIsDouble(prhs[3]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notDouble",
+                "Input 3 (lines) needs to be a double vector.");
+    }
+    if( !mxIsDouble(prhs[4]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notDouble",
+                "Input 4 (band_skipszlist) needs to be a double vector.");
+    }
+    if( !mxIsDouble(prhs[5]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notDouble",
+                "Input 5 (band_readszlist) needs to be a double vector.");
+    }
+    if( nrhs>6 && !mxIsStruct(prhs[6]) && !mxIsEmpty(prhs[6]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:notStruct",
+                "Input 6 (read_opt) needs to be a struct.");
+    }
+    if( mxGetNumberOfElements(prhs[2]) != mxGetNumberOfElements(prhs[3]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:SizeMismatch",
+                "Inputs 2 (smpls) and 3 (lines) need to have the same number of elements.");
+    }
+    if( mxGetNumberOfElements(prhs[4]) != mxGetNumberOfElements(prhs[5]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:SizeMismatch",
+                "Inputs 4 (band_skipszlist) and 5 (band_readszlist) need to have the same number of elements.");
+    }
+
+    /* -----------------------------------------------------------------
+     * I/O SETUPs
+     * ----------------------------------------------------------------- */
+
+    /* INPUT 0 imgpath */
+    imgpath = mxArrayToString(prhs[0]);
+
+    /* INPUT 1 msldem_header */
+    hdr = mxGetEnviHeader(prhs[1]);
+
+    /* INPUT 6 read_opt */
+    read_opt = mxGetEnviReadOption((nrhs>6) ? prhs[6] : NULL);
+
+    /* INPUT 2/3 smpls/lines */
+    npix = (size_t) mxGetNumberOfElements(prhs[2]);
+    smpls_dbl = (double*) mxGetData(prhs[2]);
+    lines_dbl = (double*) mxGetData(prhs[3]);
+    smpls = (size_t*) malloc(npix*sizeof(size_t));
+    lines = (size_t*) malloc(npix*sizeof(size_t));
+    for(i=0;i<npix;i++){
+        if(smpls_dbl[i] > 0.5 && smpls_dbl[i] < (double) hdr.samples + 0.5){
+            smpls[i] = (size_t) (smpls_dbl[i] - 0.5);
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:"
+                "Invalid Value",
+                "Input 2 (smpls) has values out of the image.");
+        }
+        if(lines_dbl[i] > 0.5 && lines_dbl[i] < (double) hdr.lines + 0.5){
+            lines[i] = (size_t) (lines_dbl[i] - 0.5);
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:"
+                "Invalid Value",
+                "Input 3 (lines) has values out of the image.");
+        }
+    }
+
+    /* INPUT 4/5 band_skipszlist/band_readszlist */
+    N_band_skipread = (size_t) mxGetNumberOfElements(prhs[4]);
+    band_skipszlist_dbl = (double*) mxGetData(prhs[4]);
+    band_readszlist_dbl = (double*) mxGetData(prhs[5]);
+    band_skipszlist = (long int*) malloc( (size_t) N_band_skipread*sizeof(long int) );
+    band_readszlist = (size_t*) malloc( (size_t) N_band_skipread*sizeof(size_t) );
+    for(i=0;i<N_band_skipread;i++){
+        if(band_skipszlist_dbl[i] > -0.5){
+            band_skipszlist[i] = (long int) band_skipszlist_dbl[i];
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:"
+                "Invalid Value",
+                "Inputs 4 (band_skipszlist) have invalid values (needs to be nonnegative).");
+        }
+        if(band_readszlist_dbl[i] > -0.5){
+            band_readszlist[i] = (size_t) band_readszlist_dbl[i];
+        } else {
+            mexErrMsgIdAndTxt(
+                "lazyenvireadPixelsx_multBandRaster_mex:"
+                "Invalid Value",
+                "Inputs 5 (band_readszlist) have invalid values (needs to be nonnegative).");
+        }
+    }
+    bandsc = 0; band_skips=0;
+    for(i=0;i<N_band_skipread;i++){
+        bandsc += band_readszlist[i];
+        band_skips += band_skipszlist[i];
+    }
+    band_skip_last = (long int) hdr.bands - band_skips - (long int) bandsc;
+    if(band_skip_last < 0){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadPixelsx_multBandRaster_mex:"
+            "SizeInconsistent",
+            "Inputs 4 & 5 (band_skipszlist & band_readszlist) is inconsistent with the image size.");
+    }
+    dims[0] = (mwSize) npix;
+    dims[1] = (mwSize) bandsc;
+
+    /* -----------------------------------------------------------------
+     * CALL MAIN COMPUTATION ROUTINE
+     * ----------------------------------------------------------------- */
+    sz = envi_get_data_type_size(hdr.data_type);
+    if(sz==0){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadPixelsx_multBandRaster_mex:"
+            "UnsupportedDataType",
+            "data_type=%d is not supported.",hdr.data_type);
+    }
+    envi_copy_kernel_init(&kernel, hdr, &read_opt, NULL);
+    plhs[0] = mxCreateNumericArray(2,dims,
+        envi_data_type_to_mxClassID(kernel.dst_type),
+        (kernel.ncomp==2) ? mxCOMPLEX : mxREAL);
+    if(nlhs>1){
+        plhs[1] = mxCreateLogicalArray(2,dims);
+        read_opt.valid = mxGetLogicals(plhs[1]);
+        memset(read_opt.valid, 1, mxGetNumberOfElements(plhs[1])*sizeof(mxLogical));
+    }
+    io_stats.n_syscalls = 0; io_stats.n_copies = 0;
+    io_stats.nbytes_read = 0; io_stats.nbytes_used = 0;
+    if(mxIsEmpty(plhs[0])){
+        errflg = 0;
+    } else {
+#if MX_HAS_INTERLEAVED_COMPLEX
+        spc = mxGetData(plhs[0]);
+#else
+        if(mxIsComplex(plhs[0])){
+            spc = mxMalloc(mxGetNumberOfElements(plhs[0])*kernel.dst_sz);
+        } else {
+            spc = mxGetData(plhs[0]);
+        }
+#endif
+        errflg = lazyenvireadPixelsx_multBand(imgpath, hdr, smpls, lines,
+            npix, band_skipszlist, band_readszlist, N_band_skipread,
+            band_skip_last, spc, sz, &read_opt,
+            (nlhs>2) ? &io_stats : NULL);
+#if !MX_HAS_INTERLEAVED_COMPLEX
+        if(mxIsComplex(plhs[0])){
+            if(errflg == 0)
+                split_complex_mxArray(plhs[0], spc, kernel.dst_sz/2);
+            mxFree(spc);
+        }
+#endif
+    }
+
+    mxEnviErrMsg("lazyenvireadPixelsx_multBandRaster_mex", errflg, imgpath);
+
+    if(nlhs>2){
+        plhs[2] = mxCreateEnviIOPlanStats(&io_stats);
+    }
+
+    /* free memories */
+    mxFree(imgpath);
+    free(smpls);
+    free(lines);
+    free(band_skipszlist);
+    free(band_readszlist);
+}
@@ -1,6 +1,7 @@
 /* =====================================================================
  * lazyenvireadRectxv2_multBandRaster_mex.c
- * Read the specified rectangle region of an float32 image cube.
+ * Read the specified rectangle region of an image cube of any ENVI 
+ * data_type (1-6, 9, 12-16).
  * This function is endian free. The image data needs to be a binary image.
  * Rectangle part of the image:
  * [smpl_offset:(smpl_offset+samples), line_offset:(line_offset+lines),
@@ -16,14 +17,73 @@
  * 5 samples        integer
  * 6 lines          integer
  * 7 bands          integer
+ * 8 read_opt       struct (optional), read options
+ *     read_mode  : 'fread', 'mmap', 'pread', 'uring', 'direct', or 
+ *                  'default'
+ *     num_threads: number of threads for 'pread' (0: automatic)
+ *     queue_depth: number of reads in flight for 'uring' (0: default)
+ *     coalesce_gap: gap (bytes) below which neighboring runs are merged
+ *                   into one read by the I/O plan of 'pread'
+ *     precision  : class of the output ('double', 'single', 'int8', ...,
+ *                  'uint64'), or 'raw' for the class of data_type. The
+ *                  values are converted while they are copied out of the
+ *                  read buffers.
+ *     replace_div: whether or not to replace data_ignore_value in header
+ *                  with repval_div while reading (default false)
+ *     repval_div : value replacing data_ignore_value (default NaN)
+ *     band_index : bands of the output (optional), 1-based indices into 
+ *                  the selected bands, in any order and possibly 
+ *                  duplicated. Each selected band is read once and 
+ *                  written to every output band requesting it.
  * 
  * 
  * OUTPUTS:
- * 0  subimg 3 dimensional float (32bit) array, whose shape depends on 
- * interleave in header.
- * #Note that the image needs to be permuted after this.
+ * 0  subimg [lines x samples x bands] array of the class of precision 
+ * (bands: numel(band_index) if given)
+ * (data_type if 'raw'), whatever the interleave in header. Complex data 
+ * types (6 and 9) are returned as complex single/double arrays.
+ * 1  valid logical array (optional), same shape as subimg, false where 
+ *    the value in the file is data_ignore_value. Computed during the read.
+ * 2  io_stats struct (optional), statistics of the I/O plan
+ *     n_syscalls : number of read syscalls
+ *     n_copies   : number of copies out of the staging buffer
+ *     bytes_read : number of bytes read from the file
+ *     bytes_used : number of bytes used in subimg
  *
  *
+ * The block cache and the pool of open image files shared by the calls to
+ * this MEX file are controlled with ('-cache', ...) and ('-files', ...) 
+ * instead of the inputs above (see mxEnviControlCommand in envi_v2.h, 
+ * envi_block_cache.m and envi_file_pool.m).
+ *
+ * Prepared reads (see envi_readplan.h and envi_read_plan.m) resolve the 
+ * inputs and the I/O plan once for repeated reads of the same window:
+ *   ('-plan','create',imgpath,header,...,read_opt) 
+ *        the inputs of a read: returns the handle of the prepared read
+ *        (nothing is read)
+ *   ('-plan','read',handle,imgpath)
+ *        read the prepared window of imgpath, any image file with the
+ *        geometry of header: returns the outputs of a read
+ *   ('-plan','free',handle)
+ *        free the prepared read
+ *
+ * Tile iterators (see envi_tileiter.h and envi_tile_iterator.m) visit the
+ * whole image in tiles of a bounded size, in the order of the file:
+ *   ('-tiles','create',header,tile_size,max_bytes,read_opt)
+ *        tile_size [lines samples bands] (0: chosen to fit max_bytes),
+ *        max_bytes of a tile (0: 64 MiB): returns the handle of the 
+ *        iterator and its info
+ *   ('-tiles','next',handle)
+ *        returns the next tile [first last] (3 x 2, 1-based) of the lines,
+ *        samples, and bands, or [] once all the tiles have been visited
+ *   ('-tiles','read',handle,imgpath,tile)
+ *        read the tile of imgpath: returns the outputs of a read
+ *   ('-tiles','info',handle), ('-tiles','reset',handle)
+ *        returns the tile size, the number of tiles, and the index of the
+ *        next tile (after restarting from the first tile for 'reset')
+ *   ('-tiles','free',handle)
+ *        free the iterator
+ *
  * This is a MEX file for MATLAB.
  *
  * ---------------
@@ -43,54 +103,45 @@
 #include "io64.h"
 #include "mex.h"
 #include "matrix.h"
-// #include <string.h>
+#include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include "envi_v2.h"
-// #include "mex_create_array.h"
 
-/* The gateway function */
-void mexFunction( int nlhs, mxArray *plhs[],
-                  int nrhs, const mxArray *prhs[])
+/* function : envi_rectx_prepare
+ *  Check the inputs of a read (without the control command prefix) and 
+ *  prepare the read of the window into rp. */
+static void envi_rectx_prepare(int nrhs, const mxArray *prhs[],
+        EnviReadPlan *rp)
 {
-    char *imgpath;
     EnviHeader hdr;
+    EnviReadOption read_opt;
     double *smpl_skipszlist_dbl, *smpl_readszlist_dbl;
     double *line_skipszlist_dbl, *line_readszlist_dbl;
     double *band_skipszlist_dbl, *band_readszlist_dbl;
-
     long int *smpl_skipszlist, *line_skipszlist, *band_skipszlist;
     size_t   *smpl_readszlist, *line_readszlist, *band_readszlist;
-
     mwSize ndim_skip, ndim_read;
     const mwSize *dims_skip, *dims_read;
     size_t N_smpl_skipread, N_line_skipread, N_band_skipread;
     size_t i;
-
     size_t samplesc, linesc, bandsc;
     long int smpl_skips, line_skips, band_skips;
     long int smpl_skip_last, line_skip_last, band_skip_last;
-
-    void *subimg;
-    size_t sz;
-    mwSize samples, lines, bands;
-    mwSize dims[3];
-    size_t dims_size_t[3];
+    const mxArray *band_index_mx;
+    double *band_index_dbl;
+    size_t *band_index;
+    size_t N_band_index;
     int errflg;
 
     /* -----------------------------------------------------------------
      * CHECK PROPER NUMBER OF INPUTS AND OUTPUTS
      * ----------------------------------------------------------------- */
-    if(nrhs!=8) {
+    if(nrhs!=8 && nrhs!=9) {
         mexErrMsgIdAndTxt(
                 "lazyenvireadRectxv2_multBandRaster_mex:nrhs",
-                "Eight inputs required.");
-    }
-    if(nlhs!=1) {
-        mexErrMsgIdAndTxt(
-                "lazyenvireadRectxv2_multBandRaster_mex:nlhs",
-                "One output required.");
+                "Eight or nine inputs required.");
     }
     /* make sure the first input argument is scalar */
     if( !mxIsChar(prhs[0]) ) {
@@ -133,6 +184,11 @@ void mexFunction( int nlhs, mxArray *plhs[],
                 "lazyenvireadRectxv2_multBandRaster_mex:notDouble",
                 "Input 7 (band_readszlist) needs to be a double vector.");
     }
+    if( nrhs>8 && !mxIsStruct(prhs[8]) && !mxIsEmpty(prhs[8]) ) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:notStruct",
+                "Input 8 (read_opt) needs to be a struct.");
+    }
     
     /* Check the size of input variables */
     /* 2: smpl_skipszlist and 3: smpl_readszlist */
@@ -196,11 +252,11 @@ void mexFunction( int nlhs, mxArray *plhs[],
      * I/O SETUPs
      * ----------------------------------------------------------------- */
     
-    /* INPUT 0 imgpath */
-    imgpath = mxArrayToString(prhs[0]);
-    
     /* INPUT 1 msldem_header */
     hdr = mxGetEnviHeader(prhs[1]);
+    
+    /* INPUT 8 read_opt */
+    read_opt = mxGetEnviReadOption((nrhs>8) ? prhs[8] : NULL);
 
     /* INPUT 2/3 smpl_skipszlist/smpl_readszlist */
     N_smpl_skipread = (size_t) mxGetNumberOfElements(prhs[2]);
@@ -269,7 +325,7 @@ void mexFunction( int nlhs, mxArray *plhs[],
         line_skips += line_skipszlist[i];
     }
     line_skip_last = (long int) hdr.lines - line_skips - (long int) linesc;
-    if(band_skip_last < 0){
+    if(line_skip_last < 0){
         mexErrMsgIdAndTxt(
             "lazyenvireadRectxv2_multBandRaster_mex:"
             "SizeInconsistent",
@@ -317,110 +373,427 @@ void mexFunction( int nlhs, mxArray *plhs[],
     
     
     
-    // N = samples*lines*bands;
-    switch(hdr.interleave){
-        case BSQ :
-            dims[0] = (mwSize) samplesc;
-            dims[1] = (mwSize) linesc;
-            dims[2] = (mwSize) bandsc;
-            break;
-        case BIL :
-            dims[0] = (mwSize) samplesc;
-            dims[1] = (mwSize) bandsc;
-            dims[2] = (mwSize) linesc;
-            break;
-        case BIP :
-            dims[0] = (mwSize) bandsc;
-            dims[1] = (mwSize) samplesc;
-            dims[2] = (mwSize) linesc;
-            break;
-            
-    }
-    
-    
-    
-    /* -----------------------------------------------------------------
-     * CALL MAIN COMPUTATION ROUTINE
-     * ----------------------------------------------------------------- */
-    switch(hdr.data_type){
-        case 1:
-            plhs[0] = mxCreateNumericArray(3,dims,mxUINT8_CLASS,mxREAL);
-            sz = sizeof(uint8_t);
-            break;
-        case 2:
-            plhs[0] = mxCreateNumericArray(3,dims,mxINT16_CLASS,mxREAL);
-            sz = sizeof(int16_t);
-            break;
-        case 4:
-            plhs[0] = mxCreateNumericArray(3,dims,mxSINGLE_CLASS,mxREAL);
-            sz = sizeof(float);
-            break;
-        case 12:
-            plhs[0] = mxCreateNumericArray(3,dims,mxUINT16_CLASS,mxREAL);
-            sz = sizeof(uint16_t);
-            break;
-        case 16:
-            plhs[0] = mxCreateNumericArray(3,dims,mxINT8_CLASS,mxREAL);
-            sz = sizeof(int8_t);
-            break;
-        default:
+    /* read_opt.band_index: the selected bands are read once each, packed 
+     * in the order of their first request, and expanded to the output 
+     * bands after the read (see envi_readplan_create). */
+    band_index = NULL; N_band_index = 0;
+    band_index_mx = (nrhs>8 && mxIsStruct(prhs[8]) && !mxIsEmpty(prhs[8])) 
+                  ? mxGetField(prhs[8],0,"band_index") : NULL;
+    if(band_index_mx != NULL && !mxIsEmpty(band_index_mx)){
+        if(!mxIsDouble(band_index_mx)){
             mexErrMsgIdAndTxt(
-                "lazyenvireadRectxv2_multBandRaster_mex:"
-                "UnsupportedDataType",
-                "data_type=%d is not supported.",hdr.data_type);
-    }
-    if(mxIsEmpty(plhs[0])){
-        errflg = 0;
-    } else {
-        subimg = mxGetData(plhs[0]);
-
-        dims_size_t[0] = (size_t) dims[0];
-        dims_size_t[1] = (size_t) dims[1];
-        dims_size_t[2] = (size_t) dims[2];
-
-        errflg = lazyenvireadRectx_multBand(imgpath, hdr, 
-            smpl_skipszlist, smpl_readszlist, 
-            N_smpl_skipread, smpl_skip_last,
-            line_skipszlist, line_readszlist,
-            N_line_skipread, line_skip_last,
-            band_skipszlist, band_readszlist,
-            N_band_skipread, band_skip_last,
-            subimg, dims_size_t, sz);
-    
+                "lazyenvireadRectxv2_multBandRaster_mex:notDouble",
+                "read_opt.band_index needs to be a double vector.");
+        }
+        N_band_index = (size_t) mxGetNumberOfElements(band_index_mx);
+        band_index_dbl = (double*) mxGetData(band_index_mx);
+        band_index = (size_t*) malloc((N_band_index+1)*sizeof(size_t));
+        if(band_index == NULL){
+            free(smpl_skipszlist);
+            free(smpl_readszlist);
+            free(line_skipszlist);
+            free(line_readszlist);
+            free(band_skipszlist);
+            free(band_readszlist);
+            mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:OutOfMemory",
+                "Memory allocation failed.");
+        }
+        for(i=0;i<N_band_index;i++){
+            band_index[i] = (band_index_dbl[i] > 0.5) 
+                          ? (size_t) (band_index_dbl[i] - 0.5) : bandsc;
+        }
     }
     
-    if(errflg==0){
-        /* Byte Swap if necessary */
-        switch(hdr.data_type){
-            case 2:
-                image_byteswapInt16(subimg, dims_size_t, hdr.byte_order);
-                break;
-            case 4:
-                image_byteswapFloat(subimg, dims_size_t, hdr.byte_order);
-                break;
-            case 12:
-                image_byteswapUint16(subimg, dims_size_t, hdr.byte_order);
-                break;
-        }
-    } else if(errflg == -1){
-        mexErrMsgIdAndTxt(
-                "lazyenvireadRectxv2_multBandRaster_mex:"
-                "FileOpenError",
-                "File: %s does not exist.",imgpath);
-    } else if(errflg == -2){
+    if(envi_get_data_type_size(hdr.data_type)==0){
         mexErrMsgIdAndTxt(
-                "lazyenvireadRectxv2_multBandRaster_mex:"
-                "FileSizeInvalid",
-                "FileSize is incorrect.");
+            "lazyenvireadRectxv2_multBandRaster_mex:"
+            "UnsupportedDataType",
+            "data_type=%d is not supported.",hdr.data_type);
     }
-        
-    
-    /* free memories */
-    mxFree(imgpath);
+    errflg = envi_readplan_create(rp, hdr,
+        smpl_skipszlist, smpl_readszlist, N_smpl_skipread,
+        line_skipszlist, line_readszlist, N_line_skipread,
+        band_skipszlist, band_readszlist, N_band_skipread,
+        band_index, N_band_index, &read_opt);
     free(smpl_skipszlist);
     free(smpl_readszlist);
     free(line_skipszlist);
     free(line_readszlist);
     free(band_skipszlist);
     free(band_readszlist);
+    free(band_index);
+    if(errflg == -2){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadRectxv2_multBandRaster_mex:"
+            "Invalid Value",
+            "read_opt.band_index needs to request every selected band and only them.");
+    } else if(errflg != 0){
+        mexErrMsgIdAndTxt(
+            "lazyenvireadRectxv2_multBandRaster_mex:OutOfMemory",
+            "Memory allocation failed.");
+    }
+}
+
+/* function : envi_rectx_outputs
+ *  Create the outputs subimg (plhs[0]) and valid (plhs[1], if requested,
+ *  all true) of dims [lines x samples x bands] for the kernel. Returns 
+ *  the buffer the reader writes into (see envi_rectx_finish) and sets 
+ *  *valid. */
+static void *envi_rectx_outputs(int nlhs, mxArray *plhs[], 
+        const size_t *dims_read, const EnviCopyKernel *kernel, bool **valid)
+{
+    mwSize dims[3];
+
+    /* The readers transpose the data into [lines x samples x bands] 
+     * whatever the interleave. The output is directly created in the 
+     * class of the precision. */
+    dims[0] = (mwSize) dims_read[0];
+    dims[1] = (mwSize) dims_read[1];
+    dims[2] = (mwSize) dims_read[2];
+    plhs[0] = mxCreateNumericArray(3,dims,
+        envi_data_type_to_mxClassID(kernel->dst_type),
+        (kernel->ncomp==2) ? mxCOMPLEX : mxREAL);
+    /* valid is true unless the reader finds data_ignore_value. */
+    *valid = NULL;
+    if(nlhs>1){
+        plhs[1] = mxCreateLogicalArray(3,dims);
+        *valid = mxGetLogicals(plhs[1]);
+        memset(*valid, 1, mxGetNumberOfElements(plhs[1])*sizeof(mxLogical));
+    }
+#if MX_HAS_INTERLEAVED_COMPLEX
+    /* complex data are stored interleaved both in the file and in 
+     * plhs[0], so it is read directly. */
+    return mxGetData(plhs[0]);
+#else
+    /* With the separate complex API, the interleaved complex data is
+     * read into a temporary buffer and split afterwards. */
+    if(mxIsComplex(plhs[0]) && !mxIsEmpty(plhs[0]))
+        return mxMalloc(mxGetNumberOfElements(plhs[0])*kernel->dst_sz);
+    return mxGetData(plhs[0]);
+#endif
+}
+
+/* function : envi_rectx_finish
+ *  Move the data read into subimg (from envi_rectx_outputs) to plhs[0]
+ *  and set the statistics (plhs[stats_index]) if requested. */
+static void envi_rectx_finish(int nlhs, mxArray *plhs[], void *subimg,
+        const EnviCopyKernel *kernel, int errflg, 
+        const EnviIOPlanStats *io_stats, int stats_index)
+{
+#if !MX_HAS_INTERLEAVED_COMPLEX
+    if(mxIsComplex(plhs[0]) && !mxIsEmpty(plhs[0])){
+        if(errflg == 0)
+            split_complex_mxArray(plhs[0], subimg, kernel->dst_sz/2);
+        mxFree(subimg);
+    }
+#else
+    (void) subimg; (void) kernel;
+#endif
+    /* The bytes are already swapped by the readers if necessary. */
+    if(errflg == 0 && nlhs>stats_index){
+        plhs[stats_index] = mxCreateEnviIOPlanStats(io_stats);
+    }
+}
+
+/* function : envi_rectx_read
+ *  Read the window prepared in rp from imgpath into the outputs.
+ *  Returns the error code of the reader (see mxEnviErrMsg). */
+static int envi_rectx_read(int nlhs, mxArray *plhs[],
+        const EnviReadPlan *rp, const char *imgpath)
+{
+    EnviIOPlanStats io_stats;
+    void *subimg;
+    bool *valid;
+    int errflg;
+
+    subimg = envi_rectx_outputs(nlhs, plhs, rp->dims, &rp->kernel, &valid);
+    errflg = envi_readplan_execute(rp, imgpath, subimg, valid,
+                (nlhs>2) ? &io_stats : NULL);
+    envi_rectx_finish(nlhs, plhs, subimg, &rp->kernel, errflg, &io_stats, 2);
+    return errflg;
+}
+
+/* function : envi_rectx_plan_command
+ *  Handle ('-plan',...) (see the top of this file).
+ *  Returns false if the arguments are not a plan command. */
+static bool envi_rectx_plan_command(int nlhs, mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char *cmd, *imgpath;
+    EnviReadPlan *rp;
+    bool is_plan;
+    int errflg;
+
+    if(nrhs < 1 || !mxIsChar(prhs[0]))
+        return false;
+    cmd = mxArrayToString(prhs[0]);
+    is_plan = (cmd != NULL && strcmp(cmd,"-plan") == 0);
+    mxFree(cmd);
+    if(!is_plan)
+        return false;
+    if(nrhs < 2 || !mxIsChar(prhs[1])){
+        mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:plan",
+            "'-plan' needs a command: 'create', 'read', or 'free'");
+    }
+    cmd = mxArrayToString(prhs[1]);
+    if(strcmp(cmd,"create")==0){
+        mxFree(cmd);
+        rp = (EnviReadPlan*) malloc(sizeof(EnviReadPlan));
+        if(rp == NULL){
+            mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:OutOfMemory",
+                "Memory allocation failed.");
+        }
+        envi_rectx_prepare(nrhs-2, prhs+2, rp);
+        plhs[0] = mxCreateDoubleScalar(mxEnviReadPlanRegister(rp));
+    } else if(strcmp(cmd,"read")==0){
+        mxFree(cmd);
+        if(nrhs != 4 || !mxIsChar(prhs[3])){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:plan",
+                "'-plan','read' needs a handle and imgpath.");
+        }
+        if(nlhs>3) {
+            mexErrMsgIdAndTxt(
+                    "lazyenvireadRectxv2_multBandRaster_mex:nlhs",
+                    "One to three outputs required.");
+        }
+        rp = mxGetEnviReadPlan(prhs[2]);
+        imgpath = mxArrayToString(prhs[3]);
+        errflg = envi_rectx_read(nlhs, plhs, rp, imgpath);
+        mxEnviErrMsg("lazyenvireadRectxv2_multBandRaster_mex", errflg,
+            imgpath);
+        mxFree(imgpath);
+    } else if(strcmp(cmd,"free")==0){
+        mxFree(cmd);
+        if(nrhs != 3){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:plan",
+                "'-plan','free' needs a handle.");
+        }
+        mxEnviReadPlanRelease(prhs[2]);
+    } else {
+        mxFree(cmd);
+        mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:plan",
+            "'-plan' command is not valid");
+    }
+    return true;
+}
+
+/* function : envi_rectx_get_tile
+ *  Tile given by the 3 x 2 array pm of the 1-based first and last lines,
+ *  samples and bands, which needs to lie in the image of the iterator. */
+static void envi_rectx_get_tile(const mxArray *pm, const EnviTileIter *it,
+        EnviTile *tile)
+{
+    const double *range;
+    size_t k;
+
+    if(!mxIsDouble(pm) || mxIsComplex(pm) || mxGetM(pm) != 3 
+            || mxGetN(pm) != 2){
+        mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+            "The tile needs to be a 3 x 2 array of the first and last lines, samples, and bands.");
+    }
+    range = mxGetPr(pm);
+    tile->index = 0;
+    for(k=0;k<3;k++){
+        if(!(range[k] >= 1 && range[k] <= range[k+3]
+                && range[k+3] <= (double) it->dims[k])){
+            mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "The tile is out of the image.");
+        }
+        tile->start[k] = (size_t) range[k] - 1;
+        tile->count[k] = (size_t) range[k+3] - tile->start[k];
+    }
+}
+
+/* function : envi_rectx_tile_info
+ *  Struct of the tile size, the number of tiles, and the next tile. */
+static mxArray *envi_rectx_tile_info(const EnviTileIter *it)
+{
+    const char *fields[] = {"tile_size","num_tiles","num_tiles_total",
+        "next_tile","tile_bytes"};
+    mxArray *pm, *tile_size, *num_tiles;
+    size_t k;
+
+    tile_size = mxCreateDoubleMatrix(1,3,mxREAL);
+    num_tiles = mxCreateDoubleMatrix(1,3,mxREAL);
+    for(k=0;k<3;k++){
+        mxGetPr(tile_size)[k] = (double) it->tile[k];
+        mxGetPr(num_tiles)[k] = (double) it->ntiles[k];
+    }
+    pm = mxCreateStructMatrix(1,1,5,fields);
+    mxSetField(pm,0,"tile_size",tile_size);
+    mxSetField(pm,0,"num_tiles",num_tiles);
+    mxSetField(pm,0,"num_tiles_total",
+        mxCreateDoubleScalar((double) it->ntiles_total));
+    mxSetField(pm,0,"next_tile",mxCreateDoubleScalar((double) it->next + 1));
+    mxSetField(pm,0,"tile_bytes",
+        mxCreateDoubleScalar((double) it->nbytes_tile));
+    return pm;
+}
+
+/* function : envi_rectx_tiles_command
+ *  Handle ('-tiles',...) (see the top of this file).
+ *  Returns false if the arguments are not a tile command. */
+static bool envi_rectx_tiles_command(int nlhs, mxArray *plhs[], int nrhs,
+        const mxArray *prhs[])
+{
+    char *cmd, *imgpath;
+    EnviTileIter *it;
+    EnviTile tile;
+    EnviHeader hdr;
+    EnviReadOption read_opt;
+    EnviCopyKernel kernel;
+    EnviIOPlanStats io_stats;
+    size_t tile_size[3], k;
+    double max_bytes;
+    void *subimg;
+    bool *valid, is_tiles;
+    int errflg;
+
+    if(nrhs < 1 || !mxIsChar(prhs[0]))
+        return false;
+    cmd = mxArrayToString(prhs[0]);
+    is_tiles = (cmd != NULL && strcmp(cmd,"-tiles") == 0);
+    mxFree(cmd);
+    if(!is_tiles)
+        return false;
+    if(nrhs < 2 || !mxIsChar(prhs[1])){
+        mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+            "'-tiles' needs a command: 'create', 'next', 'read', 'info', 'reset', or 'free'");
+    }
+    cmd = mxArrayToString(prhs[1]);
+    if(strcmp(cmd,"create")==0){
+        mxFree(cmd);
+        if(nrhs < 5 || nrhs > 6 || !mxIsStruct(prhs[2])
+                || !mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3]) != 3
+                || !mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) != 1){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "'-tiles','create' needs a header, a tile size [lines samples bands], max_bytes, and read_opt.");
+        }
+        hdr = mxGetEnviHeader(prhs[2]);
+        for(k=0;k<3;k++){
+            if(!(mxGetPr(prhs[3])[k] >= 0)){
+                mexErrMsgIdAndTxt(
+                    "lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                    "The tile size needs to be nonnegative.");
+            }
+            tile_size[k] = (size_t) mxGetPr(prhs[3])[k];
+        }
+        max_bytes = mxGetScalar(prhs[4]);
+        if(!(max_bytes >= 0)){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "max_bytes needs to be nonnegative.");
+        }
+        read_opt = mxGetEnviReadOption((nrhs > 5) ? prhs[5] : NULL);
+        it = (EnviTileIter*) malloc(sizeof(EnviTileIter));
+        if(it == NULL){
+            mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:OutOfMemory",
+                "Memory allocation failed.");
+        }
+        errflg = envi_tileiter_init(it, hdr, tile_size, (size_t) max_bytes,
+                    &read_opt);
+        if(errflg != 0){
+            free(it);
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "The tiles do not fit in max_bytes or the data type is not supported.");
+        }
+        plhs[0] = mxCreateDoubleScalar(mxEnviTileIterRegister(it));
+        if(nlhs > 1)
+            plhs[1] = envi_rectx_tile_info(it);
+    } else if(strcmp(cmd,"next")==0){
+        mxFree(cmd);
+        if(nrhs != 3){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "'-tiles','next' needs a handle.");
+        }
+        it = mxGetEnviTileIter(prhs[2]);
+        if(envi_tileiter_next(it, &tile)){
+            plhs[0] = mxCreateDoubleMatrix(3,2,mxREAL);
+            for(k=0;k<3;k++){
+                mxGetPr(plhs[0])[k] = (double) tile.start[k] + 1;
+                mxGetPr(plhs[0])[k+3] = (double) (tile.start[k] 
+                                                  + tile.count[k]);
+            }
+        } else {
+            plhs[0] = mxCreateDoubleMatrix(0,0,mxREAL);
+        }
+    } else if(strcmp(cmd,"read")==0){
+        mxFree(cmd);
+        if(nrhs != 5 || !mxIsChar(prhs[3])){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "'-tiles','read' needs a handle, imgpath, and a tile.");
+        }
+        if(nlhs>3) {
+            mexErrMsgIdAndTxt(
+                    "lazyenvireadRectxv2_multBandRaster_mex:nlhs",
+                    "One to three outputs required.");
+        }
+        it = mxGetEnviTileIter(prhs[2]);
+        envi_rectx_get_tile(prhs[4], it, &tile);
+        envi_copy_kernel_init(&kernel, it->hdr, &it->opt, NULL);
+        subimg = envi_rectx_outputs(nlhs, plhs, tile.count, &kernel, &valid);
+        imgpath = mxArrayToString(prhs[3]);
+        errflg = envi_tileiter_read(it, imgpath, &tile, subimg, valid,
+                    (nlhs>2) ? &io_stats : NULL);
+        envi_rectx_finish(nlhs, plhs, subimg, &kernel, errflg, &io_stats, 2);
+        mxEnviErrMsg("lazyenvireadRectxv2_multBandRaster_mex", errflg,
+            imgpath);
+        mxFree(imgpath);
+    } else if(strcmp(cmd,"info")==0 || strcmp(cmd,"reset")==0){
+        if(nrhs != 3){
+            mxFree(cmd);
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "'-tiles','info' and 'reset' need a handle.");
+        }
+        it = mxGetEnviTileIter(prhs[2]);
+        if(strcmp(cmd,"reset")==0)
+            envi_tileiter_reset(it);
+        mxFree(cmd);
+        plhs[0] = envi_rectx_tile_info(it);
+    } else if(strcmp(cmd,"free")==0){
+        mxFree(cmd);
+        if(nrhs != 3){
+            mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+                "'-tiles','free' needs a handle.");
+        }
+        mxEnviTileIterRelease(prhs[2]);
+    } else {
+        mxFree(cmd);
+        mexErrMsgIdAndTxt("lazyenvireadRectxv2_multBandRaster_mex:tiles",
+            "'-tiles' command is not valid");
+    }
+    return true;
+}
+
+/* The gateway function */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[])
+{
+    char *imgpath;
+    EnviReadPlan rp;
+    int errflg;
+    
+    /* control commands, e.g. ('-cache','stats') */
+    if(mxEnviControlCommand(nlhs, plhs, nrhs, prhs))
+        return;
+    if(envi_rectx_plan_command(nlhs, plhs, nrhs, prhs))
+        return;
+    if(envi_rectx_tiles_command(nlhs, plhs, nrhs, prhs))
+        return;
+
+    if(nlhs>3) {
+        mexErrMsgIdAndTxt(
+                "lazyenvireadRectxv2_multBandRaster_mex:nlhs",
+                "One to three outputs required.");
+    }
+    /* a single read is a prepared read used once */
+    envi_rectx_prepare(nrhs, prhs, &rp);
+    imgpath = mxArrayToString(prhs[0]);
+    errflg = envi_rectx_read(nlhs, plhs, &rp, imgpath);
+    envi_readplan_free(&rp);
+    mxEnviErrMsg("lazyenvireadRectxv2_multBandRaster_mex", errflg, imgpath);
+    mxFree(imgpath);
 }
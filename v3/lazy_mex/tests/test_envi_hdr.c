@@ -0,0 +1,289 @@
+/* =====================================================================
+ * test_envi_hdr.c
+ * Check the header parser of libenvi against the fixture headers.
+ *
+ * USAGE:
+ *   test_envi_hdr datadir
+ *
+ * The headers datadir/crism.hdr and datadir/fields.hdr are parsed with
+ * envi_hdr_read and envi_header_read, and the names, types and values of
+ * their fields are compared with those given by envihdrreadx2.m.
+ * envi_parse_double is checked on strings accepted and rejected by
+ * str2double.
+ * Returns 0 if all the checks pass.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "envi_io.h"
+#include "envi_hdr.h"
+
+static int envi_test_nfail = 0;
+
+static void envi_test_fail(const char *path, const char *name,
+        const char *what)
+{
+    fprintf(stderr, "%s: %s: %s\n", path, name, what);
+    envi_test_nfail++;
+}
+
+/* function : envi_test_field
+ *  The field name of hdr if it has the type type, NULL otherwise (the
+ *  failure is reported). */
+static const EnviHdrField *envi_test_field(const EnviHdr *hdr,
+        const char *path, const char *name, EnviHdrValueType type)
+{
+    size_t i;
+
+    for(i=0;i<hdr->nfields;i++){
+        if(strcmp(hdr->fields[i].name, name) != 0)
+            continue;
+        if(hdr->fields[i].type != type){
+            envi_test_fail(path, name, "wrong type");
+            return NULL;
+        }
+        return &hdr->fields[i];
+    }
+    envi_test_fail(path, name, "missing");
+    return NULL;
+}
+
+static void envi_test_string(const EnviHdr *hdr, const char *path,
+        const char *name, const char *str)
+{
+    const EnviHdrField *f;
+
+    f = envi_test_field(hdr, path, name, ENVI_HDR_STRING);
+    if(f != NULL && strcmp(f->str, str) != 0)
+        envi_test_fail(path, name, "wrong string");
+}
+
+static void envi_test_number(const EnviHdr *hdr, const char *path,
+        const char *name, double num)
+{
+    const EnviHdrField *f;
+
+    f = envi_test_field(hdr, path, name, ENVI_HDR_NUMBER);
+    if(f != NULL && f->num != num)
+        envi_test_fail(path, name, "wrong number");
+}
+
+/* function : envi_test_strs
+ *  Check the strings (type ENVI_HDR_STRINGS or ENVI_HDR_LINES) of name
+ *  against the nstrs strings strs. */
+static void envi_test_strs(const EnviHdr *hdr, const char *path,
+        const char *name, EnviHdrValueType type, const char **strs,
+        size_t nstrs)
+{
+    const EnviHdrField *f;
+    size_t i;
+
+    f = envi_test_field(hdr, path, name, type);
+    if(f == NULL)
+        return;
+    if(f->nstrs != nstrs){
+        envi_test_fail(path, name, "wrong number of strings");
+        return;
+    }
+    for(i=0;i<nstrs;i++){
+        if(strcmp(f->strs[i], strs[i]) != 0)
+            envi_test_fail(path, name, "wrong string");
+    }
+}
+
+/* function : envi_test_nums
+ *  Check the numbers of name against the nnums numbers nums (NaN matching
+ *  NaN). */
+static void envi_test_nums(const EnviHdr *hdr, const char *path,
+        const char *name, const double *nums, size_t nnums)
+{
+    const EnviHdrField *f;
+    size_t i;
+
+    f = envi_test_field(hdr, path, name, ENVI_HDR_NUMBERS);
+    if(f == NULL)
+        return;
+    if(f->nnums != nnums){
+        envi_test_fail(path, name, "wrong number of numbers");
+        return;
+    }
+    for(i=0;i<nnums;i++){
+        if(f->nums[i] != nums[i] && !(isnan(f->nums[i]) && isnan(nums[i])))
+            envi_test_fail(path, name, "wrong number");
+    }
+}
+
+static void envi_test_crism(const char *datadir)
+{
+    static const char *description[] = {
+        "{", "  CRISM DATA [Tue Mar 14 03:13:37 2017]",
+        "  PDS label: frt00003e12_07_if166l_trr3.lbl}"
+    };
+    static const char *band_names[] = {"Band 1", "Band 2", "Band 3",
+                                       "Band 4"};
+    static const double default_bands[] = {233, 78, 13};
+    static const double wavelength[] = {1001.35, 1007.9, 1014.45, 1021};
+    static const double bbl[] = {1, 1, 0, 1};
+    double fwhm[4];
+    char path[1024];
+    EnviHdr hdr;
+    EnviHeader h;
+    int errflg;
+
+    sprintf(path, "%.1000s/crism.hdr", datadir);
+    errflg = envi_hdr_read(&hdr, path);
+    if(errflg != 0){
+        envi_test_fail(path, "envi_hdr_read", envi_strerror(errflg));
+        return;
+    }
+    if(hdr.nfields != 20 || strcmp(hdr.fields[0].name, "description") != 0
+            || strcmp(hdr.fields[19].name, "map_info") != 0)
+        envi_test_fail(path, "fields", "wrong fields or order");
+    envi_test_strs(&hdr, path, "description", ENVI_HDR_LINES, description,
+        3);
+    envi_test_number(&hdr, path, "samples", 640);
+    envi_test_number(&hdr, path, "lines", 450);
+    envi_test_number(&hdr, path, "bands", 438);
+    envi_test_number(&hdr, path, "header_offset", 0);
+    envi_test_string(&hdr, path, "file_type", "ENVI Standard");
+    envi_test_number(&hdr, path, "data_type", 4);
+    envi_test_string(&hdr, path, "interleave", "bil");
+    envi_test_string(&hdr, path, "sensor_type", "Unknown");
+    envi_test_nums(&hdr, path, "default_bands", default_bands, 3);
+    envi_test_number(&hdr, path, "data_ignore_value", 65535);
+    /* kept as strings */
+    envi_test_string(&hdr, path, "cat_crism_obsid", "00003E12");
+    envi_test_string(&hdr, path, "cat_sclk_start", "0913455174.14384");
+    envi_test_strs(&hdr, path, "band_names", ENVI_HDR_STRINGS, band_names,
+        4);
+    envi_test_nums(&hdr, path, "wavelength", wavelength, 4);
+    fwhm[0] = 6.5; fwhm[1] = 6.5; fwhm[2] = NAN; fwhm[3] = 6.5;
+    envi_test_nums(&hdr, path, "fwhm", fwhm, 4);
+    envi_test_nums(&hdr, path, "bbl", bbl, 4);
+    envi_test_string(&hdr, path, "map_info", "{UTM, 1.000, 1.000, "
+        "500000.000, 4500000.000, 18.0, 18.0, 13, North, WGS-84, "
+        "units=Meters}");
+    envi_hdr_free(&hdr);
+
+    errflg = envi_header_read(&h, path);
+    if(errflg != 0){
+        envi_test_fail(path, "envi_header_read", envi_strerror(errflg));
+        return;
+    }
+    if(h.samples != 640 || h.lines != 450 || h.bands != 438
+            || h.data_type != 4 || h.byte_order != 0 || h.header_offset != 0
+            || h.interleave != BIL || h.data_ignore_value != 65535)
+        envi_test_fail(path, "envi_header_read", "wrong header");
+}
+
+static void envi_test_fields(const char *datadir)
+{
+    static const double thousands[] = {1, 200};
+    char path[1024];
+    EnviHdr hdr;
+    EnviHeader h;
+    int errflg;
+
+    sprintf(path, "%.1000s/fields.hdr", datadir);
+    errflg = envi_hdr_read(&hdr, path);
+    if(errflg != 0){
+        envi_test_fail(path, "envi_hdr_read", envi_strerror(errflg));
+        return;
+    }
+    /* a field given again takes the last value in its first place */
+    if(hdr.nfields != 17 || strcmp(hdr.fields[2].name, "bands") != 0)
+        envi_test_fail(path, "fields", "wrong fields or order");
+    envi_test_number(&hdr, path, "bands", 4);
+    /* commented out */
+    envi_test_number(&hdr, path, "header_offset", 128);
+    /* renamed */
+    envi_test_number(&hdr, path, "x_start_pixels", 5);
+    envi_test_number(&hdr, path, "GainOffset___Band", 2.5e-3);
+    envi_test_string(&hdr, path, "sensor-type", "Unknown");
+    /* single line descriptions are strings */
+    envi_test_string(&hdr, path, "one_line_description", "{single line}");
+    envi_test_string(&hdr, path, "description", "plain text");
+    envi_test_number(&hdr, path, "exponent", 1000);
+    envi_test_number(&hdr, path, "negative", -HUGE_VAL);
+    /* a number for str2double with commas is split by str2num */
+    envi_test_nums(&hdr, path, "thousands", thousands, 2);
+    envi_test_string(&hdr, path, "numbers", "1, 2,3");
+    /* the trimmed lines are appended */
+    envi_test_string(&hdr, path, "split_value", "{first,second}");
+    envi_hdr_free(&hdr);
+
+    errflg = envi_header_read(&h, path);
+    if(errflg != 0){
+        envi_test_fail(path, "envi_header_read", envi_strerror(errflg));
+        return;
+    }
+    if(h.samples != 10 || h.lines != 20 || h.bands != 4
+            || h.data_type != 12 || h.byte_order != 1
+            || h.header_offset != 128 || h.interleave != BSQ
+            || !isnan(h.data_ignore_value))
+        envi_test_fail(path, "envi_header_read", "wrong header");
+
+    sprintf(path, "%.1000s/missing.hdr", datadir);
+    if(envi_hdr_read(&hdr, path) != ENVI_ERR_OPEN)
+        envi_test_fail(path, "envi_hdr_read", "opened a missing file");
+}
+
+static void envi_test_parse_double(void)
+{
+    static const struct { const char *s; bool ok; double v; } cases[] = {
+        {"42", true, 42},
+        {"  -3.25  ", true, -3.25},
+        {"+.5", true, 0.5},
+        {"1e3", true, 1000},
+        {"2.5D-2", true, 0.025},
+        {"1,200.5", true, 1200.5},
+        {"Inf", true, HUGE_VAL},
+        {"0.1", true, 0.1},
+        {"123456789012345678", true, 123456789012345678.0},
+        {"", false, 0},
+        {"abc", false, 0},
+        {"1 2", false, 0},
+        {"NaN", false, 0},
+        {"1.5x", false, 0}
+    };
+    size_t i;
+    double v;
+    bool ok;
+
+    for(i=0;i<sizeof(cases)/sizeof(cases[0]);i++){
+        ok = envi_parse_double(cases[i].s, cases[i].s + strlen(cases[i].s),
+                &v);
+        if(ok != cases[i].ok || (ok && v != cases[i].v))
+            envi_test_fail("envi_parse_double", cases[i].s,
+                "wrong value");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc != 2){
+        fprintf(stderr, "usage: test_envi_hdr datadir\n");
+        return 1;
+    }
+    envi_test_crism(argv[1]);
+    envi_test_fields(argv[1]);
+    envi_test_parse_double();
+    if(envi_test_nfail == 0)
+        printf("all the headers match\n");
+    return envi_test_nfail != 0;
+}
@@ -0,0 +1,715 @@
+/* =====================================================================
+ * test_envi_read.c
+ * Compare the readers of libenvi with a plain reference reader.
+ *
+ * USAGE:
+ *   test_envi_read [niter]
+ *
+ * Each iteration writes a small random image (test_envi_read.hdr/.img in
+ * the current directory) of one of the data types, interleaves and byte
+ * orders, and reads random skip-read lists of it with every read mode,
+ * through a read plan with a band_index, and tile by tile, with a random
+ * precision and data ignore value handling. The outputs and the valid
+ * flags are compared with those of the reference reader, which loads the
+ * whole file and converts the elements one by one. One iteration in four
+ * runs with the block cache and the file pool enabled. The first 
+ * iterations read float32 images whose data ignore value is not 
+ * representable in float32 (-1.23e34 and -3.40282e+38).
+ * Returns 0 if all the reads match.
+ *
+ * ---------------
+ * Update History
+ * ---------------
+ * +============|==========================================|==============+
+ * | Date       | Comment                                  | Name         |
+ * +============|==========================================|==============+
+ *
+ * -----------------
+ * Copyright Notice
+ * -----------------
+ * Copyright (C) 2021 by Yuki Itoh <yukiitohand@gmail.com>
+ *
+ * ===================================================================== */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "envi_io.h"
+#include "envi_cache.h"
+#include "envi_filepool.h"
+#include "envi_readplan.h"
+#include "envi_tileiter.h"
+
+#define ENVI_TEST_HDR "test_envi_read.hdr"
+#define ENVI_TEST_IMG "test_envi_read.img"
+#define ENVI_TEST_NLIST 6
+
+/* EnviTestImage
+ *  The image under test: its header, the elements of the file after the
+ *  header offset (data, as written), the size of an element (sz) and of
+ *  its real or imaginary part (part_sz), and whether the elements are
+ *  byte-swapped in the file. */
+typedef struct EnviTestImage {
+    EnviHeader hdr;
+    unsigned char *data;
+    size_t sz;
+    size_t part_sz;
+    bool swap;
+} EnviTestImage ;
+
+/* EnviTestValue
+ *  A value of an element, held as double (floating point types), int64_t
+ *  (signed types) or uint64_t (unsigned types). */
+typedef struct EnviTestValue {
+    int kind;
+    double d;
+    int64_t s;
+    uint64_t u;
+} EnviTestValue ;
+
+/* EnviTestSel
+ *  Skip-read list of one dimension and the indices it selects. */
+typedef struct EnviTestSel {
+    long int skip[ENVI_TEST_NLIST];
+    size_t read[ENVI_TEST_NLIST];
+    size_t N;
+    long int skip_last;
+    size_t idx[256];
+    size_t n;
+} EnviTestSel ;
+
+static uint32_t envi_test_state = 2021u;
+
+static uint32_t envi_test_rand(void)
+{
+    envi_test_state ^= envi_test_state << 13;
+    envi_test_state ^= envi_test_state >> 17;
+    envi_test_state ^= envi_test_state << 5;
+    return envi_test_state;
+}
+
+static size_t envi_test_rand_range(size_t n)
+{
+    return (size_t) envi_test_rand() % n;
+}
+
+/* ---------------------------------------------------------------------
+ * Reference reader
+ * --------------------------------------------------------------------- */
+static bool envi_test_is_float(int32_t type)
+{
+    return type == 4 || type == 5;
+}
+
+static bool envi_test_is_signed(int32_t type)
+{
+    return type == 2 || type == 3 || type == 14 || type == 16;
+}
+
+/* function : envi_test_part_type
+ *  ENVI data_type of the real and imaginary parts of complex types. */
+static int32_t envi_test_part_type(int32_t type)
+{
+    return (type == 6) ? 4 : ((type == 9) ? 5 : type);
+}
+
+static void envi_test_limits(int32_t type, int64_t *lo, uint64_t *hi)
+{
+    switch(type){
+        case 1:  *lo = 0;         *hi = UINT8_MAX;  break;
+        case 16: *lo = INT8_MIN;  *hi = INT8_MAX;   break;
+        case 2:  *lo = INT16_MIN; *hi = INT16_MAX;  break;
+        case 12: *lo = 0;         *hi = UINT16_MAX; break;
+        case 3:  *lo = INT32_MIN; *hi = INT32_MAX;  break;
+        case 13: *lo = 0;         *hi = UINT32_MAX; break;
+        case 14: *lo = INT64_MIN; *hi = INT64_MAX;  break;
+        default: *lo = 0;         *hi = UINT64_MAX; break;
+    }
+}
+
+static void envi_test_reverse(unsigned char *p, size_t n)
+{
+    size_t i;
+    unsigned char c;
+
+    for(i=0;i<n/2;i++){
+        c = p[i]; p[i] = p[n-1-i]; p[n-1-i] = c;
+    }
+}
+
+/* function : envi_test_load
+ *  Value of the part of type (not complex) at p, byte-swapped if swap. */
+static EnviTestValue envi_test_load(const unsigned char *p, int32_t type,
+        bool swap)
+{
+    union { unsigned char c[8]; float f; double d; uint8_t u8; int8_t s8;
+            uint16_t u16; int16_t s16; uint32_t u32; int32_t s32;
+            uint64_t u64; int64_t s64; } b;
+    EnviTestValue v;
+    size_t sz;
+
+    sz = envi_get_data_type_size(type);
+    memcpy(b.c, p, sz);
+    if(swap)
+        envi_test_reverse(b.c, sz);
+    v.kind = envi_test_is_float(type) ? 0 : (envi_test_is_signed(type) ? 1
+                                                                        : 2);
+    v.d = 0; v.s = 0; v.u = 0;
+    switch(type){
+        case 1:  v.u = b.u8;  break;
+        case 16: v.s = b.s8;  break;
+        case 2:  v.s = b.s16; break;
+        case 12: v.u = b.u16; break;
+        case 3:  v.s = b.s32; break;
+        case 13: v.u = b.u32; break;
+        case 14: v.s = b.s64; break;
+        case 15: v.u = b.u64; break;
+        case 4:  v.d = b.f;   break;
+        default: v.d = b.d;   break;
+    }
+    return v;
+}
+
+/* function : envi_test_store
+ *  Store v as type (not complex) at dst, rounding half away from zero and
+ *  saturating as the casts of MATLAB (NaN becomes 0). */
+static void envi_test_store(unsigned char *dst, int32_t type,
+        EnviTestValue v)
+{
+    int64_t lo;
+    uint64_t hi, r;
+    float f;
+    double d;
+
+    if(type == 4 || type == 5){
+        d = (v.kind == 0) ? v.d : ((v.kind == 1) ? (double) v.s
+                                                 : (double) v.u);
+        if(type == 4){
+            f = (v.kind == 0) ? (float) v.d : ((v.kind == 1) ? (float) v.s
+                                                             : (float) v.u);
+            memcpy(dst, &f, sizeof(f));
+        } else {
+            memcpy(dst, &d, sizeof(d));
+        }
+        return;
+    }
+    envi_test_limits(type, &lo, &hi);
+    if(v.kind == 0){
+        if(isnan(v.d))
+            r = 0;
+        else if(v.d >= (double) hi)
+            r = hi;
+        else if(v.d <= (double) lo)
+            r = (uint64_t) lo;
+        else if(lo == 0)
+            r = (uint64_t) round(v.d);
+        else
+            r = (uint64_t) (int64_t) round(v.d);
+    } else if(v.kind == 1){
+        if(v.s < lo)
+            r = (uint64_t) lo;
+        else if(v.s > 0 && (uint64_t) v.s > hi)
+            r = hi;
+        else
+            r = (uint64_t) v.s;
+    } else {
+        r = (v.u > hi) ? hi : v.u;
+    }
+    /* two's complement: the low bytes of r */
+    switch(envi_get_data_type_size(type)){
+        case 1: { uint8_t x = (uint8_t) r;   memcpy(dst, &x, 1); break; }
+        case 2: { uint16_t x = (uint16_t) r; memcpy(dst, &x, 2); break; }
+        case 4: { uint32_t x = (uint32_t) r; memcpy(dst, &x, 4); break; }
+        default: memcpy(dst, &r, 8); break;
+    }
+}
+
+static EnviTestValue envi_test_value_double(double d)
+{
+    EnviTestValue v;
+
+    v.kind = 0; v.d = d; v.s = 0; v.u = 0;
+    return v;
+}
+
+/* function : envi_test_is_div
+ *  Whether the value v of the image of type type is the data ignore value
+ *  div: floating point values are compared with div rounded to their
+ *  type (0 matching -0), and integer values with div if it is an integer
+ *  (an integer div out of the range of type matches nothing). */
+static bool envi_test_is_div(EnviTestValue v, int32_t type, double div)
+{
+    if(isnan(div))
+        return false;
+    if(v.kind == 0)
+        return (type == 4) ? ((float) v.d == (float) div) : (v.d == div);
+    if(div != floor(div))
+        return false;
+    if(v.kind == 1)
+        return div >= -9223372036854775808.0 && div < 9223372036854775808.0
+                && v.s == (int64_t) div;
+    return div >= 0 && div < 18446744073709551616.0 && v.u == (uint64_t) div;
+}
+
+/* function : envi_test_reference
+ *  Read the lines x smpls x bands of img into out ([nl x ns x nb]
+ *  column-major, lines fastest) in precision (0: the data type of the
+ *  image), replacing the data ignore value with repval if replace, and
+ *  set valid (if not NULL). */
+static void envi_test_reference(const EnviTestImage *img,
+        const size_t *lines, size_t nl, const size_t *smpls, size_t ns,
+        const size_t *bands, size_t nb, int32_t precision, bool replace,
+        double repval, unsigned char *out, bool *valid)
+{
+    const EnviHeader *hdr = &img->hdr;
+    const unsigned char *src;
+    unsigned char *dst;
+    int32_t src_type, dst_type;
+    size_t il, is, ib, k, ncomp, idx, dst_part_sz;
+    size_t S, L, B, s, l, b;
+    EnviTestValue v;
+    bool is_div, check;
+
+    S = (size_t) hdr->samples; L = (size_t) hdr->lines;
+    B = (size_t) hdr->bands;
+    src_type = envi_test_part_type(hdr->data_type);
+    dst_type = (precision == 0) ? src_type : precision;
+    ncomp = img->sz / img->part_sz;
+    dst_part_sz = envi_get_data_type_size(dst_type);
+    /* complex images are not compared with the data ignore value */
+    check = ncomp == 1 && !isnan(hdr->data_ignore_value);
+    for(ib=0;ib<nb;ib++){
+        for(is=0;is<ns;is++){
+            for(il=0;il<nl;il++){
+                s = smpls[is]; l = lines[il]; b = bands[ib];
+                switch(hdr->interleave){
+                    case BSQ: idx = (b*L + l)*S + s; break;
+                    case BIL: idx = (l*B + b)*S + s; break;
+                    default:  idx = (l*S + s)*B + b; break;
+                }
+                is_div = false;
+                for(k=0;k<ncomp;k++){
+                    src = img->data + idx*img->sz + k*img->part_sz;
+                    dst = out + (ncomp*(il + nl*(is + ns*ib)) + k)
+                            * dst_part_sz;
+                    v = envi_test_load(src, src_type, img->swap);
+                    is_div = check && envi_test_is_div(v, src_type,
+                                            hdr->data_ignore_value);
+                    if(is_div && replace){
+                        envi_test_store(dst, dst_type,
+                            envi_test_value_double(repval));
+                    } else if(dst_type == src_type){
+                        /* the bits as they are (signaling NaNs) */
+                        memcpy(dst, src, img->part_sz);
+                        if(img->swap)
+                            envi_test_reverse(dst, img->part_sz);
+                    } else {
+                        envi_test_store(dst, dst_type, v);
+                    }
+                }
+                if(valid != NULL)
+                    valid[il + nl*(is + ns*ib)] = !is_div;
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Random images and selections
+ * --------------------------------------------------------------------- */
+/* function : envi_test_write_image
+ *  Write a random image of the geometry of img->hdr (header and image
+ *  file) and keep its elements in img->data. A sixth of the elements are
+ *  the data ignore value and a third are small numbers (halves for
+ *  floating point types) which are not saturated by the conversions. */
+static int envi_test_write_image(EnviTestImage *img)
+{
+    const EnviHeader *hdr = &img->hdr;
+    const char *interleave;
+    unsigned char *p;
+    size_t n, i, k, ncomp;
+    int32_t type;
+    double d;
+    FILE *fp;
+
+    interleave = (hdr->interleave == BSQ) ? "bsq"
+                    : ((hdr->interleave == BIL) ? "bil" : "bip");
+    fp = fopen(ENVI_TEST_HDR, "w");
+    if(fp == NULL)
+        return -1;
+    fprintf(fp, "ENVI\ndescription = {\n  test_envi_read}\n"
+        "samples = %d\nlines   = %d\nbands   = %d\nheader offset = %d\n"
+        "file type = ENVI Standard\ndata type = %d\ninterleave = %s\n"
+        "byte order = %d\n", hdr->samples, hdr->lines, hdr->bands,
+        hdr->header_offset, hdr->data_type, interleave, hdr->byte_order);
+    if(!isnan(hdr->data_ignore_value))
+        fprintf(fp, "data ignore value = %.17g\n", hdr->data_ignore_value);
+    fclose(fp);
+
+    type = envi_test_part_type(hdr->data_type);
+    img->sz = envi_get_data_type_size(hdr->data_type);
+    img->part_sz = envi_get_data_type_size(type);
+    ncomp = img->sz / img->part_sz;
+    n = (size_t) hdr->samples * (size_t) hdr->lines * (size_t) hdr->bands;
+    img->data = (unsigned char*) malloc(n * img->sz);
+    if(img->data == NULL)
+        return -5;
+    for(i=0;i<n*ncomp;i++){
+        p = img->data + i*img->part_sz;
+        switch(envi_test_rand_range(6)){
+            case 0:
+                d = hdr->data_ignore_value;
+                break;
+            case 1: case 2:
+                d = (double) ((long int) envi_test_rand_range(601) - 300);
+                if(envi_test_is_float(type))
+                    d /= 2;
+                break;
+            default:
+                for(k=0;k<img->part_sz;k++)
+                    p[k] = (unsigned char) envi_test_rand();
+                continue;
+        }
+        envi_test_store(p, type, envi_test_value_double(d));
+        if(img->swap)
+            envi_test_reverse(p, img->part_sz);
+    }
+
+    fp = fopen(ENVI_TEST_IMG, "wb");
+    if(fp == NULL)
+        return -1;
+    for(i=0;i<(size_t) hdr->header_offset;i++)
+        fputc('H', fp);
+    if(fwrite(img->data, img->sz, n, fp) != n){
+        fclose(fp);
+        return -4;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* function : envi_test_make_sel
+ *  Draw a skip-read list of a dimension of size d: the whole dimension,
+ *  one run, or up to ENVI_TEST_NLIST runs with random (possibly zero)
+ *  skips. */
+static void envi_test_make_sel(EnviTestSel *sel, size_t d)
+{
+    size_t pos, i, k, s, r;
+
+    pos = 0;
+    sel->N = 0;
+    switch(envi_test_rand_range(4)){
+        case 0:
+            sel->skip[0] = 0; sel->read[0] = d; sel->N = 1; pos = d;
+            break;
+        case 1:
+            s = envi_test_rand_range(d);
+            r = 1 + envi_test_rand_range(d - s);
+            sel->skip[0] = (long int) s; sel->read[0] = r; sel->N = 1;
+            pos = s + r;
+            break;
+        default:
+            while(pos < d && sel->N < ENVI_TEST_NLIST){
+                s = envi_test_rand_range(3);
+                if(pos + s >= d)
+                    break;
+                r = 1 + envi_test_rand_range(4);
+                if(pos + s + r > d)
+                    r = d - pos - s;
+                sel->skip[sel->N] = (long int) s; sel->read[sel->N] = r;
+                sel->N++;
+                pos += s + r;
+            }
+            if(sel->N == 0){
+                sel->skip[0] = 0; sel->read[0] = 1; sel->N = 1; pos = 1;
+            }
+            break;
+    }
+    sel->skip_last = (long int) (d - pos);
+    sel->n = 0;
+    pos = 0;
+    for(i=0;i<sel->N;i++){
+        pos += (size_t) sel->skip[i];
+        for(k=0;k<sel->read[i];k++)
+            sel->idx[sel->n++] = pos++;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Comparisons
+ * --------------------------------------------------------------------- */
+static const char *envi_test_mode_name[] = {
+    "fread", "mmap", "pread", "uring", "direct"
+};
+
+static const EnviReadMode envi_test_modes[] = {
+    ENVI_READ_FREAD, ENVI_READ_MMAP, ENVI_READ_PREAD, ENVI_READ_URING,
+    ENVI_READ_DIRECT
+};
+
+#define ENVI_TEST_NMODES (sizeof(envi_test_modes)/sizeof(envi_test_modes[0]))
+
+static int envi_test_check(int it, const char *what, int errflg,
+        const unsigned char *out, const unsigned char *ref, size_t nbytes,
+        const bool *valid, const bool *valid_ref, size_t n)
+{
+    if(errflg != 0){
+        fprintf(stderr, "iteration %d: %s failed: %s\n", it, what,
+            envi_strerror(errflg));
+        return 1;
+    }
+    if(memcmp(out, ref, nbytes) != 0){
+        fprintf(stderr, "iteration %d: %s differs from the reference\n",
+            it, what);
+        return 1;
+    }
+    if(valid != NULL && memcmp(valid, valid_ref, n) != 0){
+        fprintf(stderr, "iteration %d: the valid flags of %s differ from "
+            "the reference\n", it, what);
+        return 1;
+    }
+    return 0;
+}
+
+/* function : envi_test_iteration
+ *  Write an image and compare the readers with the reference on it. */
+static int envi_test_iteration(int it, EnviTestImage *img,
+        const EnviReadOption *opt0)
+{
+    EnviHeader hdr;
+    EnviReadOption opt;
+    EnviTestSel ssel, lsel, bsel;
+    EnviReadPlan rp;
+    EnviTileIter ti;
+    EnviTile tile;
+    unsigned char *out, *ref;
+    bool *valid, *valid_ref;
+    size_t bands[256], band_index[256];
+    size_t dims[3], tile_sz[3], n, nmax, nbytes, dst_sz, i, m, N_bi;
+    size_t lines_t[256], smpls_t[256], bands_t[256], ncovered, budget;
+    char what[64];
+    int errflg, nfail;
+
+    nfail = 0;
+    errflg = envi_header_read(&hdr, ENVI_TEST_HDR);
+    if(errflg != 0){
+        fprintf(stderr, "iteration %d: the header cannot be read: %s\n", it,
+            envi_strerror(errflg));
+        return 1;
+    }
+    if(hdr.samples != img->hdr.samples || hdr.lines != img->hdr.lines
+            || hdr.bands != img->hdr.bands
+            || hdr.data_type != img->hdr.data_type
+            || hdr.interleave != img->hdr.interleave
+            || hdr.byte_order != img->hdr.byte_order
+            || hdr.header_offset != img->hdr.header_offset
+            || (hdr.data_ignore_value != img->hdr.data_ignore_value
+                && !(isnan(hdr.data_ignore_value)
+                    && isnan(img->hdr.data_ignore_value)))){
+        fprintf(stderr, "iteration %d: the header is not read back\n", it);
+        return 1;
+    }
+    opt = *opt0;
+    dst_sz = (opt.precision == 0) ? img->sz
+                : envi_get_data_type_size(opt.precision)
+                    * (img->sz / img->part_sz);
+    nmax = (size_t) hdr.samples * (size_t) hdr.lines * (size_t) hdr.bands
+            * 2;
+    out = (unsigned char*) malloc(nmax * dst_sz);
+    ref = (unsigned char*) malloc(nmax * dst_sz);
+    valid = (bool*) malloc(nmax * sizeof(bool));
+    valid_ref = (bool*) malloc(nmax * sizeof(bool));
+    if(out == NULL || ref == NULL || valid == NULL || valid_ref == NULL){
+        free(out); free(ref); free(valid); free(valid_ref);
+        fprintf(stderr, "%s\n", envi_strerror(ENVI_ERR_NOMEM));
+        return 1;
+    }
+
+    /* rectangles with every read mode */
+    envi_test_make_sel(&ssel, (size_t) hdr.samples);
+    envi_test_make_sel(&lsel, (size_t) hdr.lines);
+    envi_test_make_sel(&bsel, (size_t) hdr.bands);
+    dims[0] = lsel.n; dims[1] = ssel.n; dims[2] = bsel.n;
+    n = dims[0] * dims[1] * dims[2];
+    nbytes = n * dst_sz;
+    envi_test_reference(img, lsel.idx, lsel.n, ssel.idx, ssel.n, bsel.idx,
+        bsel.n, opt.precision, opt.replace_div, opt.repval_div, ref,
+        valid_ref);
+    for(i=0;i<ENVI_TEST_NMODES;i++){
+        opt.read_mode = envi_test_modes[i];
+        opt.num_threads = 1 + envi_test_rand_range(3);
+        opt.coalesce_gap = envi_test_rand_range(2) ? 0
+                                : envi_test_rand_range(256);
+        opt.valid = envi_test_rand_range(2) ? valid : NULL;
+        memset(out, 0, nbytes);
+        memset(valid, 1, n);
+        errflg = lazyenvireadRectx_multBand_auto(ENVI_TEST_IMG, hdr,
+            ssel.skip, ssel.read, ssel.N, ssel.skip_last,
+            lsel.skip, lsel.read, lsel.N, lsel.skip_last,
+            bsel.skip, bsel.read, bsel.N, bsel.skip_last,
+            out, dims, img->sz, &opt, NULL);
+        sprintf(what, "the %s read", envi_test_mode_name[i]);
+        nfail += envi_test_check(it, what, errflg, out, ref, nbytes,
+            opt.valid, valid_ref, n);
+    }
+    opt.valid = NULL;
+
+    /* a read plan with a band_index: every selected band once, some
+     * twice, shuffled */
+    N_bi = 0;
+    for(i=0;i<bsel.n;i++)
+        band_index[N_bi++] = i;
+    m = envi_test_rand_range(bsel.n + 1);
+    for(i=0;i<m;i++)
+        band_index[N_bi++] = envi_test_rand_range(bsel.n);
+    for(i=N_bi;i>1;i--){
+        m = envi_test_rand_range(i);
+        bands[0] = band_index[i-1];
+        band_index[i-1] = band_index[m];
+        band_index[m] = bands[0];
+    }
+    for(i=0;i<N_bi;i++)
+        bands[i] = bsel.idx[band_index[i]];
+    opt.read_mode = envi_test_modes[envi_test_rand_range(ENVI_TEST_NMODES)];
+    n = dims[0] * dims[1] * N_bi;
+    nbytes = n * dst_sz;
+    envi_test_reference(img, lsel.idx, lsel.n, ssel.idx, ssel.n, bands,
+        N_bi, opt.precision, opt.replace_div, opt.repval_div, ref,
+        valid_ref);
+    errflg = envi_readplan_create(&rp, hdr, ssel.skip, ssel.read, ssel.N,
+        lsel.skip, lsel.read, lsel.N, bsel.skip, bsel.read, bsel.N,
+        band_index, N_bi, &opt);
+    if(errflg == 0){
+        /* twice: a plan is reusable */
+        for(i=0;i<2 && errflg == 0;i++){
+            memset(out, 0, nbytes);
+            memset(valid, 1, n);
+            errflg = envi_readplan_execute(&rp, ENVI_TEST_IMG, out, valid,
+                NULL);
+        }
+        envi_readplan_free(&rp);
+    }
+    sprintf(what, "the read plan (%s)", envi_test_mode_name[opt.read_mode]);
+    nfail += envi_test_check(it, what, errflg, out, ref, nbytes, valid,
+        valid_ref, n);
+
+    /* tiles covering the image: the sizes left to 0 are chosen within a
+     * budget of a few times the sizes given */
+    budget = dst_sz * (1 + envi_test_rand_range(8));
+    for(i=0;i<3;i++){
+        m = (i == 0) ? (size_t) hdr.lines : ((i == 1) ? (size_t) hdr.samples
+                                                      : (size_t) hdr.bands);
+        tile_sz[i] = envi_test_rand_range(3) ? 1 + envi_test_rand_range(m)
+                                             : 0;
+        if(tile_sz[i] > 0)
+            budget *= tile_sz[i];
+    }
+    opt.read_mode = envi_test_modes[envi_test_rand_range(ENVI_TEST_NMODES)];
+    errflg = envi_tileiter_init(&ti, hdr, tile_sz, budget, &opt);
+    ncovered = 0;
+    while(errflg == 0 && envi_tileiter_next(&ti, &tile)){
+        for(i=0;i<tile.count[0];i++) lines_t[i] = tile.start[0] + i;
+        for(i=0;i<tile.count[1];i++) smpls_t[i] = tile.start[1] + i;
+        for(i=0;i<tile.count[2];i++) bands_t[i] = tile.start[2] + i;
+        n = tile.count[0] * tile.count[1] * tile.count[2];
+        nbytes = n * dst_sz;
+        ncovered += n;
+        envi_test_reference(img, lines_t, tile.count[0], smpls_t,
+            tile.count[1], bands_t, tile.count[2], opt.precision,
+            opt.replace_div, opt.repval_div, ref, valid_ref);
+        memset(out, 0, nbytes);
+        memset(valid, 1, n);
+        errflg = envi_tileiter_read(&ti, ENVI_TEST_IMG, &tile, out, valid,
+                    NULL);
+        sprintf(what, "the tile %zu (%s)", tile.index,
+            envi_test_mode_name[opt.read_mode]);
+        nfail += envi_test_check(it, what, errflg, out, ref, nbytes, valid,
+            valid_ref, n);
+        if(nfail > 0)
+            break;
+    }
+    if(errflg == 0 && nfail == 0 && ncovered != nmax/2){
+        fprintf(stderr, "iteration %d: the tiles cover %zu of %zu "
+            "elements\n", it, ncovered, nmax/2);
+        nfail++;
+    } else if(errflg != 0 && nfail == 0){
+        fprintf(stderr, "iteration %d: the tile iteration failed: %s\n", it,
+            envi_strerror(errflg));
+        nfail++;
+    }
+
+    free(out); free(ref); free(valid); free(valid_ref);
+    return nfail;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int32_t data_types[] = {1, 2, 3, 4, 5, 6, 9, 12, 13, 14, 15,
+                                         16};
+    static const int32_t precisions[] = {0, 0, 4, 5, 1, 2, 12, 13, 14, 16};
+    static const double divs[] = {5, -1, 0, 255, 1e10};
+    static const double repvals[] = {-1, 0, 7.5, 1e300};
+    static const double float_divs[] = {-1.23e34, -3.40282e+38};
+    const size_t ntypes = sizeof(data_types)/sizeof(data_types[0]);
+    EnviTestImage img;
+    EnviReadOption opt;
+    bool cached;
+    int it, niter, nfail;
+
+    niter = (argc > 1) ? atoi(argv[1]) : 360;
+    nfail = 0;
+    for(it=0;it<niter && nfail==0;it++){
+        img.hdr.data_type = data_types[(size_t) it % ntypes];
+        img.hdr.interleave = (EnviHeaderInterleave) ((size_t) it / ntypes
+                                                        % 3);
+        img.hdr.byte_order = (int32_t) ((size_t) it / ntypes / 3 % 2);
+        img.swap = (img.hdr.byte_order == 1) == isComputerLSBF();
+        img.hdr.samples = (int32_t) (1 + envi_test_rand_range(24));
+        img.hdr.lines = (int32_t) (1 + envi_test_rand_range(24));
+        img.hdr.bands = (int32_t) (1 + envi_test_rand_range(12));
+        img.hdr.header_offset = (int32_t) envi_test_rand_range(18);
+        img.hdr.file_type = NULL;
+        img.hdr.data_ignore_value = envi_test_rand_range(8) ? divs[
+                envi_test_rand_range(sizeof(divs)/sizeof(divs[0]))] : NAN;
+        if(it < 4){
+            img.hdr.data_type = 4;
+            img.hdr.data_ignore_value = float_divs[it % 2];
+        }
+        if(envi_test_write_image(&img) != 0){
+            fprintf(stderr, "iteration %d: the image cannot be written\n",
+                it);
+            return 1;
+        }
+
+        envi_read_option_init(&opt);
+        opt.precision = precisions[envi_test_rand_range(
+                            sizeof(precisions)/sizeof(precisions[0]))];
+        if(img.sz != img.part_sz && opt.precision != 0)
+            opt.precision = 4 + (int32_t) envi_test_rand_range(2);
+        opt.replace_div = envi_test_rand_range(2);
+        opt.repval_div = repvals[envi_test_rand_range(
+                            sizeof(repvals)/sizeof(repvals[0]))];
+        if(it < 4){
+            opt.precision = 4 + it / 2;
+            opt.replace_div = true;
+        }
+
+        /* the image file is rewritten in place at each iteration */
+        cached = it % 4 == 3
+                    && envi_cache_configure(4096 * (1
+                        + envi_test_rand_range(8)), 512) == 0;
+        envi_filepool_configure(cached ? 2 : 0);
+        nfail += envi_test_iteration(it, &img, &opt);
+        if(cached)
+            envi_cache_free();
+        free(img.data);
+    }
+    envi_filepool_configure(0);
+    remove(ENVI_TEST_HDR);
+    remove(ENVI_TEST_IMG);
+    if(nfail == 0)
+        printf("%d iterations: all the reads match the reference\n", it);
+    return nfail != 0;
+}
@@ -0,0 +1,89 @@
+function [stats] = envi_block_cache(command,varargin)
+% [stats] = envi_block_cache(command,varargin)
+%   Control the in-process LRU block cache of the lazy ENVI readers. The
+%   blocks of the files read with the 'pread' back-end (the 'default'
+%   READ_MODE while the cache is enabled) and by the pixel readers are kept
+%   in memory across calls, so that reading the same part of a file again
+%   is served from memory. A cached block is dropped as soon as its file
+%   is found to be changed (inode, size, modification or status change
+%   time). Each MEX file has its own cache, and stays loaded (mexLock)
+%   while its cache is enabled.
+% INPUTS
+%   command: char, string
+%      'configure': set the capacity and the block size, and empty the
+%                   cache. A capacity of 0 disables the cache.
+%      'stats'    : get the counters.
+%      'clear'    : drop the cached blocks and reset the counters.
+% OUTPUTS
+%   stats: struct array, one element per MEX file (see MEX_FILES), with
+%      fields
+%       capacity     : capacity (bytes)
+%       block_size   : size of the blocks (bytes)
+%       nblocks      : number of cached blocks
+%       bytes_cached : bytes held by the cached blocks
+%       hits         : number of block reads served from the cache
+%       misses       : number of blocks read from the file
+%       bytes_hit    : bytes copied out of the cache
+%       bytes_miss   : bytes read from the file into the cache
+%       bytes_bypass : bytes of the reads larger than half the capacity,
+%                      which go directly to the file
+%       evictions    : number of least recently used blocks evicted
+%       invalidations: number of blocks dropped because their file changed
+%      and mex_file, the name of the MEX file.
+% OPTIONAL PARAMETERS
+%  "CAPACITY": integer, capacity of the cache (bytes) for 'configure'.
+%      (default) 268435456 (256 MiB)
+%  "BLOCK_SIZE": integer, size of the blocks (bytes) for 'configure'.
+%      (default) 262144 (256 KiB)
+%  "MEX_FILES": cell array of the names of the MEX files to apply the
+%      command to.
+%      (default) {'lazyenvireadRectxv2_multBandRaster_mex',
+%                 'lazyenvireadPixelsx_multBandRaster_mex',
+%                 'lazyenvireadGLTx_multBandRaster_mex',
+%                 'lazyenvireadGLTProjx_multBandRaster_mex'}
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+capacity   = 256*1024*1024;
+block_size = 256*1024;
+mex_files  = {'lazyenvireadRectxv2_multBandRaster_mex', ...
+              'lazyenvireadPixelsx_multBandRaster_mex', ...
+              'lazyenvireadGLTx_multBandRaster_mex', ...
+              'lazyenvireadGLTProjx_multBandRaster_mex'};
+if (rem(length(varargin),2)==1)
+    error('Optional parameters should always go by pairs');
+else
+    for i=1:2:(length(varargin)-1)
+        switch upper(varargin{i})
+            case 'CAPACITY'
+                capacity = varargin{i+1};
+            case 'BLOCK_SIZE'
+                block_size = varargin{i+1};
+            case 'MEX_FILES'
+                mex_files = varargin{i+1};
+                if ischar(mex_files), mex_files = {mex_files}; end
+            otherwise
+                error('Unrecognized option: %s',varargin{i});
+        end
+    end
+end
+
+command = lower(command);
+switch command
+    case 'configure'
+        args = {'-cache',command,double(capacity),double(block_size)};
+    case {'stats','clear'}
+        args = {'-cache',command};
+    otherwise
+        error('Unrecognized command: %s',command);
+end
+
+stats = [];
+for i=1:length(mex_files)
+    st = feval(mex_files{i},args{:});
+    st.mex_file = mex_files{i};
+    stats = [stats st];
+end
+
+end
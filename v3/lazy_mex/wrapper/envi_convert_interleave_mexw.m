@@ -0,0 +1,43 @@
+function [img_out] = envi_convert_interleave_mexw(img,from,to,varargin)
+% [img_out] = envi_convert_interleave_mexw(img,from,to,varargin)
+%   convert an image cube in memory from one interleave to another. The
+%   MEX function uses the same cache-blocked, multithreaded transpose as
+%   the readers.
+% INPUTS
+%   img : numeric or logical array, 3-dimensional, in the layout "from"
+%   from, to : char, string; layout of img and of img_out.
+%      'bsq' [samples x lines x bands]
+%      'bil' [samples x bands x lines]
+%      'bip' [bands x samples x lines]
+%      'lsb' [lines x samples x bands] (layout returned by the readers)
+%      The first three are the orders of the data in ENVI files of the 
+%      corresponding interleave, as read with fread.
+% OUTPUTS
+%   img_out: array of the class of img, in the layout "to".
+% 
+% OPTIONAL PARAMETERS
+%  "NUM_THREADS": integer, number of threads. 0 uses the number of 
+%      available processors.
+%      (default) 0
+% 
+% Copyright (C) 2021 Yuki Itoh <yukiitohand@gmail.com>
+% 
+
+num_threads = 0;
+if (rem(length(varargin),2)==1)
+    error('Optional parameters should always go by pairs');
+else
+    for i=1:2:(length(varargin)-1)
+        switch upper(varargin{i})
+            case 'NUM_THREADS'
+                num_threads = varargin{i+1};
+            otherwise
+                error('Unrecognized option: %s',varargin{i});
+        end
+    end
+end
+
+img_out = envi_convert_interleave_mex(img,lower(from),lower(to), ...
+    double(num_threads));
+
+end
@@ -0,0 +1,96 @@
+function [stats] = envi_file_pool(command,varargin)
+% [stats] = envi_file_pool(command,varargin)
+%   Control the pool of open image files of the lazy ENVI readers. The
+%   readers keep the image files they read open across calls (up to the
+%   capacity of the pool, least recently used files are closed first), so
+%   that a loop of small reads does not open, size and close the file
+%   every time. A pooled file is reused only while it is still the file at
+%   its path (same inode, size, modification and status change times),
+%   and is reopened otherwise. Each MEX file has its own pool, which is
+%   closed when the MEX file is cleared.
+% INPUTS
+%   command: char, string
+%      'configure': set the capacity of the pool, closing the pooled
+%                   files. A capacity of 0 disables the pool.
+%      'stats'    : get the counters.
+%      'close'    : close the pooled file of the image file imgpath (e.g.,
+%                   before the file is overwritten or deleted).
+%      'flush'    : close all the pooled files.
+% OUTPUTS
+%   stats: struct array, one element per MEX file (see MEX_FILES), with
+%      fields
+%       capacity : maximum number of pooled files
+%       nopen    : number of pooled files
+%       hits     : number of reads served by a pooled file
+%       misses   : number of reads that opened their file
+%       reopens  : number of pooled files reopened because their file
+%                  changed
+%       evictions: number of pooled files closed to make room
+%      and mex_file, the name of the MEX file.
+% OPTIONAL PARAMETERS
+%  "CAPACITY": integer, number of pooled files for 'configure'.
+%      (default) 16
+%  "IMGPATH": char, string, path to the image file for 'close'.
+%  "MEX_FILES": cell array of the names of the MEX files to apply the
+%      command to. 'close' and 'flush' skip the MEX files not loaded.
+%      (default) {'lazyenvireadRectxv2_multBandRaster_mex',
+%                 'lazyenvireadPixelsx_multBandRaster_mex',
+%                 'lazyenvireadGLTx_multBandRaster_mex',
+%                 'lazyenvireadGLTProjx_multBandRaster_mex'}
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+capacity   = 16;
+imgpath    = '';
+mex_files  = {'lazyenvireadRectxv2_multBandRaster_mex', ...
+              'lazyenvireadPixelsx_multBandRaster_mex', ...
+              'lazyenvireadGLTx_multBandRaster_mex', ...
+              'lazyenvireadGLTProjx_multBandRaster_mex'};
+if (rem(length(varargin),2)==1)
+    error('Optional parameters should always go by pairs');
+else
+    for i=1:2:(length(varargin)-1)
+        switch upper(varargin{i})
+            case 'CAPACITY'
+                capacity = varargin{i+1};
+            case 'IMGPATH'
+                imgpath = varargin{i+1};
+            case 'MEX_FILES'
+                mex_files = varargin{i+1};
+                if ischar(mex_files), mex_files = {mex_files}; end
+            otherwise
+                error('Unrecognized option: %s',varargin{i});
+        end
+    end
+end
+
+command = lower(command);
+switch command
+    case 'configure'
+        args = {'-files',command,double(capacity)};
+    case 'close'
+        if isempty(imgpath)
+            error('IMGPATH is necessary for close');
+        end
+        args = {'-files',command,imgpath};
+    case {'stats','flush'}
+        args = {'-files',command};
+    otherwise
+        error('Unrecognized command: %s',command);
+end
+
+% closing files does not need to load the MEX files that hold none.
+if any(strcmp(command,{'close','flush'}))
+    [~,mex_loaded] = inmem;
+    mex_files = mex_files(ismember(mex_files,mex_loaded));
+end
+
+stats = [];
+for i=1:length(mex_files)
+    st = feval(mex_files{i},args{:});
+    st.mex_file = mex_files{i};
+    stats = [stats st];
+end
+
+end
@@ -0,0 +1,86 @@
+function [read_opt,opts] = envi_read_options(hdr,varargin)
+% [read_opt,opts] = envi_read_options(hdr,varargin)
+%   Parse the optional parameters shared by the readers into the struct
+%   of the reading options taken by the MEX functions. The precision 'raw'
+%   is resolved with the data type of hdr, and the defaults of the
+%   replacement of data_ignore_value depend on the precision.
+% INPUTS
+%   hdr : ENVI header struct
+%   varargin: pairs of the optional parameters of the reader
+% OUTPUTS
+%   read_opt: struct with the fields read_mode, num_threads, queue_depth,
+%      coalesce_gap, precision (lower case), replace_div and repval_div.
+%   opts: cell array, the pairs of the other optional parameters, left to
+%      the reader.
+%
+% OPTIONAL PARAMETERS
+%   "PRECISION", "REPLACE_DATA_IGNORE_VALUE", "REPVAL_DATA_IGNORE_VALUE",
+%   "READ_MODE", "NUM_THREADS", "QUEUE_DEPTH", "COALESCE_GAP"
+%      Refer "lazyenvireadRectxv2_multBandRaster_mexw.m".
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+precision  = 'double';
+rep_div    = [];
+repval_div = [];
+read_mode  = 'default';
+num_threads = 0;
+queue_depth = 0;
+coalesce_gap = [];
+opts = {};
+if (rem(length(varargin),2)==1)
+    error('Optional parameters should always go by pairs');
+else
+    for i=1:2:(length(varargin)-1)
+        switch upper(varargin{i})
+            case 'PRECISION'
+                precision = varargin{i+1};
+            case 'REPLACE_DATA_IGNORE_VALUE'
+                rep_div = varargin{i+1};
+            case 'REPVAL_DATA_IGNORE_VALUE'
+                repval_div = varargin{i+1};
+            case 'READ_MODE'
+                read_mode = lower(varargin{i+1});
+            case 'NUM_THREADS'
+                num_threads = varargin{i+1};
+            case 'QUEUE_DEPTH'
+                queue_depth = varargin{i+1};
+            case 'COALESCE_GAP'
+                coalesce_gap = varargin{i+1};
+            otherwise
+                opts = [opts varargin(i:i+1)];
+        end
+    end
+end
+
+[precision_raw] = envihdr_get_precision_sizeA_from_data_type(...
+    hdr.data_type);
+
+if strcmpi(precision,'raw')
+    precision = precision_raw;
+end
+
+switch lower(precision)
+    case {'single','double'}
+        if isempty(rep_div), rep_div = true; end
+        if rep_div && isempty(repval_div), repval_div = nan; end
+    case {'uint8','uint16','uint32','uint64','int8','int16','int32','int64'}
+        if isempty(rep_div), rep_div = false; end
+        if rep_div && isempty(repval_div)
+            fprintf(...
+                ['With integer precision, explicitly specify '
+                 '"REPVAL_DATA_IGNORE_VALUE"\n']...
+              );
+            rep_div = false;
+        end
+    otherwise
+        error('Not implemented yet for data_type %s.',precision);
+end
+
+read_opt = struct('read_mode',read_mode,'num_threads',num_threads, ...
+    'queue_depth',queue_depth,'coalesce_gap',coalesce_gap, ...
+    'precision',lower(precision),'replace_div',rep_div, ...
+    'repval_div',repval_div);
+
+end
@@ -0,0 +1,108 @@
+classdef envi_read_plan < handle
+% obj = envi_read_plan(imgpath,hdr,...
+%    sample_rangelist,line_rangelist,band_rangelist,varargin)
+%   Prepared read of a rectangular window of a multi-band raster image,
+%   for windows read again and again (e.g., by a viewer). The inputs are
+%   checked, converted into skip-read lists and resolved with the I/O
+%   plan of the read once by the constructor, so that each read only
+%   reads the file. The plan can also read any other image file with the
+%   same geometry (samples, lines, bands, header_offset, data_type,
+%   byte_order and interleave of hdr).
+% INPUTS
+%   same as lazyenvireadRectxv2_multBandRaster_mexw
+% OPTIONAL PARAMETERS
+%   same as lazyenvireadRectxv2_multBandRaster_mexw
+% METHODS
+%   [subimg,valid,io_stats] = read(obj)
+%   [subimg,valid,io_stats] = read(obj,imgpath)
+%      read the window of imgpath (default: obj.imgpath), with the outputs
+%      of lazyenvireadRectxv2_multBandRaster_mexw.
+% The plan lives in lazyenvireadRectxv2_multBandRaster_mex, which stays
+% in memory while it holds plans. It is freed when the object is deleted.
+%
+% Example
+%   plan = envi_read_plan(imgpath,hdr,[101 356],[1001 1256],[1 hdr.bands]);
+%   for i=1:100, subimg = plan.read(); ... end
+%   delete(plan);
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+    properties (SetAccess = private)
+        imgpath
+        hdr
+        sample_rangelist
+        line_rangelist
+        band_rangelist
+        read_opt   % reading options (see envi_read_options)
+        bands_out  % bands of the image held by subimg
+        handle
+    end
+
+    methods
+        function obj = envi_read_plan(imgpath,hdr,...
+                sample_rangelist,line_rangelist,band_rangelist,varargin)
+            [read_opt,opts] = envi_read_options(hdr,varargin{:});
+            band_index = [];
+            for i=1:2:(length(opts)-1)
+                switch upper(opts{i})
+                    case 'BAND_INDEX'
+                        band_index = opts{i+1};
+                    otherwise
+                        error('Unrecognized option: %s',opts{i});
+                end
+            end
+
+            dir_info = dir(imgpath);
+            obj.imgpath = fullfile(dir_info.folder,dir_info.name);
+            obj.hdr = hdr;
+            obj.sample_rangelist = sample_rangelist;
+            obj.line_rangelist = line_rangelist;
+            obj.band_rangelist = band_rangelist;
+            obj.bands_out = rangelist2ind(band_rangelist);
+            if ~isempty(band_index)
+                obj.bands_out = obj.bands_out(band_index);
+            end
+
+            [sample_skipszlist,sample_readszlist] = ...
+                rangelist2skipreadsizelist(sample_rangelist);
+            [line_skipszlist,line_readszlist] = ...
+                rangelist2skipreadsizelist(line_rangelist);
+            [band_skipszlist,band_readszlist] = ...
+                rangelist2skipreadsizelist(band_rangelist);
+            read_opt.band_index = double(band_index(:));
+            obj.read_opt = read_opt;
+            obj.handle = lazyenvireadRectxv2_multBandRaster_mex('-plan', ...
+                'create',obj.imgpath,hdr,sample_skipszlist, ...
+                sample_readszlist,line_skipszlist,line_readszlist, ...
+                band_skipszlist,band_readszlist,read_opt);
+        end
+
+        function [subimg,valid,io_stats] = read(obj,imgpath)
+            if nargin < 2
+                imgfullpath = obj.imgpath;
+            else
+                dir_info = dir(imgpath);
+                imgfullpath = fullfile(dir_info.folder,dir_info.name);
+            end
+            mex_out = cell(1,max(1,min(nargout,3)));
+            valid = [];
+            io_stats = [];
+            [mex_out{:}] = lazyenvireadRectxv2_multBandRaster_mex('-plan', ...
+                'read',obj.handle,imgfullpath);
+            subimg = mex_out{1};
+            if numel(mex_out)>1, valid = mex_out{2}; end
+            if numel(mex_out)>2, io_stats = mex_out{3}; end
+
+            [subimg,valid] = envi_replace_band_div(subimg,valid, ...
+                obj.hdr,obj.bands_out,3,obj.read_opt);
+        end
+
+        function delete(obj)
+            if ~isempty(obj.handle)
+                lazyenvireadRectxv2_multBandRaster_mex('-plan','free', ...
+                    obj.handle);
+            end
+        end
+    end
+end
@@ -0,0 +1,46 @@
+function [img,valid] = envi_replace_band_div(img,valid,hdr,bands,dim,...
+    read_opt,has_src)
+% [img,valid] = envi_replace_band_div(img,valid,hdr,bands,dim,...
+%    read_opt,has_src)
+%   Replace a data_ignore_value given for each band, which is not handled
+%   by the MEX functions (they only take a scalar data_ignore_value).
+%   Nothing is done if hdr.data_ignore_value is not given for each band.
+% INPUTS
+%   img: array read by a MEX function, its bands along the dimension dim
+%   valid: logical array, same size as img, or [] if not requested
+%   hdr : ENVI header struct
+%   bands: vector, bands of the image (1-based) held by img
+%   dim: dimension of the bands in img (3 for [L x S x bands], 2 for
+%      [N x bands])
+%   read_opt: struct of the reading options (see envi_read_options)
+%   has_src: (optional) logical array, broadcast against img, false where
+%      the element has no source pixel and keeps its fill value.
+% OUTPUTS
+%   img: the elements equal to the data_ignore_value of their band are
+%      replaced with read_opt.repval_div if read_opt.replace_div is true.
+%   valid: also false where the elements are equal to the
+%      data_ignore_value of their band.
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+if ~isfield(hdr,'data_ignore_value') ...
+        || numel(hdr.data_ignore_value) ~= hdr.bands || hdr.bands < 2
+    return;
+end
+if ~read_opt.replace_div && isempty(valid)
+    return;
+end
+
+div = cast(reshape(hdr.data_ignore_value(bands),...
+    [ones(1,dim-1) numel(bands)]),class(img));
+is_div = (img==div);
+if nargin > 6
+    is_div = is_div & has_src;
+end
+if read_opt.replace_div
+    img(is_div) = cast(read_opt.repval_div,class(img));
+end
+if ~isempty(valid), valid = valid & ~is_div; end
+
+end
@@ -0,0 +1,125 @@
+classdef envi_tile_iterator < handle
+% obj = envi_tile_iterator(imgpath,hdr,varargin)
+%   Iterator over the tiles of [lines x samples x bands] of a multi-band
+%   raster image, for processing the whole image with a bounded memory.
+%   The tiles are visited in the order of the file (e.g., bands of a BSQ
+%   image last), so that the file is read forward, and only one tile is
+%   held in memory at a time. The tiles on the far edges are smaller.
+% INPUTS
+%   imgpath: path to the image file
+%   hdr: struct of the header
+% OPTIONAL PARAMETERS
+%   'TILE_SIZE': [lines samples bands] of a tile. The sizes set to 0 are
+%      chosen to fit in MAX_BYTES, giving the whole extent to the
+%      dimensions varying fastest in the file first.
+%      (default) [0 0 0]
+%   'MAX_BYTES': maximum size (bytes) of a tile in the output precision
+%      (0: 64 MiB).
+%      (default) 0
+%   'PRECISION', 'REPLACE_DATA_IGNORE_VALUE', 'REPVAL_DATA_IGNORE_VALUE',
+%   'READ_MODE', 'NUM_THREADS', 'QUEUE_DEPTH', 'COALESCE_GAP'
+%      same as lazyenvireadRectxv2_multBandRaster_mexw
+% PROPERTIES
+%   tile_size: [lines samples bands] of a tile
+%   num_tiles: number of the tiles along [lines samples bands]
+%   num_tiles_total: number of the tiles
+% METHODS
+%   tf = hasNext(obj)
+%      true if some tiles have not been visited yet.
+%   [tile,valid,range,io_stats] = next(obj)
+%      read the next tile, with the outputs of
+%      lazyenvireadRectxv2_multBandRaster_mexw. range is the tile given by
+%      [first last] (3 x 2) of its lines, samples, and bands in the image.
+%   reset(obj)
+%      restart from the first tile.
+% The iterator lives in lazyenvireadRectxv2_multBandRaster_mex. It is
+% freed when the object is deleted.
+%
+% Example
+%   it = envi_tile_iterator(imgpath,hdr,'MAX_BYTES',256*2^20);
+%   while it.hasNext()
+%       [tile,~,range] = it.next(); ...
+%   end
+%   delete(it);
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+    properties (SetAccess = private)
+        imgpath
+        hdr
+        read_opt   % reading options (see envi_read_options)
+        tile_size
+        num_tiles
+        num_tiles_total
+        handle
+    end
+
+    methods
+        function obj = envi_tile_iterator(imgpath,hdr,varargin)
+            tile_size  = [0 0 0];
+            max_bytes  = 0;
+            [read_opt,opts] = envi_read_options(hdr,varargin{:});
+            for i=1:2:(length(opts)-1)
+                switch upper(opts{i})
+                    case 'TILE_SIZE'
+                        tile_size = opts{i+1};
+                    case 'MAX_BYTES'
+                        max_bytes = opts{i+1};
+                    otherwise
+                        error('Unrecognized option: %s',opts{i});
+                end
+            end
+
+            dir_info = dir(imgpath);
+            obj.imgpath = fullfile(dir_info.folder,dir_info.name);
+            obj.hdr = hdr;
+            obj.read_opt = read_opt;
+
+            [obj.handle,info] = lazyenvireadRectxv2_multBandRaster_mex( ...
+                '-tiles','create',hdr,double(tile_size(:)), ...
+                double(max_bytes),read_opt);
+            obj.tile_size = info.tile_size;
+            obj.num_tiles = info.num_tiles;
+            obj.num_tiles_total = info.num_tiles_total;
+        end
+
+        function tf = hasNext(obj)
+            info = lazyenvireadRectxv2_multBandRaster_mex('-tiles', ...
+                'info',obj.handle);
+            tf = info.next_tile <= info.num_tiles_total;
+        end
+
+        function [tile,valid,range,io_stats] = next(obj)
+            range = lazyenvireadRectxv2_multBandRaster_mex('-tiles', ...
+                'next',obj.handle);
+            if isempty(range)
+                error('envi_tile_iterator:NoMoreTiles', ...
+                    'All the tiles have been visited.');
+            end
+            mex_out = cell(1,max(1,min(nargout,3)));
+            valid = [];
+            io_stats = [];
+            [mex_out{:}] = lazyenvireadRectxv2_multBandRaster_mex('-tiles', ...
+                'read',obj.handle,obj.imgpath,range);
+            tile = mex_out{1};
+            if numel(mex_out)>1, valid = mex_out{2}; end
+            if numel(mex_out)>2, io_stats = mex_out{3}; end
+
+            [tile,valid] = envi_replace_band_div(tile,valid,obj.hdr, ...
+                range(3,1):range(3,2),3,obj.read_opt);
+        end
+
+        function reset(obj)
+            lazyenvireadRectxv2_multBandRaster_mex('-tiles','reset', ...
+                obj.handle);
+        end
+
+        function delete(obj)
+            if ~isempty(obj.handle)
+                lazyenvireadRectxv2_multBandRaster_mex('-tiles','free', ...
+                    obj.handle);
+            end
+        end
+    end
+end
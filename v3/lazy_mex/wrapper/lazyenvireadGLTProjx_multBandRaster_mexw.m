@@ -0,0 +1,105 @@
+function [img_proj] = lazyenvireadGLTProjx_multBandRaster_mexw(imgpath,hdr,...
+   glt_x,glt_y,band_rangelist,varargin)
+% [img_proj] = lazyenvireadGLTProjx_multBandRaster_mexw(imgpath,hdr,...
+%    glt_x,glt_y,band_rangelist,varargin)
+%   project a multi-band raster image through a geometric lookup table 
+%   (GLT) directly from its file. Image needs to be stored 
+%   non-compressiond binary format. Only the bounding box of the source 
+%   pixels is read, a group of bands at a time, so the unprojected cube is
+%   never loaded as a whole.
+% INPUTS
+%   imgpath: path to the image file of the source image
+%   hdr : ENVI header struct of the source image
+%   glt_x,glt_y: [L x S] arrays, source samples and lines of the projected
+%      pixels. The pixels whose glt_x or glt_y is out of the source image
+%      (e.g., 0 or NaN) have no source.
+%   band_rangelist: 2-column array, representing the selected ranges of
+%      band.
+% OUTPUTS
+%   img_proj: array [L x S x bands]
+%      complex data types (6 and 9) are returned as complex arrays.
+%
+% OPTIONAL PARAMETERS
+%   "PRECISION": char, string; data type of the output image.
+%       'raw','double', 'single','int8','int16', 'int32','int64'
+%       'uint8','uint16','uint32','uint64'
+%      if 'raw', the data is returned with the original data type of the
+%      image.
+%      (default) 'double'
+%  "Replace_data_ignore_value": boolean,
+%      whether or not to replace data_ignore_value with NaNs or not.
+%      (default) true (for single and double data types)
+%                false (for integer types)
+%  "RepVal_data_ignore_value":
+%      replaced values for the pixels with data_ignore_value.
+%      (default) nan (for double and single precisions). Need to specify
+%                for integer precisions.
+%  "FILL_VALUE": value of the pixels without a source, cast to the
+%      precision.
+%      (default) nan
+%  "GLT_NEGATIVE_ABS": boolean, whether negative GLT entries (pixels
+%      ENVI filled with their nearest neighbor) refer to the source pixel
+%      of their absolute value (true) or have no source (false).
+%      (default) false
+%  "READ_MODE": char, string; back-end used to read the file.
+%      'fread', 'mmap', 'pread', 'uring', 'direct', 'default'
+%      Refer "lazyenvireadRectxv2_multBandRaster_mexw.m".
+%      (default) 'default'
+%  "NUM_THREADS": integer, number of threads projecting the output lines
+%      (and reading in the 'pread' mode). 0 uses the number of available
+%      processors.
+%      (default) 0
+%  "QUEUE_DEPTH": integer, number of reads in flight in the 'uring' mode.
+%      (default) 0 (64, defined in envi_uring.h)
+%  "COALESCE_GAP": integer, neighboring runs of the selected pixels and
+%      bands separated by no more than this many bytes are read with one
+%      read call and the wanted parts are copied out.
+%      (default) [] (64 KiB, defined in envi_v2.h)
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+
+
+[read_opt,opts] = envi_read_options(hdr,varargin{:});
+fill_value = nan;
+glt_neg_abs = false;
+for i=1:2:(length(opts)-1)
+    switch upper(opts{i})
+        case 'FILL_VALUE'
+            fill_value = opts{i+1};
+        case 'GLT_NEGATIVE_ABS'
+            glt_neg_abs = opts{i+1};
+        otherwise
+            error('Unrecognized option: %s',opts{i});
+    end
+end
+
+if ~ismatrix(glt_x) || any(size(glt_x) ~= size(glt_y))
+    error('glt_x and glt_y need to be matrices of the same size.');
+end
+
+dir_info = dir(imgpath);
+imgfullpath = fullfile(dir_info.folder,dir_info.name);
+
+%%
+[band_skipszlist,band_readszlist] = rangelist2skipreadsizelist(band_rangelist);
+read_opt.fill_value = fill_value;
+read_opt.glt_neg_abs = logical(glt_neg_abs);
+
+%%
+[img_proj] = lazyenvireadGLTProjx_multBandRaster_mex(...
+    imgfullpath,hdr,double(glt_x),double(glt_y), ...
+    band_skipszlist,band_readszlist,read_opt);
+
+% the pixels without a source keep fill_value.
+if glt_neg_abs
+    glt_x = abs(glt_x); glt_y = abs(glt_y);
+end
+has_src = glt_x>0.5 & glt_x<hdr.samples+0.5 ...
+    & glt_y>0.5 & glt_y<hdr.lines+0.5;
+img_proj = envi_replace_band_div(img_proj,[],hdr, ...
+    rangelist2ind(band_rangelist),3,read_opt,has_src);
+
+
+end
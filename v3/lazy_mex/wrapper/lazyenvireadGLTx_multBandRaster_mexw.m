@@ -0,0 +1,105 @@
+function [subimg,valid,io_stats] = lazyenvireadGLTx_multBandRaster_mexw(imgpath,hdr,...
+   glt_x,glt_y,band_rangelist,varargin)
+% [subimg,valid,io_stats] = lazyenvireadGLTx_multBandRaster_mexw(imgpath,hdr,...
+%    glt_x,glt_y,band_rangelist,varargin)
+%   read a window of a projected image defined by a geometric lookup table
+%   (GLT) from the source multi-band raster image. Image needs to be 
+%   stored non-compressiond binary format. The source pixels of the window
+%   are sorted by their position in the file and each distinct one is read
+%   once, with the reads of neighboring pixels merged.
+% INPUTS
+%   imgpath: path to the image file of the source image
+%   hdr : ENVI header struct of the source image
+%   glt_x,glt_y: [L x S] arrays, source samples and lines of the pixels of
+%      the window. The pixels whose glt_x or glt_y is out of the source
+%      image (e.g., 0, negative, or NaN) have no source.
+%   band_rangelist: 2-column array, representing the selected ranges of
+%      band.
+% OUTPUTS
+%   subimg: array [L x S x bands]
+%      complex data types (6 and 9) are returned as complex arrays.
+%   valid: logical array, same size as subimg, false where the pixel has
+%      data_ignore_value or no source. It is computed while reading.
+%   io_stats: struct, statistics of the I/O plans (coalesced reads), with
+%      fields n_syscalls, n_copies, bytes_read, and bytes_used.
+%
+% OPTIONAL PARAMETERS
+%   "PRECISION": char, string; data type of the output image.
+%       'raw','double', 'single','int8','int16', 'int32','int64'
+%       'uint8','uint16','uint32','uint64'
+%      if 'raw', the data is returned with the original data type of the
+%      image.
+%      (default) 'double'
+%  "Replace_data_ignore_value": boolean,
+%      whether or not to replace data_ignore_value with NaNs or not.
+%      (default) true (for single and double data types)
+%                false (for integer types)
+%  "RepVal_data_ignore_value":
+%      replaced values for the pixels with data_ignore_value.
+%      (default) nan (for double and single precisions). Need to specify
+%                for integer precisions.
+%  "FILL_VALUE": value of the pixels without a source, cast to the
+%      precision.
+%      (default) nan
+%  "COALESCE_GAP": integer, neighboring runs of the selected pixels and
+%      bands separated by no more than this many bytes are read with one
+%      read call and the wanted parts are copied out.
+%      (default) [] (64 KiB, defined in envi_v2.h)
+%  "READ_MODE": char, string; 'uring' submits the reads of the pixels to
+%      an io_uring (Linux 5.6 or later), QUEUE_DEPTH of them in flight,
+%      instead of reading them one after the other. Any other mode reads
+%      them with fread.
+%      (default) 'default'
+%  "QUEUE_DEPTH": integer, number of reads in flight in the 'uring' mode.
+%      (default) 0 (64, defined in envi_uring.h)
+%  "NUM_THREADS": not used, the pixels are read by one thread (accepted
+%      as by the other readers).
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+
+
+[read_opt,opts] = envi_read_options(hdr,varargin{:});
+fill_value = nan;
+for i=1:2:(length(opts)-1)
+    switch upper(opts{i})
+        case 'FILL_VALUE'
+            fill_value = opts{i+1};
+        otherwise
+            error('Unrecognized option: %s',opts{i});
+    end
+end
+
+if ~ismatrix(glt_x) || any(size(glt_x) ~= size(glt_y))
+    error('glt_x and glt_y need to be matrices of the same size.');
+end
+
+dir_info = dir(imgpath);
+imgfullpath = fullfile(dir_info.folder,dir_info.name);
+
+%%
+[band_skipszlist,band_readszlist] = rangelist2skipreadsizelist(band_rangelist);
+read_opt.fill_value = fill_value;
+% valid and the statistics of the I/O plans are only computed when
+% requested.
+mex_out = cell(1,max(1,min(nargout,3)));
+valid = [];
+io_stats = [];
+
+%%
+[mex_out{:}] = lazyenvireadGLTx_multBandRaster_mex(...
+    imgfullpath,hdr,double(glt_x),double(glt_y), ...
+    band_skipszlist,band_readszlist,read_opt);
+subimg = mex_out{1};
+if numel(mex_out)>1, valid = mex_out{2}; end
+if numel(mex_out)>2, io_stats = mex_out{3}; end
+
+% the pixels without a source keep fill_value.
+has_src = glt_x>0.5 & glt_x<hdr.samples+0.5 ...
+    & glt_y>0.5 & glt_y<hdr.lines+0.5;
+[subimg,valid] = envi_replace_band_div(subimg,valid,hdr, ...
+    rangelist2ind(band_rangelist),3,read_opt,has_src);
+
+
+end
@@ -0,0 +1,91 @@
+function [spc,valid,io_stats] = lazyenvireadPixelsx_multBandRaster_mexw(imgpath,hdr,...
+   s,l,band_rangelist,varargin)
+% [spc,valid,io_stats] = lazyenvireadPixelsx_multBandRaster_mexw(imgpath,hdr,...
+%    s,l,band_rangelist,varargin)
+%   read the spectra of a list of pixels of multi-band raster image. Image
+%   needs to be stored non-compressiond binary format. The pixels are
+%   sorted by their position in the file and each distinct pixel is read
+%   once, with the reads of neighboring pixels merged.
+% INPUTS
+%   imgpath: path to the image file
+%   hdr : ENVI header struct
+%   s,l: vectors of the same length N, samples and lines of the pixels.
+%      They can be in any order and can be duplicated.
+%   band_rangelist: 2-column array, representing the selected ranges of
+%      band.
+% OUTPUTS
+%   spc: array [N x bands], the spectra in the order of the pixels given,
+%      whatever the interleave.
+%      complex data types (6 and 9) are returned as complex arrays.
+%   valid: logical array, same size as spc, false where the pixel has
+%      data_ignore_value. It is computed while reading.
+%   io_stats: struct, statistics of the I/O plans (coalesced reads), with
+%      fields n_syscalls, n_copies, bytes_read, and bytes_used.
+%
+% OPTIONAL PARAMETERS
+%   "PRECISION": char, string; data type of the output image.
+%       'raw','double', 'single','int8','int16', 'int32','int64'
+%       'uint8','uint16','uint32','uint64'
+%      if 'raw', the data is returned with the original data type of the
+%      image.
+%      (default) 'double'
+%  "Replace_data_ignore_value": boolean,
+%      whether or not to replace data_ignore_value with NaNs or not.
+%      (default) true (for single and double data types)
+%                false (for integer types)
+%  "RepVal_data_ignore_value":
+%      replaced values for the pixels with data_ignore_value.
+%      (default) nan (for double and single precisions). Need to specify
+%                for integer precisions.
+%  "COALESCE_GAP": integer, neighboring runs of the selected pixels and
+%      bands separated by no more than this many bytes are read with one
+%      read call and the wanted parts are copied out.
+%      (default) [] (64 KiB, defined in envi_v2.h)
+%  "READ_MODE": char, string; 'uring' submits the reads of the pixels to
+%      an io_uring (Linux 5.6 or later), QUEUE_DEPTH of them in flight,
+%      instead of reading them one after the other. Any other mode reads
+%      them with fread.
+%      (default) 'default'
+%  "QUEUE_DEPTH": integer, number of reads in flight in the 'uring' mode.
+%      (default) 0 (64, defined in envi_uring.h)
+%  "NUM_THREADS": not used, the pixels are read by one thread (accepted
+%      as by the other readers).
+%
+% Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
+%
+
+
+
+[read_opt,opts] = envi_read_options(hdr,varargin{:});
+if ~isempty(opts)
+    error('Unrecognized option: %s',opts{1});
+end
+
+if numel(s) ~= numel(l)
+    error('s and l need to have the same number of elements.');
+end
+
+dir_info = dir(imgpath);
+imgfullpath = fullfile(dir_info.folder,dir_info.name);
+
+%%
+[band_skipszlist,band_readszlist] = rangelist2skipreadsizelist(band_rangelist);
+% valid and the statistics of the I/O plans are only computed when
+% requested.
+mex_out = cell(1,max(1,min(nargout,3)));
+valid = [];
+io_stats = [];
+
+%%
+[mex_out{:}] = lazyenvireadPixelsx_multBandRaster_mex(...
+    imgfullpath,hdr,double(s(:)),double(l(:)), ...
+    band_skipszlist,band_readszlist,read_opt);
+spc = mex_out{1};
+if numel(mex_out)>1, valid = mex_out{2}; end
+if numel(mex_out)>2, io_stats = mex_out{3}; end
+
+[spc,valid] = envi_replace_band_div(spc,valid,hdr, ...
+    rangelist2ind(band_rangelist),2,read_opt);
+
+
+end
@@ -57,10 +57,6 @@ end
 [precision_raw,sz,iscx] = envihdr_get_precision_sizeA_from_data_type(...
     hdr.data_type);
 
-if iscx
-    error('Complex numbers are currently not supported.');
-end
-
 if strcmpi(precision,'raw')
     precision = precision_raw;
 end
@@ -86,147 +82,17 @@ dir_info = dir(imgpath);
 imgfullpath = joinPath(dir_info.folder,dir_info.name);
 
 %%
-if verLessThan('matlab','9.4') || ispc()
-    
-    need_permute = true;
-    switch hdr.data_type
-        case 1 % uint8
-            % there is no need for dealing with the endian for uint8
-            [subimg] = lazyenvireadRect_multBandRasterUint8_ltR2018a_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 2 % int16
-            [subimg] = lazyenvireadRect_multBandRasterInt16_ltR2018a_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 4 % single (float 32bit)
-            [subimg] = lazyenvireadRect_multBandRasterSingle_ltR2018a_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 12 % uint16
-            [subimg] = lazyenvireadRect_multBandRasterUint16_ltR2018a_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 16 % int8
-            [subimg] = lazyenvireadRect_multBandRasterInt8_ltR2018a_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        otherwise
-            % fprintf('Mex not implemented yet for data_type %d.\n',hdr.data_type);
-            srange = [sample_offset+1 sample_offset+samplesc];
-            lrange = [line_offset+1 line_offset+linesc];
-            brange = [band_offset+1 band_offset+bandsc];
-            switch hdr.byte_order
-                case {0}
-                    byte_order = 'ieee-le';
-                case {1}
-                    byte_order = 'ieee-be';
-                otherwise
-                    byte_order = 'n';
-            end
-            subimg = multibandread(imgfullpath, ...
-                [hdr.lines,hdr.samples,hdr.bands],...
-                [precision_raw '=>' precision_raw],...
-                hdr.header_offset,hdr.interleave, byte_order,...
-                {'Row','Range',lrange},{'Column','Range',srange},...
-                {'Band','Range',brange});
-            need_permute = false;
-    end
-else
-    need_permute = true;
-    switch hdr.data_type
-        case 1 % uint8
-            % there is no need for dealing with the endian for uint8
-            [subimg] = lazyenvireadRect_multBandRasterUint8_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 2 % int16
-            [subimg] = lazyenvireadRect_multBandRasterInt16_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 4 % single (float 32bit)
-            [subimg] = lazyenvireadRect_multBandRasterSingle_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 12 % uint16
-            [subimg] = lazyenvireadRect_multBandRasterUint16_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        case 16 % int8
-            [subimg] = lazyenvireadRect_multBandRasterInt8_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,band_offset,...
-                samplesc,linesc,bandsc);
-        otherwise
-            % fprintf('Mex not implemented yet for data_type %d.\n',hdr.data_type);
-            srange = [sample_offset+1 sample_offset+samplesc];
-            lrange = [line_offset+1 line_offset+linesc];
-            brange = [band_offset+1 band_offset+bandsc];
-            switch hdr.byte_order
-                case {0}
-                    byte_order = 'ieee-le';
-                case {1}
-                    byte_order = 'ieee-be';
-                otherwise
-                    byte_order = 'n';
-            end
-            subimg = multibandread(imgfullpath, ...
-                [hdr.lines,hdr.samples,hdr.bands],...
-                [precision_raw '=>' precision_raw],...
-                hdr.header_offset,hdr.interleave, byte_order,...
-                {'Row','Range',lrange},{'Column','Range',srange},...
-                {'Band','Range',brange});
-            need_permute = false;
-    end
+% The v2 reader supports every ENVI data_type, converts the values into 
+% an output array of precision, replaces data_ignore_value, and 
+% transposes the data into [lines x samples x bands] while reading, so
+% that the cube is never permuted nor held twice.
+srange = [sample_offset+1 sample_offset+samplesc];
+lrange = [line_offset+1 line_offset+linesc];
+brange = [band_offset+1 band_offset+bandsc];
+subimg = lazyenvireadRectxv2_multBandRaster_mexw(imgfullpath,...
+    hdr,srange,lrange,brange,'PRECISION',precision,...
+    'REPLACE_DATA_IGNORE_VALUE',rep_div,...
+    'REPVAL_DATA_IGNORE_VALUE',repval_div);
 
-end
 
-% permute the image based on interleave option.
-if need_permute
-    switch lower(hdr.interleave)
-        case {'bsq'}
-            % subimg = reshape(subimg,[samplesc,linesc,bandsc]);
-            subimg = permute(subimg,[2,1,3]);
-        case {'bil'}
-            % subimg = reshape(subimg,[samplesc,bandsc,linesc]);
-            subimg = permute(subimg,[3,1,2]);
-        case {'bip'}
-            % subimg = reshape(subimg,[bandsc,samplesc,linesc]);
-            subimg = permute(subimg,[3,2,1]);
-    end
 end
-
-switch lower(precision)
-    case 'double'
-        subimg = double(subimg);
-    case 'single'
-        subimg = single(subimg);
-    case 'int8'
-        subimg = int8(subimg);
-    case 'int16'
-        subimg = int16(subimg);
-    case 'int32'
-        subimg = int32(subimg);
-    case 'int64'
-        subimg = int64(subimg);
-    case 'uint8'
-        subimg = uint8(subimg);
-    case 'uint16'
-        subimg = uint16(subimg);
-    case 'uint32'
-        subimg = uint32(subimg);
-    case 'uint64'
-        subimg = uint64(subimg);
-    case 'raw'
-        % not changing data_type
-    otherwise
-        error('Undefined precision %d',precision);
-end
-
-if rep_div && isfield(hdr,'data_ignore_value')
-    div = cast(hdr.data_ignore_value,class(subimg));
-    repval_div = cast(repval_div,class(subimg));
-    subimg(subimg==div) = repval_div;
-end
-
-
-end
\ No newline at end of file
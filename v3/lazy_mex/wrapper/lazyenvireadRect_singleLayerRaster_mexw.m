@@ -56,10 +56,6 @@ end
 [precision_raw,sz,iscx] = envihdr_get_precision_sizeA_from_data_type(...
     hdr.data_type);
 
-if iscx
-    error('Complex numbers are currently not supported.');
-end
-
 if strcmpi(precision,'raw')
     precision = precision_raw;
 end
@@ -85,101 +81,15 @@ dir_info = dir(imgpath);
 imgfullpath = joinPath(dir_info.folder,dir_info.name);
 
 %%
-if verLessThan('matlab','9.4') || ispc()
-    srange = [sample_offset+1 sample_offset+samplesc];
-    lrange = [line_offset+1 line_offset+linesc];
-    switch hdr.byte_order
-        case {0}
-            byte_order = 'ieee-le';
-        case {1}
-            byte_order = 'ieee-be';
-        otherwise
-            byte_order = 'n';
-    end
-    subimg = multibandread(imgfullpath, ...
-        [hdr.lines,hdr.samples,hdr.bands],...
-        [precision_raw '=>' precision_raw],...
-        hdr.header_offset,hdr.interleave, byte_order,...
-        {'Row','Range',lrange},{'Column','Range',srange});
-    need_transpose = false;
-else
-    need_transpose = true;
-    switch hdr.data_type
-        case 1 % uint8
-            % there is no need for dealing with the endian for uint8
-            [subimg] = lazyenvireadRect_singleLayerRasterUint8_mex(...
-                imgfullpath,hdr,sample_offset,line_offset,samplesc,linesc);
-        case 2 % int16
-            [subimg] = lazyenvireadRect_singleLayerRasterInt16_mex(...
-                        imgfullpath,hdr,sample_offset,line_offset,samplesc,linesc);
-        case 4 % single (float 32bit)
-            [subimg] = lazyenvireadRect_singleLayerRasterSingle_mex(...
-                        imgfullpath,hdr,sample_offset,line_offset,samplesc,linesc);
-            % subimg = reshape(subimg,[samplesc,linesc]);
-        case 12 % uint16 
-            [subimg] = lazyenvireadRect_singleLayerRasterUint16_mex(...
-                        imgfullpath,hdr,sample_offset,line_offset,samplesc,linesc);
-        case 16 % int8 
-            [subimg] = lazyenvireadRect_singleLayerRasterInt8_mex(...
-                        imgfullpath,hdr,sample_offset,line_offset,samplesc,linesc);
-        otherwise
-            srange = [sample_offset+1 sample_offset+samplesc];
-            lrange = [line_offset+1 line_offset+linesc];
-            switch hdr.byte_order
-                case {0}
-                    byte_order = 'ieee-le';
-                case {1}
-                    byte_order = 'ieee-be';
-                otherwise
-                    byte_order = 'n';
-            end
-            subimg = multibandread(imgfullpath, ...
-                [hdr.lines,hdr.samples,hdr.bands],...
-                [precision_raw '=>' precision_raw],...
-                hdr.header_offset,hdr.interleave, byte_order,...
-                {'Row','Range',lrange},{'Column','Range',srange});
-            need_transpose = false;
-    end
-
-end
+% The v2 reader supports every ENVI data_type, converts the values into 
+% an output array of precision and replaces data_ignore_value while 
+% reading, so the layer is never transposed nor cast afterwards.
+srange = [sample_offset+1 sample_offset+samplesc];
+lrange = [line_offset+1 line_offset+linesc];
+subimg = lazyenvireadRectxv2_multBandRaster_mexw(imgfullpath,...
+    hdr,srange,lrange,[1 1],'PRECISION',precision,...
+    'REPLACE_DATA_IGNORE_VALUE',rep_div,...
+    'REPVAL_DATA_IGNORE_VALUE',repval_div);
 
-% transpose image. Transposed image was read because it's faster.
-if need_transpose
-    subimg = subimg';
-end
 
-switch lower(precision)
-    case 'double'
-        subimg = double(subimg);
-    case 'single'
-        subimg = single(subimg);
-    case 'int8'
-        subimg = int8(subimg);
-    case 'int16'
-        subimg = int16(subimg);
-    case 'int32'
-        subimg = int32(subimg);
-    case 'int64'
-        subimg = int64(subimg);
-    case 'uint8'
-        subimg = uint8(subimg);
-    case 'uint16'
-        subimg = uint16(subimg);
-    case 'uint32'
-        subimg = uint32(subimg);
-    case 'uint64'
-        subimg = uint64(subimg);
-    case 'raw'
-        % not changing data_type
-    otherwise
-        error('Undefined precision %d',precision);
 end
-
-if rep_div && isfield(hdr,'data_ignore_value')
-    div = cast(hdr.data_ignore_value,class(subimg));
-    repval_div = cast(repval_div,class(subimg));
-    subimg(subimg==div) = repval_div;
-end
-
-
-end
\ No newline at end of file
@@ -1,4 +1,4 @@
-function [subimg] = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
+function [subimg,valid,io_stats] = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
    sample_rangelist,line_rangelist,band_rangelist,varargin)
 % [subimg] = lazyenvireadRectx_multBandRaster_mexw(imgpath,hdr,...
 %    sample_rangelist,line_rangelist,band_rangelist,varargin)
@@ -11,7 +11,13 @@ function [subimg] = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
 %      2-column array, representing the selected ranges of sample, line,
 %      band.
 % OUTPUTS
-%   subimg: array [ x x ]
+%   subimg: array [lines x samples x bands], whatever the interleave. 
+%      The MEX function writes it in this layout directly.
+%      complex data types (6 and 9) are returned as complex arrays.
+%   valid: logical array, same size as subimg, false where the pixel has
+%      data_ignore_value. It is computed while reading.
+%   io_stats: struct, statistics of the I/O plan (coalesced reads), with
+%      fields n_syscalls, n_copies, bytes_read, and bytes_used.
 % 
 % OPTIONAL PARAMETERS
 %   "PRECISION": char, string; data type of the output image.
@@ -28,60 +34,60 @@ function [subimg] = lazyenvireadRectxv2_multBandRaster_mexw(imgpath,hdr,...
 %      replaced values for the pixels with data_ignore_value.
 %      (default) nan (for double and single precisions). Need to specify 
 %                for integer precisions.
+%  "READ_MODE": char, string; back-end used to read the file.
+%      'fread': read whole planes with fread and copy the selected part.
+%      'mmap' : memory-map the file and copy the selected part directly.
+%      'pread': split the bands (BSQ) or lines (BIL/BIP) across threads,
+%               each reading its share with pread.
+%      'uring': submit all the reads to an io_uring (Linux 5.6 or later)
+%               at once, QUEUE_DEPTH of them in flight, for random
+%               reads on SSDs. Falls back to 'pread' where io_uring is
+%               not available.
+%      'direct': stream the reads with O_DIRECT through double-buffered
+%               aligned windows, bypassing the page cache, for scans of
+%               whole cubes that are not read again (batch jobs). Falls
+%               back to reads dropped from the page cache where the file
+%               system rejects O_DIRECT.
+%      'default': 'pread' while the block cache is enabled (see
+%                 envi_block_cache), else 'mmap' on Linux, 'fread'
+%                 otherwise. Only 'pread' and 'uring' read through the
+%                 cache.
+%      (default) 'default'
+%  "NUM_THREADS": integer, number of threads used by the 'pread' mode.
+%      0 uses the number of available processors.
+%      (default) 0
+%  "QUEUE_DEPTH": integer, number of reads in flight in the 'uring' mode.
+%      0 uses the default (64, defined in envi_uring.h).
+%      (default) 0
+%  "COALESCE_GAP": integer, neighboring runs of the selected samples,
+%      lines, and bands separated by no more than this many bytes are
+%      read with one read call and the wanted parts are copied out.
+%      (default) [] (64 KiB, defined in envi_v2.h)
+%  "BAND_INDEX": vector, bands of subimg given as indices into the bands
+%      selected by band_rangelist, in any order and possibly duplicated.
+%      Each selected band is read once and written to every band of 
+%      subimg requesting it. Every selected band needs to be requested.
+%      (default) [] (the selected bands in file order)
 % 
+% See envi_read_plan for a window read again and again, and
+% envi_tile_iterator for a whole image read in tiles of bounded size.
+%
 % Copyright (C) 2022 Yuki Itoh <yukiitohand@gmail.com>
 % 
 
 
 
-precision  = 'double';
-rep_div    = [];
-repval_div = [];
-if (rem(length(varargin),2)==1)
-    error('Optional parameters should always go by pairs');
-else
-    for i=1:2:(length(varargin)-1)
-        switch upper(varargin{i})
-            case 'PRECISION'
-                precision = varargin{i+1};
-            case 'REPLACE_DATA_IGNORE_VALUE'
-                rep_div = varargin{i+1};
-            case 'REPVAL_DATA_IGNORE_VALUE'
-                repval_div = varargin{i+1};
-            otherwise
-                error('Unrecognized option: %s',varargin{i});
-        end
+[read_opt,opts] = envi_read_options(hdr,varargin{:});
+band_index = [];
+for i=1:2:(length(opts)-1)
+    switch upper(opts{i})
+        case 'BAND_INDEX'
+            band_index = opts{i+1};
+        otherwise
+            error('Unrecognized option: %s',opts{i});
     end
 end
 
-[precision_raw,sz,iscx] = envihdr_get_precision_sizeA_from_data_type(...
-    hdr.data_type);
-
-if iscx
-    error('Complex numbers are currently not supported.');
-end
-
-if strcmpi(precision,'raw')
-    precision = precision_raw;
-end
-
-switch lower(precision)
-    case {'single','double'}
-        if isempty(rep_div), rep_div = true; end
-        if rep_div && isempty(repval_div), repval_div = nan; end
-    case {'uint8','uint16','uint32','uint64','int8','int16','int32','int64'}
-        if isempty(rep_div), rep_div = false; end
-        if rep_div && isempty(repval_div)
-            fprintf(...
-                ['With integer precision, explicitly specify '
-                 '"REPVAL_DATA_IGNORE_VALUE"\n']...
-              );
-            rep_div = false;
-        end
-    otherwise
-        error('Not implemented yet for data_type %s.',precision);
-end
-
 dir_info = dir(imgpath);
 imgfullpath = fullfile(dir_info.folder,dir_info.name);
 
@@ -89,124 +95,31 @@ imgfullpath = fullfile(dir_info.folder,dir_info.name);
 [sample_skipszlist,sample_readszlist] = rangelist2skipreadsizelist(sample_rangelist);
 [line_skipszlist,line_readszlist] = rangelist2skipreadsizelist(line_rangelist);
 [band_skipszlist,band_readszlist] = rangelist2skipreadsizelist(band_rangelist);
+% the values are converted to precision inside the MEX function, so that
+% the cube is never allocated in its raw data type. A scalar 
+% data_ignore_value is also replaced there while the values are copied.
+read_opt.band_index = double(band_index(:));
+% valid and the statistics of the I/O plan are only computed when 
+% requested.
+mex_out = cell(1,max(1,min(nargout,3)));
+valid = [];
+io_stats = [];
 
 %%
-if ispc()
-else
-    if verLessThan('matlab','9.4')
-        need_permute = true;
-        switch hdr.data_type
-            case {1 2 4 12 16} % uint8 int16 single (float 32bit) uint16 int8
-                [subimg] = lazyenvireadRectxv2_multBandRaster_mex(...
-                    imgfullpath,hdr,sample_skipszlist,sample_readszlist, ...
-                    line_skipszlist,line_readszlist, ...
-                    band_skipszlist,band_readszlist);
-            otherwise
-                fprintf('Mex not implemented yet for data_type %d.\n',hdr.data_type);
-                % sindxes = 
-                % lindxes = ;
-                % bindxes = ;
-    %             switch hdr.byte_order
-    %                 case {0}
-    %                     byte_order = 'ieee-le';
-    %                 case {1}
-    %                     byte_order = 'ieee-be';
-    %                 otherwise
-    %                     byte_order = 'n';
-    %             end
-    %             subimg = multibandread(imgfullpath, ...
-    %                 [hdr.lines,hdr.samples,hdr.bands],...
-    %                 [precision_raw '=>' precision_raw],...
-    %                 hdr.header_offset,hdr.interleave, byte_order,...
-    %                 {'Row','Direct',lrange},{'Column','Direct',srange},...
-    %                 {'Band','Direct',brange});
-    %             need_permute = false;
-        end
-    else
-        need_permute = true;
-        switch hdr.data_type
-            case {1 2 4 12 16} % uint8 int16 single (float 32bit) uint16 int8
-                [subimg] = lazyenvireadRectxv2_multBandRaster_mex(...
-                    imgfullpath,hdr,sample_skipszlist,sample_readszlist, ...
-                    line_skipszlist,line_readszlist, ...
-                    band_skipszlist,band_readszlist);
-            otherwise
-                fprintf('Mex not implemented yet for data_type %d.\n',hdr.data_type);
-                % sindxes = 
-                % lindxes = ;
-                % bindxes = ;
-    %             switch hdr.byte_order
-    %                 case {0}
-    %                     byte_order = 'ieee-le';
-    %                 case {1}
-    %                     byte_order = 'ieee-be';
-    %                 otherwise
-    %                     byte_order = 'n';
-    %             end
-    %             subimg = multibandread(imgfullpath, ...
-    %                 [hdr.lines,hdr.samples,hdr.bands],...
-    %                 [precision_raw '=>' precision_raw],...
-    %                 hdr.header_offset,hdr.interleave, byte_order,...
-    %                 {'Row','Direct',lrange},{'Column','Direct',srange},...
-    %                 {'Band','Direct',brange});
-    %             need_permute = false;
-        end
-    
-    end
-    
-    % permute the image based on interleave option.
-    if need_permute
-        switch lower(hdr.interleave)
-            case {'bsq'}
-                % subimg = reshape(subimg,[samplesc,linesc,bandsc]);
-                subimg = permute(subimg,[2,1,3]);
-            case {'bil'}
-                % subimg = reshape(subimg,[samplesc,bandsc,linesc]);
-                subimg = permute(subimg,[3,1,2]);
-            case {'bip'}
-                % subimg = reshape(subimg,[bandsc,samplesc,linesc]);
-                subimg = permute(subimg,[3,2,1]);
-        end
-    end
-end
+% every ENVI data_type is read natively. Complex data are returned as
+% complex arrays. The output needs no permutation.
+[mex_out{:}] = lazyenvireadRectxv2_multBandRaster_mex(...
+    imgfullpath,hdr,sample_skipszlist,sample_readszlist, ...
+    line_skipszlist,line_readszlist, ...
+    band_skipszlist,band_readszlist,read_opt);
+subimg = mex_out{1};
+if numel(mex_out)>1, valid = mex_out{2}; end
+if numel(mex_out)>2, io_stats = mex_out{3}; end
 
-switch lower(precision)
-    case 'double'
-        subimg = double(subimg);
-    case 'single'
-        subimg = single(subimg);
-    case 'int8'
-        subimg = int8(subimg);
-    case 'int16'
-        subimg = int16(subimg);
-    case 'int32'
-        subimg = int32(subimg);
-    case 'int64'
-        subimg = int64(subimg);
-    case 'uint8'
-        subimg = uint8(subimg);
-    case 'uint16'
-        subimg = uint16(subimg);
-    case 'uint32'
-        subimg = uint32(subimg);
-    case 'uint64'
-        subimg = uint64(subimg);
-    case 'raw'
-        % not changing data_type
-    otherwise
-        error('Undefined precision %d',precision);
-end
-
-if rep_div && isfield(hdr,'data_ignore_value')
-    div = cast(hdr.data_ignore_value,class(subimg));
-    repval_div = cast(repval_div,class(subimg));
-    if numel(hdr.data_ignore_value) == 1
-       subimg(subimg==div) = repval_div;
-    elseif numel(hdr.data_ignore_value) == hdr.bands
-        div = reshape(div,1,1,hdr.bands);
-        subimg(subimg==div) = repval_div;
-    end
-end
+bands_out = rangelist2ind(band_rangelist);
+if ~isempty(band_index), bands_out = bands_out(band_index); end
+[subimg,valid] = envi_replace_band_div(subimg,valid,hdr,bands_out,3, ...
+    read_opt);
 
 
 end
\ No newline at end of file